@@ -0,0 +1,931 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "render.h"
+#include "ENGINE/jobs.h"
+#include <string>
+#include <chrono>
+
+//Skeletal animation with GPU skinning.
+//
+//Skeletons and clips are pulled out of the Assimp scene when a model is loaded.
+//Every clip is resampled at ANIMATION_SAMPLE_RATE so that sampling is an index
+//instead of a key search, then quantized:
+//		rotation     4 x i16 per bone, kept in one hemisphere from frame to frame
+//		translation  3 x u16 per bone, relative to the bounds of the whole clip
+//		scale        3 x u16 per bone, the same way
+//The bones of a frame are stored in groups of four, component by component, so
+//four bones decode, nlerp, blend and turn into matrices together in SSE.
+//
+//Every instance of a skeleton writes its skinning matrices into one shared
+//palette. The instances are updated across the job system, the palette goes to
+//the GPU as a buffer texture and skinned.vert blends up to four bones per vertex.
+//
+//Files without bones, like the OBJ pirates, get a small sway rig built from
+//their bounds, with procedural idle and haul clips, so they still move.
+//
+//		SkinnedModel pirate = load_skinned_model("data/models/pirate_crew.obj");
+//		Animator animator = create_animator();
+//		u32 crew = add_animation_instance(&animator, &pirate, 0);
+//		update_animations(&animator, dt);
+//		upload_animations(&animator);
+//		bind_animations(&animator, skinned, 6);
+//		draw_skinned_model(skinned, &pirate, &animator, crew);
+
+#define MAX_BONES                64
+#define MAX_BONE_GROUPS          (MAX_BONES / 4)
+#define ANIMATION_SAMPLE_RATE    30.0f
+#define QUATERNION_SCALE         32767.0f
+
+struct BonePose {
+    Quaternion rotation;
+    vec3 translation;
+    vec3 scale;
+};
+
+struct Skeleton {
+    u32 boneCount;
+    //parents always come before their children, the root has -1
+    std::vector<i32> parents;
+    std::vector<std::string> names;
+    std::vector<mat4> inverseBind;
+    //pose of the bones a clip does not animate
+    std::vector<BonePose> rest;
+    //undoes the transform of the root node, folded into the root bone
+    mat4 globalInverse;
+};
+
+struct AnimationClip {
+    std::string name;
+    f32 duration;
+    u32 frameCount;
+    u32 groupCount;
+
+    //[frame][group][component][lane]
+    std::vector<i16> rotations;
+    std::vector<u16> translations;
+    std::vector<u16> scales;
+    vec3 translationMin;
+    vec3 translationStep;
+    vec3 scaleMin;
+    vec3 scaleStep;
+};
+
+struct SkinnedModel {
+    Model model;
+    Skeleton skeleton;
+    std::vector<AnimationClip> clips;
+    //bone indices and weights of every mesh, attributes 3 and 4 of its vao
+    std::vector<GLuint> boneBuffers;
+
+    //bind pose of all meshes back to back, kept for baking vertex animation textures
+    std::vector<Vertex> bindVertices;
+    std::vector<u8> bindBones;
+    std::vector<vec4> bindColors;
+    std::vector<u32> bindIndices;
+};
+
+struct AnimationInstance {
+    const SkinnedModel* skinned;
+    u32 clip;
+    f32 time;
+    //second clip blended on top, weight 0 turns the blend off
+    u32 blendClip;
+    f32 blendTime;
+    f32 blendWeight;
+    f32 speed;
+    //first matrix of this instance in the palette
+    u32 boneOffset;
+};
+
+struct Animator {
+    std::vector<AnimationInstance> instances;
+    std::vector<mat4> palette;
+    GLuint buffer;
+    GLuint texture;
+};
+
+static inline
+mat4 ai_to_mat4(const aiMatrix4x4& m) {
+    //assimp is row major
+    mat4 result;
+    result.elements[0] = m.a1; result.elements[4] = m.a2; result.elements[8] = m.a3;  result.elements[12] = m.a4;
+    result.elements[1] = m.b1; result.elements[5] = m.b2; result.elements[9] = m.b3;  result.elements[13] = m.b4;
+    result.elements[2] = m.c1; result.elements[6] = m.c2; result.elements[10] = m.c3; result.elements[14] = m.c4;
+    result.elements[3] = m.d1; result.elements[7] = m.d2; result.elements[11] = m.d3; result.elements[15] = m.d4;
+    return result;
+}
+
+static inline
+BonePose rest_bone_pose() {
+    BonePose pose;
+    pose.rotation.x = pose.rotation.y = pose.rotation.z = 0.0f;
+    pose.rotation.w = 1.0f;
+    pose.translation = V3(0, 0, 0);
+    pose.scale = V3(1, 1, 1);
+    return pose;
+}
+
+static inline
+Quaternion axis_angle_quaternion(vec3 axis, f32 degrees) {
+    f32 half = deg_to_rad(degrees) * 0.5f;
+    Quaternion q;
+    q.x = axis.x * sinf(half);
+    q.y = axis.y * sinf(half);
+    q.z = axis.z * sinf(half);
+    q.w = cosf(half);
+    return q;
+}
+
+//the local matrix of a pose, translation * rotation * scale
+static inline
+mat4 bone_pose_matrix(const BonePose& pose) {
+    const Quaternion& q = pose.rotation;
+    mat4 m = identity();
+    m.elements[0] = (1 - 2 * (q.y * q.y + q.z * q.z)) * pose.scale.x;
+    m.elements[1] = (2 * (q.x * q.y + q.w * q.z)) * pose.scale.x;
+    m.elements[2] = (2 * (q.x * q.z - q.w * q.y)) * pose.scale.x;
+    m.elements[4] = (2 * (q.x * q.y - q.w * q.z)) * pose.scale.y;
+    m.elements[5] = (1 - 2 * (q.x * q.x + q.z * q.z)) * pose.scale.y;
+    m.elements[6] = (2 * (q.y * q.z + q.w * q.x)) * pose.scale.y;
+    m.elements[8] = (2 * (q.x * q.z + q.w * q.y)) * pose.scale.z;
+    m.elements[9] = (2 * (q.y * q.z - q.w * q.x)) * pose.scale.z;
+    m.elements[10] = (1 - 2 * (q.x * q.x + q.y * q.y)) * pose.scale.z;
+    m.elements[12] = pose.translation.x;
+    m.elements[13] = pose.translation.y;
+    m.elements[14] = pose.translation.z;
+    return m;
+}
+
+//==========================================================================================
+//Description: Quantizes a clip that has already been sampled at ANIMATION_SAMPLE_RATE
+//
+//Parameters:
+//		-Name the clip is looked up by
+//		-Bones of the skeleton it animates
+//		-Number of frames, the last one is the pose at the duration
+//		-Poses as [frame * boneCount + bone]
+//==========================================================================================
+static inline
+AnimationClip build_animation_clip(const char* name, u32 boneCount, u32 frameCount, const BonePose* poses) {
+    AnimationClip clip;
+    clip.name = name;
+    clip.frameCount = frameCount;
+    clip.duration = (frameCount - 1) / ANIMATION_SAMPLE_RATE;
+    clip.groupCount = (boneCount + 3) / 4;
+
+    vec3 tMin = V3(FLT_MAX, FLT_MAX, FLT_MAX), tMax = V3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    vec3 sMin = V3(FLT_MAX, FLT_MAX, FLT_MAX), sMax = V3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(u32 i = 0; i < frameCount * boneCount; ++i) {
+        for(u32 c = 0; c < 3; ++c) {
+            tMin.e[c] = fminf(tMin.e[c], poses[i].translation.e[c]);
+            tMax.e[c] = fmaxf(tMax.e[c], poses[i].translation.e[c]);
+            sMin.e[c] = fminf(sMin.e[c], poses[i].scale.e[c]);
+            sMax.e[c] = fmaxf(sMax.e[c], poses[i].scale.e[c]);
+        }
+    }
+    clip.translationMin = tMin;
+    clip.scaleMin = sMin;
+    for(u32 c = 0; c < 3; ++c) {
+        clip.translationStep.e[c] = fmaxf(tMax.e[c] - tMin.e[c], 0.000001f) / 65535.0f;
+        clip.scaleStep.e[c] = fmaxf(sMax.e[c] - sMin.e[c], 0.000001f) / 65535.0f;
+    }
+
+    clip.rotations.resize(frameCount * clip.groupCount * 16);
+    clip.translations.resize(frameCount * clip.groupCount * 12);
+    clip.scales.resize(frameCount * clip.groupCount * 12);
+    std::vector<Quaternion> previous(boneCount);
+    for(u32 f = 0; f < frameCount; ++f) {
+        for(u32 b = 0; b < clip.groupCount * 4; ++b) {
+            BonePose pose = b < boneCount ? poses[f * boneCount + b] : rest_bone_pose();
+            Quaternion q = pose.rotation;
+            f32 len = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+            for(u32 c = 0; c < 4; ++c)
+                q.e[c] /= len;
+            //keep neighbouring frames in the same hemisphere so nlerp takes the short way
+            if(b < boneCount) {
+                if(f > 0 && q.x * previous[b].x + q.y * previous[b].y + q.z * previous[b].z + q.w * previous[b].w < 0)
+                    for(u32 c = 0; c < 4; ++c)
+                        q.e[c] = -q.e[c];
+                previous[b] = q;
+            }
+
+            u32 group = f * clip.groupCount + b / 4;
+            u32 lane = b % 4;
+            for(u32 c = 0; c < 4; ++c)
+                clip.rotations[group * 16 + c * 4 + lane] = (i16)roundf(q.e[c] * QUATERNION_SCALE);
+            for(u32 c = 0; c < 3; ++c) {
+                clip.translations[group * 12 + c * 4 + lane] = (u16)roundf(fminf(fmaxf((pose.translation.e[c] - tMin.e[c]) / clip.translationStep.e[c], 0.0f), 65535.0f));
+                clip.scales[group * 12 + c * 4 + lane] = (u16)roundf(fminf(fmaxf((pose.scale.e[c] - sMin.e[c]) / clip.scaleStep.e[c], 0.0f), 65535.0f));
+            }
+        }
+    }
+    return clip;
+}
+
+static inline
+const aiNodeAnim* find_channel(const aiAnimation* animation, const std::string& name) {
+    for(u32 i = 0; i < animation->mNumChannels; ++i)
+        if(name == animation->mChannels[i]->mNodeName.C_Str())
+            return animation->mChannels[i];
+    return NULL;
+}
+
+static inline
+aiVector3D sample_vector_keys(const aiVectorKey* keys, u32 count, f64 ticks) {
+    if(count == 1 || ticks <= keys[0].mTime)
+        return keys[0].mValue;
+    for(u32 i = 0; i + 1 < count; ++i) {
+        if(ticks < keys[i + 1].mTime) {
+            f32 t = (f32)((ticks - keys[i].mTime) / (keys[i + 1].mTime - keys[i].mTime));
+            return keys[i].mValue + (keys[i + 1].mValue - keys[i].mValue) * t;
+        }
+    }
+    return keys[count - 1].mValue;
+}
+
+static inline
+aiQuaternion sample_rotation_keys(const aiQuatKey* keys, u32 count, f64 ticks) {
+    if(count == 1 || ticks <= keys[0].mTime)
+        return keys[0].mValue;
+    for(u32 i = 0; i + 1 < count; ++i) {
+        if(ticks < keys[i + 1].mTime) {
+            f32 t = (f32)((ticks - keys[i].mTime) / (keys[i + 1].mTime - keys[i].mTime));
+            aiQuaternion result;
+            aiQuaternion::Interpolate(result, keys[i].mValue, keys[i + 1].mValue, t);
+            return result;
+        }
+    }
+    return keys[count - 1].mValue;
+}
+
+//resamples an assimp animation at ANIMATION_SAMPLE_RATE, bones without a channel keep their rest pose
+static inline
+AnimationClip load_animation_clip(const Skeleton* skeleton, const aiAnimation* animation) {
+    f64 ticksPerSecond = animation->mTicksPerSecond > 0 ? animation->mTicksPerSecond : 25.0;
+    f64 duration = animation->mDuration / ticksPerSecond;
+    u32 frameCount = (u32)ceil(duration * ANIMATION_SAMPLE_RATE) + 1;
+    if(frameCount < 2)
+        frameCount = 2;
+
+    std::vector<const aiNodeAnim*> channels(skeleton->boneCount);
+    for(u32 b = 0; b < skeleton->boneCount; ++b)
+        channels[b] = find_channel(animation, skeleton->names[b]);
+
+    std::vector<BonePose> poses(frameCount * skeleton->boneCount);
+    for(u32 f = 0; f < frameCount; ++f) {
+        f64 ticks = fmin(f / ANIMATION_SAMPLE_RATE, duration) * ticksPerSecond;
+        for(u32 b = 0; b < skeleton->boneCount; ++b) {
+            BonePose& pose = poses[f * skeleton->boneCount + b];
+            pose = skeleton->rest[b];
+            const aiNodeAnim* channel = channels[b];
+            if(channel == NULL)
+                continue;
+            if(channel->mNumPositionKeys) {
+                aiVector3D p = sample_vector_keys(channel->mPositionKeys, channel->mNumPositionKeys, ticks);
+                pose.translation = V3(p.x, p.y, p.z);
+            }
+            if(channel->mNumRotationKeys) {
+                aiQuaternion q = sample_rotation_keys(channel->mRotationKeys, channel->mNumRotationKeys, ticks);
+                pose.rotation.x = q.x; pose.rotation.y = q.y; pose.rotation.z = q.z; pose.rotation.w = q.w;
+            }
+            if(channel->mNumScalingKeys) {
+                aiVector3D s = sample_vector_keys(channel->mScalingKeys, channel->mNumScalingKeys, ticks);
+                pose.scale = V3(s.x, s.y, s.z);
+            }
+        }
+    }
+    return build_animation_clip(animation->mName.length ? animation->mName.C_Str() : "clip", skeleton->boneCount, frameCount, &poses[0]);
+}
+
+//adds a node and everything below it, parents first
+static inline
+void add_skeleton_node(Skeleton* skeleton, const aiNode* node, i32 parent) {
+    if(skeleton->boneCount == MAX_BONES) {
+        BMT_LOG(WARNING, "Skeleton has more than %d nodes, [%s] and its children are not animated", MAX_BONES, node->mName.C_Str());
+        return;
+    }
+    aiVector3D scaling, position;
+    aiQuaternion rotation;
+    node->mTransformation.Decompose(scaling, rotation, position);
+    BonePose pose;
+    pose.rotation.x = rotation.x; pose.rotation.y = rotation.y; pose.rotation.z = rotation.z; pose.rotation.w = rotation.w;
+    pose.translation = V3(position.x, position.y, position.z);
+    pose.scale = V3(scaling.x, scaling.y, scaling.z);
+
+    i32 index = skeleton->boneCount++;
+    skeleton->parents.push_back(parent);
+    skeleton->names.push_back(node->mName.C_Str());
+    skeleton->inverseBind.push_back(identity());
+    skeleton->rest.push_back(pose);
+    for(u32 i = 0; i < node->mNumChildren; ++i)
+        add_skeleton_node(skeleton, node->mChildren[i], index);
+}
+
+static inline
+i32 find_bone(const Skeleton* skeleton, const char* name) {
+    for(u32 b = 0; b < skeleton->boneCount; ++b)
+        if(skeleton->names[b] == name)
+            return b;
+    return -1;
+}
+
+//slots a weight into the four of a vertex, replacing the smallest once they are full
+static inline
+void add_bone_weight(u8* bones, f32* weights, u32 bone, f32 weight) {
+    u32 smallest = 0;
+    for(u32 i = 1; i < 4; ++i)
+        if(weights[i] < weights[smallest])
+            smallest = i;
+    if(weight > weights[smallest]) {
+        bones[smallest] = (u8)bone;
+        weights[smallest] = weight;
+    }
+}
+
+//==========================================================================================
+//Description: Builds a hips, chest and head rig from the bounds of a model without bones
+//
+//Comments: Vertices are weighted by their height, blending across a band around every
+//          joint. Adds an "idle" sway and a "haul" clip.
+//==========================================================================================
+static inline
+void build_sway_rig(SkinnedModel* skinned) {
+    Skeleton* skeleton = &skinned->skeleton;
+    vec3 boundsMin = skinned->model.boundsMin;
+    vec3 boundsMax = skinned->model.boundsMax;
+    f32 height = boundsMax.y - boundsMin.y;
+    vec3 center = V3((boundsMin.x + boundsMax.x) * 0.5f, boundsMin.y, (boundsMin.z + boundsMax.z) * 0.5f);
+    //joint heights as a fraction of the model
+    const f32 joints[] = {0.0f, 0.45f, 0.7f, 0.85f};
+    const char* names[] = {"root", "hips", "chest", "head"};
+
+    for(u32 b = 0; b < 4; ++b) {
+        BonePose pose = rest_bone_pose();
+        pose.translation = b == 0 ? center : V3(0, (joints[b] - joints[b - 1]) * height, 0);
+        skeleton->parents.push_back((i32)b - 1);
+        skeleton->names.push_back(names[b]);
+        skeleton->rest.push_back(pose);
+        skeleton->inverseBind.push_back(translation(-center.x, -(boundsMin.y + joints[b] * height), -center.z));
+    }
+    skeleton->boneCount = 4;
+    skeleton->globalInverse = identity();
+
+    //two second loops, the first and last frame are the same pose
+    u32 frameCount = (u32)(2.0f * ANIMATION_SAMPLE_RATE) + 1;
+    std::vector<BonePose> poses(frameCount * 4);
+    for(u32 clip = 0; clip < 2; ++clip) {
+        for(u32 f = 0; f < frameCount; ++f) {
+            f32 phase = 2.0f * PI * f / (frameCount - 1);
+            for(u32 b = 0; b < 4; ++b)
+                poses[f * 4 + b] = skeleton->rest[b];
+            if(clip == 0) {
+                poses[f * 4 + 1].translation.y += sinf(phase * 2.0f) * 0.01f * height;
+                poses[f * 4 + 2].rotation = axis_angle_quaternion(V3(0, 0, 1), sinf(phase) * 6.0f);
+                poses[f * 4 + 3].rotation = axis_angle_quaternion(V3(1, 0, 0), sinf(phase * 2.0f) * 8.0f);
+            }
+            else {
+                poses[f * 4 + 1].rotation = axis_angle_quaternion(V3(0, 1, 0), sinf(phase) * 10.0f);
+                poses[f * 4 + 2].rotation = axis_angle_quaternion(V3(1, 0, 0), 15.0f + sinf(phase * 2.0f) * 20.0f);
+                poses[f * 4 + 3].rotation = axis_angle_quaternion(V3(1, 0, 0), -10.0f - sinf(phase * 2.0f) * 10.0f);
+            }
+        }
+        skinned->clips.push_back(build_animation_clip(clip == 0 ? "idle" : "haul", 4, frameCount, &poses[0]));
+    }
+}
+
+static inline
+f32 sway_rig_weight(f32 height, u32 bone) {
+    const f32 joints[] = {0.0f, 0.45f, 0.7f, 0.85f, 2.0f};
+    const f32 band = 0.05f;
+    f32 below = fminf(fmaxf((height - joints[bone] + band) / (2 * band), 0.0f), 1.0f);
+    f32 above = bone == 3 ? 0.0f : fminf(fmaxf((height - joints[bone + 1] + band) / (2 * band), 0.0f), 1.0f);
+    return bone == 0 ? 1.0f - above : below - above;
+}
+
+//==========================================================================================
+//Description: Loads a model with its skeleton and every animation in the file
+//
+//Comments: Files without bones get the sway rig of build_sway_rig. Bone indices and weights
+//          go into a second buffer of every mesh, so draw_model still works for it.
+//==========================================================================================
+static inline
+SkinnedModel load_skinned_model(const char* filename) {
+    BMT_PROFILE_FUNCTION();
+    SkinnedModel skinned;
+    skinned.skeleton.boneCount = 0;
+
+    Assimp::Importer importer;
+    const aiScene* pScene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_GenNormals | aiProcess_LimitBoneWeights);
+    skinned.model = load_model_from_scene(pScene, filename);
+    if(pScene == NULL)
+        return skinned;
+
+    bool hasBones = false;
+    for(u32 m = 0; m < pScene->mNumMeshes; ++m)
+        hasBones |= pScene->mMeshes[m]->HasBones();
+
+    Skeleton* skeleton = &skinned.skeleton;
+    if(hasBones) {
+        add_skeleton_node(skeleton, pScene->mRootNode, -1);
+        skeleton->globalInverse = inverse(ai_to_mat4(pScene->mRootNode->mTransformation));
+        for(u32 m = 0; m < pScene->mNumMeshes; ++m) {
+            const aiMesh* paiMesh = pScene->mMeshes[m];
+            for(u32 b = 0; b < paiMesh->mNumBones; ++b) {
+                i32 bone = find_bone(skeleton, paiMesh->mBones[b]->mName.C_Str());
+                if(bone >= 0)
+                    skeleton->inverseBind[bone] = ai_to_mat4(paiMesh->mBones[b]->mOffsetMatrix);
+            }
+        }
+        for(u32 a = 0; a < pScene->mNumAnimations; ++a)
+            skinned.clips.push_back(load_animation_clip(skeleton, pScene->mAnimations[a]));
+    }
+    else {
+        build_sway_rig(&skinned);
+    }
+
+    for(u32 m = 0; m < pScene->mNumMeshes; ++m) {
+        const aiMesh* paiMesh = pScene->mMeshes[m];
+        std::vector<u8> bones(paiMesh->mNumVertices * 4, 0);
+        std::vector<f32> weights(paiMesh->mNumVertices * 4, 0.0f);
+        if(hasBones) {
+            for(u32 b = 0; b < paiMesh->mNumBones; ++b) {
+                const aiBone* bone = paiMesh->mBones[b];
+                i32 index = find_bone(skeleton, bone->mName.C_Str());
+                if(index < 0)
+                    continue;
+                for(u32 w = 0; w < bone->mNumWeights; ++w) {
+                    u32 v = bone->mWeights[w].mVertexId;
+                    add_bone_weight(&bones[v * 4], &weights[v * 4], index, bone->mWeights[w].mWeight);
+                }
+            }
+        }
+        else {
+            f32 height = skinned.model.boundsMax.y - skinned.model.boundsMin.y;
+            for(u32 v = 0; v < paiMesh->mNumVertices; ++v) {
+                f32 y = (paiMesh->mVertices[v].y - skinned.model.boundsMin.y) / height;
+                for(u32 b = 0; b < 4; ++b) {
+                    bones[v * 4 + b] = b;
+                    weights[v * 4 + b] = sway_rig_weight(y, b);
+                }
+            }
+        }
+
+        //weights are normalized to bytes, a vertex no bone touches follows the root
+        std::vector<u8> packed(paiMesh->mNumVertices * 8);
+        for(u32 v = 0; v < paiMesh->mNumVertices; ++v) {
+            f32 total = weights[v * 4] + weights[v * 4 + 1] + weights[v * 4 + 2] + weights[v * 4 + 3];
+            for(u32 i = 0; i < 4; ++i) {
+                packed[v * 8 + i] = bones[v * 4 + i];
+                packed[v * 8 + 4 + i] = total > 0 ? (u8)roundf(weights[v * 4 + i] / total * 255.0f) : (i == 0 ? 255 : 0);
+            }
+        }
+
+        u32 base = skinned.bindVertices.size();
+        vec4 color = skinned.model.materials[paiMesh->mMaterialIndex].diffuseColor;
+        for(u32 v = 0; v < paiMesh->mNumVertices; ++v) {
+            Vertex vertex = {
+                {paiMesh->mVertices[v].x, paiMesh->mVertices[v].y, paiMesh->mVertices[v].z},
+                {paiMesh->mNormals[v].x, paiMesh->mNormals[v].y, paiMesh->mNormals[v].z},
+                {0, 0}
+            };
+            skinned.bindVertices.push_back(vertex);
+            skinned.bindColors.push_back(color);
+        }
+        skinned.bindBones.insert(skinned.bindBones.end(), packed.begin(), packed.end());
+        for(u32 f = 0; f < paiMesh->mNumFaces; ++f)
+            for(u32 i = 0; i < 3; ++i)
+                skinned.bindIndices.push_back(base + paiMesh->mFaces[f].mIndices[i]);
+
+        GLuint buffer;
+        glBindVertexArray(skinned.model.meshes[m].vao);
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, packed.size(), &packed[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(4);
+        glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, 8, (const GLvoid*)0);              //bone indices
+        glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, 8, (const GLvoid*)4);     //bone weights
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        skinned.boneBuffers.push_back(buffer);
+    }
+
+    BMT_LOG(INFO, "[%s] %d bones, %d clips", filename, skeleton->boneCount, skinned.clips.size());
+    return skinned;
+}
+
+static inline
+void dispose_skinned_model(SkinnedModel* skinned) {
+    if(!skinned->boneBuffers.empty())
+        glDeleteBuffers(skinned->boneBuffers.size(), &skinned->boneBuffers[0]);
+    skinned->boneBuffers.clear();
+    dispose_model(&skinned->model);
+    skinned->clips.clear();
+}
+
+static inline
+u32 find_animation_clip(const SkinnedModel* skinned, const char* name) {
+    for(u32 i = 0; i < skinned->clips.size(); ++i)
+        if(skinned->clips[i].name == name)
+            return i;
+    return 0;
+}
+
+//=============================================
+//
+//      POSE SAMPLING
+//
+//=============================================
+
+static inline
+void clip_frames(const AnimationClip* clip, f32 time, u32* frame, f32* alpha) {
+    f32 position = time * ANIMATION_SAMPLE_RATE;
+    u32 first = (u32)position;
+    if(first > clip->frameCount - 2)
+        first = clip->frameCount - 2;
+    *frame = first;
+    *alpha = fminf(fmaxf(position - first, 0.0f), 1.0f);
+}
+
+#ifdef BMT_SSE
+//four bones in SoA form, one register per component
+struct BoneGroup {
+    __m128 rotation[4];
+    __m128 translation[3];
+    __m128 scale[3];
+};
+
+static inline
+__m128 load_i16x4(const i16* values) {
+    __m128i v = _mm_loadl_epi64((const __m128i*)values);
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+static inline
+__m128 load_u16x4(const u16* values) {
+    __m128i v = _mm_loadl_epi64((const __m128i*)values);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+
+static inline
+__m128 lerp_x4(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+//nlerp of four quaternion pairs, flipping b where it sits in the other hemisphere
+static inline
+void nlerp_x4(__m128* a, const __m128* b, __m128 t) {
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_add_ps(_mm_mul_ps(a[2], b[2]), _mm_mul_ps(a[3], b[3])));
+    __m128 sign = _mm_and_ps(dot, _mm_set1_ps(-0.0f));
+    for(u32 c = 0; c < 4; ++c)
+        a[c] = lerp_x4(a[c], _mm_xor_ps(b[c], sign), t);
+    __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], a[0]), _mm_mul_ps(a[1], a[1])), _mm_add_ps(_mm_mul_ps(a[2], a[2]), _mm_mul_ps(a[3], a[3])));
+    //rsqrt plus one newton step is plenty for a rotation that is about to become a matrix
+    __m128 r = _mm_rsqrt_ps(length2);
+    r = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), r), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(length2, r), r)));
+    for(u32 c = 0; c < 4; ++c)
+        a[c] = _mm_mul_ps(a[c], r);
+}
+
+static inline
+void decode_bone_group(const AnimationClip* clip, u32 frame, u32 group, BoneGroup* out) {
+    u32 index = frame * clip->groupCount + group;
+    const i16* rotations = &clip->rotations[index * 16];
+    const u16* translations = &clip->translations[index * 12];
+    const u16* scales = &clip->scales[index * 12];
+    __m128 unit = _mm_set1_ps(1.0f / QUATERNION_SCALE);
+    for(u32 c = 0; c < 4; ++c)
+        out->rotation[c] = _mm_mul_ps(load_i16x4(rotations + c * 4), unit);
+    for(u32 c = 0; c < 3; ++c) {
+        out->translation[c] = _mm_add_ps(_mm_set1_ps(clip->translationMin.e[c]), _mm_mul_ps(load_u16x4(translations + c * 4), _mm_set1_ps(clip->translationStep.e[c])));
+        out->scale[c] = _mm_add_ps(_mm_set1_ps(clip->scaleMin.e[c]), _mm_mul_ps(load_u16x4(scales + c * 4), _mm_set1_ps(clip->scaleStep.e[c])));
+    }
+}
+
+static inline
+void sample_bone_group(const AnimationClip* clip, f32 time, u32 group, BoneGroup* out) {
+    u32 frame;
+    f32 alpha;
+    clip_frames(clip, time, &frame, &alpha);
+    BoneGroup next;
+    decode_bone_group(clip, frame, group, out);
+    decode_bone_group(clip, frame + 1, group, &next);
+    __m128 t = _mm_set1_ps(alpha);
+    nlerp_x4(out->rotation, next.rotation, t);
+    for(u32 c = 0; c < 3; ++c) {
+        out->translation[c] = lerp_x4(out->translation[c], next.translation[c], t);
+        out->scale[c] = lerp_x4(out->scale[c], next.scale[c], t);
+    }
+}
+
+//turns four poses into four local matrices, building the columns side by side
+static inline
+void bone_group_matrices(const BoneGroup* pose, mat4* out) {
+    __m128 x = pose->rotation[0], y = pose->rotation[1], z = pose->rotation[2], w = pose->rotation[3];
+    __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+    __m128 c0[4] = {
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), pose->scale[0]),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), pose->scale[0]),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), pose->scale[0]),
+        zero
+    };
+    __m128 c1[4] = {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), pose->scale[1]),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), pose->scale[1]),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), pose->scale[1]),
+        zero
+    };
+    __m128 c2[4] = {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), pose->scale[2]),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), pose->scale[2]),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), pose->scale[2]),
+        zero
+    };
+    __m128 c3[4] = { pose->translation[0], pose->translation[1], pose->translation[2], one };
+    _MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+    _MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+    _MM_TRANSPOSE4_PS(c2[0], c2[1], c2[2], c2[3]);
+    _MM_TRANSPOSE4_PS(c3[0], c3[1], c3[2], c3[3]);
+    for(u32 lane = 0; lane < 4; ++lane) {
+        _mm_storeu_ps(out[lane].elements + 0, c0[lane]);
+        _mm_storeu_ps(out[lane].elements + 4, c1[lane]);
+        _mm_storeu_ps(out[lane].elements + 8, c2[lane]);
+        _mm_storeu_ps(out[lane].elements + 12, c3[lane]);
+    }
+}
+
+static inline
+void multiply_mat4_sse(const mat4* a, const mat4* b, mat4* out) {
+    __m128 a0 = _mm_loadu_ps(a->elements + 0);
+    __m128 a1 = _mm_loadu_ps(a->elements + 4);
+    __m128 a2 = _mm_loadu_ps(a->elements + 8);
+    __m128 a3 = _mm_loadu_ps(a->elements + 12);
+    for(u32 c = 0; c < 4; ++c) {
+        const f32* column = b->elements + c * 4;
+        __m128 result = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(column[0])), _mm_mul_ps(a1, _mm_set1_ps(column[1]))),
+            _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(column[2])), _mm_mul_ps(a3, _mm_set1_ps(column[3]))));
+        _mm_storeu_ps(out->elements + c * 4, result);
+    }
+}
+#else
+static inline
+BonePose decode_bone_pose(const AnimationClip* clip, u32 frame, u32 bone) {
+    u32 index = frame * clip->groupCount + bone / 4;
+    u32 lane = bone % 4;
+    BonePose pose;
+    for(u32 c = 0; c < 4; ++c)
+        pose.rotation.e[c] = clip->rotations[index * 16 + c * 4 + lane] / QUATERNION_SCALE;
+    for(u32 c = 0; c < 3; ++c) {
+        pose.translation.e[c] = clip->translationMin.e[c] + clip->translations[index * 12 + c * 4 + lane] * clip->translationStep.e[c];
+        pose.scale.e[c] = clip->scaleMin.e[c] + clip->scales[index * 12 + c * 4 + lane] * clip->scaleStep.e[c];
+    }
+    return pose;
+}
+
+static inline
+void nlerp_bone_pose(BonePose* a, const BonePose& b, f32 t) {
+    f32 dot = a->rotation.x * b.rotation.x + a->rotation.y * b.rotation.y + a->rotation.z * b.rotation.z + a->rotation.w * b.rotation.w;
+    f32 sign = dot < 0 ? -1.0f : 1.0f;
+    f32 length2 = 0;
+    for(u32 c = 0; c < 4; ++c) {
+        a->rotation.e[c] += (b.rotation.e[c] * sign - a->rotation.e[c]) * t;
+        length2 += a->rotation.e[c] * a->rotation.e[c];
+    }
+    f32 r = 1.0f / sqrtf(length2);
+    for(u32 c = 0; c < 4; ++c)
+        a->rotation.e[c] *= r;
+    for(u32 c = 0; c < 3; ++c) {
+        a->translation.e[c] += (b.translation.e[c] - a->translation.e[c]) * t;
+        a->scale.e[c] += (b.scale.e[c] - a->scale.e[c]) * t;
+    }
+}
+
+static inline
+BonePose sample_bone_pose(const AnimationClip* clip, f32 time, u32 bone) {
+    u32 frame;
+    f32 alpha;
+    clip_frames(clip, time, &frame, &alpha);
+    BonePose pose = decode_bone_pose(clip, frame, bone);
+    nlerp_bone_pose(&pose, decode_bone_pose(clip, frame + 1, bone), alpha);
+    return pose;
+}
+#endif
+
+//==========================================================================================
+//Description: Samples the clips of one instance and writes its skinning matrices
+//
+//Parameters:
+//		-The instance to pose
+//		-Where its first matrix goes, one per bone of its skeleton
+//==========================================================================================
+static inline
+void pose_animation_instance(const AnimationInstance* instance, mat4* out) {
+    const Skeleton* skeleton = &instance->skinned->skeleton;
+    const AnimationClip* clip = &instance->skinned->clips[instance->clip];
+    const AnimationClip* blend = &instance->skinned->clips[instance->blendClip];
+    bool blending = instance->blendWeight > 0.0f;
+    mat4 locals[MAX_BONES];
+    mat4 globals[MAX_BONES];
+
+#ifdef BMT_SSE
+    __m128 weight = _mm_set1_ps(instance->blendWeight);
+    for(u32 g = 0; g < clip->groupCount; ++g) {
+        BoneGroup pose;
+        sample_bone_group(clip, instance->time, g, &pose);
+        if(blending) {
+            BoneGroup other;
+            sample_bone_group(blend, instance->blendTime, g, &other);
+            nlerp_x4(pose.rotation, other.rotation, weight);
+            for(u32 c = 0; c < 3; ++c) {
+                pose.translation[c] = lerp_x4(pose.translation[c], other.translation[c], weight);
+                pose.scale[c] = lerp_x4(pose.scale[c], other.scale[c], weight);
+            }
+        }
+        bone_group_matrices(&pose, &locals[g * 4]);
+    }
+    for(u32 b = 0; b < skeleton->boneCount; ++b) {
+        i32 parent = skeleton->parents[b];
+        //the global inverse rides along with the root so every bone picks it up
+        multiply_mat4_sse(parent < 0 ? &skeleton->globalInverse : &globals[parent], &locals[b], &globals[b]);
+        multiply_mat4_sse(&globals[b], &skeleton->inverseBind[b], &out[b]);
+    }
+#else
+    for(u32 b = 0; b < skeleton->boneCount; ++b) {
+        BonePose pose = sample_bone_pose(clip, instance->time, b);
+        if(blending)
+            nlerp_bone_pose(&pose, sample_bone_pose(blend, instance->blendTime, b), instance->blendWeight);
+        locals[b] = bone_pose_matrix(pose);
+    }
+    for(u32 b = 0; b < skeleton->boneCount; ++b) {
+        i32 parent = skeleton->parents[b];
+        globals[b] = (parent < 0 ? skeleton->globalInverse : globals[parent]) * locals[b];
+        out[b] = globals[b] * skeleton->inverseBind[b];
+    }
+#endif
+}
+
+//=============================================
+//
+//      ANIMATOR
+//
+//=============================================
+
+static inline
+Animator create_animator() {
+    Animator animator;
+    glGenBuffers(1, &animator.buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, animator.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(mat4), NULL, GL_STREAM_DRAW);
+    glGenTextures(1, &animator.texture);
+    glBindTexture(GL_TEXTURE_BUFFER, animator.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, animator.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return animator;
+}
+
+static inline
+void dispose_animator(Animator* animator) {
+    glDeleteBuffers(1, &animator->buffer);
+    glDeleteTextures(1, &animator->texture);
+    animator->instances.clear();
+    animator->palette.clear();
+}
+
+//Adds an instance playing one of the model's clips and reserves its bones in the palette.
+//Returns the handle used by draw_skinned_model.
+static inline
+u32 add_animation_instance(Animator* animator, const SkinnedModel* skinned, u32 clip, f32 time = 0.0f) {
+    AnimationInstance instance;
+    instance.skinned = skinned;
+    instance.clip = instance.blendClip = clip;
+    instance.time = instance.blendTime = time;
+    instance.blendWeight = 0.0f;
+    instance.speed = 1.0f;
+    instance.boneOffset = animator->palette.size();
+    animator->palette.resize(animator->palette.size() + (skinned->skeleton.boneCount > 0 ? skinned->skeleton.boneCount : 1), identity());
+    animator->instances.push_back(instance);
+    return animator->instances.size() - 1;
+}
+
+static inline
+void pose_animation_instances(void* data, u32 begin, u32 end) {
+    Animator* animator = (Animator*)data;
+    for(u32 i = begin; i < end; ++i) {
+        const AnimationInstance* instance = &animator->instances[i];
+        if(instance->skinned->skeleton.boneCount > 0 && !instance->skinned->clips.empty())
+            pose_animation_instance(instance, &animator->palette[instance->boneOffset]);
+    }
+}
+
+//==========================================================================================
+//Description: Advances every instance and rebuilds the palette
+//
+//Comments: Only CPU work, the instances are posed in groups of eight across the job system.
+//==========================================================================================
+static inline
+void update_animations(Animator* animator, f32 dt) {
+    BMT_PROFILE_FUNCTION();
+    for(u32 i = 0; i < animator->instances.size(); ++i) {
+        AnimationInstance* instance = &animator->instances[i];
+        if(instance->skinned->clips.empty())
+            continue;
+        f32 duration = instance->skinned->clips[instance->clip].duration;
+        f32 blendDuration = instance->skinned->clips[instance->blendClip].duration;
+        instance->time = fmodf(instance->time + dt * instance->speed, duration);
+        instance->blendTime = fmodf(instance->blendTime + dt * instance->speed, blendDuration);
+    }
+    parallel_for(animator->instances.size(), 8, pose_animation_instances, animator);
+}
+
+static inline
+void upload_animations(Animator* animator) {
+    if(animator->palette.empty())
+        return;
+    glBindBuffer(GL_TEXTURE_BUFFER, animator->buffer);
+    glBufferData(GL_TEXTURE_BUFFER, animator->palette.size() * sizeof(mat4), &animator->palette[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    BMT_STAT_ADD(STAT_BUFFER_BYTES, animator->palette.size() * sizeof(mat4));
+}
+
+//binds the palette to a shader using skinned.vert
+static inline
+void bind_animations(Animator* animator, Shader shader, u32 slot) {
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_BUFFER, animator->texture);
+    glActiveTexture(GL_TEXTURE0);
+    upload_int(shader, "bonePalette", slot);
+}
+
+static inline
+void draw_skinned_model(Shader shader, SkinnedModel* skinned, Animator* animator, u32 instance) {
+    upload_int(shader, "boneOffset", animator->instances[instance].boneOffset);
+    draw_model(shader, &skinned->model);
+}
+
+static inline
+Shader load_skinned_shader() {
+    Shader shader = { 0 };
+    shader.vertexshaderID = load_shader_file("data/shaders/skinned.vert", GL_VERTEX_SHADER);
+    shader.fragshaderID = load_shader_file("data/shaders/static.frag", GL_FRAGMENT_SHADER);
+    shader.ID = glCreateProgram();
+
+    glAttachShader(shader.ID, shader.vertexshaderID);
+    glAttachShader(shader.ID, shader.fragshaderID);
+    glBindFragDataLocation(shader.ID, 0, "outColor");
+    glBindAttribLocation(shader.ID, 0, "position");
+    glBindAttribLocation(shader.ID, 1, "normal");
+    glBindAttribLocation(shader.ID, 2, "uv");
+    glBindAttribLocation(shader.ID, 3, "bones");
+    glBindAttribLocation(shader.ID, 4, "weights");
+    glLinkProgram(shader.ID);
+    glValidateProgram(shader.ID);
+
+    glUseProgram(0);
+    return shader;
+}
+
+//==========================================================================================
+//Description: Logs how long posing a crew takes, no GL context is needed past loading
+//
+//Comments: Every instance blends two clips, the worst case for the sampler.
+//==========================================================================================
+static inline
+void benchmark_animation(const SkinnedModel* skinned, u32 count = 512, u32 updates = 120) {
+    if(skinned->clips.empty())
+        return;
+    BMT_LOG(INFO, "Animation benchmark, %d instances of %d bones on %d worker threads", count, skinned->skeleton.boneCount, get_job_worker_count());
+    Animator animator;
+    for(u32 i = 0; i < count; ++i) {
+        AnimationInstance instance;
+        instance.skinned = skinned;
+        instance.clip = 0;
+        instance.blendClip = skinned->clips.size() - 1;
+        instance.time = instance.blendTime = i * 0.01f;
+        instance.blendWeight = 0.5f;
+        instance.speed = 1.0f;
+        instance.boneOffset = animator.palette.size();
+        animator.palette.resize(animator.palette.size() + skinned->skeleton.boneCount);
+        animator.instances.push_back(instance);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < updates; ++i)
+        pose_animation_instances(&animator, 0, count);
+    f64 single = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count() / updates;
+
+    start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < updates; ++i)
+        update_animations(&animator, 1.0f / 60.0f);
+    f64 threaded = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count() / updates;
+
+    BMT_LOG(INFO, "    %8.3f ms per update on one thread, %8.3f ms threaded, %6.2f us per instance", single, threaded, single * 1000.0 / count);
+}
+
+#endif
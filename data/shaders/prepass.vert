@@ -0,0 +1,16 @@
+#version 330 core
+
+in vec3 position;
+
+uniform mat4 projection = mat4(1.0);
+uniform mat4 transform = mat4(1.0);
+uniform mat4 view = mat4(1.0);
+
+//the colour pass tests against this depth with GL_EQUAL, so both shaders
+//have to compute gl_Position with the exact same expression
+invariant gl_Position;
+
+void main() {
+    vec4 viewPos = view * transform * vec4(position, 1.0);
+    gl_Position = projection * viewPos;
+}
@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 pass_uv;
+out vec4 out_color;
+
+uniform sampler2D scene;
+
+//
+//  MAIN
+//
+
+void main(void) {
+    out_color = texture(scene, pass_uv);
+}
@@ -0,0 +1,14 @@
+#version 330 core
+
+out vec2 pass_uv;
+
+//
+//  MAIN
+//
+
+void main(void) {
+    //one triangle that covers the screen, no vertex buffer needed
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    pass_uv = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
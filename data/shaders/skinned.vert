@@ -0,0 +1,48 @@
+#version 330 core
+
+in vec3 position;
+in vec3 normal;
+in vec2 uv;
+in uvec4 bones;
+in vec4 weights;
+
+uniform mat4 projection = mat4(1.0);
+uniform mat4 transform = mat4(1.0);
+uniform mat4 view = mat4(1.0);
+
+//skinning matrices of every animated instance, four texels per matrix
+uniform samplerBuffer bonePalette;
+uniform int boneOffset = 0;
+
+out vec2 pass_uv;
+out vec3 pass_normal;
+out vec3 pass_pos;
+out float pass_depth;
+
+mat4 bone_matrix(uint bone) {
+    int texel = (boneOffset + int(bone)) * 4;
+    return mat4(texelFetch(bonePalette, texel),
+                texelFetch(bonePalette, texel + 1),
+                texelFetch(bonePalette, texel + 2),
+                texelFetch(bonePalette, texel + 3));
+}
+
+//
+//   MAIN
+//
+
+void main() {
+    mat4 skin = bone_matrix(bones.x) * weights.x
+              + bone_matrix(bones.y) * weights.y
+              + bone_matrix(bones.z) * weights.z
+              + bone_matrix(bones.w) * weights.w;
+    vec4 skinnedPos = skin * vec4(position, 1.0);
+    vec3 skinnedNormal = mat3(skin) * normal;
+
+    pass_pos = vec3(transform * skinnedPos);
+    pass_normal = transpose(inverse(mat3(transform))) * skinnedNormal;
+    pass_uv = uv;
+    vec4 viewPos = view * transform * skinnedPos;
+    pass_depth = -viewPos.z;
+    gl_Position = projection * viewPos;
+}
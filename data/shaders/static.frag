@@ -5,38 +5,83 @@ out vec4 color;
 in vec2 pass_uv;
 in vec3 pass_normal;
 in vec3 pass_pos;
-in vec4 pass_lightspace;
+in float pass_depth;
 
-uniform sampler2D shadowMap;
+//one layer per cascade, see shadows.h
+uniform sampler2DArray shadowMap;
+uniform mat4 lightSpaceMatrices[4];
+uniform float cascadeBias[4];
+uniform int cascadeCount = 0;
+
+//clustered point lights, see lights.h
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+uniform samplerBuffer lightData;
+uniform vec2 clusterScreenSize = vec2(1, 1);
+uniform float clusterNear = 0.1;
+uniform float clusterFar = 1.0;
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
 
 uniform vec4 diffuseColor = vec4(1, 1, 1, 1);
 uniform vec3 lightColor = vec3(1, 1, 1);
-uniform vec3 lightPos = vec3(0, 40, 0);
+//direction towards the sun
+uniform vec3 lightDirection = vec3(0, 1, 0);
 
 //
 //FUNCTIONS
 //
 
-float shadow_calculation(vec4 lightspace, vec3 lightDir) {
-    vec3 projCoords = lightspace.xyz / lightspace.w;
-    projCoords = projCoords * 0.5 + 0.5;
+float shadow_calculation(vec3 worldPos, vec3 normal, vec3 lightDir) {
+    //cascades are ordered from nearest to farthest, use the first one the fragment falls inside of
+    for(int i = 0; i < cascadeCount; ++i) {
+        vec4 lightspace = lightSpaceMatrices[i] * vec4(worldPos, 1.0);
+        vec3 projCoords = lightspace.xyz / lightspace.w;
+        projCoords = projCoords * 0.5 + 0.5;
+        if(any(lessThan(projCoords.xy, vec2(0.0))) || any(greaterThan(projCoords.xy, vec2(1.0))) || projCoords.z > 1.0)
+            continue;
 
-    float closestDepth = texture(shadowMap, projCoords.xy).r;
-    float currentDepth = projCoords.z;
-    float bias = max(0.05 * (1.0f - dot(pass_normal, lightDir)), 0.005f);
+        float currentDepth = projCoords.z;
+        float bias = cascadeBias[i] * (1.0 + 2.0 * (1.0 - max(dot(normal, lightDir), 0.0)));
 
-    float shadow = 0.0f;
-    vec2 texelSize = 1.0f / textureSize(shadowMap, 0);
-    for(int x = -1; x <= 1; ++x) {
-        for(int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        float shadow = 0.0f;
+        vec2 texelSize = 1.0f / textureSize(shadowMap, 0).xy;
+        for(int x = -1; x <= 1; ++x) {
+            for(int y = -1; y <= 1; ++y) {
+                float pcfDepth = texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, i)).r;
+                shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+            }
         }
+        return shadow / 9.0f;
     }
-    shadow /= 9.0f;
-    //float shadow = currentDepth - bias > closestDepth ? 1.0f : 0.0f;
+    return 0.0f;
+}
+
+vec3 point_lights(vec3 normal) {
+    if(pass_depth < clusterNear || pass_depth >= clusterFar)
+        return vec3(0);
 
-    return shadow;
+    ivec3 cluster;
+    cluster.xy = ivec2(gl_FragCoord.xy / clusterScreenSize * vec2(CLUSTER_X, CLUSTER_Y));
+    cluster.z = int(log(pass_depth / clusterNear) / log(clusterFar / clusterNear) * CLUSTER_Z);
+    cluster = clamp(cluster, ivec3(0), ivec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+    uvec2 grid = texelFetch(clusterGrid, (cluster.z * CLUSTER_Y + cluster.y) * CLUSTER_X + cluster.x).rg;
+
+    vec3 result = vec3(0);
+    for(uint i = 0u; i < grid.y; ++i) {
+        int index = int(texelFetch(clusterIndices, int(grid.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, index * 2);
+        vec4 colorIntensity = texelFetch(lightData, index * 2 + 1);
+
+        vec3 toLight = positionRadius.xyz - pass_pos;
+        float dist = length(toLight);
+        //inverse square falloff, smoothly windowed to zero at the light radius
+        float window = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (dist * dist + 1.0);
+        result += max(dot(normal, toLight / dist), 0.0) * attenuation * colorIntensity.rgb * colorIntensity.a;
+    }
+    return result;
 }
 
 //
@@ -46,12 +91,11 @@ float shadow_calculation(vec4 lightspace, vec3 lightDir) {
 void main() {
     vec3 normal = normalize(pass_normal);
     vec3 ambient = 0.65 * diffuseColor.xyz;
-    vec3 lightDir = normalize(lightPos - pass_pos);
+    vec3 lightDir = normalize(lightDirection);
     float diff = max(dot(lightDir, normal), 0.0);
     vec3 diffuse = diff * lightColor;
 
-    float shadow = shadow_calculation(pass_lightspace, lightDir);
-    //vec3 lighting = (ambient + (1.0f - shadow) * (diffuse)) * diffuseColor.rgb;
-    vec3 lighting = (ambient + diffuse) * diffuseColor.xyz;
+    float shadow = shadow_calculation(pass_pos, normal, lightDir);
+    vec3 lighting = (ambient + (1.0f - shadow) * diffuse + point_lights(normal)) * diffuseColor.xyz;
     color = vec4(lighting, 1.0);
 }
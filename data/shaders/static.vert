@@ -7,12 +7,14 @@ in vec2 uv;
 uniform mat4 projection = mat4(1.0);
 uniform mat4 transform = mat4(1.0);
 uniform mat4 view = mat4(1.0);
-uniform mat4 lightSpaceMatrix = mat4(1.0);
 
 out vec2 pass_uv;
 out vec3 pass_normal;
 out vec3 pass_pos;
-out vec4 pass_lightspace;
+out float pass_depth;
+
+//must match prepass.vert so the depth pre-pass can be tested with GL_EQUAL
+invariant gl_Position;
 
 //
 //   MAIN
@@ -22,6 +24,7 @@ void main() {
     pass_pos = vec3(transform * vec4(position, 1.0));
     pass_normal = transpose(inverse(mat3(transform))) * normal;
     pass_uv = uv;
-    pass_lightspace = lightSpaceMatrix * vec4(pass_pos, 1.0);
-    gl_Position = projection * view * transform * vec4(position, 1.0);
+    vec4 viewPos = view * transform * vec4(position, 1.0);
+    pass_depth = -viewPos.z;
+    gl_Position = projection * viewPos;
 }
@@ -1,8 +1,40 @@
 #version 330 core
 
-in vec3 pass_color;
-out vec4 out_color;
+in vec3 pass_normal;
+in vec3 pass_world;
+in vec2 pass_blend_uv;
+
+out vec4 outColor;
+
+//grass, mud, flowers, path, sand and rock
+uniform sampler2DArray layers;
+//red is mud, green is flowers, blue is path and black is grass
+uniform sampler2D blendMap;
+uniform float layerScale = 0.125;
+uniform vec3 lightDirection = vec3(0.5, 1.0, 0.3);
+
+//
+//  MAIN
+//
 
 void main(void) {
-    out_color = vec4(pass_color, 1.0);
+    vec3 normal = normalize(pass_normal);
+    vec2 uv = pass_world.xz * layerScale;
+
+    vec3 blend = texture(blendMap, pass_blend_uv).rgb;
+    float grass = max(1.0 - blend.r - blend.g - blend.b, 0.0);
+    vec3 color = texture(layers, vec3(uv, 0.0)).rgb * grass;
+    color += texture(layers, vec3(uv, 1.0)).rgb * blend.r;
+    color += texture(layers, vec3(uv, 2.0)).rgb * blend.g;
+    color += texture(layers, vec3(uv, 3.0)).rgb * blend.b;
+    color /= max(grass + blend.r + blend.g + blend.b, 1.0);
+
+    //beaches along the waterline and bare rock wherever it gets steep
+    float sand = 1.0 - smoothstep(1.0, 3.0, pass_world.y);
+    color = mix(color, texture(layers, vec3(uv, 4.0)).rgb, sand);
+    float rock = 1.0 - smoothstep(0.6, 0.8, normal.y);
+    color = mix(color, texture(layers, vec3(uv * 0.5, 5.0)).rgb, rock);
+
+    float light = 0.35 + 0.65 * max(dot(normal, normalize(lightDirection)), 0.0);
+    outColor = vec4(color * light, 1.0);
 }
@@ -1,30 +1,41 @@
 #version 330 core
 
-in vec3 position;
-in vec3 normal;
-in vec4 color;
+//grid cell of the vertex inside its chunk
+in vec2 position;
+//height, height once morphed, normal x and normal z
+in vec4 heights;
 
-out vec3 pass_color;
+out vec3 pass_normal;
+out vec3 pass_world;
+out vec2 pass_blend_uv;
 
 uniform mat4 projection = mat4(1.0);
-uniform mat4 transform = mat4(1.0);
 uniform mat4 view = mat4(1.0);
+uniform vec3 cameraPos;
+uniform vec4 clipPlane = vec4(0.0, 0.0, 0.0, 1.0);
+uniform float worldSize = 4096.0;
 
-uniform vec3 lightPos = vec3(-2, 4, -1);
-uniform vec3 lightColor = vec3(1.0, 1.0, 1.0);
-uniform vec2 lightBias = vec2(1.0, 1.0);
+//world offset x, world offset z, cell spacing and level of the chunk
+uniform vec4 node;
+//morph start and end distance of every level
+uniform vec2 cdlodMorph[10];
 
-vec3 calculate_light() {
-    vec3 lightDir = normalize(lightPos - position);
-
-    vec3 light_normal = normal.xyz * 2.0 - 1.0;
-    float brightness = max(dot(-lightDir, light_normal), 0.0);
-    return (lightColor * lightBias.x) + (brightness * lightColor * lightBias.y);
-}
+//
+//  MAIN
+//
 
 void main(void) {
-    gl_Position = projection * view * transform * vec4(position, 1.0);
-
-    vec3 lighting = calculate_light();
-    pass_color = color.rgb * lighting;
+    //same morph as the water, odd vertices slide onto the grid of the next coarser level
+    vec2 flat_position = node.xy + position * node.z;
+    vec2 range = cdlodMorph[int(node.w)];
+    float morph = clamp((distance(cameraPos, vec3(flat_position.x, heights.x, flat_position.y)) - range.x) / (range.y - range.x), 0.0, 1.0);
+    vec2 grid = position - mod(position, 2.0) * morph;
+    vec4 world = vec4(node.x + grid.x * node.z, mix(heights.x, heights.y, morph), node.y + grid.y * node.z, 1.0);
+
+    pass_normal = vec3(heights.z, sqrt(max(1.0 - dot(heights.zw, heights.zw), 0.0)), heights.w);
+    pass_world = world.xyz;
+    pass_blend_uv = world.xz / worldSize + 0.5;
+
+    gl_ClipDistance[0] = dot(world, clipPlane);
+    gl_Position = projection * view * world;
 }
@@ -0,0 +1,29 @@
+#version 330 core
+
+//grid cell of the vertex inside its chunk
+in vec2 position;
+//height, height once morphed, normal x and normal z
+in vec4 heights;
+
+uniform mat4 lightSpaceMatrix = mat4(1.0);
+uniform vec3 cameraPos;
+
+//world offset x, world offset z, cell spacing and level of the chunk
+uniform vec4 node;
+//morph start and end distance of every level
+uniform vec2 cdlodMorph[10];
+
+//
+//  MAIN
+//
+
+void main(void) {
+    //same morph as terrain.vert, around the point the shadow map picked its detail for
+    vec2 flat_position = node.xy + position * node.z;
+    vec2 range = cdlodMorph[int(node.w)];
+    float morph = clamp((distance(cameraPos, vec3(flat_position.x, heights.x, flat_position.y)) - range.x) / (range.y - range.x), 0.0, 1.0);
+    vec2 grid = position - mod(position, 2.0) * morph;
+    vec4 world = vec4(node.x + grid.x * node.z, mix(heights.x, heights.y, morph), node.y + grid.y * node.z, 1.0);
+
+    gl_Position = lightSpaceMatrix * world;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+out vec4 outColor;
+
+in vec4 pass_color;
+in vec3 pass_normal;
+
+uniform vec3 lightColor = vec3(1, 1, 1);
+//direction towards the sun
+uniform vec3 lightDirection = vec3(0, 1, 0);
+
+//
+//   MAIN
+//
+
+void main() {
+    //crowds are only drawn far away, so they get the sun and ambient of static.frag and nothing else
+    float diff = max(dot(normalize(pass_normal), normalize(lightDirection)), 0.0);
+    vec3 lighting = (0.65 + diff * lightColor) * pass_color.xyz;
+    outColor = vec4(lighting, 1.0);
+}
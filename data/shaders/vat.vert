@@ -0,0 +1,49 @@
+#version 330 core
+
+in vec4 color;
+//world position and heading in degrees
+in vec4 placement;
+//scale, clip, time offset, playback speed
+in vec4 playback;
+
+uniform mat4 projection = mat4(1.0);
+uniform mat4 view = mat4(1.0);
+uniform float time = 0.0;
+
+//baked by vertex_animation.h, one layer per clip
+uniform sampler2DArray vatPositions;
+uniform sampler2DArray vatNormals;
+uniform int vatWidth = 1;
+uniform int vatRows = 1;
+uniform float clipFrames[8];
+
+const float SAMPLE_RATE = 30.0;
+
+out vec4 pass_color;
+out vec3 pass_normal;
+
+ivec3 vat_texel(int frame, int layer) {
+    return ivec3(gl_VertexID % vatWidth, frame * vatRows + gl_VertexID / vatWidth, layer);
+}
+
+void main() {
+    int layer = int(playback.y);
+    //the last frame is the same pose as the first, so a loop covers frames - 1 intervals
+    float intervals = clipFrames[layer] - 1.0;
+    float frame = mod((time * playback.w + playback.z) * SAMPLE_RATE, intervals);
+    int first = int(frame);
+    float alpha = frame - float(first);
+
+    vec3 position = mix(texelFetch(vatPositions, vat_texel(first, layer), 0).xyz, texelFetch(vatPositions, vat_texel(first + 1, layer), 0).xyz, alpha);
+    vec3 normal = mix(texelFetch(vatNormals, vat_texel(first, layer), 0).xyz, texelFetch(vatNormals, vat_texel(first + 1, layer), 0).xyz, alpha);
+
+    float heading = radians(placement.w);
+    mat3 rotation = mat3(cos(heading), 0, -sin(heading),
+                         0, 1, 0,
+                         sin(heading), 0, cos(heading));
+    vec3 world = placement.xyz + rotation * position * playback.x;
+
+    pass_color = color;
+    pass_normal = rotation * normal;
+    gl_Position = projection * view * vec4(world, 1.0);
+}
@@ -3,24 +3,78 @@
 in vec3 pass_color;
 in vec4 clip_space;
 in vec2 pass_uv;
+in vec2 pass_ocean_uv;
+in vec3 pass_world;
+in vec2 pass_ripple_uv;
 out vec4 out_color;
 
 uniform sampler2D reflection;
 uniform sampler2D dudv;
+uniform sampler2D normalMap;
+uniform sampler2D rippleMap;
+//copy of the opaque scene under the water, taken right before the water pass
+uniform sampler2D refractionColor;
+uniform sampler2D refractionDepth;
 uniform float moveFactor;
+uniform vec3 cameraPos;
+uniform float nearPlane = 0.1;
+uniform float farPlane = 999.9;
 
 //
 //  MAIN
 //
 
 const float waveStrength = 0.005;
+const float normalStrength = 0.04;
+const vec3 sunDirection = normalize(vec3(0.5, 1.0, 0.3));
+const vec3 deepColor = vec3(0.02, 0.12, 0.18);
+const float absorption = 0.12;
+const float shoreSoftness = 1.5;
+
+float linear_depth(float depth) {
+    float z = depth * 2.0 - 1.0;
+    return 2.0 * nearPlane * farPlane / (farPlane + nearPlane - z * (farPlane - nearPlane));
+}
 
 void main(void) {
+    vec3 normal = normalize(texture(normalMap, pass_ocean_uv).xyz * 2.0 - 1.0);
+    if (all(greaterThan(pass_ripple_uv, vec2(0.0))) && all(lessThan(pass_ripple_uv, vec2(1.0)))) {
+        vec3 ripple = texture(rippleMap, pass_ripple_uv).xyz;
+        normal = normalize(vec3(normal.x + ripple.x, normal.y * ripple.y, normal.z + ripple.z));
+    }
+    vec3 toCamera = normalize(cameraPos - pass_world);
+
     vec2 ndc = (clip_space.xy / clip_space.w) / 2.0 + 0.5;
     vec2 reflectionUV = vec2(ndc.x, 1.0-ndc.y);
     vec2 distortion = (texture(dudv, vec2(pass_uv.x + moveFactor, pass_uv.y)).rg * 2.0 - 1.0) * waveStrength;
-    reflectionUV += distortion;
-    vec4 reflectionColor = texture(reflection, reflectionUV);
+    reflectionUV += distortion + normal.xz * normalStrength;
+    vec4 reflectionColor = texture(reflection, clamp(reflectionUV, 0.001, 0.999));
+
+    //how much water lies between the surface and the scene behind it. When the distorted
+    //lookup lands on something in front of the water, fall back to the straight lookup
+    float surfaceDepth = linear_depth(gl_FragCoord.z);
+    vec2 refractionUV = clamp(ndc + distortion + normal.xz * normalStrength, 0.001, 0.999);
+    float thickness = linear_depth(texture(refractionDepth, refractionUV).r) - surfaceDepth;
+    if (thickness < 0.0) {
+        refractionUV = ndc;
+        thickness = linear_depth(texture(refractionDepth, ndc).r) - surfaceDepth;
+    }
+    thickness = max(thickness, 0.0);
+
+    //light is absorbed the further it travels through the water
+    vec3 refracted = texture(refractionColor, refractionUV).rgb;
+    vec3 waterColor = pass_color * (0.6 + 0.4 * max(dot(normal, sunDirection), 0.0));
+    float transmittance = exp(-thickness * absorption);
+    vec3 underwater = mix(mix(deepColor, waterColor, 0.5), refracted, transmittance);
+
+    //steeper views see more of what is under the water, grazing views more of the reflection
+    float fresnel = pow(1.0 - max(dot(toCamera, normal), 0.0), 3.0);
+    vec3 color = mix(underwater, reflectionColor.rgb, clamp(0.1 + fresnel, 0.0, 1.0));
+
+    vec3 halfway = normalize(sunDirection + toCamera);
+    color += vec3(1.0, 0.95, 0.85) * pow(max(dot(normal, halfway), 0.0), 128.0) * 0.6;
 
-    out_color = mix(reflectionColor, vec4(pass_color, 1.0), 0.9);
+    //fade into the scene where the water meets the shore
+    float shore = clamp(thickness / shoreSoftness, 0.0, 1.0);
+    out_color = vec4(mix(texture(refractionColor, ndc).rgb, color, shore), 1.0);
 }
@@ -1,24 +1,62 @@
 #version 330 core
 
-in vec3 position;
-in vec3 normal;
-in vec4 color;
+//grid cell of the vertex inside its node
+in vec2 position;
+//world offset x, world offset z, cell spacing and level of the node
+in vec4 node;
 
 out vec3 pass_color;
 out vec4 clip_space;
 out vec2 pass_uv;
+out vec2 pass_ocean_uv;
+out vec3 pass_world;
+out vec2 pass_ripple_uv;
 
 uniform mat4 projection = mat4(1.0);
-uniform mat4 transform = mat4(1.0);
 uniform mat4 view = mat4(1.0);
+uniform vec3 cameraPos;
+uniform vec3 waterColor = vec3(88.0/255.0, 213.0/255.0, 211.0/255.0);
+
+//morph start and end distance of every level
+uniform vec2 cdlodMorph[10];
+
+uniform sampler2D displacementMap;
+uniform float oceanPatchSize = 100.0;
+uniform float oceanSize = 256.0;
+
+uniform sampler2D rippleMap;
+uniform vec2 rippleCenter;
+uniform float rippleExtent = 1.0;
 
 //
 //  MAIN
 //
 
 void main(void) {
-    clip_space = projection * view * transform * vec4(position, 1.0);
+    //towards the end of its range every odd vertex slides onto its even neighbour,
+    //which matches the grid of the next coarser level
+    vec2 flat_position = node.xy + position * node.z;
+    vec2 range = cdlodMorph[int(node.w)];
+    float morph = clamp((distance(cameraPos, vec3(flat_position.x, 0.0, flat_position.y)) - range.x) / (range.y - range.x), 0.0, 1.0);
+    vec2 grid = position - mod(position, 2.0) * morph;
+    vec4 world = vec4(node.x + grid.x * node.z, 0.0, node.y + grid.y * node.z, 1.0);
+
+    //the ocean patch tiles, so the displacement map wraps across the whole plane.
+    //coarse cells read a coarser mip so that far away waves don't alias. The mip follows
+    //the morphed spacing, so both sides of a level seam read the same height
+    pass_ocean_uv = world.xz / oceanPatchSize;
+    float lod = log2(max(node.z * (1.0 + morph) * oceanSize / oceanPatchSize, 1.0));
+    world.xyz += textureLod(displacementMap, pass_ocean_uv, lod).xyz;
+
+    //the ripple field only covers the area around the camera and fades out at its border
+    pass_ripple_uv = (world.xz - rippleCenter) / rippleExtent + 0.5;
+    vec2 edge = min(pass_ripple_uv, 1.0 - pass_ripple_uv);
+    float fade = clamp(min(edge.x, edge.y) * 10.0, 0.0, 1.0);
+    world.y += texture(rippleMap, pass_ripple_uv).w * fade;
+
+    clip_space = projection * view * world;
     gl_Position = clip_space;
-    pass_uv = vec2(position.x/2.0 + 0.5, position.z/2.0 + 0.5) / 350;
-    pass_color = color.rgb;
+    pass_uv = vec2(world.x/2.0 + 0.5, world.z/2.0 + 0.5) / 350;
+    pass_color = waterColor;
+    pass_world = world.xyz;
 }
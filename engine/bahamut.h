@@ -35,6 +35,23 @@
 #include "shader.h"
 #include "texture.h"
 #include "window.h"
+#include "gpu_profiler.h"
+#include "profiler.h"
+#include "render_stats.h"
+#include "text.h"
+#include "stats_hud.h"
+#include "jobs.h"
+#include "occlusion.h"
+#include "ocean.h"
+#include "ripples.h"
+#include "cdlod.h"
+#include "noise.h"
+#include "render_targets.h"
+#include "particles.h"
+#include "command_buffer.h"
+#include "render_thread.h"
+#include "benchmark.h"
+#include "gl_capture.h"
 
 INTERNAL vec4 LIGHTGRAY = V4(200, 200, 200, 255);
 INTERNAL vec4 GRAY = V4(130, 130, 130, 255);
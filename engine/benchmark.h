@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        benchmark.h                              //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "defines.h"
+#include "maths.h"
+#include "gpu_profiler.h"
+#include <vector>
+#include <algorithm>
+
+//Repeatable frame timing.
+//
+//A benchmark run flies the camera along a CameraPath instead of reading the
+//mouse, throws away warmupFrames frames (shader compiles, streaming, the GPU
+//profiler's readback latency) and then records the CPU and GPU time of
+//measuredFrames frames. The app is expected to fix its random seed and step
+//its simulation once per rendered frame, so two runs of the same build draw the
+//same frames and two builds can be compared number for number.
+//
+//Paths are plain text, the seconds between keys on the first line and then one
+//"x y z pitch yaw roll" key per line, so they can be recorded from a live session
+//with record_camera_key() and save_camera_path(), or written by hand.
+//
+//		Benchmark bench = create_benchmark(1337, 120, 600);
+//		...every frame
+//		Camera cam = sample_camera_path(&path, frame / 60.0f);
+//		...
+//		if (benchmark_frame(&bench, cpuMs, gpuMs))
+//			report_benchmark(&bench, &gpuProfiler, "benchmark.json");
+
+struct CameraPath {
+	std::vector<Camera> keys;
+	f32 secondsPerKey;
+};
+
+struct FrameTimeStats {
+	f64 mean;
+	f64 p50;
+	f64 p95;
+	f64 p99;
+	f64 max;
+	u32 samples;
+};
+
+struct Benchmark {
+	u32 seed;
+	u32 warmupFrames;
+	u32 measuredFrames;
+	u32 frame;
+	std::vector<f64> cpu;
+	std::vector<f64> gpu;
+	//where the camera came from, only for the report
+	const char* path;
+};
+
+INTERNAL inline
+Benchmark create_benchmark(u32 seed, u32 warmupFrames, u32 measuredFrames) {
+	Benchmark bench;
+	bench.seed = seed;
+	bench.warmupFrames = warmupFrames;
+	bench.measuredFrames = measuredFrames;
+	bench.frame = 0;
+	bench.cpu.reserve(measuredFrames);
+	bench.gpu.reserve(measuredFrames);
+	bench.path = "orbit";
+	return bench;
+}
+
+//==========================================================================================
+//Description: Counts a frame, and records its times once the warm-up is over
+//
+//Parameters:
+//		-The benchmark
+//		-CPU time of the frame in milliseconds
+//		-GPU time of the frame in milliseconds, 0 if there was no GPU timing
+//
+//Comments: Returns true on the last measured frame
+//==========================================================================================
+INTERNAL inline
+bool benchmark_frame(Benchmark* bench, f64 cpuMs, f64 gpuMs) {
+	if (bench->frame++ >= bench->warmupFrames) {
+		bench->cpu.push_back(cpuMs);
+		bench->gpu.push_back(gpuMs);
+	}
+	return bench->frame == bench->warmupFrames + bench->measuredFrames;
+}
+
+//same percentiles as get_gpu_pass_stats() so the numbers line up with the GPU profiler
+INTERNAL inline
+FrameTimeStats compute_frame_time_stats(const std::vector<f64>& samples) {
+	FrameTimeStats stats = { 0 };
+	stats.samples = samples.size();
+	if (samples.empty())
+		return stats;
+
+	std::vector<f64> sorted = samples;
+	std::sort(sorted.begin(), sorted.end());
+	f64 sum = 0;
+	for (u32 i = 0; i < sorted.size(); ++i)
+		sum += sorted[i];
+	u32 last = sorted.size() - 1;
+	stats.mean = sum / sorted.size();
+	stats.p50 = sorted[last * 50 / 100];
+	stats.p95 = sorted[last * 95 / 100];
+	stats.p99 = sorted[last * 99 / 100];
+	stats.max = sorted[last];
+	return stats;
+}
+
+INTERNAL inline
+void write_frame_time_stats(FILE* file, const char* name, FrameTimeStats stats) {
+	fprintf(file, "\t\"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"samples\": %u }",
+		name, stats.mean, stats.p50, stats.p95, stats.p99, stats.max, stats.samples);
+}
+
+//==========================================================================================
+//Description: Prints the CPU and GPU frame time statistics, and writes them out as JSON
+//
+//Parameters:
+//		-The finished benchmark
+//		-GPU profiler the per-pass times are taken from, can be NULL
+//		-Path of the JSON file, NULL to only print
+//==========================================================================================
+INTERNAL inline
+void report_benchmark(Benchmark* bench, GPUProfiler* profiler, const char* jsonPath) {
+	FrameTimeStats cpu = compute_frame_time_stats(bench->cpu);
+	FrameTimeStats gpu = compute_frame_time_stats(bench->gpu);
+	BMT_LOG(INFO, "Benchmark: %u frames after %u warm-up frames, seed %u, camera %s", cpu.samples, bench->warmupFrames, bench->seed, bench->path);
+	BMT_LOG(INFO, "  CPU ms   mean %7.3f  p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f", cpu.mean, cpu.p50, cpu.p95, cpu.p99, cpu.max);
+	BMT_LOG(INFO, "  GPU ms   mean %7.3f  p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f", gpu.mean, gpu.p50, gpu.p95, gpu.p99, gpu.max);
+
+	if (jsonPath == NULL)
+		return;
+	FILE* file = fopen(jsonPath, "w");
+	if (file == NULL) {
+		BMT_LOG(WARNING, "Could not write benchmark results to %s", jsonPath);
+		return;
+	}
+	fprintf(file, "{\n\t\"seed\": %u,\n\t\"warmupFrames\": %u,\n\t\"measuredFrames\": %u,\n\t\"camera\": \"%s\",\n",
+		bench->seed, bench->warmupFrames, cpu.samples, bench->path);
+	write_frame_time_stats(file, "cpu", cpu);
+	fprintf(file, ",\n");
+	write_frame_time_stats(file, "gpu", gpu);
+	//the profiler only keeps its last GPU_PROFILER_HISTORY frames per pass
+	fprintf(file, ",\n\t\"gpuPasses\": {");
+	for (u32 i = 0; profiler && i < profiler->passcount; ++i) {
+		GPUPassStats pass = get_gpu_pass_stats(profiler, i);
+		fprintf(file, "%s\n\t\t\"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"samples\": %u }",
+			i ? "," : "", pass.name, pass.avg, pass.p50, pass.p95, pass.p99, pass.max, pass.samples);
+	}
+	fprintf(file, "\n\t}\n}\n");
+	fclose(file);
+	BMT_LOG(INFO, "Benchmark results written to %s", jsonPath);
+}
+
+//
+//  CAMERA PATHS
+//
+
+INTERNAL inline
+f32 catmull_rom(f32 p0, f32 p1, f32 p2, f32 p3, f32 t) {
+	f32 t2 = t * t;
+	f32 t3 = t2 * t;
+	return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+//==========================================================================================
+//Description: Camera on a Catmull-Rom spline through the keys, which it passes through
+//             exactly at multiples of secondsPerKey
+//
+//Comments: Holds the last key once time runs past the end of the path
+//==========================================================================================
+INTERNAL inline
+Camera sample_camera_path(const CameraPath* path, f32 time) {
+	Camera cam = { 0 };
+	u32 count = path->keys.size();
+	if (count == 0)
+		return cam;
+	f32 at = time / path->secondsPerKey;
+	if (at >= count - 1)
+		return path->keys[count - 1];
+	if (at < 0)
+		at = 0;
+	i32 i = (i32)at;
+	f32 t = at - i;
+	const Camera& k0 = path->keys[i > 0 ? i - 1 : 0];
+	const Camera& k1 = path->keys[i];
+	const Camera& k2 = path->keys[i + 1];
+	const Camera& k3 = path->keys[(u32)i + 2 < count ? i + 2 : count - 1];
+	cam.x = catmull_rom(k0.x, k1.x, k2.x, k3.x, t);
+	cam.y = catmull_rom(k0.y, k1.y, k2.y, k3.y, t);
+	cam.z = catmull_rom(k0.z, k1.z, k2.z, k3.z, t);
+	cam.pitch = catmull_rom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t);
+	cam.yaw = catmull_rom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t);
+	cam.roll = catmull_rom(k0.roll, k1.roll, k2.roll, k3.roll, t);
+	return cam;
+}
+
+INTERNAL inline
+f32 camera_path_duration(const CameraPath* path) {
+	return path->keys.size() > 1 ? (path->keys.size() - 1) * path->secondsPerKey : 0.0f;
+}
+
+//a slow circle around center looking in at it, rising and sinking so the water and the islands both get covered
+INTERNAL inline
+CameraPath create_orbit_camera_path(vec3 center, f32 radius, f32 height, u32 keys, f32 secondsPerKey) {
+	CameraPath path;
+	path.secondsPerKey = secondsPerKey;
+	for (u32 i = 0; i < keys; ++i) {
+		f32 angle = 2.0f * PI * i / (keys - 1);
+		Camera cam = { 0 };
+		cam.x = center.x + sinf(angle) * radius;
+		cam.z = center.z + cosf(angle) * radius;
+		cam.y = center.y + height * (0.6f + 0.4f * sinf(angle * 3.0f));
+		//the camera looks down -z at yaw 0, turn it back towards the center
+		cam.yaw = -angle * 180.0f / PI;
+		cam.pitch = 15.0f;
+		path.keys.push_back(cam);
+	}
+	return path;
+}
+
+INTERNAL inline
+bool load_camera_path(CameraPath* path, const char* filename) {
+	FILE* file = fopen(filename, "r");
+	if (file == NULL) {
+		BMT_LOG(WARNING, "Could not open camera path %s", filename);
+		return false;
+	}
+	path->keys.clear();
+	path->secondsPerKey = 1.0f;
+	if (fscanf(file, "%f", &path->secondsPerKey) != 1 || path->secondsPerKey <= 0)
+		path->secondsPerKey = 1.0f;
+	Camera cam;
+	while (fscanf(file, "%f %f %f %f %f %f", &cam.x, &cam.y, &cam.z, &cam.pitch, &cam.yaw, &cam.roll) == 6)
+		path->keys.push_back(cam);
+	fclose(file);
+	BMT_LOG(INFO, "Loaded camera path %s, %d keys over %.1fs", filename, (int)path->keys.size(), camera_path_duration(path));
+	return !path->keys.empty();
+}
+
+INTERNAL inline
+bool save_camera_path(const CameraPath* path, const char* filename) {
+	FILE* file = fopen(filename, "w");
+	if (file == NULL) {
+		BMT_LOG(WARNING, "Could not write camera path %s", filename);
+		return false;
+	}
+	fprintf(file, "%f\n", path->secondsPerKey);
+	for (u32 i = 0; i < path->keys.size(); ++i) {
+		const Camera& cam = path->keys[i];
+		fprintf(file, "%f %f %f %f %f %f\n", cam.x, cam.y, cam.z, cam.pitch, cam.yaw, cam.roll);
+	}
+	fclose(file);
+	BMT_LOG(INFO, "Saved camera path %s, %d keys", filename, (int)path->keys.size());
+	return true;
+}
+
+//adds the camera as a key every secondsPerKey of simulated time
+INTERNAL inline
+void record_camera_key(CameraPath* path, Camera cam, f32 time) {
+	if (time >= path->keys.size() * path->secondsPerKey)
+		path->keys.push_back(cam);
+}
+
+#endif
@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                         cdlod.h                                 //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef CDLOD_H
+#define CDLOD_H
+
+#include "defines.h"
+#include "maths.h"
+#include "shader.h"
+#include "profiler.h"
+#include <vector>
+
+//Continuous distance-dependent level of detail for large flat surfaces.
+//
+//A grid of root nodes follows the camera. Every root is a quadtree, and a
+//node is subdivided while its children are still inside the next finer
+//level's range around the camera. Together the selected nodes form nested
+//rings of detail around the camera. Nodes outside the view frustum are
+//dropped during selection.
+//
+//Every selected node is drawn as an instance of the same resolution x
+//resolution grid. Where only some children were selected, the remaining
+//quarters use a half-size grid at the parent's spacing. Near the end of a
+//level's range the vertex shader slides every odd vertex onto its even
+//neighbour. The edges then match the next coarser level exactly, so there
+//are no cracks or popping between levels.
+//
+//		CDLOD lod = create_cdlod(5, 32, 16.0f);
+//		init_cdlod_meshes(&lod);
+//		select_cdlod(&lod, cameraPosition, projection * view);
+//		bind_cdlod(&lod, shader);
+//		draw_cdlod(&lod);
+//
+//The grid position (in grid cells) is attribute 0. The node is attribute 1,
+//a vec4 of world offset x, world offset z, cell spacing and level.
+//
+//Surfaces with real height data, like the terrain, set a node callback.
+//The callback supplies each node's height range and reports whether the
+//node's data is loaded yet. A node is only split once all four of its
+//children are loaded, so selection never picks a node that can't be drawn.
+
+#define CDLOD_MAX_LEVELS 10
+
+//Returns false if the node at the given level and node coordinates can't be drawn yet,
+//otherwise fills in its height range.
+typedef bool(*CDLODNodeFunc)(void* data, u32 level, i32 x, i32 z, f32* minHeight, f32* maxHeight);
+
+struct CDLODNode {
+	f32 x;
+	f32 z;
+	f32 spacing;
+	f32 level;
+};
+
+struct CDLOD {
+	u32 levels;
+	u32 resolution;
+	f32 leafSize;
+	//height range of the surface, used for the bounding boxes of the nodes
+	f32 minHeight;
+	f32 maxHeight;
+
+	f32 ranges[CDLOD_MAX_LEVELS];
+	f32 morphStart[CDLOD_MAX_LEVELS];
+
+	//optional, see CDLODNodeFunc
+	CDLODNodeFunc nodeFunc;
+	void* nodeData;
+	//optional limits of the root grid, in root nodes, for surfaces that don't go on forever
+	bool bounded;
+	i32 rootBegin[2];
+	i32 rootEnd[2];
+
+	//selection result, whole nodes and quarters of nodes
+	std::vector<CDLODNode> nodes;
+	std::vector<CDLODNode> quarters;
+	u32 culled;
+
+	//[0] is the full grid, [1] the quarter grid
+	GLuint vao[2];
+	GLuint vbo[2];
+	GLuint ebo[2];
+	GLuint instances[2];
+	u32 indexCount[2];
+};
+
+//==========================================================================================
+//Description: Creates the level of detail settings of a surface
+//
+//Parameters:
+//		-Number of levels, the finest level is 0
+//		-Grid cells along one side of a node, must be even
+//		-World space size of a level 0 node
+//		-Range of level 0 as a multiple of its node size, every level doubles it
+//		-Fraction of each level's range after which its vertices start morphing
+//
+//Comments: The range multiple needs to be about 4 or more so that morphing finishes
+//          before a node meets a coarser neighbour. Creates no GL objects, see
+//          init_cdlod_meshes()
+//==========================================================================================
+INTERNAL inline
+CDLOD create_cdlod(u32 levels, u32 resolution, f32 leafSize, f32 rangeMultiple = 5.0f, f32 morphRatio = 0.7f) {
+	CDLOD lod = { 0 };
+	if (levels > CDLOD_MAX_LEVELS)
+		levels = CDLOD_MAX_LEVELS;
+	if (resolution & 1)
+		resolution++;
+	lod.levels = levels;
+	lod.resolution = resolution;
+	lod.leafSize = leafSize;
+	lod.minHeight = -1.0f;
+	lod.maxHeight = 1.0f;
+
+	f32 previous = 0.0f;
+	for (u32 i = 0; i < levels; ++i) {
+		lod.ranges[i] = leafSize * rangeMultiple * (f32)(1 << i);
+		lod.morphStart[i] = previous + (lod.ranges[i] - previous) * morphRatio;
+		previous = lod.ranges[i];
+	}
+	return lod;
+}
+
+INTERNAL inline
+void init_cdlod_meshes(CDLOD* lod) {
+	for (u32 m = 0; m < 2; ++m) {
+		u32 cells = m == 0 ? lod->resolution : lod->resolution / 2;
+		std::vector<vec2> vertices;
+		std::vector<GLushort> indices;
+		for (u32 z = 0; z <= cells; ++z)
+			for (u32 x = 0; x <= cells; ++x)
+				vertices.push_back(V2((f32)x, (f32)z));
+		for (u32 z = 0; z < cells; ++z) {
+			for (u32 x = 0; x < cells; ++x) {
+				GLushort topLeft = z * (cells + 1) + x;
+				GLushort bottomLeft = topLeft + cells + 1;
+				indices.push_back(topLeft);
+				indices.push_back(bottomLeft);
+				indices.push_back(topLeft + 1);
+				indices.push_back(topLeft + 1);
+				indices.push_back(bottomLeft);
+				indices.push_back(bottomLeft + 1);
+			}
+		}
+
+		glGenVertexArrays(1, &lod->vao[m]);
+		glBindVertexArray(lod->vao[m]);
+
+		glGenBuffers(1, &lod->vbo[m]);
+		glBindBuffer(GL_ARRAY_BUFFER, lod->vbo[m]);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vec2), &vertices[0], GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), (const GLvoid*)0);
+
+		glGenBuffers(1, &lod->instances[m]);
+		glBindBuffer(GL_ARRAY_BUFFER, lod->instances[m]);
+		glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CDLODNode), (const GLvoid*)0);
+		glVertexAttribDivisor(1, 1);
+
+		glGenBuffers(1, &lod->ebo[m]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod->ebo[m]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+		lod->indexCount[m] = indices.size();
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
+
+INTERNAL inline
+void dispose_cdlod(CDLOD* lod) {
+	for (u32 m = 0; m < 2; ++m) {
+		if (!lod->vao[m])
+			continue;
+		glDeleteVertexArrays(1, &lod->vao[m]);
+		glDeleteBuffers(1, &lod->vbo[m]);
+		glDeleteBuffers(1, &lod->ebo[m]);
+		glDeleteBuffers(1, &lod->instances[m]);
+		lod->vao[m] = 0;
+	}
+}
+
+//the six planes of the frustum of a column major view projection matrix, pointing inwards
+INTERNAL inline
+void extract_frustum_planes(mat4 viewProjection, vec4 planes[6]) {
+	const f32* m = viewProjection.elements;
+	vec4 rows[4];
+	for (u32 i = 0; i < 4; ++i)
+		rows[i] = V4(m[i], m[i + 4], m[i + 8], m[i + 12]);
+	for (u32 i = 0; i < 3; ++i) {
+		planes[i * 2 + 0] = rows[3] + rows[i];
+		planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+}
+
+INTERNAL inline
+bool aabb_in_frustum(const vec4 planes[6], vec3 min, vec3 max) {
+	for (u32 i = 0; i < 6; ++i) {
+		//the corner furthest along the plane normal
+		vec3 corner = V3(planes[i].x > 0 ? max.x : min.x, planes[i].y > 0 ? max.y : min.y, planes[i].z > 0 ? max.z : min.z);
+		if (planes[i].x * corner.x + planes[i].y * corner.y + planes[i].z * corner.z + planes[i].w < 0)
+			return false;
+	}
+	return true;
+}
+
+INTERNAL inline
+bool sphere_intersects_aabb(vec3 center, f32 radius, vec3 min, vec3 max) {
+	f32 dx = center.x < min.x ? min.x - center.x : (center.x > max.x ? center.x - max.x : 0.0f);
+	f32 dy = center.y < min.y ? min.y - center.y : (center.y > max.y ? center.y - max.y : 0.0f);
+	f32 dz = center.z < min.z ? min.z - center.z : (center.z > max.z ? center.z - max.z : 0.0f);
+	return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+INTERNAL inline
+bool get_cdlod_node_bounds(CDLOD* lod, u32 level, i32 x, i32 z, f32* minHeight, f32* maxHeight) {
+	if (!lod->nodeFunc) {
+		*minHeight = lod->minHeight;
+		*maxHeight = lod->maxHeight;
+		return true;
+	}
+	return lod->nodeFunc(lod->nodeData, level, x, z, minHeight, maxHeight);
+}
+
+//returns false when the node is outside its level's range and must be drawn by its parent
+INTERNAL
+bool select_cdlod_node(CDLOD* lod, i32 x, i32 z, u32 level, f32 minHeight, f32 maxHeight, vec3 camera, const vec4 planes[6]) {
+	f32 size = lod->leafSize * (f32)(1 << level);
+	vec3 min = V3(x * size, minHeight, z * size);
+	vec3 max = V3(min.x + size, maxHeight, min.z + size);
+	if (!sphere_intersects_aabb(camera, lod->ranges[level], min, max))
+		return false;
+	if (!aabb_in_frustum(planes, min, max)) {
+		lod->culled++;
+		return true;
+	}
+
+	f32 spacing = size / lod->resolution;
+	bool split = level > 0 && sphere_intersects_aabb(camera, lod->ranges[level - 1], min, max);
+	//children that can't be drawn yet keep the whole node at this level
+	f32 childMin[4], childMax[4];
+	for (u32 i = 0; split && i < 4; ++i)
+		split = get_cdlod_node_bounds(lod, level - 1, x * 2 + (i & 1), z * 2 + (i >> 1), &childMin[i], &childMax[i]);
+	if (!split) {
+		lod->nodes.push_back({ min.x, min.z, spacing, (f32)level });
+		return true;
+	}
+
+	for (u32 i = 0; i < 4; ++i) {
+		i32 childX = x * 2 + (i & 1);
+		i32 childZ = z * 2 + (i >> 1);
+		if (!select_cdlod_node(lod, childX, childZ, level - 1, childMin[i], childMax[i], camera, planes))
+			lod->quarters.push_back({ min.x + (i & 1) * size * 0.5f, min.z + (i >> 1) * size * 0.5f, spacing, (f32)level });
+	}
+	return true;
+}
+
+//==========================================================================================
+//Description: Selects and frustum culls the nodes to draw from the given camera
+//==========================================================================================
+INTERNAL inline
+void select_cdlod(CDLOD* lod, vec3 camera, mat4 viewProjection) {
+	BMT_PROFILE_FUNCTION();
+	lod->nodes.clear();
+	lod->quarters.clear();
+	lod->culled = 0;
+
+	vec4 planes[6];
+	extract_frustum_planes(viewProjection, planes);
+
+	//every root that the coarsest range reaches, snapped to the root grid
+	u32 top = lod->levels - 1;
+	f32 rootSize = lod->leafSize * (f32)(1 << top);
+	f32 range = lod->ranges[top];
+	i32 beginX = (i32)floorf((camera.x - range) / rootSize);
+	i32 endX = (i32)floorf((camera.x + range) / rootSize);
+	i32 beginZ = (i32)floorf((camera.z - range) / rootSize);
+	i32 endZ = (i32)floorf((camera.z + range) / rootSize);
+	if (lod->bounded) {
+		beginX = beginX > lod->rootBegin[0] ? beginX : lod->rootBegin[0];
+		beginZ = beginZ > lod->rootBegin[1] ? beginZ : lod->rootBegin[1];
+		endX = endX < lod->rootEnd[0] - 1 ? endX : lod->rootEnd[0] - 1;
+		endZ = endZ < lod->rootEnd[1] - 1 ? endZ : lod->rootEnd[1] - 1;
+	}
+	for (i32 z = beginZ; z <= endZ; ++z) {
+		for (i32 x = beginX; x <= endX; ++x) {
+			f32 minHeight, maxHeight;
+			if (get_cdlod_node_bounds(lod, top, x, z, &minHeight, &maxHeight))
+				select_cdlod_node(lod, x, z, top, minHeight, maxHeight, camera, planes);
+		}
+	}
+}
+
+//uploads the morph range of every level used by the vertex shader
+INTERNAL inline
+void bind_cdlod(CDLOD* lod, Shader shader) {
+	char name[32];
+	for (u32 i = 0; i < lod->levels; ++i) {
+		snprintf(name, sizeof(name), "cdlodMorph[%u]", i);
+		upload_vec2(shader, name, V2(lod->morphStart[i], lod->ranges[i]));
+	}
+}
+
+INTERNAL inline
+void draw_cdlod(CDLOD* lod) {
+	BMT_PROFILE_FUNCTION();
+	std::vector<CDLODNode>* lists[] = { &lod->nodes, &lod->quarters };
+	for (u32 m = 0; m < 2; ++m) {
+		if (lists[m]->empty())
+			continue;
+		glBindBuffer(GL_ARRAY_BUFFER, lod->instances[m]);
+		glBufferData(GL_ARRAY_BUFFER, lists[m]->size() * sizeof(CDLODNode), &(*lists[m])[0], GL_STREAM_DRAW);
+		glBindVertexArray(lod->vao[m]);
+		glDrawElementsInstanced(GL_TRIANGLES, lod->indexCount[m], GL_UNSIGNED_SHORT, 0, lists[m]->size());
+		BMT_STAT_ADD(STAT_BUFFER_BYTES, lists[m]->size() * sizeof(CDLODNode));
+		BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+		BMT_STAT_DRAW(GL_TRIANGLES, lod->indexCount[m], lists[m]->size());
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+#endif
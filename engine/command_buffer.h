@@ -0,0 +1,435 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        command_buffer.h                         //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include "defines.h"
+#include "maths.h"
+#include "shader.h"
+#include <vector>
+#include <string.h>
+
+//Draw commands recorded off the GL thread.
+//
+//A CommandBuffer is a flat run of small POD commands, each a CommandHeader
+//followed by its payload. Recording only writes bytes, it never touches GL, so
+//any thread can fill its own buffer: split a pass into chunks, give each chunk a
+//buffer and record them across the job system. The GL thread then replays the
+//buffers back to back in chunk order.
+//
+//Replay keeps track of the bound program, pipeline state, vertex array and
+//textures across every buffer it is given, so the binds each chunk had to
+//record to stand on its own are merged away when they repeat what is already
+//bound.
+//
+//Uniforms are recorded by location. Looking a location up is a GL call, so
+//resolve them once on the GL thread (get_uniform_location) and hand the
+//locations to the recording jobs.
+//
+//		reset_command_buffer(&buffer);
+//		record_bind_pipeline(&buffer, shader.ID, PIPELINE_DEFAULT);
+//		record_bind_vertex_array(&buffer, mesh.vao, 0x7);
+//		record_uniform_mat4(&buffer, transformLocation, transform);
+//		record_draw_indexed(&buffer, PRIMITIVE_TRIANGLES, mesh.indexcount, INDEX_U16, 0);
+//		...
+//		replay_command_buffers(&buffer, 1);
+
+enum CommandType {
+	COMMAND_BIND_PIPELINE,
+	COMMAND_BIND_VERTEX_ARRAY,
+	COMMAND_BIND_TEXTURE,
+	COMMAND_UNIFORM_INT,
+	COMMAND_UNIFORM_FLOAT,
+	COMMAND_UNIFORM_VEC3,
+	COMMAND_UNIFORM_VEC4,
+	COMMAND_UNIFORM_MAT4,
+	COMMAND_DRAW_INDEXED,
+	COMMAND_DRAW_INSTANCED
+};
+
+//pipeline state bound along with the program, anything not set is the GL default
+enum PipelineFlags {
+	PIPELINE_DEFAULT = 0,
+	//depth test passes only on equal depth, for drawing over a depth pre-pass
+	PIPELINE_DEPTH_EQUAL = 1 << 0,
+	PIPELINE_DEPTH_READ_ONLY = 1 << 1,
+	PIPELINE_BLEND = 1 << 2,
+	PIPELINE_NO_CULL = 1 << 3
+};
+
+enum PrimitiveType {
+	PRIMITIVE_TRIANGLES,
+	PRIMITIVE_LINES,
+	PRIMITIVE_POINTS
+};
+
+enum IndexType {
+	INDEX_U16,
+	INDEX_U32
+};
+
+enum TextureTarget {
+	TEXTURE_TARGET_2D,
+	TEXTURE_TARGET_2D_ARRAY,
+	TEXTURE_TARGET_BUFFER
+};
+
+struct CommandHeader {
+	u16 type;
+	//header and payload together, in bytes
+	u16 size;
+};
+
+struct BindPipelineCommand {
+	u32 program;
+	u32 flags;
+};
+
+struct BindVertexArrayCommand {
+	u32 vao;
+	//bit i enables attribute i
+	u32 attributes;
+};
+
+struct BindTextureCommand {
+	u32 slot;
+	u32 target;
+	u32 texture;
+};
+
+struct UniformCommand {
+	i32 location;
+	union {
+		i32 i;
+		f32 f;
+		f32 v[4];
+		f32 m[16];
+	};
+};
+
+struct DrawCommand {
+	u32 primitive;
+	u32 count;
+	u32 indexType;
+	//into the index buffer, in indices
+	u32 first;
+	u32 instances;
+};
+
+struct CommandBuffer {
+	std::vector<u8> data;
+	u32 commandCount;
+	u32 drawCount;
+};
+
+//what a replay actually sent to GL, against what was recorded
+struct CommandReplayStats {
+	u32 commands;
+	u32 draws;
+	u32 binds;
+	u32 mergedBinds;
+};
+
+INTERNAL inline
+void reset_command_buffer(CommandBuffer* buffer) {
+	//clear() keeps the capacity, after the first few frames recording stops allocating
+	buffer->data.clear();
+	buffer->commandCount = 0;
+	buffer->drawCount = 0;
+}
+
+INTERNAL inline
+void* push_command(CommandBuffer* buffer, CommandType type, u32 payload) {
+	u32 size = sizeof(CommandHeader) + ((payload + 3) & ~3u);
+	size_t offset = buffer->data.size();
+	buffer->data.resize(offset + size);
+	CommandHeader* header = (CommandHeader*)&buffer->data[offset];
+	header->type = type;
+	header->size = size;
+	buffer->commandCount++;
+	return header + 1;
+}
+
+INTERNAL inline
+void record_bind_pipeline(CommandBuffer* buffer, u32 program, u32 flags = PIPELINE_DEFAULT) {
+	BindPipelineCommand* command = (BindPipelineCommand*)push_command(buffer, COMMAND_BIND_PIPELINE, sizeof(BindPipelineCommand));
+	command->program = program;
+	command->flags = flags;
+}
+
+INTERNAL inline
+void record_bind_vertex_array(CommandBuffer* buffer, u32 vao, u32 attributes) {
+	BindVertexArrayCommand* command = (BindVertexArrayCommand*)push_command(buffer, COMMAND_BIND_VERTEX_ARRAY, sizeof(BindVertexArrayCommand));
+	command->vao = vao;
+	command->attributes = attributes;
+}
+
+INTERNAL inline
+void record_bind_texture(CommandBuffer* buffer, u32 slot, u32 texture, TextureTarget target = TEXTURE_TARGET_2D) {
+	BindTextureCommand* command = (BindTextureCommand*)push_command(buffer, COMMAND_BIND_TEXTURE, sizeof(BindTextureCommand));
+	command->slot = slot;
+	command->target = target;
+	command->texture = texture;
+}
+
+//uniforms only carry as many bytes as their value needs, a location of -1 records nothing
+INTERNAL inline
+void record_uniform(CommandBuffer* buffer, CommandType type, i32 location, const void* value, u32 bytes) {
+	if (location < 0)
+		return;
+	UniformCommand* command = (UniformCommand*)push_command(buffer, type, sizeof(i32) + bytes);
+	command->location = location;
+	memcpy(command->v, value, bytes);
+}
+
+INTERNAL inline
+void record_uniform_int(CommandBuffer* buffer, i32 location, i32 value) {
+	record_uniform(buffer, COMMAND_UNIFORM_INT, location, &value, sizeof(i32));
+}
+
+INTERNAL inline
+void record_uniform_float(CommandBuffer* buffer, i32 location, f32 value) {
+	record_uniform(buffer, COMMAND_UNIFORM_FLOAT, location, &value, sizeof(f32));
+}
+
+INTERNAL inline
+void record_uniform_vec3(CommandBuffer* buffer, i32 location, vec3 value) {
+	record_uniform(buffer, COMMAND_UNIFORM_VEC3, location, &value, sizeof(f32) * 3);
+}
+
+INTERNAL inline
+void record_uniform_vec4(CommandBuffer* buffer, i32 location, vec4 value) {
+	record_uniform(buffer, COMMAND_UNIFORM_VEC4, location, &value, sizeof(f32) * 4);
+}
+
+INTERNAL inline
+void record_uniform_mat4(CommandBuffer* buffer, i32 location, mat4 value) {
+	record_uniform(buffer, COMMAND_UNIFORM_MAT4, location, value.elements, sizeof(f32) * 16);
+}
+
+INTERNAL inline
+void record_draw_indexed(CommandBuffer* buffer, PrimitiveType primitive, u32 count, IndexType indexType, u32 first = 0) {
+	DrawCommand* command = (DrawCommand*)push_command(buffer, COMMAND_DRAW_INDEXED, sizeof(DrawCommand));
+	command->primitive = primitive;
+	command->count = count;
+	command->indexType = indexType;
+	command->first = first;
+	command->instances = 1;
+	buffer->drawCount++;
+}
+
+INTERNAL inline
+void record_draw_instanced(CommandBuffer* buffer, PrimitiveType primitive, u32 count, IndexType indexType, u32 instances, u32 first = 0) {
+	DrawCommand* command = (DrawCommand*)push_command(buffer, COMMAND_DRAW_INSTANCED, sizeof(DrawCommand));
+	command->primitive = primitive;
+	command->count = count;
+	command->indexType = indexType;
+	command->first = first;
+	command->instances = instances;
+	buffer->drawCount++;
+}
+
+//
+//  GL REPLAY
+//
+
+#define COMMAND_TEXTURE_SLOTS 16
+
+INTERNAL inline
+GLenum gl_primitive(u32 primitive) {
+	switch (primitive) {
+		case PRIMITIVE_LINES:  return GL_LINES;
+		case PRIMITIVE_POINTS: return GL_POINTS;
+		default:               return GL_TRIANGLES;
+	}
+}
+
+INTERNAL inline
+GLenum gl_texture_target(u32 target) {
+	switch (target) {
+		case TEXTURE_TARGET_2D_ARRAY: return GL_TEXTURE_2D_ARRAY;
+		case TEXTURE_TARGET_BUFFER:   return GL_TEXTURE_BUFFER;
+		default:                      return GL_TEXTURE_2D;
+	}
+}
+
+INTERNAL inline
+void apply_pipeline_flags(u32 flags, u32 previous) {
+	u32 changed = flags ^ previous;
+	if (changed & PIPELINE_DEPTH_EQUAL)
+		glDepthFunc(flags & PIPELINE_DEPTH_EQUAL ? GL_EQUAL : GL_LESS);
+	if (changed & PIPELINE_DEPTH_READ_ONLY)
+		glDepthMask(flags & PIPELINE_DEPTH_READ_ONLY ? GL_FALSE : GL_TRUE);
+	if (changed & PIPELINE_BLEND) {
+		if (flags & PIPELINE_BLEND) glEnable(GL_BLEND);
+		else glDisable(GL_BLEND);
+	}
+	if (changed & PIPELINE_NO_CULL) {
+		if (flags & PIPELINE_NO_CULL) glDisable(GL_CULL_FACE);
+		else glEnable(GL_CULL_FACE);
+	}
+}
+
+//==========================================================================================
+//Description: Sends the buffers to GL in order, must be called on the GL thread
+//
+//Parameters:
+//		-The recorded buffers, replayed first to last
+//		-Number of buffers
+//
+//Comments: Nothing is known to be bound when replay starts, so the first bind of each
+//          kind always goes through. The pipeline state is put back to the defaults
+//          and the vertex array unbound when it ends; the program stays bound.
+//==========================================================================================
+INTERNAL inline
+CommandReplayStats replay_command_buffers(const CommandBuffer* buffers, u32 count) {
+	CommandReplayStats stats = { 0 };
+	u32 program = 0xFFFFFFFF;
+	u32 flags = PIPELINE_DEFAULT;
+	bool flagsKnown = false;
+	u32 vao = 0xFFFFFFFF;
+	u32 textures[COMMAND_TEXTURE_SLOTS];
+	memset(textures, 0xFF, sizeof(textures));
+	u32 activeSlot = 0xFFFFFFFF;
+
+	for (u32 b = 0; b < count; ++b) {
+		const u8* at = buffers[b].data.data();
+		const u8* end = at + buffers[b].data.size();
+		while (at < end) {
+			const CommandHeader* header = (const CommandHeader*)at;
+			const void* payload = header + 1;
+			at += header->size;
+			stats.commands++;
+
+			switch (header->type) {
+			case COMMAND_BIND_PIPELINE: {
+				const BindPipelineCommand* command = (const BindPipelineCommand*)payload;
+				bool merged = true;
+				if (command->program != program) {
+					glUseProgram(command->program);
+					program = command->program;
+					BMT_STAT_ADD(STAT_PROGRAM_BINDS, 1);
+					merged = false;
+				}
+				if (!flagsKnown || command->flags != flags) {
+					//the state before replay is unknown, force every flag the first time
+					apply_pipeline_flags(command->flags, flagsKnown ? flags : ~command->flags);
+					flags = command->flags;
+					flagsKnown = true;
+					merged = false;
+				}
+				if (merged) stats.mergedBinds++; else stats.binds++;
+			} break;
+			case COMMAND_BIND_VERTEX_ARRAY: {
+				const BindVertexArrayCommand* command = (const BindVertexArrayCommand*)payload;
+				if (command->vao == vao) {
+					stats.mergedBinds++;
+					break;
+				}
+				glBindVertexArray(command->vao);
+				//enabled arrays are vertex array state, enabling them again is cheap but not free
+				for (u32 i = 0; i < 16; ++i)
+					if (command->attributes & (1 << i))
+						glEnableVertexAttribArray(i);
+				vao = command->vao;
+				stats.binds++;
+				BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+			} break;
+			case COMMAND_BIND_TEXTURE: {
+				const BindTextureCommand* command = (const BindTextureCommand*)payload;
+				if (command->slot < COMMAND_TEXTURE_SLOTS && textures[command->slot] == command->texture) {
+					stats.mergedBinds++;
+					break;
+				}
+				if (command->slot != activeSlot) {
+					glActiveTexture(GL_TEXTURE0 + command->slot);
+					activeSlot = command->slot;
+				}
+				glBindTexture(gl_texture_target(command->target), command->texture);
+				if (command->slot < COMMAND_TEXTURE_SLOTS)
+					textures[command->slot] = command->texture;
+				stats.binds++;
+				BMT_STAT_ADD(STAT_TEXTURE_BINDS, 1);
+			} break;
+			case COMMAND_UNIFORM_INT: {
+				const UniformCommand* command = (const UniformCommand*)payload;
+				glUniform1i(command->location, command->i);
+				BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
+			} break;
+			case COMMAND_UNIFORM_FLOAT: {
+				const UniformCommand* command = (const UniformCommand*)payload;
+				glUniform1f(command->location, command->f);
+				BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
+			} break;
+			case COMMAND_UNIFORM_VEC3: {
+				const UniformCommand* command = (const UniformCommand*)payload;
+				glUniform3f(command->location, command->v[0], command->v[1], command->v[2]);
+				BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
+			} break;
+			case COMMAND_UNIFORM_VEC4: {
+				const UniformCommand* command = (const UniformCommand*)payload;
+				glUniform4f(command->location, command->v[0], command->v[1], command->v[2], command->v[3]);
+				BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
+			} break;
+			case COMMAND_UNIFORM_MAT4: {
+				const UniformCommand* command = (const UniformCommand*)payload;
+				glUniformMatrix4fv(command->location, 1, GL_FALSE, command->m);
+				BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
+			} break;
+			case COMMAND_DRAW_INDEXED:
+			case COMMAND_DRAW_INSTANCED: {
+				const DrawCommand* command = (const DrawCommand*)payload;
+				GLenum type = command->indexType == INDEX_U32 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+				u32 stride = command->indexType == INDEX_U32 ? 4 : 2;
+				const GLvoid* offset = (const GLvoid*)(size_t)(command->first * stride);
+				if (header->type == COMMAND_DRAW_INSTANCED)
+					glDrawElementsInstanced(gl_primitive(command->primitive), command->count, type, offset, command->instances);
+				else
+					glDrawElements(gl_primitive(command->primitive), command->count, type, offset);
+				stats.draws++;
+				BMT_STAT_DRAW(gl_primitive(command->primitive), command->count,
+					header->type == COMMAND_DRAW_INSTANCED ? command->instances : 1);
+			} break;
+			default:
+				BMT_LOG(WARNING, "Unknown command %d in command buffer", header->type);
+				at = end;
+				break;
+			}
+		}
+	}
+
+	if (flagsKnown && flags != PIPELINE_DEFAULT)
+		apply_pipeline_flags(PIPELINE_DEFAULT, flags);
+	if (activeSlot != 0xFFFFFFFF)
+		glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(0);
+	return stats;
+}
+
+#endif
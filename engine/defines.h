@@ -42,6 +42,13 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+//SSE2 is always there on x64, so the SIMD paths are on by default there and
+//fall back to plain scalar code everywhere else.
+#if !defined(BMT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BMT_SSE 1
+#include <emmintrin.h>
+#endif
+
 #define INTERNAL static
 #define LOCAL static
 #define GLOBAL static
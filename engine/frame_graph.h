@@ -0,0 +1,384 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        frame_graph.h                            //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include "defines.h"
+#include "maths.h"
+#include "texture.h"
+#include "render_targets.h"
+#include "gpu_profiler.h"
+#include "profiler.h"
+#include <chrono>
+
+//Frame graph, rebuilt every frame.
+//
+//Passes are declared in submission order, along with the resources each one
+//reads and writes. Compiling walks the passes backwards from the outputs
+//(the window) and culls every pass whose writes nobody reads, so a pass whose
+//output is unused simply doesn't run. Declaring the passes in order already
+//puts every writer before its readers, so the surviving passes keep their
+//declared order.
+//
+//Transient targets get their first and last use from the surviving passes.
+//They are acquired from the render target pool right before their first use
+//and released right after their last one, so later passes alias them. A
+//transient is cleared when it is first written, which discards whatever the
+//previous user of the pooled target left in it. GL 3.3 has no
+//glInvalidateFramebuffer, so dropping the contents after the last use is only
+//marked in the dump.
+//
+//Executing binds the first target a pass writes and sets the viewport to it.
+//Each pass is timed on the CPU, and on the GPU through the GPU profiler under
+//the pass name.
+//
+//		begin_frame_graph(&graph, &pool, &gpuProfiler);
+//		u32 window = import_frame_target(&graph, "window", windowBuffer, true);
+//		u32 scene = create_frame_target(&graph, "scene", width, height, RENDER_TARGET_SCENE);
+//		u32 pass = add_frame_pass(&graph, "main", main_pass, &context);
+//		write_frame_target(&graph, pass, scene);
+//		...
+//		compile_frame_graph(&graph);
+//		execute_frame_graph(&graph);
+
+#define FRAME_GRAPH_MAX_PASSES        32
+#define FRAME_GRAPH_MAX_RESOURCES     32
+#define FRAME_GRAPH_MAX_PASS_TARGETS  8
+
+struct FrameGraph;
+typedef void(*FramePassFunc)(FrameGraph* graph, void* data);
+
+struct FrameResource {
+	const char* name;
+	u32 width;
+	u32 height;
+	RenderTargetFormat format;
+	u32 samples;
+	//imported resources live outside the graph, external ones can't even be bound
+	bool imported;
+	bool external;
+	bool output;
+	Framebuffer buffer;
+	//positions in the execution order, -1 when no surviving pass touches it
+	i32 firstUse;
+	i32 lastUse;
+	bool written;
+};
+
+struct FramePass {
+	const char* name;
+	FramePassFunc func;
+	void* data;
+	u32 reads[FRAME_GRAPH_MAX_PASS_TARGETS];
+	u32 readCount;
+	u32 writes[FRAME_GRAPH_MAX_PASS_TARGETS];
+	bool clears[FRAME_GRAPH_MAX_PASS_TARGETS];
+	u32 writeCount;
+	bool sideEffects;
+	bool culled;
+	f64 cpuMs;
+};
+
+struct FrameGraph {
+	FramePass passes[FRAME_GRAPH_MAX_PASSES];
+	u32 passCount;
+	FrameResource resources[FRAME_GRAPH_MAX_RESOURCES];
+	u32 resourceCount;
+	u32 order[FRAME_GRAPH_MAX_PASSES];
+	u32 orderCount;
+	RenderTargetPool* pool;
+	GPUProfiler* profiler;
+};
+
+//==========================================================================================
+//Description: Starts declaring a new frame
+//
+//Parameters:
+//		-The graph, cleared of last frame's passes
+//		-Pool the transient targets come from
+//		-GPU profiler to time the passes with, can be NULL
+//==========================================================================================
+INTERNAL inline
+void begin_frame_graph(FrameGraph* graph, RenderTargetPool* pool, GPUProfiler* profiler = NULL) {
+	graph->passCount = 0;
+	graph->resourceCount = 0;
+	graph->orderCount = 0;
+	graph->pool = pool;
+	graph->profiler = profiler;
+}
+
+INTERNAL inline
+u32 add_frame_resource(FrameGraph* graph, const char* name) {
+	BMT_ASSERT(graph->resourceCount < FRAME_GRAPH_MAX_RESOURCES);
+	FrameResource* resource = &graph->resources[graph->resourceCount];
+	memset(resource, 0, sizeof(FrameResource));
+	resource->name = name;
+	resource->firstUse = resource->lastUse = -1;
+	return graph->resourceCount++;
+}
+
+//==========================================================================================
+//Description: Declares a transient target, allocated from the pool only if a pass needs it
+//==========================================================================================
+INTERNAL inline
+u32 create_frame_target(FrameGraph* graph, const char* name, u32 width, u32 height, RenderTargetFormat format, u32 samples = 1) {
+	u32 index = add_frame_resource(graph, name);
+	FrameResource* resource = &graph->resources[index];
+	resource->width = width;
+	resource->height = height;
+	resource->format = format;
+	resource->samples = samples;
+	return index;
+}
+
+//==========================================================================================
+//Description: Declares a framebuffer owned by someone else, e.g. the window
+//
+//Comments: Passes that write an output are never culled. The window is a framebuffer with
+//          an ID of 0 and the size of the window.
+//==========================================================================================
+INTERNAL inline
+u32 import_frame_target(FrameGraph* graph, const char* name, Framebuffer buffer, bool output) {
+	u32 index = add_frame_resource(graph, name);
+	FrameResource* resource = &graph->resources[index];
+	resource->imported = true;
+	resource->output = output;
+	resource->buffer = buffer;
+	resource->width = buffer.texture.width;
+	resource->height = buffer.texture.height;
+	return index;
+}
+
+//==========================================================================================
+//Description: Declares a resource the graph can't bind, e.g. the shadow map array
+//
+//Comments: Only tracks the dependency, the passes that use it bind it themselves
+//==========================================================================================
+INTERNAL inline
+u32 import_frame_resource(FrameGraph* graph, const char* name) {
+	u32 index = add_frame_resource(graph, name);
+	graph->resources[index].imported = true;
+	graph->resources[index].external = true;
+	return index;
+}
+
+INTERNAL inline
+u32 add_frame_pass(FrameGraph* graph, const char* name, FramePassFunc func, void* data) {
+	BMT_ASSERT(graph->passCount < FRAME_GRAPH_MAX_PASSES);
+	FramePass* pass = &graph->passes[graph->passCount];
+	memset(pass, 0, sizeof(FramePass));
+	pass->name = name;
+	pass->func = func;
+	pass->data = data;
+	return graph->passCount++;
+}
+
+INTERNAL inline
+void read_frame_target(FrameGraph* graph, u32 pass, u32 resource) {
+	FramePass* p = &graph->passes[pass];
+	BMT_ASSERT(p->readCount < FRAME_GRAPH_MAX_PASS_TARGETS);
+	p->reads[p->readCount++] = resource;
+}
+
+//==========================================================================================
+//Description: Declares that a pass writes a resource
+//
+//Comments: clear only matters for the first write of a transient target. Pass false when
+//          the pass overwrites every pixel anyway, like a blit
+//==========================================================================================
+INTERNAL inline
+void write_frame_target(FrameGraph* graph, u32 pass, u32 resource, bool clear = true) {
+	FramePass* p = &graph->passes[pass];
+	BMT_ASSERT(p->writeCount < FRAME_GRAPH_MAX_PASS_TARGETS);
+	p->clears[p->writeCount] = clear;
+	p->writes[p->writeCount++] = resource;
+}
+
+//passes with effects the graph can't see, like reading back a query, are never culled
+INTERNAL inline
+void keep_frame_pass(FrameGraph* graph, u32 pass) {
+	graph->passes[pass].sideEffects = true;
+}
+
+//==========================================================================================
+//Description: Returns the framebuffer behind a resource
+//
+//Comments: Transient targets only exist between their first and last use, so only call
+//          this from a pass that declared the resource
+//==========================================================================================
+INTERNAL inline
+Framebuffer get_frame_target(FrameGraph* graph, u32 resource) {
+	return graph->resources[resource].buffer;
+}
+
+//==========================================================================================
+//Description: Culls the passes nothing depends on and works out every resource's lifetime
+//==========================================================================================
+INTERNAL inline
+void compile_frame_graph(FrameGraph* graph) {
+	BMT_PROFILE_FUNCTION();
+	bool needed[FRAME_GRAPH_MAX_RESOURCES] = { 0 };
+	for (u32 i = 0; i < graph->resourceCount; ++i)
+		needed[i] = graph->resources[i].output;
+
+	//walking backwards, a pass survives if a later survivor reads what it writes
+	for (i32 i = (i32)graph->passCount - 1; i >= 0; --i) {
+		FramePass* pass = &graph->passes[i];
+		bool keep = pass->sideEffects;
+		for (u32 w = 0; w < pass->writeCount && !keep; ++w)
+			keep = needed[pass->writes[w]];
+		pass->culled = !keep;
+		if (keep)
+			for (u32 r = 0; r < pass->readCount; ++r)
+				needed[pass->reads[r]] = true;
+	}
+
+	graph->orderCount = 0;
+	for (u32 i = 0; i < graph->passCount; ++i) {
+		FramePass* pass = &graph->passes[i];
+		if (pass->culled)
+			continue;
+		i32 position = graph->orderCount;
+		graph->order[graph->orderCount++] = i;
+		u32* lists[] = { pass->reads, pass->writes };
+		u32 counts[] = { pass->readCount, pass->writeCount };
+		for (u32 list = 0; list < 2; ++list) {
+			for (u32 j = 0; j < counts[list]; ++j) {
+				FrameResource* resource = &graph->resources[lists[list][j]];
+				if (resource->firstUse < 0) {
+					resource->firstUse = position;
+					if (list == 0 && !resource->imported)
+						BMT_LOG(WARNING, "Pass '%s' reads '%s' before anything wrote it", pass->name, resource->name);
+				}
+				resource->lastUse = position;
+			}
+		}
+	}
+}
+
+//==========================================================================================
+//Description: Runs the surviving passes, allocating and releasing the transient targets
+//
+//Comments: Leaves the window framebuffer bound
+//==========================================================================================
+INTERNAL inline
+void execute_frame_graph(FrameGraph* graph) {
+	for (u32 i = 0; i < graph->orderCount; ++i) {
+		FramePass* pass = &graph->passes[graph->order[i]];
+		BMT_PROFILE_ZONE(pass->name);
+		BMT_STAT_PASS_BEGIN(pass->name);
+
+		for (u32 r = 0; r < graph->resourceCount; ++r) {
+			FrameResource* resource = &graph->resources[r];
+			if (resource->firstUse == (i32)i && !resource->imported)
+				resource->buffer = acquire_render_target(graph->pool, resource->width, resource->height, resource->format, resource->samples);
+		}
+
+		//clear the transients written for the first time, then bind the first target written
+		i32 bound = -1;
+		for (u32 w = 0; w < pass->writeCount; ++w) {
+			FrameResource* resource = &graph->resources[pass->writes[w]];
+			if (resource->external)
+				continue;
+			if (!resource->written && !resource->imported && pass->clears[w]) {
+				bind_framebuffer(resource->buffer);
+				glViewport(0, 0, resource->width, resource->height);
+				glClear(resource->format == RENDER_TARGET_DEPTH ? GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			}
+			resource->written = true;
+			if (bound < 0)
+				bound = pass->writes[w];
+		}
+		if (bound >= 0) {
+			FrameResource* resource = &graph->resources[bound];
+			bind_framebuffer(resource->buffer);
+			glViewport(0, 0, resource->width, resource->height);
+		}
+
+		if (graph->profiler)
+			begin_gpu_pass(graph->profiler, pass->name);
+		auto start = std::chrono::steady_clock::now();
+		pass->func(graph, pass->data);
+		pass->cpuMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (graph->profiler)
+			end_gpu_pass(graph->profiler);
+		BMT_STAT_PASS_END();
+
+		for (u32 r = 0; r < graph->resourceCount; ++r) {
+			FrameResource* resource = &graph->resources[r];
+			if (resource->lastUse == (i32)i && !resource->imported)
+				release_render_target(graph->pool, resource->buffer);
+		}
+	}
+	unbind_framebuffer();
+}
+
+//==========================================================================================
+//Description: Logs the compiled graph, what each pass touches and how long it took
+//
+//Comments: The GPU time is the last one the GPU profiler read back, a few frames old
+//==========================================================================================
+INTERNAL inline
+void dump_frame_graph(FrameGraph* graph) {
+	BMT_LOG(INFO, "Frame graph, %d of %d passes run, %d resources", graph->orderCount, graph->passCount, graph->resourceCount);
+	for (u32 i = 0; i < graph->passCount; ++i) {
+		FramePass* pass = &graph->passes[i];
+		if (pass->culled) {
+			BMT_LOG(INFO, "    %-16s culled", pass->name);
+			continue;
+		}
+		f64 gpuMs = -1;
+		if (graph->profiler) {
+			i32 index = find_gpu_pass(graph->profiler, pass->name);
+			if (index >= 0)
+				gpuMs = graph->profiler->passes[index].last;
+		}
+		char reads[256] = "";
+		char writes[256] = "";
+		for (u32 r = 0; r < pass->readCount; ++r)
+			snprintf(reads + strlen(reads), sizeof(reads) - strlen(reads), "%s%s", r ? ", " : "", graph->resources[pass->reads[r]].name);
+		for (u32 w = 0; w < pass->writeCount; ++w)
+			snprintf(writes + strlen(writes), sizeof(writes) - strlen(writes), "%s%s", w ? ", " : "", graph->resources[pass->writes[w]].name);
+		BMT_LOG(INFO, "    %-16s cpu %7.3f ms  gpu %7.3f ms  reads [%s] writes [%s]", pass->name, pass->cpuMs, gpuMs, reads, writes);
+	}
+	for (u32 i = 0; i < graph->resourceCount; ++i) {
+		FrameResource* resource = &graph->resources[i];
+		if (resource->external)
+			BMT_LOG(INFO, "    resource %-16s external", resource->name);
+		else if (resource->firstUse < 0)
+			BMT_LOG(INFO, "    resource %-16s %5dx%-5d unused", resource->name, resource->width, resource->height);
+		else
+			BMT_LOG(INFO, "    resource %-16s %5dx%-5d %s, alive %s -> %s, discard after %s", resource->name, resource->width, resource->height,
+				resource->imported ? "imported" : "transient", graph->passes[graph->order[resource->firstUse]].name,
+				graph->passes[graph->order[resource->lastUse]].name, resource->output ? "present" : graph->passes[graph->order[resource->lastUse]].name);
+	}
+	dump_render_target_pool(graph->pool);
+}
+
+#endif
@@ -0,0 +1,1621 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        gl_capture.cpp                           //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+
+#include "gl_capture.h"
+#include "window.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+const char* GL_CAPTURE_CALL_NAMES[CAPTURE_CALL_COUNT] = {
+	"glActiveTexture", "glAttachShader", "glBindAttribLocation", "glBindBuffer", "glBindFragDataLocation",
+	"glBindFramebuffer", "glBindRenderbuffer", "glBindTexture", "glBindVertexArray", "glBlendFunc",
+	"glBlitFramebuffer", "glBufferData", "glCheckFramebufferStatus", "glClear", "glClearColor",
+	"glClientWaitSync", "glColorMask", "glCompileShader", "glCreateProgram", "glCreateShader",
+	"glCullFace", "glDeleteBuffers", "glDeleteFramebuffers", "glDeleteProgram", "glDeleteQueries",
+	"glDeleteRenderbuffers", "glDeleteShader", "glDeleteSync", "glDeleteTextures", "glDeleteVertexArrays",
+	"glDepthFunc", "glDepthMask", "glDisable", "glDisableVertexAttribArray", "glDrawArrays",
+	"glDrawArraysInstanced", "glDrawBuffer", "glDrawElements", "glDrawElementsInstanced", "glEnable",
+	"glEnableVertexAttribArray", "glFenceSync", "glFramebufferRenderbuffer", "glFramebufferTexture2D", "glFramebufferTextureLayer",
+	"glGenBuffers", "glGenFramebuffers", "glGenQueries", "glGenRenderbuffers", "glGenTextures",
+	"glGenVertexArrays", "glGenerateMipmap", "glGetQueryObjectiv", "glGetQueryObjectui64v", "glGetUniformLocation",
+	"glLinkProgram", "glMapBufferRange", "glQueryCounter", "glReadBuffer", "glReadPixels",
+	"glRenderbufferStorage", "glRenderbufferStorageMultisample", "glShaderSource", "glTexBuffer", "glTexImage2D",
+	"glTexImage3D", "glTexParameteri", "glTexParameterfv", "glTexSubImage2D", "glUniform1f",
+	"glUniform2f", "glUniform3f", "glUniform4f", "glUniform1i", "glUniform1iv",
+	"glUniform1fv", "glUniformMatrix4fv", "glUnmapBuffer", "glUseProgram", "glValidateProgram",
+	"glVertexAttribDivisor", "glVertexAttribIPointer", "glVertexAttribPointer", "glViewport",
+	"(buffer contents)", "(setup end)", "(frame end)"
+};
+
+#define CAPTURE_TEXTURE_UNITS 32
+#define CAPTURE_MAX_ATTRIBUTES 16
+
+//every glad pointer that gets swapped, with the name of its PFN typedef
+#define CAPTURE_FUNCTIONS(X) \
+	X(ActiveTexture, ACTIVETEXTURE) X(AttachShader, ATTACHSHADER) X(BindAttribLocation, BINDATTRIBLOCATION) \
+	X(BindBuffer, BINDBUFFER) X(BindFragDataLocation, BINDFRAGDATALOCATION) X(BindFramebuffer, BINDFRAMEBUFFER) \
+	X(BindRenderbuffer, BINDRENDERBUFFER) X(BindTexture, BINDTEXTURE) X(BindVertexArray, BINDVERTEXARRAY) \
+	X(BlendFunc, BLENDFUNC) X(BlitFramebuffer, BLITFRAMEBUFFER) X(BufferData, BUFFERDATA) \
+	X(CheckFramebufferStatus, CHECKFRAMEBUFFERSTATUS) X(Clear, CLEAR) X(ClearColor, CLEARCOLOR) \
+	X(ClientWaitSync, CLIENTWAITSYNC) X(ColorMask, COLORMASK) X(CompileShader, COMPILESHADER) \
+	X(CreateProgram, CREATEPROGRAM) X(CreateShader, CREATESHADER) X(CullFace, CULLFACE) \
+	X(DeleteBuffers, DELETEBUFFERS) X(DeleteFramebuffers, DELETEFRAMEBUFFERS) X(DeleteProgram, DELETEPROGRAM) \
+	X(DeleteQueries, DELETEQUERIES) X(DeleteRenderbuffers, DELETERENDERBUFFERS) X(DeleteShader, DELETESHADER) \
+	X(DeleteSync, DELETESYNC) X(DeleteTextures, DELETETEXTURES) X(DeleteVertexArrays, DELETEVERTEXARRAYS) \
+	X(DepthFunc, DEPTHFUNC) X(DepthMask, DEPTHMASK) X(Disable, DISABLE) \
+	X(DisableVertexAttribArray, DISABLEVERTEXATTRIBARRAY) X(DrawArrays, DRAWARRAYS) X(DrawArraysInstanced, DRAWARRAYSINSTANCED) \
+	X(DrawBuffer, DRAWBUFFER) X(DrawElements, DRAWELEMENTS) X(DrawElementsInstanced, DRAWELEMENTSINSTANCED) \
+	X(Enable, ENABLE) X(EnableVertexAttribArray, ENABLEVERTEXATTRIBARRAY) X(FenceSync, FENCESYNC) \
+	X(FramebufferRenderbuffer, FRAMEBUFFERRENDERBUFFER) X(FramebufferTexture2D, FRAMEBUFFERTEXTURE2D) \
+	X(FramebufferTextureLayer, FRAMEBUFFERTEXTURELAYER) X(GenBuffers, GENBUFFERS) X(GenFramebuffers, GENFRAMEBUFFERS) \
+	X(GenQueries, GENQUERIES) X(GenRenderbuffers, GENRENDERBUFFERS) X(GenTextures, GENTEXTURES) \
+	X(GenVertexArrays, GENVERTEXARRAYS) X(GenerateMipmap, GENERATEMIPMAP) X(GetQueryObjectiv, GETQUERYOBJECTIV) \
+	X(GetQueryObjectui64v, GETQUERYOBJECTUI64V) X(GetUniformLocation, GETUNIFORMLOCATION) X(LinkProgram, LINKPROGRAM) \
+	X(MapBufferRange, MAPBUFFERRANGE) X(QueryCounter, QUERYCOUNTER) X(ReadBuffer, READBUFFER) \
+	X(ReadPixels, READPIXELS) X(RenderbufferStorage, RENDERBUFFERSTORAGE) \
+	X(RenderbufferStorageMultisample, RENDERBUFFERSTORAGEMULTISAMPLE) X(ShaderSource, SHADERSOURCE) \
+	X(TexBuffer, TEXBUFFER) X(TexImage2D, TEXIMAGE2D) X(TexImage3D, TEXIMAGE3D) X(TexParameteri, TEXPARAMETERI) \
+	X(TexParameterfv, TEXPARAMETERFV) X(TexSubImage2D, TEXSUBIMAGE2D) X(Uniform1f, UNIFORM1F) X(Uniform2f, UNIFORM2F) \
+	X(Uniform3f, UNIFORM3F) X(Uniform4f, UNIFORM4F) X(Uniform1i, UNIFORM1I) X(Uniform1iv, UNIFORM1IV) \
+	X(Uniform1fv, UNIFORM1FV) X(UniformMatrix4fv, UNIFORMMATRIX4FV) X(UnmapBuffer, UNMAPBUFFER) \
+	X(UseProgram, USEPROGRAM) X(ValidateProgram, VALIDATEPROGRAM) X(VertexAttribDivisor, VERTEXATTRIBDIVISOR) \
+	X(VertexAttribIPointer, VERTEXATTRIBIPOINTER) X(VertexAttribPointer, VERTEXATTRIBPOINTER) X(Viewport, VIEWPORT)
+
+//the driver's own entry points, saved when the glad pointers are swapped
+struct CaptureDriver {
+#define CAPTURE_DRIVER_POINTER(name, NAME) PFNGL##NAME##PROC name;
+	CAPTURE_FUNCTIONS(CAPTURE_DRIVER_POINTER)
+#undef CAPTURE_DRIVER_POINTER
+};
+
+struct CaptureBuffer {
+	u64 size;
+	GLenum usage;
+	u8* mapPointer;
+	u64 mapOffset;
+	u64 mapLength;
+	bool mapRecorded;
+};
+
+struct CaptureTextureParameter {
+	bool isFloat;
+	GLint value;
+	GLfloat values[4];
+};
+
+struct CaptureTexture {
+	GLenum target;
+	GLenum internalFormat;
+	GLenum format;
+	GLenum type;
+	i32 width;
+	i32 height;
+	i32 depth;
+	i32 levels;
+	bool mipmaps;
+	GLuint buffer;
+	std::map<GLenum, CaptureTextureParameter> parameters;
+};
+
+struct CaptureRenderbuffer {
+	i32 samples;
+	GLenum internalFormat;
+	i32 width;
+	i32 height;
+};
+
+struct CaptureAttachment {
+	u16 call;
+	GLenum attachment;
+	GLenum target;
+	GLuint object;
+	i32 level;
+	i32 layer;
+};
+
+struct CaptureFramebuffer {
+	std::vector<CaptureAttachment> attachments;
+	bool drawBufferSet;
+	bool readBufferSet;
+	GLenum drawBuffer;
+	GLenum readBuffer;
+};
+
+struct CaptureShader {
+	GLenum type;
+	std::string source;
+};
+
+struct CaptureUniform {
+	u16 call;
+	i32 count;
+	u8 transpose;
+	std::vector<u8> data;
+};
+
+struct CaptureProgram {
+	std::vector<GLuint> attached;
+	std::vector<CaptureShader> linked;
+	std::vector<std::pair<GLuint, std::string> > attributes;
+	std::vector<std::pair<GLuint, std::string> > fragData;
+	std::map<std::string, GLint> locations;
+	std::map<GLint, CaptureUniform> uniforms;
+	bool isLinked;
+};
+
+struct CaptureAttribute {
+	bool set;
+	bool enabled;
+	bool integer;
+	GLuint buffer;
+	i32 size;
+	GLenum type;
+	bool normalized;
+	i32 stride;
+	u64 offset;
+	u32 divisor;
+};
+
+struct CaptureVertexArray {
+	GLuint elementBuffer;
+	CaptureAttribute attributes[CAPTURE_MAX_ATTRIBUTES];
+};
+
+//shadow of everything the wrappers have seen, kept from install onwards so a capture can
+//start on any frame
+struct CaptureState {
+	std::unordered_map<GLuint, CaptureBuffer> buffers;
+	std::unordered_map<GLuint, CaptureTexture> textures;
+	std::unordered_map<GLuint, CaptureRenderbuffer> renderbuffers;
+	std::unordered_map<GLuint, CaptureFramebuffer> framebuffers;
+	std::unordered_map<GLuint, CaptureShader> shaders;
+	std::unordered_map<GLuint, CaptureProgram> programs;
+	std::unordered_map<GLuint, CaptureVertexArray> vertexArrays;
+	std::unordered_map<GLuint, bool> queries;
+	std::vector<GLsync> syncs;
+
+	std::map<GLenum, GLuint> bufferBindings;
+	GLuint textureBindings[CAPTURE_TEXTURE_UNITS][3];
+	u32 activeTexture;
+	GLuint vertexArray;
+	GLuint program;
+	GLuint drawFramebuffer;
+	GLuint readFramebuffer;
+	GLuint renderbuffer;
+};
+
+GLOBAL CaptureDriver captureDriver;
+GLOBAL CaptureState captureState;
+GLOBAL bool captureInstalled;
+
+GLOBAL bool captureRecording;
+GLOBAL std::vector<u8> captureStream;
+GLOBAL u64 captureRecordStart;
+GLOBAL u64 captureSetupBytes;
+GLOBAL u32 captureFrames;
+GLOBAL u32 captureFramesLeft;
+GLOBAL u32 captureWidth;
+GLOBAL u32 captureHeight;
+GLOBAL std::string capturePath;
+
+//==========================================================================================
+//Recording, arguments are appended to the open record as raw bytes
+//==========================================================================================
+
+INTERNAL inline
+void capture_write(const void* data, u64 size) {
+	const u8* bytes = (const u8*)data;
+	captureStream.insert(captureStream.end(), bytes, bytes + size);
+}
+
+INTERNAL inline void capture_u32(u32 value) { capture_write(&value, sizeof(u32)); }
+INTERNAL inline void capture_i32(i32 value) { capture_write(&value, sizeof(i32)); }
+INTERNAL inline void capture_f32(f32 value) { capture_write(&value, sizeof(f32)); }
+INTERNAL inline void capture_u64(u64 value) { capture_write(&value, sizeof(u64)); }
+
+INTERNAL inline
+void capture_memory(const void* data, u64 size) {
+	capture_u64(size);
+	capture_write(data, size);
+}
+
+INTERNAL inline
+void capture_string(const char* string) {
+	capture_memory(string, strlen(string));
+}
+
+INTERNAL inline
+void capture_begin(u16 call) {
+	captureRecordStart = captureStream.size();
+	GLCaptureRecord record = { call, 0, 0 };
+	capture_write(&record, sizeof(record));
+}
+
+INTERNAL inline
+void capture_end() {
+	u32 size = (u32)(captureStream.size() - captureRecordStart - sizeof(GLCaptureRecord));
+	memcpy(&captureStream[captureRecordStart] + offsetof(GLCaptureRecord, size), &size, sizeof(u32));
+}
+
+INTERNAL inline
+void capture_call(u16 call) {
+	capture_begin(call);
+	capture_end();
+}
+
+INTERNAL inline
+void capture_call(u16 call, u32 a) {
+	capture_begin(call);
+	capture_u32(a);
+	capture_end();
+}
+
+INTERNAL inline
+void capture_call(u16 call, u32 a, u32 b) {
+	capture_begin(call);
+	capture_u32(a);
+	capture_u32(b);
+	capture_end();
+}
+
+INTERNAL inline
+void capture_call(u16 call, u32 a, u32 b, u32 c) {
+	capture_begin(call);
+	capture_u32(a);
+	capture_u32(b);
+	capture_u32(c);
+	capture_end();
+}
+
+INTERNAL inline
+void capture_names(u16 call, GLsizei n, const GLuint* names) {
+	capture_begin(call);
+	capture_i32(n);
+	capture_write(names, sizeof(GLuint) * n);
+	capture_end();
+}
+
+//==========================================================================================
+//Shadow state helpers
+//==========================================================================================
+
+INTERNAL inline
+i32 capture_texture_target_index(GLenum target) {
+	switch (target) {
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_BUFFER: return 2;
+	}
+	return -1;
+}
+
+INTERNAL inline
+GLenum capture_texture_target(i32 index) {
+	GLenum targets[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BUFFER };
+	return targets[index];
+}
+
+INTERNAL inline
+CaptureTexture* capture_bound_texture(GLenum target) {
+	i32 index = capture_texture_target_index(target);
+	if (index < 0 || captureState.activeTexture >= CAPTURE_TEXTURE_UNITS)
+		return NULL;
+	GLuint name = captureState.textureBindings[captureState.activeTexture][index];
+	if (name == 0)
+		return NULL;
+	return &captureState.textures[name];
+}
+
+INTERNAL inline
+GLuint capture_bound_buffer(GLenum target) {
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+		return captureState.vertexArrays[captureState.vertexArray].elementBuffer;
+	std::map<GLenum, GLuint>::iterator binding = captureState.bufferBindings.find(target);
+	return binding == captureState.bufferBindings.end() ? 0 : binding->second;
+}
+
+INTERNAL inline
+CaptureFramebuffer* capture_bound_framebuffer(GLenum target) {
+	GLuint name = target == GL_READ_FRAMEBUFFER ? captureState.readFramebuffer : captureState.drawFramebuffer;
+	if (name == 0)
+		return NULL;
+	return &captureState.framebuffers[name];
+}
+
+INTERNAL inline
+void capture_attach(GLenum target, CaptureAttachment attachment) {
+	CaptureFramebuffer* framebuffer = capture_bound_framebuffer(target);
+	if (framebuffer == NULL)
+		return;
+	for (u32 i = 0; i < framebuffer->attachments.size(); ++i) {
+		if (framebuffer->attachments[i].attachment == attachment.attachment) {
+			framebuffer->attachments[i] = attachment;
+			return;
+		}
+	}
+	framebuffer->attachments.push_back(attachment);
+}
+
+INTERNAL inline
+CaptureUniform* capture_uniform(GLint location, u16 call, i32 count) {
+	if (location < 0 || captureState.program == 0)
+		return NULL;
+	std::map<GLint, CaptureUniform>& uniforms = captureState.programs[captureState.program].uniforms;
+	//an array upload overwrites whatever was set on the locations it covers
+	for (GLint i = 1; i < count; ++i)
+		uniforms.erase(location + i);
+	CaptureUniform* uniform = &uniforms[location];
+	uniform->call = call;
+	uniform->count = count;
+	uniform->transpose = 0;
+	return uniform;
+}
+
+INTERNAL inline
+void capture_texture_image(GLenum target, GLint level, GLint internalFormat, i32 width, i32 height, i32 depth, GLenum format, GLenum type) {
+	CaptureTexture* texture = capture_bound_texture(target);
+	if (texture == NULL)
+		return;
+	texture->target = target;
+	if (level == 0) {
+		texture->internalFormat = internalFormat;
+		texture->format = format;
+		texture->type = type;
+		texture->width = width;
+		texture->height = height;
+		texture->depth = depth;
+	}
+	texture->levels = level + 1 > texture->levels ? level + 1 : texture->levels;
+}
+
+//image data comes from client memory, unless a pixel unpack buffer is bound when it is an offset into that
+INTERNAL inline
+void capture_pixels(const void* pixels, u64 size) {
+	if (capture_bound_buffer(GL_PIXEL_UNPACK_BUFFER)) {
+		capture_u32(2);
+		capture_u64((u64)(uintptr_t)pixels);
+	}
+	else if (pixels) {
+		capture_u32(1);
+		capture_memory(pixels, size);
+	}
+	else {
+		capture_u32(0);
+	}
+}
+
+//==========================================================================================
+//Wrappers, each one forwards to the driver, updates the shadow and records while capturing
+//==========================================================================================
+
+INTERNAL void APIENTRY capture_glActiveTexture(GLenum texture) {
+	captureDriver.ActiveTexture(texture);
+	captureState.activeTexture = texture - GL_TEXTURE0;
+	if (captureRecording) capture_call(CAPTURE_ACTIVE_TEXTURE, texture);
+}
+
+INTERNAL void APIENTRY capture_glAttachShader(GLuint program, GLuint shader) {
+	captureDriver.AttachShader(program, shader);
+	captureState.programs[program].attached.push_back(shader);
+	if (captureRecording) capture_call(CAPTURE_ATTACH_SHADER, program, shader);
+}
+
+INTERNAL void APIENTRY capture_glBindAttribLocation(GLuint program, GLuint index, const GLchar* name) {
+	captureDriver.BindAttribLocation(program, index, name);
+	captureState.programs[program].attributes.push_back(std::make_pair(index, std::string(name)));
+	if (captureRecording) {
+		capture_begin(CAPTURE_BIND_ATTRIB_LOCATION);
+		capture_u32(program);
+		capture_u32(index);
+		capture_string(name);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glBindBuffer(GLenum target, GLuint buffer) {
+	captureDriver.BindBuffer(target, buffer);
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+		captureState.vertexArrays[captureState.vertexArray].elementBuffer = buffer;
+	else
+		captureState.bufferBindings[target] = buffer;
+	if (captureRecording) capture_call(CAPTURE_BIND_BUFFER, target, buffer);
+}
+
+INTERNAL void APIENTRY capture_glBindFragDataLocation(GLuint program, GLuint color, const GLchar* name) {
+	captureDriver.BindFragDataLocation(program, color, name);
+	captureState.programs[program].fragData.push_back(std::make_pair(color, std::string(name)));
+	if (captureRecording) {
+		capture_begin(CAPTURE_BIND_FRAG_DATA_LOCATION);
+		capture_u32(program);
+		capture_u32(color);
+		capture_string(name);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+	captureDriver.BindFramebuffer(target, framebuffer);
+	if (target != GL_READ_FRAMEBUFFER)
+		captureState.drawFramebuffer = framebuffer;
+	if (target != GL_DRAW_FRAMEBUFFER)
+		captureState.readFramebuffer = framebuffer;
+	if (captureRecording) capture_call(CAPTURE_BIND_FRAMEBUFFER, target, framebuffer);
+}
+
+INTERNAL void APIENTRY capture_glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+	captureDriver.BindRenderbuffer(target, renderbuffer);
+	captureState.renderbuffer = renderbuffer;
+	if (captureRecording) capture_call(CAPTURE_BIND_RENDERBUFFER, target, renderbuffer);
+}
+
+INTERNAL void APIENTRY capture_glBindTexture(GLenum target, GLuint texture) {
+	captureDriver.BindTexture(target, texture);
+	i32 index = capture_texture_target_index(target);
+	if (index >= 0 && captureState.activeTexture < CAPTURE_TEXTURE_UNITS)
+		captureState.textureBindings[captureState.activeTexture][index] = texture;
+	if (texture)
+		captureState.textures[texture].target = target;
+	if (captureRecording) capture_call(CAPTURE_BIND_TEXTURE, target, texture);
+}
+
+INTERNAL void APIENTRY capture_glBindVertexArray(GLuint array) {
+	captureDriver.BindVertexArray(array);
+	captureState.vertexArray = array;
+	if (captureRecording) capture_call(CAPTURE_BIND_VERTEX_ARRAY, array);
+}
+
+INTERNAL void APIENTRY capture_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+	captureDriver.BlendFunc(sfactor, dfactor);
+	if (captureRecording) capture_call(CAPTURE_BLEND_FUNC, sfactor, dfactor);
+}
+
+INTERNAL void APIENTRY capture_glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) {
+	captureDriver.BlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	if (captureRecording) {
+		capture_begin(CAPTURE_BLIT_FRAMEBUFFER);
+		capture_i32(srcX0); capture_i32(srcY0); capture_i32(srcX1); capture_i32(srcY1);
+		capture_i32(dstX0); capture_i32(dstY0); capture_i32(dstX1); capture_i32(dstY1);
+		capture_u32(mask);
+		capture_u32(filter);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+	captureDriver.BufferData(target, size, data, usage);
+	GLuint name = capture_bound_buffer(target);
+	if (name) {
+		CaptureBuffer* buffer = &captureState.buffers[name];
+		buffer->size = size;
+		buffer->usage = usage;
+	}
+	if (captureRecording) {
+		capture_begin(CAPTURE_BUFFER_DATA);
+		capture_u32(target);
+		capture_u64(size);
+		capture_u32(usage);
+		capture_u32(data != NULL);
+		if (data)
+			capture_memory(data, size);
+		capture_end();
+	}
+}
+
+INTERNAL GLenum APIENTRY capture_glCheckFramebufferStatus(GLenum target) {
+	if (captureRecording) capture_call(CAPTURE_CHECK_FRAMEBUFFER_STATUS, target);
+	return captureDriver.CheckFramebufferStatus(target);
+}
+
+INTERNAL void APIENTRY capture_glClear(GLbitfield mask) {
+	captureDriver.Clear(mask);
+	if (captureRecording) capture_call(CAPTURE_CLEAR, mask);
+}
+
+INTERNAL void APIENTRY capture_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	captureDriver.ClearColor(red, green, blue, alpha);
+	if (captureRecording) {
+		capture_begin(CAPTURE_CLEAR_COLOR);
+		capture_f32(red); capture_f32(green); capture_f32(blue); capture_f32(alpha);
+		capture_end();
+	}
+}
+
+INTERNAL GLenum APIENTRY capture_glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+	if (captureRecording) {
+		capture_begin(CAPTURE_CLIENT_WAIT_SYNC);
+		capture_u64((u64)(uintptr_t)sync);
+		capture_u32(flags);
+		capture_u64(timeout);
+		capture_end();
+	}
+	return captureDriver.ClientWaitSync(sync, flags, timeout);
+}
+
+INTERNAL void APIENTRY capture_glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+	captureDriver.ColorMask(red, green, blue, alpha);
+	if (captureRecording) {
+		capture_begin(CAPTURE_COLOR_MASK);
+		capture_u32(red); capture_u32(green); capture_u32(blue); capture_u32(alpha);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glCompileShader(GLuint shader) {
+	captureDriver.CompileShader(shader);
+	if (captureRecording) capture_call(CAPTURE_COMPILE_SHADER, shader);
+}
+
+INTERNAL GLuint APIENTRY capture_glCreateProgram() {
+	GLuint program = captureDriver.CreateProgram();
+	captureState.programs[program] = CaptureProgram();
+	if (captureRecording) capture_call(CAPTURE_CREATE_PROGRAM, program);
+	return program;
+}
+
+INTERNAL GLuint APIENTRY capture_glCreateShader(GLenum type) {
+	GLuint shader = captureDriver.CreateShader(type);
+	captureState.shaders[shader].type = type;
+	captureState.shaders[shader].source.clear();
+	if (captureRecording) capture_call(CAPTURE_CREATE_SHADER, type, shader);
+	return shader;
+}
+
+INTERNAL void APIENTRY capture_glCullFace(GLenum mode) {
+	captureDriver.CullFace(mode);
+	if (captureRecording) capture_call(CAPTURE_CULL_FACE, mode);
+}
+
+INTERNAL void APIENTRY capture_glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+	captureDriver.DeleteBuffers(n, buffers);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.buffers.erase(buffers[i]);
+	if (captureRecording) capture_names(CAPTURE_DELETE_BUFFERS, n, buffers);
+}
+
+INTERNAL void APIENTRY capture_glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+	captureDriver.DeleteFramebuffers(n, framebuffers);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.framebuffers.erase(framebuffers[i]);
+	if (captureRecording) capture_names(CAPTURE_DELETE_FRAMEBUFFERS, n, framebuffers);
+}
+
+INTERNAL void APIENTRY capture_glDeleteProgram(GLuint program) {
+	captureDriver.DeleteProgram(program);
+	captureState.programs.erase(program);
+	if (captureRecording) capture_call(CAPTURE_DELETE_PROGRAM, program);
+}
+
+INTERNAL void APIENTRY capture_glDeleteQueries(GLsizei n, const GLuint* ids) {
+	captureDriver.DeleteQueries(n, ids);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.queries.erase(ids[i]);
+	if (captureRecording) capture_names(CAPTURE_DELETE_QUERIES, n, ids);
+}
+
+INTERNAL void APIENTRY capture_glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+	captureDriver.DeleteRenderbuffers(n, renderbuffers);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.renderbuffers.erase(renderbuffers[i]);
+	if (captureRecording) capture_names(CAPTURE_DELETE_RENDERBUFFERS, n, renderbuffers);
+}
+
+INTERNAL void APIENTRY capture_glDeleteShader(GLuint shader) {
+	captureDriver.DeleteShader(shader);
+	captureState.shaders.erase(shader);
+	if (captureRecording) capture_call(CAPTURE_DELETE_SHADER, shader);
+}
+
+INTERNAL void APIENTRY capture_glDeleteSync(GLsync sync) {
+	captureDriver.DeleteSync(sync);
+	captureState.syncs.erase(std::remove(captureState.syncs.begin(), captureState.syncs.end(), sync), captureState.syncs.end());
+	if (captureRecording) {
+		capture_begin(CAPTURE_DELETE_SYNC);
+		capture_u64((u64)(uintptr_t)sync);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glDeleteTextures(GLsizei n, const GLuint* textures) {
+	captureDriver.DeleteTextures(n, textures);
+	for (GLsizei i = 0; i < n; ++i) {
+		captureState.textures.erase(textures[i]);
+		for (u32 unit = 0; unit < CAPTURE_TEXTURE_UNITS; ++unit)
+			for (u32 target = 0; target < 3; ++target)
+				if (captureState.textureBindings[unit][target] == textures[i])
+					captureState.textureBindings[unit][target] = 0;
+	}
+	if (captureRecording) capture_names(CAPTURE_DELETE_TEXTURES, n, textures);
+}
+
+INTERNAL void APIENTRY capture_glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+	captureDriver.DeleteVertexArrays(n, arrays);
+	for (GLsizei i = 0; i < n; ++i) {
+		if (arrays[i] == captureState.vertexArray)
+			captureState.vertexArray = 0;
+		if (arrays[i])
+			captureState.vertexArrays.erase(arrays[i]);
+	}
+	if (captureRecording) capture_names(CAPTURE_DELETE_VERTEX_ARRAYS, n, arrays);
+}
+
+INTERNAL void APIENTRY capture_glDepthFunc(GLenum func) {
+	captureDriver.DepthFunc(func);
+	if (captureRecording) capture_call(CAPTURE_DEPTH_FUNC, func);
+}
+
+INTERNAL void APIENTRY capture_glDepthMask(GLboolean flag) {
+	captureDriver.DepthMask(flag);
+	if (captureRecording) capture_call(CAPTURE_DEPTH_MASK, flag);
+}
+
+INTERNAL void APIENTRY capture_glDisable(GLenum cap) {
+	captureDriver.Disable(cap);
+	if (captureRecording) capture_call(CAPTURE_DISABLE, cap);
+}
+
+INTERNAL void APIENTRY capture_glDisableVertexAttribArray(GLuint index) {
+	captureDriver.DisableVertexAttribArray(index);
+	if (index < CAPTURE_MAX_ATTRIBUTES)
+		captureState.vertexArrays[captureState.vertexArray].attributes[index].enabled = false;
+	if (captureRecording) capture_call(CAPTURE_DISABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+INTERNAL void APIENTRY capture_glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	captureDriver.DrawArrays(mode, first, count);
+	if (captureRecording) capture_call(CAPTURE_DRAW_ARRAYS, mode, first, count);
+}
+
+INTERNAL void APIENTRY capture_glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+	captureDriver.DrawArraysInstanced(mode, first, count, instancecount);
+	if (captureRecording) {
+		capture_begin(CAPTURE_DRAW_ARRAYS_INSTANCED);
+		capture_u32(mode); capture_i32(first); capture_i32(count); capture_i32(instancecount);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glDrawBuffer(GLenum buf) {
+	captureDriver.DrawBuffer(buf);
+	CaptureFramebuffer* framebuffer = capture_bound_framebuffer(GL_DRAW_FRAMEBUFFER);
+	if (framebuffer) {
+		framebuffer->drawBufferSet = true;
+		framebuffer->drawBuffer = buf;
+	}
+	if (captureRecording) capture_call(CAPTURE_DRAW_BUFFER, buf);
+}
+
+//core profile draws always source indices from the bound element buffer, so the pointer is an offset
+INTERNAL void APIENTRY capture_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+	captureDriver.DrawElements(mode, count, type, indices);
+	if (captureRecording) {
+		capture_begin(CAPTURE_DRAW_ELEMENTS);
+		capture_u32(mode); capture_i32(count); capture_u32(type);
+		capture_u64((u64)(uintptr_t)indices);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount) {
+	captureDriver.DrawElementsInstanced(mode, count, type, indices, instancecount);
+	if (captureRecording) {
+		capture_begin(CAPTURE_DRAW_ELEMENTS_INSTANCED);
+		capture_u32(mode); capture_i32(count); capture_u32(type);
+		capture_u64((u64)(uintptr_t)indices);
+		capture_i32(instancecount);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glEnable(GLenum cap) {
+	captureDriver.Enable(cap);
+	if (captureRecording) capture_call(CAPTURE_ENABLE, cap);
+}
+
+INTERNAL void APIENTRY capture_glEnableVertexAttribArray(GLuint index) {
+	captureDriver.EnableVertexAttribArray(index);
+	if (index < CAPTURE_MAX_ATTRIBUTES)
+		captureState.vertexArrays[captureState.vertexArray].attributes[index].enabled = true;
+	if (captureRecording) capture_call(CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+INTERNAL GLsync APIENTRY capture_glFenceSync(GLenum condition, GLbitfield flags) {
+	GLsync sync = captureDriver.FenceSync(condition, flags);
+	captureState.syncs.push_back(sync);
+	if (captureRecording) {
+		capture_begin(CAPTURE_FENCE_SYNC);
+		capture_u32(condition);
+		capture_u32(flags);
+		capture_u64((u64)(uintptr_t)sync);
+		capture_end();
+	}
+	return sync;
+}
+
+INTERNAL void APIENTRY capture_glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+	captureDriver.FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	CaptureAttachment shadow = { CAPTURE_FRAMEBUFFER_RENDERBUFFER, attachment, renderbuffertarget, renderbuffer, 0, 0 };
+	capture_attach(target, shadow);
+	if (captureRecording) {
+		capture_begin(CAPTURE_FRAMEBUFFER_RENDERBUFFER);
+		capture_u32(target); capture_u32(attachment); capture_u32(renderbuffertarget); capture_u32(renderbuffer);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+	captureDriver.FramebufferTexture2D(target, attachment, textarget, texture, level);
+	CaptureAttachment shadow = { CAPTURE_FRAMEBUFFER_TEXTURE_2D, attachment, textarget, texture, level, 0 };
+	capture_attach(target, shadow);
+	if (captureRecording) {
+		capture_begin(CAPTURE_FRAMEBUFFER_TEXTURE_2D);
+		capture_u32(target); capture_u32(attachment); capture_u32(textarget); capture_u32(texture); capture_i32(level);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer) {
+	captureDriver.FramebufferTextureLayer(target, attachment, texture, level, layer);
+	CaptureAttachment shadow = { CAPTURE_FRAMEBUFFER_TEXTURE_LAYER, attachment, 0, texture, level, layer };
+	capture_attach(target, shadow);
+	if (captureRecording) {
+		capture_begin(CAPTURE_FRAMEBUFFER_TEXTURE_LAYER);
+		capture_u32(target); capture_u32(attachment); capture_u32(texture); capture_i32(level); capture_i32(layer);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glGenBuffers(GLsizei n, GLuint* buffers) {
+	captureDriver.GenBuffers(n, buffers);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.buffers[buffers[i]] = CaptureBuffer();
+	if (captureRecording) capture_names(CAPTURE_GEN_BUFFERS, n, buffers);
+}
+
+INTERNAL void APIENTRY capture_glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+	captureDriver.GenFramebuffers(n, framebuffers);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.framebuffers[framebuffers[i]] = CaptureFramebuffer();
+	if (captureRecording) capture_names(CAPTURE_GEN_FRAMEBUFFERS, n, framebuffers);
+}
+
+INTERNAL void APIENTRY capture_glGenQueries(GLsizei n, GLuint* ids) {
+	captureDriver.GenQueries(n, ids);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.queries[ids[i]] = false;
+	if (captureRecording) capture_names(CAPTURE_GEN_QUERIES, n, ids);
+}
+
+INTERNAL void APIENTRY capture_glGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+	captureDriver.GenRenderbuffers(n, renderbuffers);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.renderbuffers[renderbuffers[i]] = CaptureRenderbuffer();
+	if (captureRecording) capture_names(CAPTURE_GEN_RENDERBUFFERS, n, renderbuffers);
+}
+
+INTERNAL void APIENTRY capture_glGenTextures(GLsizei n, GLuint* textures) {
+	captureDriver.GenTextures(n, textures);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.textures[textures[i]] = CaptureTexture();
+	if (captureRecording) capture_names(CAPTURE_GEN_TEXTURES, n, textures);
+}
+
+INTERNAL void APIENTRY capture_glGenVertexArrays(GLsizei n, GLuint* arrays) {
+	captureDriver.GenVertexArrays(n, arrays);
+	for (GLsizei i = 0; i < n; ++i)
+		captureState.vertexArrays[arrays[i]] = CaptureVertexArray();
+	if (captureRecording) capture_names(CAPTURE_GEN_VERTEX_ARRAYS, n, arrays);
+}
+
+INTERNAL void APIENTRY capture_glGenerateMipmap(GLenum target) {
+	captureDriver.GenerateMipmap(target);
+	CaptureTexture* texture = capture_bound_texture(target);
+	if (texture)
+		texture->mipmaps = true;
+	if (captureRecording) capture_call(CAPTURE_GENERATE_MIPMAP, target);
+}
+
+INTERNAL void APIENTRY capture_glGetQueryObjectiv(GLuint id, GLenum pname, GLint* params) {
+	captureDriver.GetQueryObjectiv(id, pname, params);
+	if (captureRecording) capture_call(CAPTURE_GET_QUERY_OBJECT_IV, id, pname);
+}
+
+INTERNAL void APIENTRY capture_glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) {
+	captureDriver.GetQueryObjectui64v(id, pname, params);
+	if (captureRecording) capture_call(CAPTURE_GET_QUERY_OBJECT_UI64V, id, pname);
+}
+
+INTERNAL GLint APIENTRY capture_glGetUniformLocation(GLuint program, const GLchar* name) {
+	GLint location = captureDriver.GetUniformLocation(program, name);
+	captureState.programs[program].locations[name] = location;
+	if (captureRecording) {
+		capture_begin(CAPTURE_GET_UNIFORM_LOCATION);
+		capture_u32(program);
+		capture_string(name);
+		capture_i32(location);
+		capture_end();
+	}
+	return location;
+}
+
+INTERNAL void APIENTRY capture_glLinkProgram(GLuint program) {
+	captureDriver.LinkProgram(program);
+	//keep the sources, the shaders are usually deleted straight after linking
+	CaptureProgram* shadow = &captureState.programs[program];
+	shadow->linked.clear();
+	for (u32 i = 0; i < shadow->attached.size(); ++i)
+		shadow->linked.push_back(captureState.shaders[shadow->attached[i]]);
+	shadow->locations.clear();
+	shadow->uniforms.clear();
+	shadow->isLinked = true;
+	if (captureRecording) capture_call(CAPTURE_LINK_PROGRAM, program);
+}
+
+INTERNAL void* APIENTRY capture_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	void* pointer = captureDriver.MapBufferRange(target, offset, length, access);
+	GLuint name = capture_bound_buffer(target);
+	if (name && pointer) {
+		CaptureBuffer* buffer = &captureState.buffers[name];
+		buffer->mapPointer = (u8*)pointer;
+		buffer->mapOffset = offset;
+		buffer->mapLength = length;
+		buffer->mapRecorded = captureRecording;
+	}
+	if (captureRecording) {
+		capture_begin(CAPTURE_MAP_BUFFER_RANGE);
+		capture_u32(target);
+		capture_u64(offset);
+		capture_u64(length);
+		capture_u32(access);
+		capture_end();
+	}
+	return pointer;
+}
+
+INTERNAL void APIENTRY capture_glQueryCounter(GLuint id, GLenum target) {
+	captureDriver.QueryCounter(id, target);
+	captureState.queries[id] = true;
+	if (captureRecording) capture_call(CAPTURE_QUERY_COUNTER, id, target);
+}
+
+INTERNAL void APIENTRY capture_glReadBuffer(GLenum src) {
+	captureDriver.ReadBuffer(src);
+	CaptureFramebuffer* framebuffer = capture_bound_framebuffer(GL_READ_FRAMEBUFFER);
+	if (framebuffer) {
+		framebuffer->readBufferSet = true;
+		framebuffer->readBuffer = src;
+	}
+	if (captureRecording) capture_call(CAPTURE_READ_BUFFER, src);
+}
+
+INTERNAL void APIENTRY capture_glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) {
+	captureDriver.ReadPixels(x, y, width, height, format, type, pixels);
+	if (captureRecording) {
+		capture_begin(CAPTURE_READ_PIXELS);
+		capture_i32(x); capture_i32(y); capture_i32(width); capture_i32(height);
+		capture_u32(format); capture_u32(type);
+		capture_u32(capture_bound_buffer(GL_PIXEL_PACK_BUFFER) != 0);
+		capture_u64((u64)(uintptr_t)pixels);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+	captureDriver.RenderbufferStorage(target, internalformat, width, height);
+	if (captureState.renderbuffer) {
+		CaptureRenderbuffer shadow = { 0, internalformat, width, height };
+		captureState.renderbuffers[captureState.renderbuffer] = shadow;
+	}
+	if (captureRecording) {
+		capture_begin(CAPTURE_RENDERBUFFER_STORAGE);
+		capture_u32(target); capture_u32(internalformat); capture_i32(width); capture_i32(height);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height) {
+	captureDriver.RenderbufferStorageMultisample(target, samples, internalformat, width, height);
+	if (captureState.renderbuffer) {
+		CaptureRenderbuffer shadow = { samples, internalformat, width, height };
+		captureState.renderbuffers[captureState.renderbuffer] = shadow;
+	}
+	if (captureRecording) {
+		capture_begin(CAPTURE_RENDERBUFFER_STORAGE_MULTISAMPLE);
+		capture_u32(target); capture_i32(samples); capture_u32(internalformat); capture_i32(width); capture_i32(height);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+	captureDriver.ShaderSource(shader, count, string, length);
+	std::string source;
+	for (GLsizei i = 0; i < count; ++i) {
+		if (length && length[i] >= 0)
+			source.append(string[i], length[i]);
+		else
+			source.append(string[i]);
+	}
+	captureState.shaders[shader].source = source;
+	if (captureRecording) {
+		capture_begin(CAPTURE_SHADER_SOURCE);
+		capture_u32(shader);
+		capture_string(source.c_str());
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glTexBuffer(GLenum target, GLenum internalformat, GLuint buffer) {
+	captureDriver.TexBuffer(target, internalformat, buffer);
+	CaptureTexture* texture = capture_bound_texture(target);
+	if (texture) {
+		texture->internalFormat = internalformat;
+		texture->buffer = buffer;
+	}
+	if (captureRecording) capture_call(CAPTURE_TEX_BUFFER, target, internalformat, buffer);
+}
+
+INTERNAL void APIENTRY capture_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+	captureDriver.TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	capture_texture_image(target, level, internalformat, width, height, 1, format, type);
+	if (captureRecording) {
+		capture_begin(CAPTURE_TEX_IMAGE_2D);
+		capture_u32(target); capture_i32(level); capture_i32(internalformat);
+		capture_i32(width); capture_i32(height); capture_i32(border);
+		capture_u32(format); capture_u32(type);
+		capture_pixels(pixels, gl_capture_pixel_bytes(format, type, width, height, 1));
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) {
+	captureDriver.TexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	capture_texture_image(target, level, internalformat, width, height, depth, format, type);
+	if (captureRecording) {
+		capture_begin(CAPTURE_TEX_IMAGE_3D);
+		capture_u32(target); capture_i32(level); capture_i32(internalformat);
+		capture_i32(width); capture_i32(height); capture_i32(depth); capture_i32(border);
+		capture_u32(format); capture_u32(type);
+		capture_pixels(pixels, gl_capture_pixel_bytes(format, type, width, height, depth));
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glTexParameteri(GLenum target, GLenum pname, GLint param) {
+	captureDriver.TexParameteri(target, pname, param);
+	CaptureTexture* texture = capture_bound_texture(target);
+	if (texture) {
+		CaptureTextureParameter parameter = { false, param, { 0, 0, 0, 0 } };
+		texture->parameters[pname] = parameter;
+	}
+	if (captureRecording) capture_call(CAPTURE_TEX_PARAMETER_I, target, pname, param);
+}
+
+INTERNAL void APIENTRY capture_glTexParameterfv(GLenum target, GLenum pname, const GLfloat* params) {
+	captureDriver.TexParameterfv(target, pname, params);
+	u32 count = pname == GL_TEXTURE_BORDER_COLOR ? 4 : 1;
+	CaptureTexture* texture = capture_bound_texture(target);
+	if (texture) {
+		CaptureTextureParameter parameter = { true, 0, { 0, 0, 0, 0 } };
+		memcpy(parameter.values, params, sizeof(GLfloat) * count);
+		texture->parameters[pname] = parameter;
+	}
+	if (captureRecording) {
+		capture_begin(CAPTURE_TEX_PARAMETER_FV);
+		capture_u32(target);
+		capture_u32(pname);
+		capture_memory(params, sizeof(GLfloat) * count);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+	captureDriver.TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	if (captureRecording) {
+		capture_begin(CAPTURE_TEX_SUB_IMAGE_2D);
+		capture_u32(target); capture_i32(level);
+		capture_i32(xoffset); capture_i32(yoffset); capture_i32(width); capture_i32(height);
+		capture_u32(format); capture_u32(type);
+		capture_pixels(pixels, gl_capture_pixel_bytes(format, type, width, height, 1));
+		capture_end();
+	}
+}
+
+//uniforms are program state that outlives the frame that set them, so the last value of
+//every location is kept for the setup stream
+INTERNAL inline
+void capture_uniform_values(u16 call, GLint location, i32 count, const void* data, u64 size, u8 transpose = 0) {
+	CaptureUniform* uniform = capture_uniform(location, call, count);
+	if (uniform) {
+		uniform->transpose = transpose;
+		uniform->data.assign((const u8*)data, (const u8*)data + size);
+	}
+	if (captureRecording) {
+		capture_begin(call);
+		capture_i32(location);
+		capture_i32(count);
+		capture_u32(transpose);
+		capture_memory(data, size);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glUniform1f(GLint location, GLfloat v0) {
+	captureDriver.Uniform1f(location, v0);
+	capture_uniform_values(CAPTURE_UNIFORM_1F, location, 1, &v0, sizeof(GLfloat));
+}
+
+INTERNAL void APIENTRY capture_glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+	captureDriver.Uniform2f(location, v0, v1);
+	GLfloat values[] = { v0, v1 };
+	capture_uniform_values(CAPTURE_UNIFORM_2F, location, 1, values, sizeof(values));
+}
+
+INTERNAL void APIENTRY capture_glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+	captureDriver.Uniform3f(location, v0, v1, v2);
+	GLfloat values[] = { v0, v1, v2 };
+	capture_uniform_values(CAPTURE_UNIFORM_3F, location, 1, values, sizeof(values));
+}
+
+INTERNAL void APIENTRY capture_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+	captureDriver.Uniform4f(location, v0, v1, v2, v3);
+	GLfloat values[] = { v0, v1, v2, v3 };
+	capture_uniform_values(CAPTURE_UNIFORM_4F, location, 1, values, sizeof(values));
+}
+
+INTERNAL void APIENTRY capture_glUniform1i(GLint location, GLint v0) {
+	captureDriver.Uniform1i(location, v0);
+	capture_uniform_values(CAPTURE_UNIFORM_1I, location, 1, &v0, sizeof(GLint));
+}
+
+INTERNAL void APIENTRY capture_glUniform1iv(GLint location, GLsizei count, const GLint* value) {
+	captureDriver.Uniform1iv(location, count, value);
+	capture_uniform_values(CAPTURE_UNIFORM_1IV, location, count, value, sizeof(GLint) * count);
+}
+
+INTERNAL void APIENTRY capture_glUniform1fv(GLint location, GLsizei count, const GLfloat* value) {
+	captureDriver.Uniform1fv(location, count, value);
+	capture_uniform_values(CAPTURE_UNIFORM_1FV, location, count, value, sizeof(GLfloat) * count);
+}
+
+INTERNAL void APIENTRY capture_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+	captureDriver.UniformMatrix4fv(location, count, transpose, value);
+	capture_uniform_values(CAPTURE_UNIFORM_MATRIX_4FV, location, count, value, sizeof(GLfloat) * 16 * count, transpose);
+}
+
+INTERNAL GLboolean APIENTRY capture_glUnmapBuffer(GLenum target) {
+	GLuint name = capture_bound_buffer(target);
+	CaptureBuffer* buffer = name ? &captureState.buffers[name] : NULL;
+	if (captureRecording && buffer && buffer->mapPointer) {
+		//whatever was written through the mapping is only known now
+		capture_begin(buffer->mapRecorded ? CAPTURE_UNMAP_BUFFER : CAPTURE_BUFFER_SUB_DATA);
+		capture_u32(target);
+		if (!buffer->mapRecorded)
+			capture_u64(buffer->mapOffset);
+		capture_memory(buffer->mapPointer, buffer->mapLength);
+		capture_end();
+	}
+	if (buffer)
+		buffer->mapPointer = NULL;
+	return captureDriver.UnmapBuffer(target);
+}
+
+INTERNAL void APIENTRY capture_glUseProgram(GLuint program) {
+	captureDriver.UseProgram(program);
+	captureState.program = program;
+	if (captureRecording) capture_call(CAPTURE_USE_PROGRAM, program);
+}
+
+INTERNAL void APIENTRY capture_glValidateProgram(GLuint program) {
+	captureDriver.ValidateProgram(program);
+	if (captureRecording) capture_call(CAPTURE_VALIDATE_PROGRAM, program);
+}
+
+INTERNAL void APIENTRY capture_glVertexAttribDivisor(GLuint index, GLuint divisor) {
+	captureDriver.VertexAttribDivisor(index, divisor);
+	if (index < CAPTURE_MAX_ATTRIBUTES)
+		captureState.vertexArrays[captureState.vertexArray].attributes[index].divisor = divisor;
+	if (captureRecording) capture_call(CAPTURE_VERTEX_ATTRIB_DIVISOR, index, divisor);
+}
+
+INTERNAL inline
+void capture_attribute(GLuint index, bool integer, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+	if (index >= CAPTURE_MAX_ATTRIBUTES)
+		return;
+	CaptureAttribute* attribute = &captureState.vertexArrays[captureState.vertexArray].attributes[index];
+	attribute->set = true;
+	attribute->integer = integer;
+	attribute->buffer = capture_bound_buffer(GL_ARRAY_BUFFER);
+	attribute->size = size;
+	attribute->type = type;
+	attribute->normalized = normalized != 0;
+	attribute->stride = stride;
+	attribute->offset = (u64)(uintptr_t)pointer;
+}
+
+INTERNAL void APIENTRY capture_glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer) {
+	captureDriver.VertexAttribIPointer(index, size, type, stride, pointer);
+	capture_attribute(index, true, size, type, GL_FALSE, stride, pointer);
+	if (captureRecording) {
+		capture_begin(CAPTURE_VERTEX_ATTRIB_I_POINTER);
+		capture_u32(index); capture_i32(size); capture_u32(type); capture_i32(stride);
+		capture_u64((u64)(uintptr_t)pointer);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+	captureDriver.VertexAttribPointer(index, size, type, normalized, stride, pointer);
+	capture_attribute(index, false, size, type, normalized, stride, pointer);
+	if (captureRecording) {
+		capture_begin(CAPTURE_VERTEX_ATTRIB_POINTER);
+		capture_u32(index); capture_i32(size); capture_u32(type); capture_u32(normalized); capture_i32(stride);
+		capture_u64((u64)(uintptr_t)pointer);
+		capture_end();
+	}
+}
+
+INTERNAL void APIENTRY capture_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	captureDriver.Viewport(x, y, width, height);
+	if (captureRecording) {
+		capture_begin(CAPTURE_VIEWPORT);
+		capture_i32(x); capture_i32(y); capture_i32(width); capture_i32(height);
+		capture_end();
+	}
+}
+
+//==========================================================================================
+//Setup stream
+//==========================================================================================
+
+template <typename T>
+INTERNAL inline
+std::vector<GLuint> capture_sorted_names(const std::unordered_map<GLuint, T>& objects) {
+	std::vector<GLuint> names;
+	for (typename std::unordered_map<GLuint, T>::const_iterator it = objects.begin(); it != objects.end(); ++it)
+		if (it->first)
+			names.push_back(it->first);
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+INTERNAL inline
+void capture_setup_buffers() {
+	std::vector<GLuint> names = capture_sorted_names(captureState.buffers);
+	std::vector<u8> contents;
+	for (u32 i = 0; i < names.size(); ++i) {
+		CaptureBuffer* buffer = &captureState.buffers[names[i]];
+		capture_names(CAPTURE_GEN_BUFFERS, 1, &names[i]);
+		if (buffer->size == 0)
+			continue;
+
+		capture_call(CAPTURE_BIND_BUFFER, GL_COPY_WRITE_BUFFER, names[i]);
+		capture_begin(CAPTURE_BUFFER_DATA);
+		capture_u32(GL_COPY_WRITE_BUFFER);
+		capture_u64(buffer->size);
+		capture_u32(buffer->usage);
+		if (buffer->mapPointer) {
+			BMT_LOG(WARNING, "Buffer #%d is mapped, its contents are left out of the capture", names[i]);
+			capture_u32(0);
+		}
+		else {
+			contents.resize(buffer->size);
+			captureDriver.BindBuffer(GL_COPY_READ_BUFFER, names[i]);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, buffer->size, &contents[0]);
+			capture_u32(1);
+			capture_memory(&contents[0], buffer->size);
+		}
+		capture_end();
+	}
+	captureDriver.BindBuffer(GL_COPY_READ_BUFFER, capture_bound_buffer(GL_COPY_READ_BUFFER));
+	capture_call(CAPTURE_BIND_BUFFER, GL_COPY_WRITE_BUFFER, capture_bound_buffer(GL_COPY_WRITE_BUFFER));
+}
+
+INTERNAL inline
+void capture_setup_textures() {
+	std::vector<GLuint> names = capture_sorted_names(captureState.textures);
+	std::vector<u8> pixels;
+	GLuint packBuffer = capture_bound_buffer(GL_PIXEL_PACK_BUFFER);
+	if (packBuffer)
+		captureDriver.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	captureDriver.ActiveTexture(GL_TEXTURE0);
+	capture_call(CAPTURE_ACTIVE_TEXTURE, GL_TEXTURE0);
+
+	for (u32 i = 0; i < names.size(); ++i) {
+		CaptureTexture* texture = &captureState.textures[names[i]];
+		capture_names(CAPTURE_GEN_TEXTURES, 1, &names[i]);
+		if (texture->target == 0)
+			continue;
+		capture_call(CAPTURE_BIND_TEXTURE, texture->target, names[i]);
+
+		if (texture->target == GL_TEXTURE_BUFFER) {
+			if (texture->buffer)
+				capture_call(CAPTURE_TEX_BUFFER, GL_TEXTURE_BUFFER, texture->internalFormat, texture->buffer);
+			continue;
+		}
+
+		//every level is read back rather than regenerated, render targets hold last frame's results
+		if (texture->width > 0) {
+			captureDriver.BindTexture(texture->target, names[i]);
+			i32 levels = texture->levels;
+			if (texture->mipmaps) {
+				i32 size = texture->width > texture->height ? texture->width : texture->height;
+				for (levels = 1; size > 1; size >>= 1)
+					levels++;
+			}
+			for (i32 level = 0; level < levels; ++level) {
+				i32 width = texture->width >> level > 0 ? texture->width >> level : 1;
+				i32 height = texture->height >> level > 0 ? texture->height >> level : 1;
+				i32 depth = texture->target == GL_TEXTURE_2D_ARRAY ? texture->depth : 1;
+				u64 size = gl_capture_pixel_bytes(texture->format, texture->type, width, height, depth);
+				pixels.resize(size);
+				glGetTexImage(texture->target, level, texture->format, texture->type, &pixels[0]);
+
+				capture_begin(texture->target == GL_TEXTURE_2D_ARRAY ? CAPTURE_TEX_IMAGE_3D : CAPTURE_TEX_IMAGE_2D);
+				capture_u32(texture->target); capture_i32(level); capture_i32(texture->internalFormat);
+				capture_i32(width); capture_i32(height);
+				if (texture->target == GL_TEXTURE_2D_ARRAY)
+					capture_i32(depth);
+				capture_i32(0);
+				capture_u32(texture->format); capture_u32(texture->type);
+				capture_u32(1);
+				capture_memory(&pixels[0], size);
+				capture_end();
+			}
+		}
+
+		for (std::map<GLenum, CaptureTextureParameter>::iterator it = texture->parameters.begin(); it != texture->parameters.end(); ++it) {
+			if (!it->second.isFloat) {
+				capture_call(CAPTURE_TEX_PARAMETER_I, texture->target, it->first, it->second.value);
+				continue;
+			}
+			capture_begin(CAPTURE_TEX_PARAMETER_FV);
+			capture_u32(texture->target);
+			capture_u32(it->first);
+			capture_memory(it->second.values, sizeof(GLfloat) * (it->first == GL_TEXTURE_BORDER_COLOR ? 4 : 1));
+			capture_end();
+		}
+	}
+
+	//put back what the readback bound on unit 0
+	for (i32 target = 0; target < 3; ++target)
+		captureDriver.BindTexture(capture_texture_target(target), captureState.textureBindings[0][target]);
+	captureDriver.ActiveTexture(GL_TEXTURE0 + captureState.activeTexture);
+	if (packBuffer)
+		captureDriver.BindBuffer(GL_PIXEL_PACK_BUFFER, packBuffer);
+}
+
+INTERNAL inline
+void capture_setup_framebuffers() {
+	std::vector<GLuint> names = capture_sorted_names(captureState.renderbuffers);
+	for (u32 i = 0; i < names.size(); ++i) {
+		CaptureRenderbuffer* renderbuffer = &captureState.renderbuffers[names[i]];
+		capture_names(CAPTURE_GEN_RENDERBUFFERS, 1, &names[i]);
+		if (renderbuffer->width == 0)
+			continue;
+		capture_call(CAPTURE_BIND_RENDERBUFFER, GL_RENDERBUFFER, names[i]);
+		capture_begin(renderbuffer->samples ? CAPTURE_RENDERBUFFER_STORAGE_MULTISAMPLE : CAPTURE_RENDERBUFFER_STORAGE);
+		capture_u32(GL_RENDERBUFFER);
+		if (renderbuffer->samples)
+			capture_i32(renderbuffer->samples);
+		capture_u32(renderbuffer->internalFormat);
+		capture_i32(renderbuffer->width);
+		capture_i32(renderbuffer->height);
+		capture_end();
+	}
+
+	names = capture_sorted_names(captureState.framebuffers);
+	for (u32 i = 0; i < names.size(); ++i) {
+		CaptureFramebuffer* framebuffer = &captureState.framebuffers[names[i]];
+		capture_names(CAPTURE_GEN_FRAMEBUFFERS, 1, &names[i]);
+		capture_call(CAPTURE_BIND_FRAMEBUFFER, GL_FRAMEBUFFER, names[i]);
+		for (u32 a = 0; a < framebuffer->attachments.size(); ++a) {
+			CaptureAttachment* attachment = &framebuffer->attachments[a];
+			capture_begin(attachment->call);
+			capture_u32(GL_FRAMEBUFFER);
+			capture_u32(attachment->attachment);
+			if (attachment->call != CAPTURE_FRAMEBUFFER_TEXTURE_LAYER)
+				capture_u32(attachment->target);
+			capture_u32(attachment->object);
+			if (attachment->call != CAPTURE_FRAMEBUFFER_RENDERBUFFER)
+				capture_i32(attachment->level);
+			if (attachment->call == CAPTURE_FRAMEBUFFER_TEXTURE_LAYER)
+				capture_i32(attachment->layer);
+			capture_end();
+		}
+		if (framebuffer->drawBufferSet)
+			capture_call(CAPTURE_DRAW_BUFFER, framebuffer->drawBuffer);
+		if (framebuffer->readBufferSet)
+			capture_call(CAPTURE_READ_BUFFER, framebuffer->readBuffer);
+	}
+}
+
+INTERNAL inline
+void capture_setup_programs() {
+	std::vector<GLuint> names = capture_sorted_names(captureState.programs);
+	//the shaders a program was linked from are usually long deleted, they get names of their own
+	//that can never clash with a live one
+	u32 shaderName = 0x80000000;
+	for (u32 i = 0; i < names.size(); ++i) {
+		CaptureProgram* program = &captureState.programs[names[i]];
+		capture_call(CAPTURE_CREATE_PROGRAM, names[i]);
+		if (!program->isLinked)
+			continue;
+
+		u32 firstShader = shaderName;
+		for (u32 s = 0; s < program->linked.size(); ++s, ++shaderName) {
+			capture_call(CAPTURE_CREATE_SHADER, program->linked[s].type, shaderName);
+			capture_begin(CAPTURE_SHADER_SOURCE);
+			capture_u32(shaderName);
+			capture_string(program->linked[s].source.c_str());
+			capture_end();
+			capture_call(CAPTURE_COMPILE_SHADER, shaderName);
+			capture_call(CAPTURE_ATTACH_SHADER, names[i], shaderName);
+		}
+		for (u32 a = 0; a < program->attributes.size(); ++a) {
+			capture_begin(CAPTURE_BIND_ATTRIB_LOCATION);
+			capture_u32(names[i]);
+			capture_u32(program->attributes[a].first);
+			capture_string(program->attributes[a].second.c_str());
+			capture_end();
+		}
+		for (u32 f = 0; f < program->fragData.size(); ++f) {
+			capture_begin(CAPTURE_BIND_FRAG_DATA_LOCATION);
+			capture_u32(names[i]);
+			capture_u32(program->fragData[f].first);
+			capture_string(program->fragData[f].second.c_str());
+			capture_end();
+		}
+		capture_call(CAPTURE_LINK_PROGRAM, names[i]);
+		for (u32 s = firstShader; s < shaderName; ++s)
+			capture_call(CAPTURE_DELETE_SHADER, s);
+
+		for (std::map<std::string, GLint>::iterator it = program->locations.begin(); it != program->locations.end(); ++it) {
+			capture_begin(CAPTURE_GET_UNIFORM_LOCATION);
+			capture_u32(names[i]);
+			capture_string(it->first.c_str());
+			capture_i32(it->second);
+			capture_end();
+		}
+		if (program->uniforms.empty())
+			continue;
+		capture_call(CAPTURE_USE_PROGRAM, names[i]);
+		for (std::map<GLint, CaptureUniform>::iterator it = program->uniforms.begin(); it != program->uniforms.end(); ++it) {
+			capture_begin(it->second.call);
+			capture_i32(it->first);
+			capture_i32(it->second.count);
+			capture_u32(it->second.transpose);
+			capture_memory(&it->second.data[0], it->second.data.size());
+			capture_end();
+		}
+	}
+}
+
+INTERNAL inline
+void capture_setup_vertex_arrays() {
+	std::vector<GLuint> names = capture_sorted_names(captureState.vertexArrays);
+	for (u32 i = 0; i < names.size(); ++i) {
+		CaptureVertexArray* vertexArray = &captureState.vertexArrays[names[i]];
+		capture_names(CAPTURE_GEN_VERTEX_ARRAYS, 1, &names[i]);
+		capture_call(CAPTURE_BIND_VERTEX_ARRAY, names[i]);
+		for (u32 a = 0; a < CAPTURE_MAX_ATTRIBUTES; ++a) {
+			CaptureAttribute* attribute = &vertexArray->attributes[a];
+			if (attribute->set) {
+				capture_call(CAPTURE_BIND_BUFFER, GL_ARRAY_BUFFER, attribute->buffer);
+				capture_begin(attribute->integer ? CAPTURE_VERTEX_ATTRIB_I_POINTER : CAPTURE_VERTEX_ATTRIB_POINTER);
+				capture_u32(a);
+				capture_i32(attribute->size);
+				capture_u32(attribute->type);
+				if (!attribute->integer)
+					capture_u32(attribute->normalized);
+				capture_i32(attribute->stride);
+				capture_u64(attribute->offset);
+				capture_end();
+			}
+			if (attribute->divisor)
+				capture_call(CAPTURE_VERTEX_ATTRIB_DIVISOR, a, attribute->divisor);
+			if (attribute->enabled)
+				capture_call(CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY, a);
+		}
+		capture_call(CAPTURE_BIND_BUFFER, GL_ELEMENT_ARRAY_BUFFER, vertexArray->elementBuffer);
+	}
+}
+
+//fixed function state is read from the driver, bindings come from the shadow so they use captured names
+INTERNAL inline
+void capture_setup_state() {
+	GLenum caps[] = { GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_CLIP_DISTANCE0, GL_MULTISAMPLE, GL_SCISSOR_TEST, GL_STENCIL_TEST };
+	for (u32 i = 0; i < sizeof(caps) / sizeof(caps[0]); ++i)
+		capture_call(glIsEnabled(caps[i]) ? CAPTURE_ENABLE : CAPTURE_DISABLE, caps[i]);
+
+	GLint source, destination, depthFunc, cullFace, viewport[4];
+	GLboolean depthMask, colorMask[4];
+	GLfloat clearColor[4];
+	glGetIntegerv(GL_BLEND_SRC_RGB, &source);
+	glGetIntegerv(GL_BLEND_DST_RGB, &destination);
+	glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+	glGetIntegerv(GL_CULL_FACE_MODE, &cullFace);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+	glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+	capture_call(CAPTURE_BLEND_FUNC, source, destination);
+	capture_call(CAPTURE_DEPTH_FUNC, depthFunc);
+	capture_call(CAPTURE_CULL_FACE, cullFace);
+	capture_call(CAPTURE_DEPTH_MASK, depthMask);
+	capture_begin(CAPTURE_COLOR_MASK);
+	capture_u32(colorMask[0]); capture_u32(colorMask[1]); capture_u32(colorMask[2]); capture_u32(colorMask[3]);
+	capture_end();
+	capture_begin(CAPTURE_CLEAR_COLOR);
+	capture_f32(clearColor[0]); capture_f32(clearColor[1]); capture_f32(clearColor[2]); capture_f32(clearColor[3]);
+	capture_end();
+	capture_begin(CAPTURE_VIEWPORT);
+	capture_i32(viewport[0]); capture_i32(viewport[1]); capture_i32(viewport[2]); capture_i32(viewport[3]);
+	capture_end();
+
+	capture_call(CAPTURE_USE_PROGRAM, captureState.program);
+	capture_call(CAPTURE_BIND_VERTEX_ARRAY, captureState.vertexArray);
+	for (std::map<GLenum, GLuint>::iterator it = captureState.bufferBindings.begin(); it != captureState.bufferBindings.end(); ++it)
+		capture_call(CAPTURE_BIND_BUFFER, it->first, it->second);
+	capture_call(CAPTURE_BIND_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER, captureState.drawFramebuffer);
+	capture_call(CAPTURE_BIND_FRAMEBUFFER, GL_READ_FRAMEBUFFER, captureState.readFramebuffer);
+	capture_call(CAPTURE_BIND_RENDERBUFFER, GL_RENDERBUFFER, captureState.renderbuffer);
+	for (u32 unit = 0; unit < CAPTURE_TEXTURE_UNITS; ++unit) {
+		for (i32 target = 0; target < 3; ++target) {
+			if (captureState.textureBindings[unit][target] == 0 && unit != 0)
+				continue;
+			capture_call(CAPTURE_ACTIVE_TEXTURE, GL_TEXTURE0 + unit);
+			capture_call(CAPTURE_BIND_TEXTURE, capture_texture_target(target), captureState.textureBindings[unit][target]);
+		}
+	}
+	capture_call(CAPTURE_ACTIVE_TEXTURE, GL_TEXTURE0 + captureState.activeTexture);
+}
+
+INTERNAL inline
+void capture_setup() {
+	capture_setup_buffers();
+	capture_setup_textures();
+	capture_setup_framebuffers();
+	capture_setup_programs();
+	capture_setup_vertex_arrays();
+
+	//queries that were written before the capture get a timestamp so reading them back is legal,
+	//fences that were pending are recreated so the first waits have something to wait on
+	std::vector<GLuint> queries = capture_sorted_names(captureState.queries);
+	for (u32 i = 0; i < queries.size(); ++i) {
+		capture_names(CAPTURE_GEN_QUERIES, 1, &queries[i]);
+		if (captureState.queries[queries[i]])
+			capture_call(CAPTURE_QUERY_COUNTER, queries[i], GL_TIMESTAMP);
+	}
+	for (u32 i = 0; i < captureState.syncs.size(); ++i) {
+		capture_begin(CAPTURE_FENCE_SYNC);
+		capture_u32(GL_SYNC_GPU_COMMANDS_COMPLETE);
+		capture_u32(0);
+		capture_u64((u64)(uintptr_t)captureState.syncs[i]);
+		capture_end();
+	}
+
+	capture_setup_state();
+	capture_call(CAPTURE_SETUP_END);
+}
+
+//==========================================================================================
+//Description: Swaps the glad pointers the engine uses for recording wrappers. Call it
+//             right after init_window, objects created before it are unknown to captures
+//==========================================================================================
+void install_gl_capture() {
+	if (captureInstalled)
+		return;
+#define CAPTURE_HOOK(name, NAME) captureDriver.name = glad_gl##name; glad_gl##name = capture_gl##name;
+	CAPTURE_FUNCTIONS(CAPTURE_HOOK)
+#undef CAPTURE_HOOK
+
+	captureState.vertexArrays[0] = CaptureVertexArray();
+	captureInstalled = true;
+	BMT_LOG(INFO, "GL capture layer installed");
+}
+
+bool is_gl_capture_installed() {
+	return captureInstalled;
+}
+
+//==========================================================================================
+//Description: Starts recording GL calls, to be written to path once the given number of
+//             frames have ended
+//
+//Comments: Call it between frames, on the thread that owns the context. The setup stream
+//          reads every buffer and texture back, so this frame will hitch. The window size
+//          is passed in because GLFW only reports it on the main thread
+//==========================================================================================
+bool begin_gl_capture(const char* path, u32 width, u32 height, u32 frames) {
+	if (!captureInstalled) {
+		BMT_LOG(WARNING, "GL capture requested but the capture layer was never installed");
+		return false;
+	}
+	if (captureRecording || frames == 0)
+		return false;
+
+	capturePath = path;
+	captureFrames = frames;
+	captureFramesLeft = frames;
+	captureWidth = width;
+	captureHeight = height;
+	captureStream.clear();
+	capture_setup();
+	captureSetupBytes = captureStream.size();
+	captureRecording = true;
+	BMT_LOG(INFO, "Capturing %d GL frame(s) to %s", frames, path);
+	return true;
+}
+
+//==========================================================================================
+//Description: Marks the end of a frame, after swapping buffers. Writes the capture out
+//             once the last frame requested has ended
+//==========================================================================================
+void end_gl_capture_frame() {
+	if (!captureRecording)
+		return;
+	capture_call(CAPTURE_FRAME_END);
+	if (--captureFramesLeft > 0)
+		return;
+	captureRecording = false;
+
+	GLCaptureHeader header;
+	header.magic = GL_CAPTURE_MAGIC;
+	header.version = GL_CAPTURE_VERSION;
+	header.width = captureWidth;
+	header.height = captureHeight;
+	header.defaultFramebuffer = get_default_framebuffer();
+	header.frames = captureFrames;
+	header.setupBytes = captureSetupBytes;
+	header.frameBytes = captureStream.size() - captureSetupBytes;
+
+	FILE* file = fopen(capturePath.c_str(), "wb");
+	if (file == NULL) {
+		BMT_LOG(WARNING, "Could not open %s to write the GL capture", capturePath.c_str());
+		return;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&captureStream[0], 1, captureStream.size(), file);
+	fclose(file);
+	BMT_LOG(INFO, "GL capture written to %s, %.1f MB setup and %.1f MB over %d frame(s)", capturePath.c_str(),
+		captureSetupBytes / (1024.0 * 1024.0), header.frameBytes / (1024.0 * 1024.0), captureFrames);
+
+	std::vector<u8>().swap(captureStream);
+}
+
+bool is_gl_capturing() {
+	return captureRecording;
+}
@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        gl_capture.h                             //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifndef GL_CAPTURE_H
+#define GL_CAPTURE_H
+
+#include "defines.h"
+#include <glad/glad.h>
+
+//Opt-in recorder for the GL calls the engine makes, for taking a hitching frame
+//back to the desk. install_gl_capture() swaps the glad function pointers for
+//wrappers that forward to the driver and keep a shadow copy of every live object.
+//A run that never installs it is untouched.
+//
+//begin_gl_capture() writes that shadow out as a setup stream: objects, buffer and
+//texture contents read back from the GPU, uniform values and the bound state. From
+//then on every call is appended with its arguments and whatever memory it reads,
+//until the requested number of end_gl_capture_frame() calls have gone by. The file
+//is only written once the last frame ends.
+//
+//tools/gl_replay.cpp runs the setup stream and then re-executes the frames on a
+//headless context, timing every call. Object names, uniform locations and sync
+//objects are remapped on the way in, so a capture replays on any driver.
+//
+//Only the functions wrapped in gl_capture.cpp are seen. A GL function the engine
+//starts using has to be added there and to the replay tool as well.
+//
+//File layout: a GLCaptureHeader, then records of a GLCaptureRecord followed by
+//`size` bytes of arguments. Arguments are packed without padding: integers and
+//enums as 32 bits, sizes, offsets and sync handles as 64 bits, and memory as a
+//64 bit length followed by the bytes.
+
+#define GL_CAPTURE_MAGIC   0x50414347 //"GCAP"
+#define GL_CAPTURE_VERSION 1
+
+struct GLCaptureHeader {
+	u32 magic;
+	u32 version;
+	u32 width;
+	u32 height;
+	u32 defaultFramebuffer;
+	u32 frames;
+	u64 setupBytes;
+	u64 frameBytes;
+};
+
+struct GLCaptureRecord {
+	u16 call;
+	u16 reserved;
+	u32 size;
+};
+
+enum GLCaptureCall {
+	CAPTURE_ACTIVE_TEXTURE,
+	CAPTURE_ATTACH_SHADER,
+	CAPTURE_BIND_ATTRIB_LOCATION,
+	CAPTURE_BIND_BUFFER,
+	CAPTURE_BIND_FRAG_DATA_LOCATION,
+	CAPTURE_BIND_FRAMEBUFFER,
+	CAPTURE_BIND_RENDERBUFFER,
+	CAPTURE_BIND_TEXTURE,
+	CAPTURE_BIND_VERTEX_ARRAY,
+	CAPTURE_BLEND_FUNC,
+	CAPTURE_BLIT_FRAMEBUFFER,
+	CAPTURE_BUFFER_DATA,
+	CAPTURE_CHECK_FRAMEBUFFER_STATUS,
+	CAPTURE_CLEAR,
+	CAPTURE_CLEAR_COLOR,
+	CAPTURE_CLIENT_WAIT_SYNC,
+	CAPTURE_COLOR_MASK,
+	CAPTURE_COMPILE_SHADER,
+	CAPTURE_CREATE_PROGRAM,
+	CAPTURE_CREATE_SHADER,
+	CAPTURE_CULL_FACE,
+	CAPTURE_DELETE_BUFFERS,
+	CAPTURE_DELETE_FRAMEBUFFERS,
+	CAPTURE_DELETE_PROGRAM,
+	CAPTURE_DELETE_QUERIES,
+	CAPTURE_DELETE_RENDERBUFFERS,
+	CAPTURE_DELETE_SHADER,
+	CAPTURE_DELETE_SYNC,
+	CAPTURE_DELETE_TEXTURES,
+	CAPTURE_DELETE_VERTEX_ARRAYS,
+	CAPTURE_DEPTH_FUNC,
+	CAPTURE_DEPTH_MASK,
+	CAPTURE_DISABLE,
+	CAPTURE_DISABLE_VERTEX_ATTRIB_ARRAY,
+	CAPTURE_DRAW_ARRAYS,
+	CAPTURE_DRAW_ARRAYS_INSTANCED,
+	CAPTURE_DRAW_BUFFER,
+	CAPTURE_DRAW_ELEMENTS,
+	CAPTURE_DRAW_ELEMENTS_INSTANCED,
+	CAPTURE_ENABLE,
+	CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY,
+	CAPTURE_FENCE_SYNC,
+	CAPTURE_FRAMEBUFFER_RENDERBUFFER,
+	CAPTURE_FRAMEBUFFER_TEXTURE_2D,
+	CAPTURE_FRAMEBUFFER_TEXTURE_LAYER,
+	CAPTURE_GEN_BUFFERS,
+	CAPTURE_GEN_FRAMEBUFFERS,
+	CAPTURE_GEN_QUERIES,
+	CAPTURE_GEN_RENDERBUFFERS,
+	CAPTURE_GEN_TEXTURES,
+	CAPTURE_GEN_VERTEX_ARRAYS,
+	CAPTURE_GENERATE_MIPMAP,
+	CAPTURE_GET_QUERY_OBJECT_IV,
+	CAPTURE_GET_QUERY_OBJECT_UI64V,
+	CAPTURE_GET_UNIFORM_LOCATION,
+	CAPTURE_LINK_PROGRAM,
+	CAPTURE_MAP_BUFFER_RANGE,
+	CAPTURE_QUERY_COUNTER,
+	CAPTURE_READ_BUFFER,
+	CAPTURE_READ_PIXELS,
+	CAPTURE_RENDERBUFFER_STORAGE,
+	CAPTURE_RENDERBUFFER_STORAGE_MULTISAMPLE,
+	CAPTURE_SHADER_SOURCE,
+	CAPTURE_TEX_BUFFER,
+	CAPTURE_TEX_IMAGE_2D,
+	CAPTURE_TEX_IMAGE_3D,
+	CAPTURE_TEX_PARAMETER_I,
+	CAPTURE_TEX_PARAMETER_FV,
+	CAPTURE_TEX_SUB_IMAGE_2D,
+	CAPTURE_UNIFORM_1F,
+	CAPTURE_UNIFORM_2F,
+	CAPTURE_UNIFORM_3F,
+	CAPTURE_UNIFORM_4F,
+	CAPTURE_UNIFORM_1I,
+	CAPTURE_UNIFORM_1IV,
+	CAPTURE_UNIFORM_1FV,
+	CAPTURE_UNIFORM_MATRIX_4FV,
+	CAPTURE_UNMAP_BUFFER,
+	CAPTURE_USE_PROGRAM,
+	CAPTURE_VALIDATE_PROGRAM,
+	CAPTURE_VERTEX_ATTRIB_DIVISOR,
+	CAPTURE_VERTEX_ATTRIB_I_POINTER,
+	CAPTURE_VERTEX_ATTRIB_POINTER,
+	CAPTURE_VIEWPORT,
+
+	//not GL calls: buffer contents written through a mapping that was opened before the
+	//capture began, and the markers between the setup stream and each frame
+	CAPTURE_BUFFER_SUB_DATA,
+	CAPTURE_SETUP_END,
+	CAPTURE_FRAME_END,
+	CAPTURE_CALL_COUNT
+};
+
+//defined once in gl_capture.cpp, which the replay tool links as well
+EXTERNAL const char* GL_CAPTURE_CALL_NAMES[CAPTURE_CALL_COUNT];
+
+//==========================================================================================
+//Description: Bytes of client memory a pixel transfer of the given size reads or writes
+//
+//Comments: Rows are padded to the default GL_(UN)PACK_ALIGNMENT of 4, the engine never
+//          changes it
+//==========================================================================================
+INTERNAL inline
+u64 gl_capture_pixel_bytes(GLenum format, GLenum type, i32 width, i32 height, i32 depth) {
+	u64 components = 4;
+	switch (format) {
+	case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: case GL_DEPTH_STENCIL: components = 1; break;
+	case GL_RG: case GL_RG_INTEGER: components = 2; break;
+	case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+	}
+
+	u64 pixel = 0;
+	switch (type) {
+	case GL_UNSIGNED_BYTE: case GL_BYTE: pixel = components; break;
+	case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: pixel = components * 2; break;
+	case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: pixel = components * 4; break;
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV: pixel = 8; break;
+	default: pixel = 4; break; //the packed 32 bit types, GL_UNSIGNED_INT_24_8 and friends
+	}
+
+	u64 row = ((u64)width * pixel + 3) & ~(u64)3;
+	return row * (u64)height * (u64)(depth > 0 ? depth : 1);
+}
+
+void install_gl_capture();
+bool is_gl_capture_installed();
+bool begin_gl_capture(const char* path, u32 width, u32 height, u32 frames = 1);
+void end_gl_capture_frame();
+bool is_gl_capturing();
+
+#endif
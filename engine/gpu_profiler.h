@@ -0,0 +1,329 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                     gpu_profiler.h                              //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "defines.h"
+#include "render2D.h"
+#include <algorithm>
+
+//Passes are timed with GL_TIMESTAMP query pairs (glQueryCounter) instead of
+//GL_TIME_ELAPSED so that passes may nest. Every frame writes into its own set
+//of queries and results are only read back GPU_PROFILER_FRAMES frames later,
+//by which point the GPU has finished with them and the readback never stalls.
+
+#ifndef GPU_PROFILER_MAX_PASSES
+#define GPU_PROFILER_MAX_PASSES    32
+#endif
+#ifndef GPU_PROFILER_FRAMES
+#define GPU_PROFILER_FRAMES        4
+#endif
+#ifndef GPU_PROFILER_HISTORY
+#define GPU_PROFILER_HISTORY       128
+#endif
+#define GPU_PROFILER_NAME_LENGTH   32
+#define GPU_PROFILER_UNTIMED       0xFFFFFFFF
+
+struct GPUPassStats {
+	const char* name;
+	f64 last;
+	f64 avg;
+	f64 p50;
+	f64 p95;
+	f64 p99;
+	f64 max;
+	u32 samples;
+};
+
+struct GPUPass {
+	char name[GPU_PROFILER_NAME_LENGTH];
+	f32 history[GPU_PROFILER_HISTORY];
+	u32 head;
+	u32 count;
+	f64 last;
+};
+
+struct GPUFrameQueries {
+	GLuint begin[GPU_PROFILER_MAX_PASSES];
+	GLuint end[GPU_PROFILER_MAX_PASSES];
+	u16 pass[GPU_PROFILER_MAX_PASSES];
+	u8 level[GPU_PROFILER_MAX_PASSES];
+	u32 count;
+	bool pending;
+};
+
+struct GPUProfiler {
+	GPUPass passes[GPU_PROFILER_MAX_PASSES];
+	u32 passcount;
+	GPUFrameQueries frames[GPU_PROFILER_FRAMES];
+	u32 frame;
+	u32 stack[GPU_PROFILER_MAX_PASSES];
+	u32 depth;
+	f64 frameTime;
+	bool supported;
+	bool enabled;
+};
+
+INTERNAL inline
+void init_gpu_profiler(GPUProfiler* profiler) {
+	memset(profiler, 0, sizeof(GPUProfiler));
+
+	GLint bits = 0;
+	if (GLAD_GL_VERSION_3_3)
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+	profiler->supported = bits > 0;
+	profiler->enabled = profiler->supported;
+
+	if (!profiler->supported) {
+		BMT_LOG(WARNING, "GPU timer queries are not supported, GPU profiler disabled");
+		return;
+	}
+
+	for (u32 i = 0; i < GPU_PROFILER_FRAMES; ++i) {
+		glGenQueries(GPU_PROFILER_MAX_PASSES, profiler->frames[i].begin);
+		glGenQueries(GPU_PROFILER_MAX_PASSES, profiler->frames[i].end);
+	}
+	BMT_LOG(INFO, "GPU profiler initialized (%d bit timestamps)", bits);
+}
+
+INTERNAL inline
+void dispose_gpu_profiler(GPUProfiler* profiler) {
+	if (!profiler->supported)
+		return;
+	for (u32 i = 0; i < GPU_PROFILER_FRAMES; ++i) {
+		glDeleteQueries(GPU_PROFILER_MAX_PASSES, profiler->frames[i].begin);
+		glDeleteQueries(GPU_PROFILER_MAX_PASSES, profiler->frames[i].end);
+	}
+	profiler->supported = profiler->enabled = false;
+}
+
+INTERNAL inline
+i32 find_gpu_pass(GPUProfiler* profiler, const char* name) {
+	for (u32 i = 0; i < profiler->passcount; ++i)
+		if (strncmp(profiler->passes[i].name, name, GPU_PROFILER_NAME_LENGTH - 1) == 0)
+			return i;
+	return -1;
+}
+
+INTERNAL inline
+void push_gpu_sample(GPUPass* pass, f64 ms) {
+	pass->last = ms;
+	pass->history[pass->head] = (f32)ms;
+	pass->head = (pass->head + 1) % GPU_PROFILER_HISTORY;
+	if (pass->count < GPU_PROFILER_HISTORY)
+		pass->count++;
+}
+
+//==========================================================================================
+//Description: Reads back the queries of a finished frame and adds them to the history
+//
+//Comments: Passes that ran several times in one frame are summed into one sample.
+//          If the results are somehow still not available the frame is dropped rather
+//          than waiting on the GPU.
+//==========================================================================================
+INTERNAL inline
+void collect_gpu_frame(GPUProfiler* profiler, GPUFrameQueries* frame) {
+	if (!frame->pending)
+		return;
+	frame->pending = false;
+	if (frame->count == 0)
+		return;
+
+	GLint available = 0;
+	glGetQueryObjectiv(frame->end[frame->count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	f64 sums[GPU_PROFILER_MAX_PASSES] = { 0 };
+	bool used[GPU_PROFILER_MAX_PASSES] = { 0 };
+	f64 total = 0;
+	for (u32 i = 0; i < frame->count; ++i) {
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(frame->begin[i], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame->end[i], GL_QUERY_RESULT, &end);
+		f64 ms = end > begin ? (f64)(end - begin) / 1000000.0 : 0.0;
+		sums[frame->pass[i]] += ms;
+		used[frame->pass[i]] = true;
+		//nested passes are already contained in their parent
+		if (frame->level[i] == 0)
+			total += ms;
+	}
+
+	for (u32 i = 0; i < profiler->passcount; ++i)
+		if (used[i])
+			push_gpu_sample(&profiler->passes[i], sums[i]);
+	profiler->frameTime = total;
+}
+
+INTERNAL inline
+void begin_gpu_frame(GPUProfiler* profiler) {
+	if (!profiler->enabled)
+		return;
+	GPUFrameQueries* frame = &profiler->frames[profiler->frame % GPU_PROFILER_FRAMES];
+	collect_gpu_frame(profiler, frame);
+	frame->count = 0;
+	profiler->depth = 0;
+}
+
+INTERNAL inline
+void end_gpu_frame(GPUProfiler* profiler) {
+	if (!profiler->enabled)
+		return;
+	BMT_ASSERT(profiler->depth == 0);
+	profiler->frames[profiler->frame % GPU_PROFILER_FRAMES].pending = true;
+	profiler->frame++;
+}
+
+INTERNAL inline
+void begin_gpu_pass(GPUProfiler* profiler, const char* name) {
+	if (!profiler->enabled)
+		return;
+	BMT_ASSERT(profiler->depth < GPU_PROFILER_MAX_PASSES);
+	GPUFrameQueries* frame = &profiler->frames[profiler->frame % GPU_PROFILER_FRAMES];
+
+	i32 index = find_gpu_pass(profiler, name);
+	if (index < 0 && profiler->passcount < GPU_PROFILER_MAX_PASSES) {
+		index = profiler->passcount++;
+		strncpy(profiler->passes[index].name, name, GPU_PROFILER_NAME_LENGTH - 1);
+	}
+	if (index < 0 || frame->count >= GPU_PROFILER_MAX_PASSES) {
+		//keep begin/end balanced, the matching end_gpu_pass() skips this one
+		profiler->stack[profiler->depth++] = GPU_PROFILER_UNTIMED;
+		return;
+	}
+
+	u32 slot = frame->count++;
+	frame->pass[slot] = (u16)index;
+	frame->level[slot] = (u8)profiler->depth;
+	glQueryCounter(frame->begin[slot], GL_TIMESTAMP);
+	profiler->stack[profiler->depth++] = slot;
+}
+
+INTERNAL inline
+void end_gpu_pass(GPUProfiler* profiler) {
+	if (!profiler->enabled || profiler->depth == 0)
+		return;
+	GPUFrameQueries* frame = &profiler->frames[profiler->frame % GPU_PROFILER_FRAMES];
+	u32 slot = profiler->stack[--profiler->depth];
+	if (slot == GPU_PROFILER_UNTIMED)
+		return;
+	glQueryCounter(frame->end[slot], GL_TIMESTAMP);
+}
+
+INTERNAL inline
+GPUPassStats get_gpu_pass_stats(GPUProfiler* profiler, u32 index) {
+	GPUPassStats stats = { 0 };
+	if (index >= profiler->passcount)
+		return stats;
+
+	GPUPass* pass = &profiler->passes[index];
+	stats.name = pass->name;
+	stats.last = pass->last;
+	stats.samples = pass->count;
+	if (pass->count == 0)
+		return stats;
+
+	f32 sorted[GPU_PROFILER_HISTORY];
+	memcpy(sorted, pass->history, pass->count * sizeof(f32));
+	std::sort(sorted, sorted + pass->count);
+
+	f64 sum = 0;
+	for (u32 i = 0; i < pass->count; ++i)
+		sum += sorted[i];
+	stats.avg = sum / pass->count;
+	stats.p50 = sorted[(pass->count - 1) * 50 / 100];
+	stats.p95 = sorted[(pass->count - 1) * 95 / 100];
+	stats.p99 = sorted[(pass->count - 1) * 99 / 100];
+	stats.max = sorted[pass->count - 1];
+	return stats;
+}
+
+INTERNAL inline
+GPUPassStats get_gpu_pass_stats(GPUProfiler* profiler, const char* name) {
+	i32 index = find_gpu_pass(profiler, name);
+	if (index < 0) {
+		GPUPassStats stats = { 0 };
+		stats.name = name;
+		return stats;
+	}
+	return get_gpu_pass_stats(profiler, (u32)index);
+}
+
+INTERNAL inline
+void dump_gpu_profiler(GPUProfiler* profiler) {
+	if (!profiler->supported) {
+		BMT_LOG(INFO, "GPU profiler: timer queries unsupported");
+		return;
+	}
+	BMT_LOG(INFO, "GPU profiler (ms over last %d frames)", GPU_PROFILER_HISTORY);
+	BMT_LOG(INFO, "%-20s %8s %8s %8s %8s %8s", "pass", "avg", "p50", "p95", "p99", "max");
+	for (u32 i = 0; i < profiler->passcount; ++i) {
+		GPUPassStats s = get_gpu_pass_stats(profiler, i);
+		BMT_LOG(INFO, "%-20s %8.3f %8.3f %8.3f %8.3f %8.3f", s.name, s.avg, s.p50, s.p95, s.p99, s.max);
+	}
+	BMT_LOG(INFO, "%-20s %8.3f", "frame", profiler->frameTime);
+}
+
+//==========================================================================================
+//Description: Draws the average time of every pass as a stacked bar, with the p95 of
+//             each pass as a thin marker underneath it.
+//
+//Parameters:
+//		-A bound quad batch
+//		-The profiler to draw
+//		-Top left corner of the graph
+//		-Pixels per millisecond
+//
+//Comments: The white line marks a 60 FPS (16.6ms) frame budget.
+//==========================================================================================
+INTERNAL inline
+void draw_gpu_profiler(QuadBatch* batch, GPUProfiler* profiler, i32 x, i32 y, f32 scale = 20.0f) {
+	LOCAL vec4 PASS_COLORS[] = {
+		V4(230, 41, 55, 255), V4(0, 228, 48, 255), V4(0, 121, 241, 255), V4(253, 249, 0, 255),
+		V4(200, 122, 255, 255), V4(255, 161, 0, 255), V4(102, 191, 255, 255), V4(255, 109, 194, 255)
+	};
+	const i32 height = 12;
+
+	draw_rectangle(batch, x - 2, y - 2, (i32)(16.6f * scale) + 4, height * 2 + 4, 0, 0, 0, 160);
+
+	f32 offset = 0;
+	for (u32 i = 0; i < profiler->passcount; ++i) {
+		GPUPassStats s = get_gpu_pass_stats(profiler, i);
+		vec4 color = PASS_COLORS[i % (sizeof(PASS_COLORS) / sizeof(PASS_COLORS[0]))];
+
+		i32 width = (i32)(s.avg * scale);
+		if (width < 1) width = 1;
+		draw_rectangle(batch, x + (i32)offset, y, width, height, color);
+		draw_rectangle(batch, x + (i32)(offset + s.p95 * scale), y + height, 2, height, color);
+		offset += (f32)(s.avg * scale);
+	}
+	draw_rectangle(batch, x + (i32)(16.6f * scale), y - 2, 1, height * 2 + 4, 255, 255, 255, 255);
+}
+
+#endif
@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        jobs.cpp                                 //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#include "jobs.h"
+#include "profiler.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+struct Job {
+	JobFunc func;
+	void* data;
+	JobCounter* counter;
+};
+
+GLOBAL std::vector<std::thread*> jobWorkers;
+GLOBAL std::deque<Job> jobQueue;
+GLOBAL std::mutex jobMutex;
+GLOBAL std::condition_variable jobSignal;
+GLOBAL bool jobShutdown;
+
+INTERNAL
+void execute_job(Job job) {
+	job.func(job.data);
+	if (job.counter)
+		job.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+INTERNAL
+bool try_pop_job(Job* job) {
+	std::lock_guard<std::mutex> lock(jobMutex);
+	if (jobQueue.empty())
+		return false;
+	*job = jobQueue.front();
+	jobQueue.pop_front();
+	return true;
+}
+
+INTERNAL
+void job_worker(u32 index) {
+	char name[32];
+	snprintf(name, sizeof(name), "worker %u", index);
+	BMT_PROFILE_THREAD(name);
+
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobSignal.wait(lock, [] { return jobShutdown || !jobQueue.empty(); });
+			if (jobShutdown && jobQueue.empty())
+				return;
+			job = jobQueue.front();
+			jobQueue.pop_front();
+		}
+		execute_job(job);
+	}
+}
+
+void init_job_system(u32 workers) {
+	if (!jobWorkers.empty())
+		return;
+	if (workers == 0) {
+		u32 hardware = std::thread::hardware_concurrency();
+		workers = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	jobShutdown = false;
+	for (u32 i = 0; i < workers; ++i)
+		jobWorkers.push_back(new std::thread(job_worker, i));
+	BMT_LOG(INFO, "Job system started with %d worker threads", workers);
+}
+
+void dispose_job_system() {
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobShutdown = true;
+	}
+	jobSignal.notify_all();
+	for (u32 i = 0; i < jobWorkers.size(); ++i) {
+		jobWorkers[i]->join();
+		delete jobWorkers[i];
+	}
+	jobWorkers.clear();
+}
+
+u32 get_job_worker_count() {
+	return (u32)jobWorkers.size();
+}
+
+void run_job(JobFunc func, void* data, JobCounter* counter) {
+	if (jobWorkers.empty()) {
+		func(data);
+		return;
+	}
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobQueue.push_back({ func, data, counter });
+	}
+	jobSignal.notify_one();
+}
+
+bool jobs_finished(JobCounter* counter) {
+	return counter->pending.load(std::memory_order_acquire) <= 0;
+}
+
+void wait_for_jobs(JobCounter* counter) {
+	while (!jobs_finished(counter)) {
+		Job job;
+		if (try_pop_job(&job))
+			execute_job(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+struct ParallelForChunk {
+	ParallelForFunc func;
+	void* data;
+	u32 begin;
+	u32 end;
+};
+
+INTERNAL
+void run_parallel_for_chunk(void* data) {
+	ParallelForChunk* chunk = (ParallelForChunk*)data;
+	chunk->func(chunk->data, chunk->begin, chunk->end);
+}
+
+void parallel_for(u32 count, u32 grain, ParallelForFunc func, void* data) {
+	if (count == 0)
+		return;
+	if (grain == 0)
+		grain = 1;
+	if (jobWorkers.empty() || count <= grain) {
+		func(data, 0, count);
+		return;
+	}
+
+	u32 chunkcount = (count + grain - 1) / grain;
+	std::vector<ParallelForChunk> chunks(chunkcount);
+	JobCounter counter;
+	//the last chunk runs on this thread, the rest go to the pool
+	for (u32 i = 0; i < chunkcount; ++i) {
+		chunks[i].func = func;
+		chunks[i].data = data;
+		chunks[i].begin = i * grain;
+		chunks[i].end = (i + 1) * grain < count ? (i + 1) * grain : count;
+		if (i + 1 < chunkcount)
+			run_job(run_parallel_for_chunk, &chunks[i], &counter);
+	}
+	run_parallel_for_chunk(&chunks[chunkcount - 1]);
+	wait_for_jobs(&counter);
+}
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                         jobs.h                                  //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "defines.h"
+#include <atomic>
+
+//A fixed pool of worker threads shared by the whole engine. Unlike
+//scale_image_linear() which spawns threads per call, the pool is created
+//once by init_job_system() so per-frame work doesn't pay for thread creation.
+//
+//Every function here is safe to call before init_job_system() or with zero
+//workers, in which case jobs simply run on the calling thread.
+
+typedef void(*JobFunc)(void* data);
+typedef void(*ParallelForFunc)(void* data, u32 begin, u32 end);
+
+struct JobCounter {
+	std::atomic<i32> pending;
+	JobCounter() : pending(0) {}
+};
+
+//workers = 0 uses one worker per hardware thread, minus the calling thread
+void init_job_system(u32 workers = 0);
+void dispose_job_system();
+u32 get_job_worker_count();
+
+void run_job(JobFunc func, void* data, JobCounter* counter);
+bool jobs_finished(JobCounter* counter);
+//Blocks until every job attached to counter finished. The calling thread
+//runs queued jobs while it waits instead of sleeping.
+void wait_for_jobs(JobCounter* counter);
+
+//Splits [0, count) into chunks of at most grain items and runs func on each
+//chunk across the pool, returning once all of them are done.
+void parallel_for(u32 count, u32 grain, ParallelForFunc func, void* data);
+
+#endif
@@ -975,7 +975,7 @@ void move_cam_left(Camera* cam, f32 units) {
 
 INTERNAL inline
 f32 lerp(f32 t, f32 a1, f32 a2) {
-    return a1 * t*(a2-a1);
+    return a1 + t*(a2-a1);
 }
 
 INTERNAL inline
@@ -1000,8 +1000,9 @@ vec2 get_constant_vector(int v) {
         return {1, -1};
 }
 
+//single sample of the original perlin noise, noise.h has the seeded and SIMD versions
 INTERNAL inline
-f32 noise2D(f32 x, f32 y, std::vector<f32> P) {
+f32 noise2D(f32 x, f32 y, const std::vector<f32>& P) {
     f32 x2 = (i32)std::floor(x) & 255;
     f32 y2 = (i32)std::floor(y) & 255;
 
@@ -1029,34 +1030,4 @@ f32 noise2D(f32 x, f32 y, std::vector<f32> P) {
     return lerp(u, lerp(v, dotBottomLeft, dotTopLeft), lerp(v, dotBottomRight, dotTopRight));
 }
 
-INTERNAL inline
-vec3* perlin_noise(int width, int height) {
-    vec3* image = new vec3[width * height];
-
-    std::vector<f32> P;
-    for(int i = 0; i < 256; ++i)
-        P.push_back(i);
-
-    for(int i = P.size()-1; i > 0; i--) {
-        int index = std::floor(rand() % i);
-        f32 temp = P[i];
-        P[i] = P[index];
-        P[index] = temp;
-    }
-
-    for(int i = 0; i < 256; ++i)
-        P.push_back(P[i]);
-
-    for(int y = 0; y < height; ++y) {
-        for(int x = 0; x < width; ++x) {
-            f32 n = noise2D(x*0.01, y*0.01, P);
-            n+=1.0f;
-            n/=2.0f;
-            int c = std::floor(255*n);
-            image[x + y * width] = {(f32)c, (f32)c, (f32)c};
-        }
-    }
-    return image;
-}
-
 #endif
@@ -0,0 +1,500 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        noise.h                                  //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef NOISE_H
+#define NOISE_H
+
+#include "defines.h"
+#include "maths.h"
+#include "jobs.h"
+#include "profiler.h"
+#include <chrono>
+
+//Gradient, simplex and value noise with fBm and ridged fractals.
+//
+//Each Noise owns a seeded integer permutation table, so two generators with
+//the same seed give the same images. Single samples go through noise_2D.
+//Whole images go through generate_noise, which splits the rows across the job
+//system and evaluates four samples at a time with SSE when BMT_SSE is
+//available. The SIMD path uses the same math as the scalar one, so both give
+//the same values up to rounding.
+//
+//		Noise noise = create_noise(1234, NOISE_PERLIN, NOISE_FBM, 5, 0.01f);
+//		f32 height = noise_2D(&noise, x, z);
+//		generate_noise(&noise, pixels, 4096, 4096);
+
+enum NoiseType {
+	NOISE_VALUE,
+	NOISE_PERLIN,
+	NOISE_SIMPLEX
+};
+
+enum NoiseFractal {
+	//one octave, roughly in [-1, 1]
+	NOISE_SINGLE,
+	//octaves summed and normalized, roughly in [-1, 1]
+	NOISE_FBM,
+	//sharp creases where the octaves cross zero, in [0, 1]
+	NOISE_RIDGED
+};
+
+struct Noise {
+	//256 entries repeated twice, so two lookups never need wrapping
+	i32 perm[512];
+	NoiseType type;
+	NoiseFractal fractal;
+	u32 octaves;
+	f32 frequency;
+	f32 lacunarity;
+	f32 gain;
+};
+
+#define NOISE_SIMPLEX_F2   0.36602540378f
+#define NOISE_SIMPLEX_G2   0.21132486540f
+#define NOISE_OCTAVE_SHIFT 19.19f
+
+//==========================================================================================
+//Description: Creates a noise generator
+//
+//Parameters:
+//		-Seed of the permutation table
+//		-Base noise, and how its octaves are combined
+//		-Number of octaves and the frequency of the first one
+//		-Frequency and amplitude multipliers between octaves
+//==========================================================================================
+INTERNAL inline
+Noise create_noise(u32 seed, NoiseType type = NOISE_PERLIN, NoiseFractal fractal = NOISE_FBM, u32 octaves = 5, f32 frequency = 0.01f, f32 lacunarity = 2.0f, f32 gain = 0.5f) {
+	Noise noise;
+	noise.type = type;
+	noise.fractal = fractal;
+	noise.octaves = octaves > 0 ? octaves : 1;
+	noise.frequency = frequency;
+	noise.lacunarity = lacunarity;
+	noise.gain = gain;
+
+	for (i32 i = 0; i < 256; ++i)
+		noise.perm[i] = i;
+	u32 state = seed;
+	for (i32 i = 255; i > 0; --i) {
+		state = state * 1664525u + 1013904223u;
+		i32 index = (i32)((state >> 8) % (u32)(i + 1));
+		i32 temp = noise.perm[i];
+		noise.perm[i] = noise.perm[index];
+		noise.perm[index] = temp;
+	}
+	for (i32 i = 0; i < 256; ++i)
+		noise.perm[i + 256] = noise.perm[i];
+	return noise;
+}
+
+INTERNAL inline
+i32 noise_hash(const Noise* noise, i32 x, i32 y) {
+	return noise->perm[noise->perm[x & 255] + (y & 255)];
+}
+
+//the gradient is one of the four diagonals, the low two bits of the hash pick the signs
+INTERNAL inline
+f32 noise_gradient(i32 hash, f32 x, f32 y) {
+	return (hash & 1 ? -x : x) + (hash & 2 ? -y : y);
+}
+
+INTERNAL inline
+f32 value_noise_2D(const Noise* noise, f32 x, f32 y) {
+	f32 fx = floorf(x);
+	f32 fy = floorf(y);
+	i32 ix = (i32)fx;
+	i32 iy = (i32)fy;
+	f32 u = fade(x - fx);
+	f32 v = fade(y - fy);
+	f32 v00 = noise_hash(noise, ix, iy) * (2.0f / 255.0f) - 1.0f;
+	f32 v10 = noise_hash(noise, ix + 1, iy) * (2.0f / 255.0f) - 1.0f;
+	f32 v01 = noise_hash(noise, ix, iy + 1) * (2.0f / 255.0f) - 1.0f;
+	f32 v11 = noise_hash(noise, ix + 1, iy + 1) * (2.0f / 255.0f) - 1.0f;
+	return lerp(v, lerp(u, v00, v10), lerp(u, v01, v11));
+}
+
+INTERNAL inline
+f32 perlin_noise_2D(const Noise* noise, f32 x, f32 y) {
+	f32 fx = floorf(x);
+	f32 fy = floorf(y);
+	i32 ix = (i32)fx;
+	i32 iy = (i32)fy;
+	f32 xf = x - fx;
+	f32 yf = y - fy;
+	f32 d00 = noise_gradient(noise_hash(noise, ix, iy), xf, yf);
+	f32 d10 = noise_gradient(noise_hash(noise, ix + 1, iy), xf - 1.0f, yf);
+	f32 d01 = noise_gradient(noise_hash(noise, ix, iy + 1), xf, yf - 1.0f);
+	f32 d11 = noise_gradient(noise_hash(noise, ix + 1, iy + 1), xf - 1.0f, yf - 1.0f);
+	f32 u = fade(xf);
+	f32 v = fade(yf);
+	return lerp(v, lerp(u, d00, d10), lerp(u, d01, d11));
+}
+
+INTERNAL inline
+f32 simplex_corner(i32 hash, f32 x, f32 y) {
+	f32 t = 0.5f - x * x - y * y;
+	if (t < 0.0f)
+		return 0.0f;
+	t *= t;
+	return t * t * noise_gradient(hash, x, y);
+}
+
+INTERNAL inline
+f32 simplex_noise_2D(const Noise* noise, f32 x, f32 y) {
+	//skew onto the grid of triangles, find which of the two triangles of the cell we are in
+	f32 s = (x + y) * NOISE_SIMPLEX_F2;
+	f32 fi = floorf(x + s);
+	f32 fj = floorf(y + s);
+	f32 t = (fi + fj) * NOISE_SIMPLEX_G2;
+	f32 x0 = x - (fi - t);
+	f32 y0 = y - (fj - t);
+	i32 i1 = x0 > y0 ? 1 : 0;
+	i32 j1 = 1 - i1;
+	f32 x1 = x0 - i1 + NOISE_SIMPLEX_G2;
+	f32 y1 = y0 - j1 + NOISE_SIMPLEX_G2;
+	f32 x2 = x0 - 1.0f + 2.0f * NOISE_SIMPLEX_G2;
+	f32 y2 = y0 - 1.0f + 2.0f * NOISE_SIMPLEX_G2;
+	i32 i = (i32)fi;
+	i32 j = (i32)fj;
+	f32 n = simplex_corner(noise_hash(noise, i, j), x0, y0);
+	n += simplex_corner(noise_hash(noise, i + i1, j + j1), x1, y1);
+	n += simplex_corner(noise_hash(noise, i + 1, j + 1), x2, y2);
+	return 70.0f * n;
+}
+
+INTERNAL inline
+f32 base_noise_2D(const Noise* noise, f32 x, f32 y) {
+	switch (noise->type) {
+		case NOISE_VALUE:   return value_noise_2D(noise, x, y);
+		case NOISE_SIMPLEX: return simplex_noise_2D(noise, x, y);
+		default:            return perlin_noise_2D(noise, x, y);
+	}
+}
+
+//==========================================================================================
+//Description: Samples the noise at a point, with its frequency and fractal applied
+//==========================================================================================
+INTERNAL inline
+f32 noise_2D(const Noise* noise, f32 x, f32 y) {
+	x *= noise->frequency;
+	y *= noise->frequency;
+	if (noise->fractal == NOISE_SINGLE)
+		return base_noise_2D(noise, x, y);
+
+	f32 sum = 0.0f;
+	f32 amplitude = 1.0f;
+	f32 total = 0.0f;
+	for (u32 octave = 0; octave < noise->octaves; ++octave) {
+		//every octave is shifted so their lattices don't line up at the origin
+		f32 n = base_noise_2D(noise, x + octave * NOISE_OCTAVE_SHIFT, y + octave * NOISE_OCTAVE_SHIFT);
+		if (noise->fractal == NOISE_RIDGED) {
+			n = 1.0f - fabsf(n);
+			n *= n;
+		}
+		sum += n * amplitude;
+		total += amplitude;
+		amplitude *= noise->gain;
+		x *= noise->lacunarity;
+		y *= noise->lacunarity;
+	}
+	return sum / total;
+}
+
+#ifdef BMT_SSE
+//SSE2 has no floor, truncate and step down where that rounded up
+INTERNAL inline
+__m128 noise_floor4(__m128 x) {
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(x, truncated), _mm_set1_ps(1.0f)));
+}
+
+INTERNAL inline
+__m128 noise_fade4(__m128 t) {
+	__m128 inner = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f)), t), _mm_set1_ps(10.0f));
+	return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+INTERNAL inline
+__m128 noise_lerp4(__m128 t, __m128 a, __m128 b) {
+	return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+//the signs of the gradient are flipped straight into the sign bits of x and y
+INTERNAL inline
+__m128 noise_gradient4(__m128i hash, __m128 x, __m128 y) {
+	__m128 signX = _mm_castsi128_ps(_mm_slli_epi32(hash, 31));
+	__m128 signY = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(hash, 1), 31));
+	return _mm_add_ps(_mm_xor_ps(x, signX), _mm_xor_ps(y, signY));
+}
+
+//SSE2 has no gather, so the table lookups are done per lane and packed straight
+//into registers. Everything else runs on all four lanes at once
+#define NOISE_HASH4(noise, x, y, dx, dy) _mm_setr_epi32( \
+	noise_hash(noise, x[0] + (dx), y[0] + (dy)), noise_hash(noise, x[1] + (dx), y[1] + (dy)), \
+	noise_hash(noise, x[2] + (dx), y[2] + (dy)), noise_hash(noise, x[3] + (dx), y[3] + (dy)))
+
+INTERNAL inline
+__m128 value_noise_2D_x4(const Noise* noise, __m128 x, __m128 y) {
+	__m128 fx = noise_floor4(x);
+	__m128 fy = noise_floor4(y);
+	alignas(16) i32 ix[4];
+	alignas(16) i32 iy[4];
+	_mm_store_si128((__m128i*)ix, _mm_cvttps_epi32(fx));
+	_mm_store_si128((__m128i*)iy, _mm_cvttps_epi32(fy));
+	__m128 scale = _mm_set1_ps(2.0f / 255.0f);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 v00 = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(NOISE_HASH4(noise, ix, iy, 0, 0)), scale), one);
+	__m128 v10 = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(NOISE_HASH4(noise, ix, iy, 1, 0)), scale), one);
+	__m128 v01 = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(NOISE_HASH4(noise, ix, iy, 0, 1)), scale), one);
+	__m128 v11 = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(NOISE_HASH4(noise, ix, iy, 1, 1)), scale), one);
+	__m128 u = noise_fade4(_mm_sub_ps(x, fx));
+	__m128 v = noise_fade4(_mm_sub_ps(y, fy));
+	return noise_lerp4(v, noise_lerp4(u, v00, v10), noise_lerp4(u, v01, v11));
+}
+
+INTERNAL inline
+__m128 perlin_noise_2D_x4(const Noise* noise, __m128 x, __m128 y) {
+	__m128 fx = noise_floor4(x);
+	__m128 fy = noise_floor4(y);
+	alignas(16) i32 ix[4];
+	alignas(16) i32 iy[4];
+	_mm_store_si128((__m128i*)ix, _mm_cvttps_epi32(fx));
+	_mm_store_si128((__m128i*)iy, _mm_cvttps_epi32(fy));
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 xf = _mm_sub_ps(x, fx);
+	__m128 yf = _mm_sub_ps(y, fy);
+	__m128 xf1 = _mm_sub_ps(xf, one);
+	__m128 yf1 = _mm_sub_ps(yf, one);
+	__m128 d00 = noise_gradient4(NOISE_HASH4(noise, ix, iy, 0, 0), xf, yf);
+	__m128 d10 = noise_gradient4(NOISE_HASH4(noise, ix, iy, 1, 0), xf1, yf);
+	__m128 d01 = noise_gradient4(NOISE_HASH4(noise, ix, iy, 0, 1), xf, yf1);
+	__m128 d11 = noise_gradient4(NOISE_HASH4(noise, ix, iy, 1, 1), xf1, yf1);
+	__m128 u = noise_fade4(xf);
+	__m128 v = noise_fade4(yf);
+	return noise_lerp4(v, noise_lerp4(u, d00, d10), noise_lerp4(u, d01, d11));
+}
+
+INTERNAL inline
+__m128 simplex_corner4(__m128i hash, __m128 x, __m128 y) {
+	__m128 t = _mm_sub_ps(_mm_set1_ps(0.5f), _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+	t = _mm_max_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+	return _mm_mul_ps(_mm_mul_ps(t, t), noise_gradient4(hash, x, y));
+}
+
+INTERNAL inline
+__m128 simplex_noise_2D_x4(const Noise* noise, __m128 x, __m128 y) {
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 g2 = _mm_set1_ps(NOISE_SIMPLEX_G2);
+	__m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(NOISE_SIMPLEX_F2));
+	__m128 fi = noise_floor4(_mm_add_ps(x, s));
+	__m128 fj = noise_floor4(_mm_add_ps(y, s));
+	__m128 t = _mm_mul_ps(_mm_add_ps(fi, fj), g2);
+	__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(fi, t));
+	__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(fj, t));
+	__m128 lower = _mm_cmpgt_ps(x0, y0);
+	__m128 i1 = _mm_and_ps(lower, one);
+	__m128 j1 = _mm_sub_ps(one, i1);
+	__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), g2);
+	__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, j1), g2);
+	__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, one), _mm_add_ps(g2, g2));
+	__m128 y2 = _mm_add_ps(_mm_sub_ps(y0, one), _mm_add_ps(g2, g2));
+
+	//the middle corner is one step along x below the diagonal and one along z above it
+	alignas(16) i32 i[4];
+	alignas(16) i32 j[4];
+	alignas(16) i32 middleI[4];
+	alignas(16) i32 middleJ[4];
+	__m128i step = _mm_castps_si128(lower);
+	_mm_store_si128((__m128i*)i, _mm_cvttps_epi32(fi));
+	_mm_store_si128((__m128i*)j, _mm_cvttps_epi32(fj));
+	_mm_store_si128((__m128i*)middleI, _mm_sub_epi32(_mm_load_si128((__m128i*)i), step));
+	_mm_store_si128((__m128i*)middleJ, _mm_add_epi32(_mm_add_epi32(_mm_load_si128((__m128i*)j), _mm_set1_epi32(1)), step));
+
+	__m128 n = simplex_corner4(NOISE_HASH4(noise, i, j, 0, 0), x0, y0);
+	n = _mm_add_ps(n, simplex_corner4(NOISE_HASH4(noise, middleI, middleJ, 0, 0), x1, y1));
+	n = _mm_add_ps(n, simplex_corner4(NOISE_HASH4(noise, i, j, 1, 1), x2, y2));
+	return _mm_mul_ps(n, _mm_set1_ps(70.0f));
+}
+
+INTERNAL inline
+__m128 base_noise_2D_x4(const Noise* noise, __m128 x, __m128 y) {
+	switch (noise->type) {
+		case NOISE_VALUE:   return value_noise_2D_x4(noise, x, y);
+		case NOISE_SIMPLEX: return simplex_noise_2D_x4(noise, x, y);
+		default:            return perlin_noise_2D_x4(noise, x, y);
+	}
+}
+
+//==========================================================================================
+//Description: noise_2D for four points at once
+//==========================================================================================
+INTERNAL inline
+__m128 noise_2D_x4(const Noise* noise, __m128 x, __m128 y) {
+	__m128 frequency = _mm_set1_ps(noise->frequency);
+	x = _mm_mul_ps(x, frequency);
+	y = _mm_mul_ps(y, frequency);
+	if (noise->fractal == NOISE_SINGLE)
+		return base_noise_2D_x4(noise, x, y);
+
+	__m128 sum = _mm_setzero_ps();
+	__m128 lacunarity = _mm_set1_ps(noise->lacunarity);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 sign = _mm_set1_ps(-0.0f);
+	f32 amplitude = 1.0f;
+	f32 total = 0.0f;
+	for (u32 octave = 0; octave < noise->octaves; ++octave) {
+		__m128 shift = _mm_set1_ps(octave * NOISE_OCTAVE_SHIFT);
+		__m128 n = base_noise_2D_x4(noise, _mm_add_ps(x, shift), _mm_add_ps(y, shift));
+		if (noise->fractal == NOISE_RIDGED) {
+			n = _mm_sub_ps(one, _mm_andnot_ps(sign, n));
+			n = _mm_mul_ps(n, n);
+		}
+		sum = _mm_add_ps(sum, _mm_mul_ps(n, _mm_set1_ps(amplitude)));
+		total += amplitude;
+		amplitude *= noise->gain;
+		x = _mm_mul_ps(x, lacunarity);
+		y = _mm_mul_ps(y, lacunarity);
+	}
+	return _mm_mul_ps(sum, _mm_set1_ps(1.0f / total));
+}
+#endif
+
+struct NoiseRows {
+	const Noise* noise;
+	f32* out;
+	u32 width;
+	f32 originX;
+	f32 originY;
+	f32 spacing;
+};
+
+INTERNAL inline
+void generate_noise_rows(void* data, u32 begin, u32 end) {
+	NoiseRows* rows = (NoiseRows*)data;
+	const Noise* noise = rows->noise;
+	for (u32 y = begin; y < end; ++y) {
+		f32* out = rows->out + (u64)y * rows->width;
+		f32 worldY = rows->originY + y * rows->spacing;
+		u32 x = 0;
+#ifdef BMT_SSE
+		__m128 steps = _mm_mul_ps(_mm_setr_ps(0, 1, 2, 3), _mm_set1_ps(rows->spacing));
+		__m128 sampleY = _mm_set1_ps(worldY);
+		for (; x + 4 <= rows->width; x += 4) {
+			__m128 sampleX = _mm_add_ps(_mm_set1_ps(rows->originX + x * rows->spacing), steps);
+			_mm_storeu_ps(out + x, noise_2D_x4(noise, sampleX, sampleY));
+		}
+#endif
+		for (; x < rows->width; ++x)
+			out[x] = noise_2D(noise, rows->originX + x * rows->spacing, worldY);
+	}
+}
+
+//==========================================================================================
+//Description: Fills an image with noise, one sample per pixel
+//
+//Parameters:
+//		-The generator and a width * height array of floats to write to
+//		-Position of the first pixel and the distance between pixels, before the frequency
+//
+//Comments: Rows are spread across the job system, run it from one thread at a time per image
+//==========================================================================================
+INTERNAL inline
+void generate_noise(const Noise* noise, f32* out, u32 width, u32 height, f32 originX = 0.0f, f32 originY = 0.0f, f32 spacing = 1.0f) {
+	BMT_PROFILE_FUNCTION();
+	NoiseRows rows = { noise, out, width, originX, originY, spacing };
+	parallel_for(height, 16, generate_noise_rows, &rows);
+}
+
+//==========================================================================================
+//Description: Returns a width * height grey image of perlin noise, values from 0 to 255
+//
+//Comments: The caller deletes the image with delete[]
+//==========================================================================================
+INTERNAL inline
+vec3* perlin_noise(int width, int height) {
+	Noise noise = create_noise(rand(), NOISE_PERLIN, NOISE_SINGLE, 1, 0.01f);
+	f32* values = (f32*)malloc(width * height * sizeof(f32));
+	generate_noise(&noise, values, width, height);
+
+	vec3* image = new vec3[width * height];
+	for (int i = 0; i < width * height; ++i) {
+		f32 c = floorf(255 * (values[i] + 1.0f) / 2.0f);
+		image[i] = V3(c, c, c);
+	}
+	free(values);
+	return image;
+}
+
+//==========================================================================================
+//Description: Logs the throughput of the legacy noise2D against this library
+//
+//Comments: The legacy path is the single threaded noise2D of maths.h. The rest is run on one
+//          thread first, then across the job system.
+//==========================================================================================
+INTERNAL inline
+void benchmark_noise(u32 size = 2048) {
+	BMT_LOG(INFO, "Noise benchmark, %dx%d samples on %d worker threads", size, size, get_job_worker_count());
+	std::vector<f32> P;
+	for (int i = 0; i < 256; ++i)
+		P.push_back(i);
+	for (int i = 0; i < 256; ++i)
+		P.push_back(P[i]);
+
+	f32* out = (f32*)malloc((u64)size * size * sizeof(f32));
+	f64 samples = (f64)size * size;
+	auto start = std::chrono::steady_clock::now();
+	f32 sink = 0;
+	for (u32 y = 0; y < size; ++y)
+		for (u32 x = 0; x < size; ++x)
+			sink += noise2D(x * 0.01f, y * 0.01f, P);
+	f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+	BMT_LOG(INFO, "    legacy noise2D       %9.2f ms %8.2f Msamples/s (%f)", ms, samples / ms / 1000.0, sink);
+
+	const char* names[] = { "value", "perlin", "simplex" };
+	for (u32 type = NOISE_VALUE; type <= NOISE_SIMPLEX; ++type) {
+		for (u32 octaves = 1; octaves <= 5; octaves += 4) {
+			Noise noise = create_noise(1, (NoiseType)type, octaves == 1 ? NOISE_SINGLE : NOISE_FBM, octaves);
+			NoiseRows rows = { &noise, out, size, 0.0f, 0.0f, 1.0f };
+
+			start = std::chrono::steady_clock::now();
+			generate_noise_rows(&rows, 0, size);
+			f64 single = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			generate_noise(&noise, out, size, size);
+			f64 threaded = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			BMT_LOG(INFO, "    %-7s %d octave%s   %9.2f ms %8.2f Msamples/s, threaded %9.2f ms %8.2f Msamples/s",
+				names[type], octaves, octaves == 1 ? " " : "s", single, samples / single / 1000.0, threaded, samples / threaded / 1000.0);
+		}
+	}
+	free(out);
+}
+
+#endif
@@ -0,0 +1,669 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                      occlusion.h                                //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "defines.h"
+#include "maths.h"
+#include "jobs.h"
+#include "profiler.h"
+#include <vector>
+#include <algorithm>
+
+//Software occlusion culling. Large occluders are rasterized on the CPU into a
+//small depth buffer, which is then reduced into a chain of max-depth mips.
+//An instance whose screen-space bounding rectangle lies entirely behind the
+//farthest occluder depth under it can be skipped before any GL call is made.
+//
+//		begin_occlusion(&buffer, projection * view);
+//		add_occluder(&buffer, &occluder, transform);      //for every occluder
+//		finish_occlusion(&buffer);                        //rasterize + build mips
+//		if (test_occlusion_aabb(&buffer, min, max, transform)) draw...
+//
+//The buffer is split into tiles that are rasterized in parallel on the job
+//system, four pixels at a time when BMT_SSE is available. Depth follows the
+//GL convention: 0 is the near plane, 1 the far plane, and the buffer is
+//cleared to 1.
+//
+//Occluder triangles are clipped against the near plane (z = -w) in clip
+//space before they are projected, so the part of an occluder in front of the
+//camera never writes a depth GL would not have drawn.
+
+#ifndef OCCLUSION_WIDTH
+#define OCCLUSION_WIDTH        256
+#endif
+#ifndef OCCLUSION_HEIGHT
+#define OCCLUSION_HEIGHT       128
+#endif
+#define OCCLUSION_TILE_WIDTH   32
+#define OCCLUSION_TILE_HEIGHT  32
+#define OCCLUSION_MAX_MIPS     8
+//clip space w below which a vertex is treated as being behind the camera
+#define OCCLUSION_NEAR_W       0.0001f
+//resolution of the voxel grid simplify_occluder() finds the inner box on
+#define OCCLUDER_VOXELS        24
+
+struct Occluder {
+	std::vector<vec3> vertices;
+	std::vector<u32> indices;
+};
+
+struct OcclusionTriangle {
+	//screen space position in pixels and [0, 1] depth of each vertex
+	f32 x[3];
+	f32 y[3];
+	f32 z[3];
+};
+
+struct OcclusionStats {
+	u32 occluderTriangles;
+	u32 rasterizedTriangles;
+	u32 testedBoxes;
+	u32 culledBoxes;
+};
+
+struct OcclusionBuffer {
+	u32 width;
+	u32 height;
+	u32 tilesX;
+	u32 tilesY;
+	u32 mipcount;
+	u32 mipWidth[OCCLUSION_MAX_MIPS];
+	u32 mipHeight[OCCLUSION_MAX_MIPS];
+	//mips[0] is the rasterized depth buffer itself
+	f32* mips[OCCLUSION_MAX_MIPS];
+
+	mat4 viewProjection;
+	std::vector<OcclusionTriangle> triangles;
+	std::vector<std::vector<u32>> bins;
+	OcclusionStats stats;
+};
+
+INTERNAL inline
+vec4 occlusion_transform(const mat4& m, vec3 p) {
+	const f32* e = m.elements;
+	vec4 c;
+	c.x = e[0] * p.x + e[4] * p.y + e[8] * p.z + e[12];
+	c.y = e[1] * p.x + e[5] * p.y + e[9] * p.z + e[13];
+	c.z = e[2] * p.x + e[6] * p.y + e[10] * p.z + e[14];
+	c.w = e[3] * p.x + e[7] * p.y + e[11] * p.z + e[15];
+	return c;
+}
+
+INTERNAL inline
+OcclusionBuffer create_occlusion_buffer(u32 width = OCCLUSION_WIDTH, u32 height = OCCLUSION_HEIGHT) {
+	OcclusionBuffer buffer;
+	//the SIMD rasterizer works on groups of 4 pixels
+	buffer.width = (width + 3) & ~3u;
+	buffer.height = height;
+	buffer.tilesX = (buffer.width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+	buffer.tilesY = (buffer.height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+	buffer.bins.resize(buffer.tilesX * buffer.tilesY);
+	buffer.viewProjection = identity();
+	buffer.stats = { 0 };
+
+	u32 w = buffer.width;
+	u32 h = buffer.height;
+	buffer.mipcount = 0;
+	while (buffer.mipcount < OCCLUSION_MAX_MIPS) {
+		buffer.mipWidth[buffer.mipcount] = w;
+		buffer.mipHeight[buffer.mipcount] = h;
+		buffer.mips[buffer.mipcount] = (f32*)malloc(w * h * sizeof(f32));
+		buffer.mipcount++;
+		if (w == 1 && h == 1)
+			break;
+		w = w > 1 ? (w + 1) / 2 : 1;
+		h = h > 1 ? (h + 1) / 2 : 1;
+	}
+	return buffer;
+}
+
+INTERNAL inline
+void dispose_occlusion_buffer(OcclusionBuffer* buffer) {
+	for (u32 i = 0; i < buffer->mipcount; ++i)
+		free(buffer->mips[i]);
+	buffer->mipcount = 0;
+	buffer->triangles.clear();
+	buffer->bins.clear();
+}
+
+INTERNAL inline
+void begin_occlusion(OcclusionBuffer* buffer, mat4 viewProjection) {
+	buffer->viewProjection = viewProjection;
+	buffer->triangles.clear();
+	for (u32 i = 0; i < buffer->bins.size(); ++i)
+		buffer->bins[i].clear();
+	buffer->stats = { 0 };
+}
+
+//==========================================================================================
+//Description: Checks that every voxel in [mn, mx] of the grid is solid
+//==========================================================================================
+INTERNAL inline
+bool occluder_voxels_solid(const std::vector<u8>& solid, const i32* mn, const i32* mx) {
+	const i32 N = OCCLUDER_VOXELS;
+	for (i32 z = mn[2]; z <= mx[2]; ++z)
+		for (i32 y = mn[1]; y <= mx[1]; ++y)
+			for (i32 x = mn[0]; x <= mx[0]; ++x)
+				if (!solid[(z * N + y) * N + x])
+					return false;
+	return true;
+}
+
+//==========================================================================================
+//Description: Replaces an occluder mesh with a box that lies inside of it
+//
+//Comments: The render meshes are far too detailed to rasterize on the CPU every frame. The
+//          mesh is voxelized by casting rays through its bounds along each axis, a voxel is
+//          solid when at least two of the three rays find it inside, so small holes in the
+//          mesh don't leak. A box is then grown from the voxel deepest inside the solid for as
+//          long as none of its faces leave it. Being inside the mesh, the box never hides
+//          anything the mesh would not, and it costs 12 triangles.
+//
+//Parameters:
+//		-The occluder, loaded from the render mesh
+//		-The size, in mesh units, the box must reach along its two longest sides
+//
+//Returns: false and leaves the occluder empty when no box of that size fits in the mesh,
+//         such meshes hide too little to be worth registering as occluders
+//==========================================================================================
+INTERNAL inline
+bool simplify_occluder(Occluder* occluder, f32 minSize) {
+	BMT_PROFILE_FUNCTION();
+	const i32 N = OCCLUDER_VOXELS;
+	std::vector<vec3>& vertices = occluder->vertices;
+	std::vector<u32>& indices = occluder->indices;
+	if (indices.size() < 3) {
+		vertices.clear();
+		indices.clear();
+		return false;
+	}
+
+	vec3 lo = vertices[indices[0]];
+	vec3 hi = lo;
+	for (u32 i = 0; i < indices.size(); ++i) {
+		for (u32 a = 0; a < 3; ++a) {
+			lo.e[a] = fminf(lo.e[a], vertices[indices[i]].e[a]);
+			hi.e[a] = fmaxf(hi.e[a], vertices[indices[i]].e[a]);
+		}
+	}
+	f32 cell[3];
+	for (u32 a = 0; a < 3; ++a)
+		cell[a] = (hi.e[a] - lo.e[a]) / N;
+
+	//count for every voxel how many of the axis rays through it find it inside the mesh
+	std::vector<u8> votes(N * N * N, 0);
+	std::vector<f32> hits;
+	for (u32 a = 0; a < 3 && cell[0] > 0 && cell[1] > 0 && cell[2] > 0; ++a) {
+		u32 u = (a + 1) % 3;
+		u32 v = (a + 2) % 3;
+		for (i32 j = 0; j < N; ++j) {
+			for (i32 k = 0; k < N; ++k) {
+				f32 pu = lo.e[u] + (j + 0.5f) * cell[u];
+				f32 pv = lo.e[v] + (k + 0.5f) * cell[v];
+
+				hits.clear();
+				for (u32 i = 0; i + 2 < indices.size(); i += 3) {
+					const vec3& p0 = vertices[indices[i]];
+					const vec3& p1 = vertices[indices[i + 1]];
+					const vec3& p2 = vertices[indices[i + 2]];
+					f32 d = (p1.e[u] - p0.e[u]) * (p2.e[v] - p0.e[v]) - (p2.e[u] - p0.e[u]) * (p1.e[v] - p0.e[v]);
+					if (d == 0.0f)
+						continue;
+					f32 s = ((pu - p0.e[u]) * (p2.e[v] - p0.e[v]) - (p2.e[u] - p0.e[u]) * (pv - p0.e[v])) / d;
+					f32 t = ((p1.e[u] - p0.e[u]) * (pv - p0.e[v]) - (pu - p0.e[u]) * (p1.e[v] - p0.e[v])) / d;
+					if (s < 0.0f || t < 0.0f || s + t > 1.0f)
+						continue;
+					hits.push_back(p0.e[a] + s * (p1.e[a] - p0.e[a]) + t * (p2.e[a] - p0.e[a]));
+				}
+				std::sort(hits.begin(), hits.end());
+
+				//the ray is inside between every odd and even crossing
+				for (u32 h = 0; h + 1 < hits.size(); h += 2) {
+					i32 first = (i32)ceilf((hits[h] - lo.e[a]) / cell[a] - 0.5f);
+					i32 last = (i32)floorf((hits[h + 1] - lo.e[a]) / cell[a] - 0.5f);
+					for (i32 i = (first > 0 ? first : 0); i <= last && i < N; ++i) {
+						i32 voxel[3];
+						voxel[a] = i;
+						voxel[u] = j;
+						voxel[v] = k;
+						votes[(voxel[2] * N + voxel[1]) * N + voxel[0]]++;
+					}
+				}
+			}
+		}
+	}
+
+	//erode the solid to find how deep every voxel lies, the deepest one seeds the box
+	std::vector<u8> solid(N * N * N);
+	std::vector<u8> depth(N * N * N);
+	for (u32 i = 0; i < solid.size(); ++i) {
+		solid[i] = votes[i] >= 2;
+		depth[i] = solid[i];
+	}
+	i32 seed = -1;
+	for (u8 level = 1; ; ++level) {
+		bool deeper = false;
+		for (i32 z = 0; z < N; ++z) {
+			for (i32 y = 0; y < N; ++y) {
+				for (i32 x = 0; x < N; ++x) {
+					i32 i = (z * N + y) * N + x;
+					if (depth[i] != level)
+						continue;
+					seed = i;
+					if (x == 0 || y == 0 || z == 0 || x == N - 1 || y == N - 1 || z == N - 1)
+						continue;
+					if (depth[i - 1] >= level && depth[i + 1] >= level &&
+						depth[i - N] >= level && depth[i + N] >= level &&
+						depth[i - N * N] >= level && depth[i + N * N] >= level) {
+						depth[i] = level + 1;
+						deeper = true;
+					}
+				}
+			}
+		}
+		if (!deeper)
+			break;
+	}
+
+	i32 mn[3] = { 0, 0, 0 };
+	i32 mx[3] = { -1, -1, -1 };
+	if (seed >= 0) {
+		mn[0] = mx[0] = seed % N;
+		mn[1] = mx[1] = (seed / N) % N;
+		mn[2] = mx[2] = seed / (N * N);
+		//push the faces out one voxel slab at a time while the slab is solid
+		for (bool grown = true; grown; ) {
+			grown = false;
+			for (u32 face = 0; face < 6; ++face) {
+				u32 a = face / 2;
+				i32 next = (face & 1) ? mx[a] + 1 : mn[a] - 1;
+				if (next < 0 || next >= N)
+					continue;
+				i32 slabMin[3] = { mn[0], mn[1], mn[2] };
+				i32 slabMax[3] = { mx[0], mx[1], mx[2] };
+				slabMin[a] = slabMax[a] = next;
+				if (!occluder_voxels_solid(solid, slabMin, slabMax))
+					continue;
+				if (face & 1)
+					mx[a] = next;
+				else
+					mn[a] = next;
+				grown = true;
+			}
+		}
+	}
+
+	vertices.clear();
+	indices.clear();
+	if (seed < 0)
+		return false;
+
+	//only the voxel centers were tested, so the box ends at the centers of its outer voxels
+	vec3 boxMin = V3(lo.x + (mn[0] + 0.5f) * cell[0], lo.y + (mn[1] + 0.5f) * cell[1], lo.z + (mn[2] + 0.5f) * cell[2]);
+	vec3 boxMax = V3(lo.x + (mx[0] + 0.5f) * cell[0], lo.y + (mx[1] + 0.5f) * cell[1], lo.z + (mx[2] + 0.5f) * cell[2]);
+	//a box needs two long sides to cover much of the screen from any direction
+	f32 sides[3] = { boxMax.x - boxMin.x, boxMax.y - boxMin.y, boxMax.z - boxMin.z };
+	std::sort(sides, sides + 3);
+	if (sides[1] < minSize)
+		return false;
+
+	for (u32 i = 0; i < 8; ++i)
+		vertices.push_back(V3((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z));
+	//counter-clockwise seen from outside: -x, +x, -y, +y, -z, +z
+	const u32 box[36] = {
+		0, 4, 6,  0, 6, 2,
+		1, 3, 7,  1, 7, 5,
+		0, 1, 5,  0, 5, 4,
+		2, 6, 7,  2, 7, 3,
+		0, 2, 3,  0, 3, 1,
+		4, 5, 7,  4, 7, 6,
+	};
+	indices.assign(box, box + 36);
+	return true;
+}
+
+//==========================================================================================
+//Description: Clips a clip space triangle against the near plane z = -w
+//
+//Returns: The number of vertices of the clipped polygon written to out, 0 when the whole
+//         triangle is in front of the near plane, otherwise 3 or 4
+//==========================================================================================
+INTERNAL inline
+u32 clip_occluder_triangle(const vec4* in, vec4* out) {
+	u32 count = 0;
+	for (u32 v = 0; v < 3; ++v) {
+		const vec4& a = in[v];
+		const vec4& b = in[(v + 1) % 3];
+		f32 da = a.z + a.w;
+		f32 db = b.z + b.w;
+		if (da >= 0)
+			out[count++] = a;
+		//the edge crosses the plane, add the point where it does
+		if ((da >= 0) != (db >= 0)) {
+			f32 t = da / (da - db);
+			out[count++] = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+		}
+	}
+	return count;
+}
+
+INTERNAL inline
+void bin_occluder_triangle(OcclusionBuffer* buffer, const vec4& a, const vec4& b, const vec4& c) {
+	const f32 halfWidth = buffer->width * 0.5f;
+	const f32 halfHeight = buffer->height * 0.5f;
+	const vec4* clip[3] = { &a, &b, &c };
+
+	OcclusionTriangle tri;
+	for (u32 v = 0; v < 3; ++v) {
+		//clipping keeps w at least the near distance, this only guards odd projections
+		if (clip[v]->w < OCCLUSION_NEAR_W)
+			return;
+		f32 invW = 1.0f / clip[v]->w;
+		tri.x[v] = (clip[v]->x * invW + 1.0f) * halfWidth;
+		tri.y[v] = (clip[v]->y * invW + 1.0f) * halfHeight;
+		tri.z[v] = clip[v]->z * invW * 0.5f + 0.5f;
+	}
+	//entirely behind the far plane
+	if (tri.z[0] > 1 && tri.z[1] > 1 && tri.z[2] > 1)
+		return;
+
+	//backface and degenerate triangles
+	f32 area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+	if (area <= 0.0f)
+		return;
+
+	f32 minx = fminf(tri.x[0], fminf(tri.x[1], tri.x[2]));
+	f32 maxx = fmaxf(tri.x[0], fmaxf(tri.x[1], tri.x[2]));
+	f32 miny = fminf(tri.y[0], fminf(tri.y[1], tri.y[2]));
+	f32 maxy = fmaxf(tri.y[0], fmaxf(tri.y[1], tri.y[2]));
+	if (maxx < 0 || maxy < 0 || minx >= buffer->width || miny >= buffer->height)
+		return;
+
+	i32 tx0 = (i32)fmaxf(minx, 0.0f) / OCCLUSION_TILE_WIDTH;
+	i32 ty0 = (i32)fmaxf(miny, 0.0f) / OCCLUSION_TILE_HEIGHT;
+	i32 tx1 = (i32)fminf(maxx, (f32)buffer->width - 1) / OCCLUSION_TILE_WIDTH;
+	i32 ty1 = (i32)fminf(maxy, (f32)buffer->height - 1) / OCCLUSION_TILE_HEIGHT;
+
+	u32 index = (u32)buffer->triangles.size();
+	buffer->triangles.push_back(tri);
+	for (i32 ty = ty0; ty <= ty1; ++ty)
+		for (i32 tx = tx0; tx <= tx1; ++tx)
+			buffer->bins[ty * buffer->tilesX + tx].push_back(index);
+}
+
+//==========================================================================================
+//Description: Projects an occluder mesh and bins its visible triangles into screen tiles
+//
+//Parameters:
+//		-The occlusion buffer, between begin_occlusion() and finish_occlusion()
+//		-The occluder mesh (counter-clockwise triangles, like the GL meshes)
+//		-The model matrix of this instance of the occluder
+//==========================================================================================
+INTERNAL inline
+void add_occluder(OcclusionBuffer* buffer, const Occluder* occluder, mat4 transform) {
+	mat4 mvp = buffer->viewProjection * transform;
+
+	for (u32 i = 0; i + 2 < occluder->indices.size(); i += 3) {
+		buffer->stats.occluderTriangles++;
+
+		vec4 clip[3];
+		for (u32 v = 0; v < 3; ++v)
+			clip[v] = occlusion_transform(mvp, occluder->vertices[occluder->indices[i + v]]);
+
+		//a triangle cut by the near plane becomes a quad, drawn as a fan of two
+		vec4 polygon[4];
+		u32 count = clip_occluder_triangle(clip, polygon);
+		for (u32 t = 1; t + 1 < count; ++t)
+			bin_occluder_triangle(buffer, polygon[0], polygon[t], polygon[t + 1]);
+	}
+}
+
+INTERNAL
+void rasterize_occlusion_tile(OcclusionBuffer* buffer, u32 tile) {
+	u32 tileX0 = (tile % buffer->tilesX) * OCCLUSION_TILE_WIDTH;
+	u32 tileY0 = (tile / buffer->tilesX) * OCCLUSION_TILE_HEIGHT;
+	u32 tileX1 = tileX0 + OCCLUSION_TILE_WIDTH < buffer->width ? tileX0 + OCCLUSION_TILE_WIDTH : buffer->width;
+	u32 tileY1 = tileY0 + OCCLUSION_TILE_HEIGHT < buffer->height ? tileY0 + OCCLUSION_TILE_HEIGHT : buffer->height;
+
+	f32* depth = buffer->mips[0];
+	for (u32 y = tileY0; y < tileY1; ++y)
+		for (u32 x = tileX0; x < tileX1; ++x)
+			depth[y * buffer->width + x] = 1.0f;
+
+	const std::vector<u32>& bin = buffer->bins[tile];
+	for (u32 b = 0; b < bin.size(); ++b) {
+		const OcclusionTriangle& tri = buffer->triangles[bin[b]];
+
+		//edge i is the one opposite vertex i: E(x, y) = A * x + B * y + C
+		f32 A[3], B[3], C[3];
+		for (u32 e = 0; e < 3; ++e) {
+			u32 v0 = (e + 1) % 3;
+			u32 v1 = (e + 2) % 3;
+			A[e] = tri.y[v0] - tri.y[v1];
+			B[e] = tri.x[v1] - tri.x[v0];
+			C[e] = tri.x[v0] * tri.y[v1] - tri.y[v0] * tri.x[v1];
+		}
+		f32 invArea = 1.0f / (C[0] + C[1] + C[2]);
+
+		//depth is affine in screen space: z = zA * x + zB * y + zC
+		f32 zA = (tri.z[0] * A[0] + tri.z[1] * A[1] + tri.z[2] * A[2]) * invArea;
+		f32 zB = (tri.z[0] * B[0] + tri.z[1] * B[1] + tri.z[2] * B[2]) * invArea;
+		f32 zC = (tri.z[0] * C[0] + tri.z[1] * C[1] + tri.z[2] * C[2]) * invArea;
+
+		f32 fminx = fminf(tri.x[0], fminf(tri.x[1], tri.x[2]));
+		f32 fmaxx = fmaxf(tri.x[0], fmaxf(tri.x[1], tri.x[2]));
+		f32 fminy = fminf(tri.y[0], fminf(tri.y[1], tri.y[2]));
+		f32 fmaxy = fmaxf(tri.y[0], fmaxf(tri.y[1], tri.y[2]));
+		u32 minx = fminx > tileX0 ? ((u32)fminx & ~3u) : tileX0;
+		u32 maxx = fmaxx + 1.0f < tileX1 ? (u32)(fmaxx + 1.0f) : tileX1;
+		u32 miny = fminy > tileY0 ? (u32)fminy : tileY0;
+		u32 maxy = fmaxy + 1.0f < tileY1 ? (u32)(fmaxy + 1.0f) : tileY1;
+
+#ifdef BMT_SSE
+		const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 A0 = _mm_set1_ps(A[0]), A1 = _mm_set1_ps(A[1]), A2 = _mm_set1_ps(A[2]);
+		const __m128 vzA = _mm_set1_ps(zA);
+
+		for (u32 y = miny; y < maxy; ++y) {
+			f32 py = y + 0.5f;
+			__m128 row0 = _mm_set1_ps(B[0] * py + C[0]);
+			__m128 row1 = _mm_set1_ps(B[1] * py + C[1]);
+			__m128 row2 = _mm_set1_ps(B[2] * py + C[2]);
+			__m128 rowz = _mm_set1_ps(zB * py + zC);
+			f32* out = depth + y * buffer->width;
+
+			for (u32 x = minx; x < maxx; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps((f32)x), offsets);
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(A0, px), row0);
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(A1, px), row1);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(A2, px), row2);
+				__m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(vzA, px), rowz);
+				__m128 old = _mm_loadu_ps(out + x);
+				__m128 closest = _mm_min_ps(old, z);
+				_mm_storeu_ps(out + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, old)));
+			}
+		}
+#else
+		for (u32 y = miny; y < maxy; ++y) {
+			f32 py = y + 0.5f;
+			f32* out = depth + y * buffer->width;
+			for (u32 x = minx; x < maxx; ++x) {
+				f32 px = x + 0.5f;
+				if (A[0] * px + B[0] * py + C[0] < 0 ||
+					A[1] * px + B[1] * py + C[1] < 0 ||
+					A[2] * px + B[2] * py + C[2] < 0)
+					continue;
+				f32 z = zA * px + zB * py + zC;
+				if (z < out[x])
+					out[x] = z;
+			}
+		}
+#endif
+	}
+}
+
+INTERNAL
+void rasterize_occlusion_tiles(void* data, u32 begin, u32 end) {
+	BMT_PROFILE_ZONE("rasterize occlusion tiles");
+	for (u32 i = begin; i < end; ++i)
+		rasterize_occlusion_tile((OcclusionBuffer*)data, i);
+}
+
+//==========================================================================================
+//Description: Rasterizes every occluder added since begin_occlusion() and builds the
+//             max-depth mip chain used by the tests
+//==========================================================================================
+INTERNAL inline
+void finish_occlusion(OcclusionBuffer* buffer) {
+	BMT_PROFILE_FUNCTION();
+	buffer->stats.rasterizedTriangles = (u32)buffer->triangles.size();
+	parallel_for(buffer->tilesX * buffer->tilesY, 1, rasterize_occlusion_tiles, buffer);
+
+	//each mip texel stores the farthest depth of the texels it covers, so a box that is
+	//behind a mip texel is behind everything in that region of the full buffer
+	for (u32 level = 1; level < buffer->mipcount; ++level) {
+		const f32* src = buffer->mips[level - 1];
+		f32* dst = buffer->mips[level];
+		u32 srcWidth = buffer->mipWidth[level - 1];
+		u32 srcHeight = buffer->mipHeight[level - 1];
+
+		for (u32 y = 0; y < buffer->mipHeight[level]; ++y) {
+			u32 y0 = y * 2;
+			u32 y1 = y0 + 1 < srcHeight ? y0 + 1 : y0;
+			for (u32 x = 0; x < buffer->mipWidth[level]; ++x) {
+				u32 x0 = x * 2;
+				u32 x1 = x0 + 1 < srcWidth ? x0 + 1 : x0;
+				f32 a = fmaxf(src[y0 * srcWidth + x0], src[y0 * srcWidth + x1]);
+				f32 b = fmaxf(src[y1 * srcWidth + x0], src[y1 * srcWidth + x1]);
+				dst[y * buffer->mipWidth[level] + x] = fmaxf(a, b);
+			}
+		}
+	}
+}
+
+//==========================================================================================
+//Description: Tests an axis aligned bounding box against the occlusion buffer
+//
+//Parameters:
+//		-The occlusion buffer, after finish_occlusion()
+//		-The box in model space
+//		-The model matrix of the instance
+//
+//Comments: Returns false if the box is hidden behind occluders or lies entirely outside
+//          the view. Boxes that cross the near plane are always visible.
+//==========================================================================================
+INTERNAL inline
+bool test_occlusion_aabb(const OcclusionBuffer* buffer, vec3 boundsMin, vec3 boundsMax, const mat4& transform) {
+	mat4 mvp = buffer->viewProjection * transform;
+
+	f32 minx = FLT_MAX, miny = FLT_MAX, minz = FLT_MAX;
+	f32 maxx = -FLT_MAX, maxy = -FLT_MAX;
+	u32 behind = 0;
+	for (u32 i = 0; i < 8; ++i) {
+		vec3 corner = {
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z
+		};
+		vec4 clip = occlusion_transform(mvp, corner);
+		if (clip.w < OCCLUSION_NEAR_W) {
+			behind++;
+			continue;
+		}
+
+		f32 invW = 1.0f / clip.w;
+		f32 x = (clip.x * invW + 1.0f) * 0.5f * buffer->width;
+		f32 y = (clip.y * invW + 1.0f) * 0.5f * buffer->height;
+		f32 z = clip.z * invW * 0.5f + 0.5f;
+		minx = fminf(minx, x); maxx = fmaxf(maxx, x);
+		miny = fminf(miny, y); maxy = fmaxf(maxy, y);
+		minz = fminf(minz, z);
+	}
+
+	if (behind == 8)
+		return false;
+	if (behind > 0)
+		return true;
+	if (maxx < 0 || maxy < 0 || minx >= buffer->width || miny >= buffer->height || minz > 1.0f)
+		return false;
+
+	i32 x0 = (i32)fmaxf(minx, 0.0f);
+	i32 y0 = (i32)fmaxf(miny, 0.0f);
+	i32 x1 = (i32)fminf(maxx, (f32)buffer->width - 1);
+	i32 y1 = (i32)fminf(maxy, (f32)buffer->height - 1);
+
+	//pick the level where the rectangle covers at most 2x2 texels
+	u32 level = 0;
+	while (level + 1 < buffer->mipcount && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		level++;
+
+	const f32* mip = buffer->mips[level];
+	u32 mipWidth = buffer->mipWidth[level];
+	for (i32 y = y0 >> level; y <= (y1 >> level); ++y)
+		for (i32 x = x0 >> level; x <= (x1 >> level); ++x)
+			if (minz <= mip[y * mipWidth + x])
+				return true;
+	return false;
+}
+
+struct OcclusionQueries {
+	const OcclusionBuffer* buffer;
+	const vec3* boundsMin;
+	const vec3* boundsMax;
+	const mat4* transforms;
+	bool* visible;
+};
+
+INTERNAL
+void test_occlusion_range(void* data, u32 begin, u32 end) {
+	OcclusionQueries* q = (OcclusionQueries*)data;
+	for (u32 i = begin; i < end; ++i)
+		q->visible[i] = test_occlusion_aabb(q->buffer, q->boundsMin[i], q->boundsMax[i], q->transforms[i]);
+}
+
+//Tests count boxes across the job system and writes the result of each to visible.
+INTERNAL inline
+void test_occlusion_aabbs(OcclusionBuffer* buffer, const vec3* boundsMin, const vec3* boundsMax, const mat4* transforms, u32 count, bool* visible) {
+	BMT_PROFILE_FUNCTION();
+	OcclusionQueries queries = { buffer, boundsMin, boundsMax, transforms, visible };
+	parallel_for(count, 64, test_occlusion_range, &queries);
+
+	buffer->stats.testedBoxes += count;
+	for (u32 i = 0; i < count; ++i)
+		if (!visible[i])
+			buffer->stats.culledBoxes++;
+}
+
+#endif
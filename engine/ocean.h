@@ -0,0 +1,505 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        ocean.h                                  //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef OCEAN_H
+#define OCEAN_H
+
+#include "defines.h"
+#include "maths.h"
+#include "texture.h"
+#include "jobs.h"
+#include "profiler.h"
+#include <chrono>
+
+//Tessendorf style FFT ocean simulated on the CPU.
+//
+//A Phillips spectrum is generated once. Every update advances it in time and
+//runs three inverse 2D FFTs. Because all five fields are real, they are
+//packed two to a transform:
+//		height + i * displacement x,  displacement z + i * slope x,  slope z
+//
+//The row pass and the column pass are spread across the job system. Rows use
+//SSE inside each butterfly stage, and columns are transformed four at a time,
+//one per SSE lane. The result is a tileable displacement map and normal map,
+//plus a CPU copy of the displacement for height queries.
+//
+//		Ocean ocean = create_ocean(256, 100.0f, V2(12, 4));
+//		init_ocean_textures(&ocean);
+//		update_ocean(&ocean, time);      //CPU only, can run without a GL context
+//		upload_ocean(&ocean);
+
+#define OCEAN_MIN_SIZE     64
+#define OCEAN_MAX_SIZE     512
+#define OCEAN_GRAVITY      9.81f
+
+struct Ocean {
+	u32 size;
+	f32 patchSize;
+	vec2 wind;
+	f32 amplitude;
+	f32 choppiness;
+	f32 time;
+
+	//initial spectrum h0(k) and conj(h0(-k)), and the dispersion of every wave vector
+	f32* h0Re;
+	f32* h0Im;
+	f32* h0ConjRe;
+	f32* h0ConjIm;
+	f32* omega;
+
+	//the three packed complex fields, each size * size
+	f32* fieldRe[3];
+	f32* fieldIm[3];
+
+	u32* bitReverse;
+	//twiddle factors of every butterfly stage back to back, the stage of half size h starts at h - 1
+	f32* twiddleRe;
+	f32* twiddleIm;
+
+	//results of the last update
+	vec3* displacement;
+	u32* normals;
+
+	Texture displacementMap;
+	Texture normalMap;
+};
+
+//small deterministic generator so that a seed always produces the same sea
+INTERNAL inline
+f32 ocean_random(u32* state) {
+	*state = *state * 1664525u + 1013904223u;
+	return ((*state >> 8) + 0.5f) / 16777216.0f;
+}
+
+INTERNAL inline
+f32 phillips_spectrum(vec2 k, vec2 wind, f32 amplitude) {
+	f32 k2 = k.x * k.x + k.y * k.y;
+	if (k2 < 0.000001f)
+		return 0.0f;
+	f32 windSpeed = length(wind);
+	f32 largest = windSpeed * windSpeed / OCEAN_GRAVITY;
+	f32 kDotW = (k.x * wind.x + k.y * wind.y) / (sqrtf(k2) * windSpeed);
+	//waves moving against the wind are damped, ripples much smaller than the patch are suppressed
+	f32 directional = kDotW * kDotW;
+	if (kDotW < 0.0f)
+		directional *= 0.07f;
+	f32 smallest = largest * 0.001f;
+	return amplitude * expf(-1.0f / (k2 * largest * largest)) / (k2 * k2) * directional * expf(-k2 * smallest * smallest);
+}
+
+//==========================================================================================
+//Description: Creates the ocean simulation and its initial spectrum
+//
+//Parameters:
+//		-Resolution of the simulation, a power of two between OCEAN_MIN_SIZE and OCEAN_MAX_SIZE
+//		-World space size of one tile of the ocean
+//		-Wind velocity
+//		-Wave amplitude, choppiness of the crests and seed of the random spectrum
+//
+//Comments: Creates no GL objects, see init_ocean_textures()
+//==========================================================================================
+INTERNAL inline
+Ocean create_ocean(u32 size, f32 patchSize, vec2 wind, f32 amplitude = 0.000002f, f32 choppiness = 1.2f, u32 seed = 1337) {
+	Ocean ocean = { 0 };
+	u32 clamped = OCEAN_MIN_SIZE;
+	while (clamped < size && clamped < OCEAN_MAX_SIZE)
+		clamped *= 2;
+	if (clamped != size)
+		BMT_LOG(WARNING, "Ocean size %d is not a power of two between %d and %d, using %d", size, OCEAN_MIN_SIZE, OCEAN_MAX_SIZE, clamped);
+	size = clamped;
+
+	ocean.size = size;
+	ocean.patchSize = patchSize;
+	ocean.wind = wind;
+	ocean.amplitude = amplitude;
+	ocean.choppiness = choppiness;
+
+	u32 count = size * size;
+	ocean.h0Re = (f32*)malloc(count * sizeof(f32));
+	ocean.h0Im = (f32*)malloc(count * sizeof(f32));
+	ocean.h0ConjRe = (f32*)malloc(count * sizeof(f32));
+	ocean.h0ConjIm = (f32*)malloc(count * sizeof(f32));
+	ocean.omega = (f32*)malloc(count * sizeof(f32));
+	for (u32 i = 0; i < 3; ++i) {
+		ocean.fieldRe[i] = (f32*)malloc(count * sizeof(f32));
+		ocean.fieldIm[i] = (f32*)malloc(count * sizeof(f32));
+	}
+	ocean.displacement = (vec3*)calloc(count, sizeof(vec3));
+	ocean.normals = (u32*)calloc(count, sizeof(u32));
+	ocean.bitReverse = (u32*)malloc(size * sizeof(u32));
+	ocean.twiddleRe = (f32*)malloc(size * sizeof(f32));
+	ocean.twiddleIm = (f32*)malloc(size * sizeof(f32));
+
+	u32 bits = 0;
+	while ((1u << bits) < size)
+		bits++;
+	for (u32 i = 0; i < size; ++i) {
+		u32 r = 0;
+		for (u32 b = 0; b < bits; ++b)
+			if (i & (1u << b))
+				r |= 1u << (bits - 1 - b);
+		ocean.bitReverse[i] = r;
+	}
+	for (u32 half = 1; half < size; half *= 2) {
+		for (u32 j = 0; j < half; ++j) {
+			f32 angle = PI * j / half;
+			ocean.twiddleRe[half - 1 + j] = cosf(angle);
+			ocean.twiddleIm[half - 1 + j] = sinf(angle);
+		}
+	}
+
+	//h0(k) = (a + ib) * sqrt(P(k) / 2) with a and b gaussian
+	u32 state = seed;
+	std::vector<f32> gaussRe(count), gaussIm(count);
+	for (u32 i = 0; i < count; ++i) {
+		f32 u1 = ocean_random(&state);
+		f32 u2 = ocean_random(&state);
+		f32 r = sqrtf(-2.0f * logf(u1));
+		gaussRe[i] = r * cosf(2.0f * PI * u2);
+		gaussIm[i] = r * sinf(2.0f * PI * u2);
+	}
+	for (u32 m = 0; m < size; ++m) {
+		for (u32 n = 0; n < size; ++n) {
+			vec2 k = V2(2.0f * PI * ((i32)n - (i32)size / 2) / patchSize, 2.0f * PI * ((i32)m - (i32)size / 2) / patchSize);
+			u32 i = m * size + n;
+			f32 p = sqrtf(phillips_spectrum(k, wind, amplitude) * 0.5f);
+			f32 pNeg = sqrtf(phillips_spectrum(V2(-k.x, -k.y), wind, amplitude) * 0.5f);
+			//-k wraps around to the mirrored index
+			u32 neg = ((size - m) % size) * size + (size - n) % size;
+			ocean.h0Re[i] = gaussRe[i] * p;
+			ocean.h0Im[i] = gaussIm[i] * p;
+			ocean.h0ConjRe[i] = gaussRe[neg] * pNeg;
+			ocean.h0ConjIm[i] = -gaussIm[neg] * pNeg;
+			ocean.omega[i] = sqrtf(OCEAN_GRAVITY * length(k));
+		}
+	}
+	return ocean;
+}
+
+INTERNAL inline
+void init_ocean_textures(Ocean* ocean) {
+	Texture* maps[] = { &ocean->displacementMap, &ocean->normalMap };
+	for (u32 i = 0; i < 2; ++i) {
+		Texture* texture = maps[i];
+		texture->width = texture->height = ocean->size;
+		texture->flip_flag = 0;
+		glGenTextures(1, &texture->ID);
+		glBindTexture(GL_TEXTURE_2D, texture->ID);
+		if (i == 0)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, ocean->size, ocean->size, 0, GL_RGB, GL_FLOAT, NULL);
+		else
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ocean->size, ocean->size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+INTERNAL inline
+void dispose_ocean(Ocean* ocean) {
+	free(ocean->h0Re); free(ocean->h0Im);
+	free(ocean->h0ConjRe); free(ocean->h0ConjIm);
+	free(ocean->omega);
+	for (u32 i = 0; i < 3; ++i) {
+		free(ocean->fieldRe[i]);
+		free(ocean->fieldIm[i]);
+	}
+	free(ocean->displacement);
+	free(ocean->normals);
+	free(ocean->bitReverse);
+	free(ocean->twiddleRe);
+	free(ocean->twiddleIm);
+	if (ocean->displacementMap.ID)
+		dispose_texture(ocean->displacementMap);
+	if (ocean->normalMap.ID)
+		dispose_texture(ocean->normalMap);
+	ocean->size = 0;
+}
+
+INTERNAL
+void ocean_spectrum_rows(void* data, u32 begin, u32 end) {
+	Ocean* ocean = (Ocean*)data;
+	const u32 size = ocean->size;
+	for (u32 m = begin; m < end; ++m) {
+		f32 kz = 2.0f * PI * ((i32)m - (i32)size / 2) / ocean->patchSize;
+		for (u32 n = 0; n < size; ++n) {
+			f32 kx = 2.0f * PI * ((i32)n - (i32)size / 2) / ocean->patchSize;
+			u32 i = m * size + n;
+			f32 c = cosf(ocean->omega[i] * ocean->time);
+			f32 s = sinf(ocean->omega[i] * ocean->time);
+
+			//h(k, t) = h0(k) e^(iwt) + conj(h0(-k)) e^(-iwt)
+			f32 hr = (ocean->h0Re[i] + ocean->h0ConjRe[i]) * c - (ocean->h0Im[i] - ocean->h0ConjIm[i]) * s;
+			f32 hi = (ocean->h0Im[i] + ocean->h0ConjIm[i]) * c + (ocean->h0Re[i] - ocean->h0ConjRe[i]) * s;
+
+			f32 k = sqrtf(kx * kx + kz * kz);
+			f32 nx = k > 0.000001f ? kx / k : 0.0f;
+			f32 nz = k > 0.000001f ? kz / k : 0.0f;
+
+			//displacement D = -i k/|k| h, slope = i k h
+			//field 0 = h + i Dx     = h + (kx/|k|) h
+			ocean->fieldRe[0][i] = hr + nx * hr;
+			ocean->fieldIm[0][i] = hi + nx * hi;
+			//field 1 = Dz + i sx    = -i (kz/|k|) h - kx h
+			ocean->fieldRe[1][i] = nz * hi - kx * hr;
+			ocean->fieldIm[1][i] = -nz * hr - kx * hi;
+			//field 2 = sz           = i kz h
+			ocean->fieldRe[2][i] = -kz * hi;
+			ocean->fieldIm[2][i] = kz * hr;
+		}
+	}
+}
+
+//In place inverse FFT of one contiguous row
+INTERNAL
+void ocean_fft_row(const Ocean* ocean, f32* re, f32* im) {
+	const u32 size = ocean->size;
+	for (u32 i = 0; i < size; ++i) {
+		u32 r = ocean->bitReverse[i];
+		if (i < r) {
+			f32 t = re[i]; re[i] = re[r]; re[r] = t;
+			t = im[i]; im[i] = im[r]; im[r] = t;
+		}
+	}
+
+	for (u32 half = 1; half < size; half *= 2) {
+		const f32* wr = ocean->twiddleRe + half - 1;
+		const f32* wi = ocean->twiddleIm + half - 1;
+		for (u32 start = 0; start < size; start += 2 * half) {
+			f32* ar = re + start;
+			f32* ai = im + start;
+			f32* br = ar + half;
+			f32* bi = ai + half;
+			u32 j = 0;
+#ifdef BMT_SSE
+			for (; j + 4 <= half; j += 4) {
+				__m128 xr = _mm_loadu_ps(br + j), xi = _mm_loadu_ps(bi + j);
+				__m128 twr = _mm_loadu_ps(wr + j), twi = _mm_loadu_ps(wi + j);
+				__m128 tr = _mm_sub_ps(_mm_mul_ps(xr, twr), _mm_mul_ps(xi, twi));
+				__m128 ti = _mm_add_ps(_mm_mul_ps(xr, twi), _mm_mul_ps(xi, twr));
+				__m128 yr = _mm_loadu_ps(ar + j), yi = _mm_loadu_ps(ai + j);
+				_mm_storeu_ps(ar + j, _mm_add_ps(yr, tr));
+				_mm_storeu_ps(ai + j, _mm_add_ps(yi, ti));
+				_mm_storeu_ps(br + j, _mm_sub_ps(yr, tr));
+				_mm_storeu_ps(bi + j, _mm_sub_ps(yi, ti));
+			}
+#endif
+			for (; j < half; ++j) {
+				f32 tr = br[j] * wr[j] - bi[j] * wi[j];
+				f32 ti = br[j] * wi[j] + bi[j] * wr[j];
+				br[j] = ar[j] - tr;
+				bi[j] = ai[j] - ti;
+				ar[j] += tr;
+				ai[j] += ti;
+			}
+		}
+	}
+}
+
+//In place inverse FFT of four neighbouring columns at once, one per SIMD lane
+INTERNAL
+void ocean_fft_columns(const Ocean* ocean, f32* re, f32* im, u32 column) {
+	const u32 size = ocean->size;
+	for (u32 i = 0; i < size; ++i) {
+		u32 r = ocean->bitReverse[i];
+		if (i < r) {
+			for (u32 lane = 0; lane < 4; ++lane) {
+				f32* a = re + i * size + column + lane;
+				f32* b = re + r * size + column + lane;
+				f32 t = *a; *a = *b; *b = t;
+				a = im + i * size + column + lane;
+				b = im + r * size + column + lane;
+				t = *a; *a = *b; *b = t;
+			}
+		}
+	}
+
+	for (u32 half = 1; half < size; half *= 2) {
+		const f32* wr = ocean->twiddleRe + half - 1;
+		const f32* wi = ocean->twiddleIm + half - 1;
+		for (u32 start = 0; start < size; start += 2 * half) {
+			for (u32 j = 0; j < half; ++j) {
+				u32 a = (start + j) * size + column;
+				u32 b = a + half * size;
+#ifdef BMT_SSE
+				__m128 twr = _mm_set1_ps(wr[j]), twi = _mm_set1_ps(wi[j]);
+				__m128 xr = _mm_loadu_ps(re + b), xi = _mm_loadu_ps(im + b);
+				__m128 tr = _mm_sub_ps(_mm_mul_ps(xr, twr), _mm_mul_ps(xi, twi));
+				__m128 ti = _mm_add_ps(_mm_mul_ps(xr, twi), _mm_mul_ps(xi, twr));
+				__m128 yr = _mm_loadu_ps(re + a), yi = _mm_loadu_ps(im + a);
+				_mm_storeu_ps(re + a, _mm_add_ps(yr, tr));
+				_mm_storeu_ps(im + a, _mm_add_ps(yi, ti));
+				_mm_storeu_ps(re + b, _mm_sub_ps(yr, tr));
+				_mm_storeu_ps(im + b, _mm_sub_ps(yi, ti));
+#else
+				for (u32 lane = 0; lane < 4; ++lane) {
+					f32 tr = re[b + lane] * wr[j] - im[b + lane] * wi[j];
+					f32 ti = re[b + lane] * wi[j] + im[b + lane] * wr[j];
+					re[b + lane] = re[a + lane] - tr;
+					im[b + lane] = im[a + lane] - ti;
+					re[a + lane] += tr;
+					im[a + lane] += ti;
+				}
+#endif
+			}
+		}
+	}
+}
+
+INTERNAL
+void ocean_fft_rows(void* data, u32 begin, u32 end) {
+	BMT_PROFILE_ZONE("ocean fft rows");
+	Ocean* ocean = (Ocean*)data;
+	for (u32 row = begin; row < end; ++row)
+		for (u32 f = 0; f < 3; ++f)
+			ocean_fft_row(ocean, ocean->fieldRe[f] + row * ocean->size, ocean->fieldIm[f] + row * ocean->size);
+}
+
+INTERNAL
+void ocean_fft_column_groups(void* data, u32 begin, u32 end) {
+	BMT_PROFILE_ZONE("ocean fft columns");
+	Ocean* ocean = (Ocean*)data;
+	for (u32 group = begin; group < end; ++group)
+		for (u32 f = 0; f < 3; ++f)
+			ocean_fft_columns(ocean, ocean->fieldRe[f], ocean->fieldIm[f], group * 4);
+}
+
+INTERNAL
+void ocean_output_rows(void* data, u32 begin, u32 end) {
+	Ocean* ocean = (Ocean*)data;
+	const u32 size = ocean->size;
+	for (u32 m = begin; m < end; ++m) {
+		for (u32 n = 0; n < size; ++n) {
+			u32 i = m * size + n;
+			//the spectrum is centred on k = 0, which flips the sign of every other sample
+			f32 sign = ((m + n) & 1) ? -1.0f : 1.0f;
+			f32 height = sign * ocean->fieldRe[0][i];
+			f32 dx = sign * ocean->fieldIm[0][i];
+			f32 dz = sign * ocean->fieldRe[1][i];
+			f32 sx = sign * ocean->fieldIm[1][i];
+			f32 sz = sign * ocean->fieldRe[2][i];
+
+			ocean->displacement[i] = V3(ocean->choppiness * dx, height, ocean->choppiness * dz);
+
+			vec3 normal = normalize(V3(-sx, 1.0f, -sz));
+			u32 r = (u32)((normal.x * 0.5f + 0.5f) * 255.0f);
+			u32 g = (u32)((normal.y * 0.5f + 0.5f) * 255.0f);
+			u32 b = (u32)((normal.z * 0.5f + 0.5f) * 255.0f);
+			ocean->normals[i] = r | (g << 8) | (b << 16) | (255u << 24);
+		}
+	}
+}
+
+//==========================================================================================
+//Description: Advances the ocean to the given time and recomputes displacement and normals
+//
+//Comments: Touches no GL state, call upload_ocean() afterwards to update the textures
+//==========================================================================================
+INTERNAL inline
+void update_ocean(Ocean* ocean, f32 time) {
+	BMT_PROFILE_FUNCTION();
+	ocean->time = time;
+	const u32 size = ocean->size;
+	const u32 grain = size / 16;
+	parallel_for(size, grain, ocean_spectrum_rows, ocean);
+	parallel_for(size, grain, ocean_fft_rows, ocean);
+	parallel_for(size / 4, grain / 4, ocean_fft_column_groups, ocean);
+	parallel_for(size, grain, ocean_output_rows, ocean);
+}
+
+INTERNAL inline
+void upload_ocean(Ocean* ocean) {
+	BMT_PROFILE_FUNCTION();
+	glBindTexture(GL_TEXTURE_2D, ocean->displacementMap.ID);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ocean->size, ocean->size, GL_RGB, GL_FLOAT, ocean->displacement);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, ocean->normalMap.ID);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ocean->size, ocean->size, GL_RGBA, GL_UNSIGNED_BYTE, ocean->normals);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+//bilinear, wrapping sample of the displacement computed by the last update
+INTERNAL inline
+vec3 sample_ocean_displacement(const Ocean* ocean, f32 x, f32 z) {
+	f32 u = x / ocean->patchSize * ocean->size;
+	f32 v = z / ocean->patchSize * ocean->size;
+	f32 fu = floorf(u);
+	f32 fv = floorf(v);
+	f32 tu = u - fu;
+	f32 tv = v - fv;
+	i32 mask = ocean->size - 1;
+	i32 x0 = (i32)fu & mask, x1 = (x0 + 1) & mask;
+	i32 z0 = (i32)fv & mask, z1 = (z0 + 1) & mask;
+
+	const vec3* d = ocean->displacement;
+	vec3 top = ((1.0f - tu) * d[z0 * ocean->size + x0]) + (tu * d[z0 * ocean->size + x1]);
+	vec3 bottom = ((1.0f - tu) * d[z1 * ocean->size + x0]) + (tu * d[z1 * ocean->size + x1]);
+	return ((1.0f - tv) * top) + (tv * bottom);
+}
+
+//==========================================================================================
+//Description: Returns the height of the water surface above the world space point x, z
+//
+//Comments: The choppy waves move vertices sideways, so the sample that ends up above x, z
+//          is found with a few fixed point iterations before reading its height.
+//==========================================================================================
+INTERNAL inline
+f32 ocean_height_at(const Ocean* ocean, f32 x, f32 z) {
+	f32 px = x;
+	f32 pz = z;
+	for (u32 i = 0; i < 4; ++i) {
+		vec3 d = sample_ocean_displacement(ocean, px, pz);
+		px = x - d.x;
+		pz = z - d.z;
+	}
+	return sample_ocean_displacement(ocean, px, pz).y;
+}
+
+//Logs the average CPU time of one update at every supported resolution.
+INTERNAL inline
+void benchmark_ocean(u32 updates = 64) {
+	BMT_LOG(INFO, "Ocean benchmark, %d updates per size on %d worker threads", updates, get_job_worker_count());
+	for (u32 size = OCEAN_MIN_SIZE; size <= OCEAN_MAX_SIZE; size *= 2) {
+		Ocean ocean = create_ocean(size, 100.0f, V2(12, 4));
+		update_ocean(&ocean, 0.0f);
+
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < updates; ++i)
+			update_ocean(&ocean, i / 60.0f);
+		f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		BMT_LOG(INFO, "    %3dx%-3d %8.3f ms per update", size, size, ms / updates);
+		dispose_ocean(&ocean);
+	}
+}
+
+#endif
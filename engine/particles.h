@@ -0,0 +1,686 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        particles.h                              //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "defines.h"
+#include "maths.h"
+#include "shader.h"
+#include "jobs.h"
+#include "profiler.h"
+#include <vector>
+#include <chrono>
+
+//Particle system for splashes, smoke and spray.
+//
+//Particles are stored as a structure of arrays, padded to a multiple of four so that
+//the update kernel integrates four of them at once with SSE:
+//		v += (gravity + (wind - v) * drag) * dt
+//		p += v * dt
+//		size += growth * dt,  age += dt
+//The arrays are cut into blocks of PARTICLE_BLOCK that are integrated across the job
+//system. Every block records the particles that died in it, and those are swap-removed
+//afterwards in descending order, so dying only costs as much as the number that died.
+//
+//Emitters live in a pool and are recycled by handle. An emitter spawns particles of one
+//ParticleDesc at a steady rate, one-off bursts like muzzle smoke go through emit_particles.
+//
+//Particles are drawn as instanced camera-facing quads, optionally sorted back to front.
+//The instance data is written straight into a mapped buffer, rotating through
+//PARTICLE_BUFFERS buffers that are fenced, so neither side waits on the other.
+//
+//		ParticleSystem particles = create_particle_system(131072);
+//		init_particle_rendering(&particles);
+//		u32 wake = create_particle_emitter(&particles, spray, position, 400.0f);
+//		update_particles(&particles, dt);          //CPU only, can run without a GL context
+//		draw_particles(&particles, projection, view);
+
+#define PARTICLE_BLOCK     4096
+#define PARTICLE_BUFFERS   3
+
+struct ParticleDesc {
+	//mean starting velocity, and the most each axis is randomly pushed away from it
+	vec3 velocity;
+	vec3 spread;
+	//particles start anywhere within this distance of the emitter
+	f32 radius;
+	f32 lifeMin;
+	f32 lifeMax;
+	f32 size;
+	//change in size per second, smoke billows out while spray stays small
+	f32 growth;
+	//vertical acceleration, negative falls and positive rises
+	f32 gravity;
+	//how quickly the velocity settles into the wind, per second
+	f32 drag;
+	//0 to 255 like the rest of the library, the alpha fades out over the lifetime
+	vec4 color;
+};
+
+struct ParticleEmitter {
+	ParticleDesc desc;
+	vec3 position;
+	//particles per second
+	f32 rate;
+	f32 accumulator;
+	bool active;
+};
+
+struct ParticleInstance {
+	vec3 position;
+	f32 size;
+	u32 color;
+	f32 fade;
+};
+
+struct ParticleSystem {
+	u32 capacity;
+	u32 count;
+
+	//one array per attribute, capacity rounded up to a multiple of four
+	f32* px;
+	f32* py;
+	f32* pz;
+	f32* vx;
+	f32* vy;
+	f32* vz;
+	f32* age;
+	f32* life;
+	f32* size;
+	f32* growth;
+	f32* gravity;
+	f32* drag;
+	u32* color;
+
+	vec3 wind;
+	u32 random;
+
+	std::vector<ParticleEmitter> emitters;
+	std::vector<u32> freeEmitters;
+
+	//dead particles of every block, written by the update
+	u32* dead;
+	u32* deadCounts;
+
+	//back to front ordering, only built when sort is set
+	bool sort;
+	u32* keys;
+	u32* order;
+	u32* scratch;
+
+	GLuint vao[PARTICLE_BUFFERS];
+	GLuint buffers[PARTICLE_BUFFERS];
+	GLsync fences[PARTICLE_BUFFERS];
+	u32 currentBuffer;
+	Shader shader;
+};
+
+INTERNAL inline
+f32 particle_random(u32* state) {
+	*state = *state * 1664525u + 1013904223u;
+	return ((*state >> 8) + 0.5f) / 16777216.0f;
+}
+
+INTERNAL inline
+u32 pack_particle_color(vec4 color) {
+	u32 r = (u32)fminf(fmaxf(color.x, 0.0f), 255.0f);
+	u32 g = (u32)fminf(fmaxf(color.y, 0.0f), 255.0f);
+	u32 b = (u32)fminf(fmaxf(color.z, 0.0f), 255.0f);
+	u32 a = (u32)fminf(fmaxf(color.w, 0.0f), 255.0f);
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+//==========================================================================================
+//Description: Creates the particle storage, rendering is set up by init_particle_rendering
+//
+//Parameters:
+//		-Most particles alive at once, emitting past this drops the new particles
+//		-Seed of the random spread
+//==========================================================================================
+INTERNAL inline
+ParticleSystem create_particle_system(u32 capacity, u32 seed = 1337) {
+	ParticleSystem system = { 0 };
+	system.capacity = (capacity + 3) & ~3u;
+	system.random = seed;
+	system.wind = V3(0, 0, 0);
+
+	//all attributes share one allocation, every array stays 16 byte aligned because the capacity is a multiple of four
+	u32 stride = system.capacity * sizeof(f32);
+	u8* memory = (u8*)calloc(13, stride);
+	f32** arrays[] = { &system.px, &system.py, &system.pz, &system.vx, &system.vy, &system.vz,
+		&system.age, &system.life, &system.size, &system.growth, &system.gravity, &system.drag };
+	for (u32 i = 0; i < 12; ++i)
+		*arrays[i] = (f32*)(memory + i * stride);
+	system.color = (u32*)(memory + 12 * stride);
+
+	u32 blocks = (system.capacity + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK;
+	system.dead = (u32*)malloc(system.capacity * sizeof(u32));
+	system.deadCounts = (u32*)calloc(blocks, sizeof(u32));
+	system.keys = (u32*)malloc(system.capacity * 2 * sizeof(u32));
+	system.order = (u32*)malloc(system.capacity * sizeof(u32));
+	system.scratch = (u32*)malloc(system.capacity * sizeof(u32));
+	return system;
+}
+
+INTERNAL inline
+void dispose_particle_system(ParticleSystem* system) {
+	free(system->px);
+	free(system->dead);
+	free(system->deadCounts);
+	free(system->keys);
+	free(system->order);
+	free(system->scratch);
+	if (system->buffers[0]) {
+		glDeleteBuffers(PARTICLE_BUFFERS, system->buffers);
+		glDeleteVertexArrays(PARTICLE_BUFFERS, system->vao);
+		for (u32 i = 0; i < PARTICLE_BUFFERS; ++i)
+			if (system->fences[i])
+				glDeleteSync(system->fences[i]);
+		dispose_shader(system->shader);
+	}
+	system->emitters.clear();
+	system->freeEmitters.clear();
+	system->capacity = system->count = 0;
+}
+
+//==========================================================================================
+//Description: Spawns particles around a point
+//
+//Parameters:
+//		-What the particles look like and how they move
+//		-Where they are spawned
+//		-How many to spawn, anything past the capacity is dropped
+//==========================================================================================
+INTERNAL inline
+void emit_particles(ParticleSystem* system, const ParticleDesc* desc, vec3 position, u32 amount) {
+	u32 color = pack_particle_color(desc->color);
+	for (u32 n = 0; n < amount && system->count < system->capacity; ++n) {
+		u32 i = system->count++;
+		u32* state = &system->random;
+		system->px[i] = position.x + (particle_random(state) * 2.0f - 1.0f) * desc->radius;
+		system->py[i] = position.y + (particle_random(state) * 2.0f - 1.0f) * desc->radius;
+		system->pz[i] = position.z + (particle_random(state) * 2.0f - 1.0f) * desc->radius;
+		system->vx[i] = desc->velocity.x + (particle_random(state) * 2.0f - 1.0f) * desc->spread.x;
+		system->vy[i] = desc->velocity.y + (particle_random(state) * 2.0f - 1.0f) * desc->spread.y;
+		system->vz[i] = desc->velocity.z + (particle_random(state) * 2.0f - 1.0f) * desc->spread.z;
+		system->age[i] = 0.0f;
+		system->life[i] = desc->lifeMin + particle_random(state) * (desc->lifeMax - desc->lifeMin);
+		system->size[i] = desc->size;
+		system->growth[i] = desc->growth;
+		system->gravity[i] = desc->gravity;
+		system->drag[i] = desc->drag;
+		system->color[i] = color;
+	}
+}
+
+//==========================================================================================
+//Description: Takes an emitter from the pool and starts it
+//
+//Parameters:
+//		-What the emitted particles look like and how they move
+//		-Where the emitter sits, move it with system->emitters[handle].position
+//		-Particles spawned per second
+//
+//Comments: The handle stays valid until it is given back with release_particle_emitter.
+//==========================================================================================
+INTERNAL inline
+u32 create_particle_emitter(ParticleSystem* system, ParticleDesc desc, vec3 position, f32 rate) {
+	ParticleEmitter emitter = { 0 };
+	emitter.desc = desc;
+	emitter.position = position;
+	emitter.rate = rate;
+	emitter.active = true;
+
+	if (!system->freeEmitters.empty()) {
+		u32 handle = system->freeEmitters.back();
+		system->freeEmitters.pop_back();
+		system->emitters[handle] = emitter;
+		return handle;
+	}
+	system->emitters.push_back(emitter);
+	return system->emitters.size() - 1;
+}
+
+INTERNAL inline
+void release_particle_emitter(ParticleSystem* system, u32 handle) {
+	if (handle >= system->emitters.size() || !system->emitters[handle].active)
+		return;
+	system->emitters[handle].active = false;
+	system->freeEmitters.push_back(handle);
+}
+
+//integrates the particles [begin, end) in one pass, the reference for the SSE kernel
+INTERNAL inline
+void integrate_particles_scalar(ParticleSystem* system, f32 dt, u32 begin, u32 end) {
+	vec3 wind = system->wind;
+	for (u32 i = begin; i < end; ++i) {
+		f32 drag = system->drag[i] * dt;
+		system->vx[i] += (wind.x - system->vx[i]) * drag;
+		system->vy[i] += (wind.y - system->vy[i]) * drag + system->gravity[i] * dt;
+		system->vz[i] += (wind.z - system->vz[i]) * drag;
+		system->px[i] += system->vx[i] * dt;
+		system->py[i] += system->vy[i] * dt;
+		system->pz[i] += system->vz[i] * dt;
+		system->size[i] += system->growth[i] * dt;
+		system->age[i] += dt;
+	}
+}
+
+#ifdef BMT_SSE
+//same as integrate_particles_scalar, begin and end have to be multiples of four
+INTERNAL inline
+void integrate_particles_sse(ParticleSystem* system, f32 dt, u32 begin, u32 end) {
+	__m128 step = _mm_set1_ps(dt);
+	__m128 windX = _mm_set1_ps(system->wind.x);
+	__m128 windY = _mm_set1_ps(system->wind.y);
+	__m128 windZ = _mm_set1_ps(system->wind.z);
+	for (u32 i = begin; i < end; i += 4) {
+		__m128 drag = _mm_mul_ps(_mm_load_ps(system->drag + i), step);
+		__m128 vx = _mm_load_ps(system->vx + i);
+		__m128 vy = _mm_load_ps(system->vy + i);
+		__m128 vz = _mm_load_ps(system->vz + i);
+		vx = _mm_add_ps(vx, _mm_mul_ps(_mm_sub_ps(windX, vx), drag));
+		vy = _mm_add_ps(vy, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(windY, vy), drag), _mm_mul_ps(_mm_load_ps(system->gravity + i), step)));
+		vz = _mm_add_ps(vz, _mm_mul_ps(_mm_sub_ps(windZ, vz), drag));
+		_mm_store_ps(system->vx + i, vx);
+		_mm_store_ps(system->vy + i, vy);
+		_mm_store_ps(system->vz + i, vz);
+		_mm_store_ps(system->px + i, _mm_add_ps(_mm_load_ps(system->px + i), _mm_mul_ps(vx, step)));
+		_mm_store_ps(system->py + i, _mm_add_ps(_mm_load_ps(system->py + i), _mm_mul_ps(vy, step)));
+		_mm_store_ps(system->pz + i, _mm_add_ps(_mm_load_ps(system->pz + i), _mm_mul_ps(vz, step)));
+		_mm_store_ps(system->size + i, _mm_add_ps(_mm_load_ps(system->size + i), _mm_mul_ps(_mm_load_ps(system->growth + i), step)));
+		_mm_store_ps(system->age + i, _mm_add_ps(_mm_load_ps(system->age + i), step));
+	}
+}
+#endif
+
+struct ParticleUpdate {
+	ParticleSystem* system;
+	f32 dt;
+};
+
+//integrates whole blocks and records which of their particles died
+INTERNAL inline
+void update_particle_blocks(void* data, u32 begin, u32 end) {
+	ParticleUpdate* update = (ParticleUpdate*)data;
+	ParticleSystem* system = update->system;
+	u32 count = system->count;
+	for (u32 block = begin; block < end; ++block) {
+		u32 first = block * PARTICLE_BLOCK;
+		u32 last = first + PARTICLE_BLOCK < count ? first + PARTICLE_BLOCK : count;
+#ifdef BMT_SSE
+		//the padding past the last particle is integrated too, it is never read back
+		integrate_particles_sse(system, update->dt, first, (last + 3) & ~3u);
+#else
+		integrate_particles_scalar(system, update->dt, first, last);
+#endif
+		u32* dead = system->dead + first;
+		u32 deadCount = 0;
+#ifdef BMT_SSE
+		//test four ages at once and only look at the lanes when one of them died
+		for (u32 i = first; i < last; i += 4) {
+			u32 mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_load_ps(system->age + i), _mm_load_ps(system->life + i)));
+			if (last - i < 4)
+				mask &= (1u << (last - i)) - 1;
+			if (mask == 0)
+				continue;
+			for (u32 lane = 0; lane < 4; ++lane)
+				if (mask & (1u << lane))
+					dead[deadCount++] = i + lane;
+		}
+#else
+		for (u32 i = first; i < last; ++i)
+			if (system->age[i] >= system->life[i])
+				dead[deadCount++] = i;
+#endif
+		system->deadCounts[block] = deadCount;
+	}
+}
+
+INTERNAL inline
+void move_particle(ParticleSystem* system, u32 from, u32 to) {
+	system->px[to] = system->px[from];
+	system->py[to] = system->py[from];
+	system->pz[to] = system->pz[from];
+	system->vx[to] = system->vx[from];
+	system->vy[to] = system->vy[from];
+	system->vz[to] = system->vz[from];
+	system->age[to] = system->age[from];
+	system->life[to] = system->life[from];
+	system->size[to] = system->size[from];
+	system->growth[to] = system->growth[from];
+	system->gravity[to] = system->gravity[from];
+	system->drag[to] = system->drag[from];
+	system->color[to] = system->color[from];
+}
+
+//==========================================================================================
+//Description: Runs the emitters, moves every particle and removes the dead ones
+//
+//Comments: The blocks are spread across the job system. Dead particles are removed
+//          highest index first, so the last particle that replaces one is always alive.
+//==========================================================================================
+INTERNAL inline
+void update_particles(ParticleSystem* system, f32 dt) {
+	BMT_PROFILE_FUNCTION();
+	for (u32 i = 0; i < system->emitters.size(); ++i) {
+		ParticleEmitter* emitter = &system->emitters[i];
+		if (!emitter->active)
+			continue;
+		emitter->accumulator += emitter->rate * dt;
+		u32 amount = (u32)emitter->accumulator;
+		emitter->accumulator -= amount;
+		emit_particles(system, &emitter->desc, emitter->position, amount);
+	}
+	if (system->count == 0)
+		return;
+
+	ParticleUpdate update = { system, dt };
+	u32 blocks = (system->count + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK;
+	parallel_for(blocks, 1, update_particle_blocks, &update);
+
+	for (i32 block = blocks - 1; block >= 0; --block) {
+		u32* dead = system->dead + block * PARTICLE_BLOCK;
+		for (i32 i = system->deadCounts[block] - 1; i >= 0; --i) {
+			system->count--;
+			if (dead[i] != system->count)
+				move_particle(system, system->count, dead[i]);
+		}
+	}
+}
+
+//=============================================
+//
+//      RENDERING
+//
+//=============================================
+
+INTERNAL inline
+Shader load_particle_shader() {
+	LOCAL const GLchar* PARTICLE_VERT_SHADER = R"FOO(
+#version 330
+in vec4 particle;
+in vec4 color;
+in float fade;
+
+uniform mat4 projection = mat4(1.0);
+uniform mat4 view = mat4(1.0);
+
+out vec4 pass_color;
+out vec2 pass_corner;
+
+void main() {
+	//the four corners of the strip come from the vertex id, no quad buffer is needed
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+	vec4 viewPos = view * vec4(particle.xyz, 1.0);
+	viewPos.xy += corner * particle.w;
+	pass_corner = corner;
+	pass_color = vec4(color.rgb, color.a * (1.0 - fade));
+	gl_Position = projection * viewPos;
+}
+
+)FOO";
+
+	LOCAL const GLchar* PARTICLE_FRAG_SHADER = R"FOO(
+#version 330
+out vec4 outColor;
+
+in vec4 pass_color;
+in vec2 pass_corner;
+
+void main() {
+	float r = dot(pass_corner, pass_corner);
+	if(r > 1.0)
+		discard;
+	outColor = vec4(pass_color.rgb, pass_color.a * (1.0 - r));
+}
+
+)FOO";
+	Shader shader = { 0 };
+	shader.vertexshaderID = load_shader_string(PARTICLE_VERT_SHADER, GL_VERTEX_SHADER);
+	shader.fragshaderID = load_shader_string(PARTICLE_FRAG_SHADER, GL_FRAGMENT_SHADER);
+
+	shader.ID = glCreateProgram();
+	glAttachShader(shader.ID, shader.vertexshaderID);
+	glAttachShader(shader.ID, shader.fragshaderID);
+	glBindFragDataLocation(shader.ID, 0, "outColor");
+	glBindAttribLocation(shader.ID, 0, "particle");
+	glBindAttribLocation(shader.ID, 1, "color");
+	glBindAttribLocation(shader.ID, 2, "fade");
+	glLinkProgram(shader.ID);
+	glValidateProgram(shader.ID);
+
+	glUseProgram(0);
+	return shader;
+}
+
+//Creates the instance buffers and the shader, needs a GL context
+INTERNAL inline
+void init_particle_rendering(ParticleSystem* system) {
+	glGenVertexArrays(PARTICLE_BUFFERS, system->vao);
+	glGenBuffers(PARTICLE_BUFFERS, system->buffers);
+	for (u32 i = 0; i < PARTICLE_BUFFERS; ++i) {
+		glBindVertexArray(system->vao[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, system->buffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, system->capacity * sizeof(ParticleInstance), NULL, GL_STREAM_DRAW);
+
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (const GLvoid*)0);                           //position and size
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), (const GLvoid*)(4 * sizeof(GLfloat))); //color
+		glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (const GLvoid*)(5 * sizeof(GLfloat)));        //fade
+		glVertexAttribDivisor(0, 1);
+		glVertexAttribDivisor(1, 1);
+		glVertexAttribDivisor(2, 1);
+		system->fences[i] = 0;
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	system->currentBuffer = 0;
+	system->shader = load_particle_shader();
+}
+
+//maps a float to an unsigned key that sorts the same way
+INTERNAL inline
+u32 particle_sort_key(f32 value) {
+	u32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+//==========================================================================================
+//Description: Orders the particles back to front along the view direction
+//
+//Comments: Four 8 bit radix passes over the view depth, the order ends up in system->order.
+//==========================================================================================
+INTERNAL inline
+void sort_particles(ParticleSystem* system, mat4 view) {
+	BMT_PROFILE_FUNCTION();
+	u32 count = system->count;
+	u32* keys = system->keys;
+	u32* keysOut = system->keys + system->capacity;
+	u32* order = system->order;
+	u32* orderOut = system->scratch;
+
+	//view space z is negative in front of the camera, so the smallest z is the farthest away
+	const f32* m = view.elements;
+	for (u32 i = 0; i < count; ++i) {
+		keys[i] = particle_sort_key(m[2] * system->px[i] + m[6] * system->py[i] + m[10] * system->pz[i] + m[14]);
+		order[i] = i;
+	}
+
+	for (u32 shift = 0; shift < 32; shift += 8) {
+		u32 offsets[256] = { 0 };
+		for (u32 i = 0; i < count; ++i)
+			offsets[(keys[i] >> shift) & 0xFF]++;
+		u32 total = 0;
+		for (u32 i = 0; i < 256; ++i) {
+			u32 bucket = offsets[i];
+			offsets[i] = total;
+			total += bucket;
+		}
+		for (u32 i = 0; i < count; ++i) {
+			u32 slot = offsets[(keys[i] >> shift) & 0xFF]++;
+			keysOut[slot] = keys[i];
+			orderOut[slot] = order[i];
+		}
+		u32* swap = keys; keys = keysOut; keysOut = swap;
+		swap = order; order = orderOut; orderOut = swap;
+	}
+	//an even number of passes leaves the result back in the original arrays
+}
+
+struct ParticleFill {
+	ParticleSystem* system;
+	ParticleInstance* instances;
+};
+
+INTERNAL inline
+void fill_particle_instances(void* data, u32 begin, u32 end) {
+	ParticleFill* fill = (ParticleFill*)data;
+	ParticleSystem* system = fill->system;
+	for (u32 n = begin; n < end; ++n) {
+		u32 i = system->sort ? system->order[n] : n;
+		ParticleInstance* instance = &fill->instances[n];
+		instance->position = V3(system->px[i], system->py[i], system->pz[i]);
+		instance->size = system->size[i];
+		instance->color = system->color[i];
+		instance->fade = system->age[i] / system->life[i];
+	}
+}
+
+//==========================================================================================
+//Description: Draws every live particle as a camera-facing quad
+//
+//Comments: Expects the depth buffer of the scene to be bound. Particles are blended on top
+//          without writing depth, blending and face culling are restored afterwards.
+//==========================================================================================
+INTERNAL inline
+void draw_particles(ParticleSystem* system, mat4 projection, mat4 view) {
+	BMT_PROFILE_FUNCTION();
+	if (system->count == 0)
+		return;
+	if (system->sort)
+		sort_particles(system, view);
+
+	//the buffer about to be written was last drawn PARTICLE_BUFFERS frames ago, this wait is almost always free
+	u32 current = system->currentBuffer;
+	if (system->fences[current]) {
+		glClientWaitSync(system->fences[current], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(system->fences[current]);
+		system->fences[current] = 0;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, system->buffers[current]);
+	ParticleFill fill;
+	fill.system = system;
+	fill.instances = (ParticleInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, system->count * sizeof(ParticleInstance),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (fill.instances == NULL) {
+		BMT_LOG(WARNING, "Could not map particle buffer #%d", system->buffers[current]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+	parallel_for(system->count, PARTICLE_BLOCK, fill_particle_instances, &fill);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	BMT_STAT_ADD(STAT_BUFFER_BYTES, system->count * sizeof(ParticleInstance));
+
+	start_shader(system->shader);
+	upload_mat4(system->shader, "projection", projection);
+	upload_mat4(system->shader, "view", view);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+	glDisable(GL_CULL_FACE);
+
+	glBindVertexArray(system->vao[current]);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, system->count);
+	glBindVertexArray(0);
+	BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+	BMT_STAT_DRAW(GL_TRIANGLE_STRIP, 4, system->count);
+
+	glEnable(GL_CULL_FACE);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	stop_shader();
+
+	system->fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	system->currentBuffer = (current + 1) % PARTICLE_BUFFERS;
+}
+
+//==========================================================================================
+//Description: Logs how long the update kernel takes, no GL context is needed
+//
+//Comments: The scalar and SSE kernels are timed on one thread, then the full update is
+//          run across the job system. Particles never die during the run.
+//==========================================================================================
+INTERNAL inline
+void benchmark_particles(u32 count = 131072, u32 updates = 240) {
+	BMT_LOG(INFO, "Particle benchmark, %d particles on %d worker threads", count, get_job_worker_count());
+	ParticleSystem system = create_particle_system(count);
+	system.wind = V3(2.0f, 0.0f, 1.0f);
+	ParticleDesc desc = { 0 };
+	desc.velocity = V3(0, 4, 0);
+	desc.spread = V3(2, 2, 2);
+	desc.radius = 1.0f;
+	desc.lifeMin = desc.lifeMax = 1000000.0f;
+	desc.size = 0.2f;
+	desc.growth = 0.1f;
+	desc.gravity = -9.81f;
+	desc.drag = 0.5f;
+	desc.color = V4(255, 255, 255, 255);
+	emit_particles(&system, &desc, V3(0, 0, 0), count);
+	f32 dt = 1.0f / 60.0f;
+
+	auto start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < updates; ++i)
+		integrate_particles_scalar(&system, dt, 0, system.count);
+	f64 scalar = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count() / updates;
+	BMT_LOG(INFO, "    scalar kernel   %8.3f ms per update %8.2f Mparticles/s", scalar, count / scalar / 1000.0);
+
+#ifdef BMT_SSE
+	start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < updates; ++i)
+		integrate_particles_sse(&system, dt, 0, (system.count + 3) & ~3u);
+	f64 sse = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count() / updates;
+	BMT_LOG(INFO, "    SSE kernel      %8.3f ms per update %8.2f Mparticles/s", sse, count / sse / 1000.0);
+#endif
+
+	start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < updates; ++i)
+		update_particles(&system, dt);
+	f64 threaded = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count() / updates;
+	BMT_LOG(INFO, "    update_particles %7.3f ms per update %8.2f Mparticles/s", threaded, count / threaded / 1000.0);
+
+	dispose_particle_system(&system);
+}
+
+#endif
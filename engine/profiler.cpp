@@ -0,0 +1,263 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                      profiler.cpp                               //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#include "profiler.h"
+
+#ifdef BMT_PROFILE
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BMT_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BMT_HAS_RDTSC 1
+#endif
+
+struct ProfileThread {
+	ProfileEvent events[PROFILER_EVENTS_PER_THREAD];
+	std::atomic<u64> written;
+	u32 depth;
+	u32 id;
+	char name[32];
+};
+
+GLOBAL ProfileThread* profileThreads[PROFILER_MAX_THREADS];
+GLOBAL std::atomic<u32> profileThreadCount;
+GLOBAL std::mutex profileThreadMutex;
+GLOBAL thread_local ProfileThread* profileLocalThread;
+GLOBAL thread_local u32 profileUnregisteredDepth;
+
+GLOBAL u64 profileFrameEnds[PROFILER_MAX_FRAMES];
+GLOBAL u64 profileFrameCount;
+GLOBAL f64 profileLastFrameMs;
+
+GLOBAL f64 profileSpikeThreshold;
+GLOBAL char profileSpikeDirectory[256];
+GLOBAL u64 profileLastSpikeFrame;
+
+//the reference point used to convert timestamp counter ticks to milliseconds
+GLOBAL u64 profileStartTicks;
+GLOBAL std::chrono::steady_clock::time_point profileStartTime;
+GLOBAL std::once_flag profileStartFlag;
+
+INTERNAL
+void profiler_start() {
+	profileStartTime = std::chrono::steady_clock::now();
+	profileStartTicks = profiler_ticks();
+}
+
+u64 profiler_ticks() {
+#ifdef BMT_HAS_RDTSC
+	return __rdtsc();
+#else
+	return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+f64 profiler_ticks_to_ms(u64 ticks) {
+#ifdef BMT_HAS_RDTSC
+	std::call_once(profileStartFlag, profiler_start);
+	f64 elapsedMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - profileStartTime).count();
+	u64 elapsedTicks = profiler_ticks() - profileStartTicks;
+	if (elapsedMs <= 0.0 || elapsedTicks == 0)
+		return 0.0;
+	return (f64)ticks * (elapsedMs / (f64)elapsedTicks);
+#else
+	return (f64)ticks / 1000000.0;
+#endif
+}
+
+INTERNAL
+ProfileThread* profiler_register_thread() {
+	std::call_once(profileStartFlag, profiler_start);
+
+	std::lock_guard<std::mutex> lock(profileThreadMutex);
+	u32 id = profileThreadCount.load();
+	if (id >= PROFILER_MAX_THREADS)
+		return NULL;
+
+	ProfileThread* thread = new ProfileThread;
+	thread->written = 0;
+	thread->depth = 0;
+	thread->id = id;
+	snprintf(thread->name, sizeof(thread->name), "thread %u", id);
+	profileThreads[id] = thread;
+	profileThreadCount.store(id + 1);
+	return thread;
+}
+
+INTERNAL inline
+ProfileThread* profiler_local_thread() {
+	if (profileLocalThread == NULL)
+		profileLocalThread = profiler_register_thread();
+	return profileLocalThread;
+}
+
+u32* profiler_thread_depth() {
+	ProfileThread* thread = profiler_local_thread();
+	return thread ? &thread->depth : &profileUnregisteredDepth;
+}
+
+void profiler_push_event(const char* name, u64 begin, u64 end, u32 depth) {
+	ProfileThread* thread = profileLocalThread;
+	if (thread == NULL)
+		return;
+	u64 index = thread->written.load(std::memory_order_relaxed);
+	ProfileEvent* e = &thread->events[index % PROFILER_EVENTS_PER_THREAD];
+	e->name = name;
+	e->begin = begin;
+	e->end = end;
+	e->depth = depth;
+	thread->written.store(index + 1, std::memory_order_release);
+}
+
+void profiler_set_thread_name(const char* name) {
+	ProfileThread* thread = profiler_local_thread();
+	if (thread)
+		snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+void profiler_set_spike_threshold(f64 ms, const char* directory) {
+	profileSpikeThreshold = ms;
+	snprintf(profileSpikeDirectory, sizeof(profileSpikeDirectory), "%s", directory);
+}
+
+f64 profiler_last_frame_ms() {
+	return profileLastFrameMs;
+}
+
+void profiler_end_frame() {
+	u64 now = profiler_ticks();
+	if (profileFrameCount > 0) {
+		u64 last = profileFrameEnds[(profileFrameCount - 1) % PROFILER_MAX_FRAMES];
+		profileLastFrameMs = profiler_ticks_to_ms(now - last);
+	}
+	profileFrameEnds[profileFrameCount % PROFILER_MAX_FRAMES] = now;
+	profileFrameCount++;
+
+	//only dump once per full ring of frames so one hitch doesn't produce a burst of files
+	if (profileSpikeThreshold > 0.0 && profileLastFrameMs > profileSpikeThreshold &&
+		(profileLastSpikeFrame == 0 || profileFrameCount - profileLastSpikeFrame > PROFILER_MAX_FRAMES)) {
+		profileLastSpikeFrame = profileFrameCount;
+
+		char path[512];
+		snprintf(path, sizeof(path), "%s/spike_frame%llu_%.1fms.json", profileSpikeDirectory,
+			(unsigned long long)profileFrameCount, profileLastFrameMs);
+		BMT_LOG(WARNING, "Frame took %.2fms (threshold %.2fms), writing %s", profileLastFrameMs, profileSpikeThreshold, path);
+		profiler_export_chrome_trace(path);
+	}
+}
+
+INTERNAL
+void write_json_string(FILE* file, const char* str) {
+	fputc('"', file);
+	for (const char* c = str; *c; ++c) {
+		if (*c == '"' || *c == '\\')
+			fputc('\\', file);
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+//==========================================================================================
+//Description: Writes the zones recorded during the last few frames as Chrome trace JSON
+//
+//Parameters:
+//		-The file to write
+//		-How many of the most recent frames to include (at most PROFILER_MAX_FRAMES)
+//
+//Comments: Threads keep recording while this runs. Only events that were complete when
+//          the export started are written.
+//==========================================================================================
+bool profiler_export_chrome_trace(const char* path, u32 frames) {
+	BMT_PROFILE_ZONE("profiler_export_chrome_trace");
+
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		BMT_LOG(MINOR_ERROR, "[%s] Could not open profiler trace for writing", path);
+		return false;
+	}
+
+	if (frames > PROFILER_MAX_FRAMES) frames = PROFILER_MAX_FRAMES;
+	if (frames > profileFrameCount) frames = (u32)profileFrameCount;
+
+	u64 start = 0;
+	if (frames > 0 && profileFrameCount > frames)
+		start = profileFrameEnds[(profileFrameCount - frames - 1) % PROFILER_MAX_FRAMES];
+	else if (profileFrameCount >= PROFILER_MAX_FRAMES)
+		start = profileFrameEnds[profileFrameCount % PROFILER_MAX_FRAMES];
+
+	f64 ticksToUs = profiler_ticks_to_ms(1000000) * 1000.0 / 1000000.0;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+
+	u32 threadcount = profileThreadCount.load();
+	for (u32 t = 0; t < threadcount; ++t) {
+		ProfileThread* thread = profileThreads[t];
+		fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", thread->id);
+		write_json_string(file, thread->name);
+		fprintf(file, "}}");
+		first = false;
+
+		u64 written = thread->written.load(std::memory_order_acquire);
+		//leave some slack at the old end of the ring in case the owner wraps into it mid-export
+		u64 capacity = PROFILER_EVENTS_PER_THREAD - PROFILER_EVENTS_PER_THREAD / 8;
+		u64 oldest = written > capacity ? written - capacity : 0;
+		for (u64 i = oldest; i < written; ++i) {
+			ProfileEvent e = thread->events[i % PROFILER_EVENTS_PER_THREAD];
+			if (e.end < start || e.begin < profileStartTicks)
+				continue;
+			fprintf(file, ",\n{\"ph\":\"X\",\"name\":");
+			write_json_string(file, e.name);
+			fprintf(file, ",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread->id,
+				(e.begin - profileStartTicks) * ticksToUs, (e.end - e.begin) * ticksToUs);
+		}
+	}
+
+	for (u32 i = 0; i < frames; ++i) {
+		u64 end = profileFrameEnds[(profileFrameCount - frames + i) % PROFILER_MAX_FRAMES];
+		if (end < profileStartTicks)
+			continue;
+		fprintf(file, "%s{\"ph\":\"i\",\"s\":\"g\",\"name\":\"frame\",\"pid\":0,\"tid\":0,\"ts\":%.3f}",
+			first ? "" : ",\n", (end - profileStartTicks) * ticksToUs);
+		first = false;
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	BMT_LOG(INFO, "Wrote profiler trace of %u frames to %s", frames, path);
+	return true;
+}
+
+#endif
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                       profiler.h                                //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "defines.h"
+
+//Hierarchical CPU profiler. Compile with BMT_PROFILE defined to enable it,
+//otherwise every macro below expands to nothing and none of profiler.cpp is
+//built.
+//
+//		BMT_PROFILE_ZONE("name");    times the enclosing scope
+//		BMT_PROFILE_FUNCTION();      same, named after the current function
+//		BMT_PROFILE_FRAME();         marks the end of a frame (end_drawing calls it)
+//		BMT_PROFILE_THREAD("name");  names the calling thread in the trace
+//
+//Zones are written into a ring buffer owned by the thread that opened them,
+//so recording never takes a lock. The last PROFILER_MAX_FRAMES frames can be
+//written out as Chrome trace_event JSON (chrome://tracing or ui.perfetto.dev)
+//either on request or automatically whenever a frame exceeds the spike
+//threshold.
+
+#ifndef PROFILER_MAX_FRAMES
+#define PROFILER_MAX_FRAMES          256
+#endif
+#ifndef PROFILER_EVENTS_PER_THREAD
+#define PROFILER_EVENTS_PER_THREAD   65536
+#endif
+#define PROFILER_MAX_THREADS         64
+
+#ifdef BMT_PROFILE
+
+struct ProfileEvent {
+	const char* name;
+	u64 begin;
+	u64 end;
+	u32 depth;
+};
+
+u64  profiler_ticks();
+f64  profiler_ticks_to_ms(u64 ticks);
+void profiler_push_event(const char* name, u64 begin, u64 end, u32 depth);
+u32* profiler_thread_depth();
+void profiler_set_thread_name(const char* name);
+void profiler_end_frame();
+f64  profiler_last_frame_ms();
+
+bool profiler_export_chrome_trace(const char* path, u32 frames = PROFILER_MAX_FRAMES);
+void profiler_set_spike_threshold(f64 ms, const char* directory = ".");
+
+struct ProfileZone {
+	const char* name;
+	u64 begin;
+	u32 depth;
+
+	ProfileZone(const char* zoneName) {
+		u32* threadDepth = profiler_thread_depth();
+		name = zoneName;
+		depth = (*threadDepth)++;
+		begin = profiler_ticks();
+	}
+	~ProfileZone() {
+		u64 end = profiler_ticks();
+		(*profiler_thread_depth())--;
+		profiler_push_event(name, begin, end, depth);
+	}
+};
+
+#define BMT_PROFILE_CONCAT_(a, b) a ## b
+#define BMT_PROFILE_CONCAT(a, b) BMT_PROFILE_CONCAT_(a, b)
+#define BMT_PROFILE_ZONE(name) ProfileZone BMT_PROFILE_CONCAT(bmtProfileZone, __LINE__)(name)
+#define BMT_PROFILE_FUNCTION() BMT_PROFILE_ZONE(__FUNCTION__)
+#define BMT_PROFILE_FRAME() profiler_end_frame()
+#define BMT_PROFILE_THREAD(name) profiler_set_thread_name(name)
+
+#else
+
+#define BMT_PROFILE_ZONE(name)
+#define BMT_PROFILE_FUNCTION()
+#define BMT_PROFILE_FRAME()
+#define BMT_PROFILE_THREAD(name)
+
+INTERNAL inline bool profiler_export_chrome_trace(const char*, u32 = PROFILER_MAX_FRAMES) { return false; }
+INTERNAL inline void profiler_set_spike_threshold(f64, const char* = ".") {}
+
+#endif
+
+#endif
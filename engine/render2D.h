@@ -32,6 +32,7 @@
 #include "defines.h"
 #include "shader.h"
 #include "texture.h"
+#include <vector>
 
 struct VertexData {
 	vec2 pos;
@@ -49,56 +50,93 @@ struct VertexData {
 #define BATCH_BUFFER_SIZE	    BATCH_SPRITE_SIZE * BATCH_MAX_SPRITES
 #define BATCH_INDICE_SIZE	    BATCH_MAX_SPRITES * 6
 #define BATCH_MAX_TEXTURES		32
+//a flush moves on to the next vertex buffer, so the GPU can still be reading the last few
+//while the next one is filled and mapping never waits on it
+#ifndef BATCH_BUFFERS
+#define BATCH_BUFFERS           3
+#endif
 
 struct QuadBatch {
-	u32 vao;
-	u32 vbo;
+	u32 vao[BATCH_BUFFERS];
+	u32 vbo[BATCH_BUFFERS];
+	GLsync fences[BATCH_BUFFERS];
+	u32 current;
 	u32 ebo;
-	u16 indexcount;
-	u16 texcount;
+	u32 indexcount;
+	u32 texcount;
+	u32 maxtextures;
 	GLuint  textures[BATCH_MAX_TEXTURES];
 	VertexData* buffer;
 	Shader shader;
+	//what bind_quad_batch was called with, a flush binds the batch again the same way
+	bool blending;
+	bool depthTest;
 };
 
-void unbind_quad_batch(QuadBatch* batch);
+INTERNAL inline void unbind_quad_batch(QuadBatch* batch);
+INTERNAL inline void flush_quad_batch(QuadBatch* batch);
+
+//The index buffer only depends on BATCH_MAX_SPRITES, every batch shares one
+GLOBAL GLuint quadBatchIndices = 0;
+GLOBAL u32 quadBatchUsers = 0;
+
+//==========================================================================================
+//Description: How many textures one batch can draw with
+//
+//Comments: Texture ids start at 1 so sampler[0] is never used, and GL 3.3 only promises
+//          16 fragment texture units
+//==========================================================================================
+INTERNAL inline
+u32 quad_batch_texture_units() {
+	GLint units = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+	return units < BATCH_MAX_TEXTURES - 1 ? (u32)units : BATCH_MAX_TEXTURES - 1;
+}
 
 INTERNAL inline
 QuadBatch create_quad_batch() {
 	QuadBatch batch = { 0 };
+	batch.maxtextures = quad_batch_texture_units();
+
+	if (quadBatchUsers++ == 0) {
+		//80000 vertices don't fit in 16 bit indices, and 480 KB doesn't belong on the stack
+		std::vector<GLuint> indices(BATCH_INDICE_SIZE);
+		GLuint offset = 0;
+		for (u32 i = 0; i < BATCH_INDICE_SIZE; i += 6) {
+			indices[i] = offset + 0;
+			indices[i + 1] = offset + 1;
+			indices[i + 2] = offset + 2;
+			indices[i + 3] = offset + 2;
+			indices[i + 4] = offset + 3;
+			indices[i + 5] = offset + 0;
+
+			offset += 4;
+		}
+		glGenBuffers(1, &quadBatchIndices);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadBatchIndices);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, BATCH_INDICE_SIZE * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	batch.ebo = quadBatchIndices;
 
-	glGenVertexArrays(1, &batch.vao);
-	glBindVertexArray(batch.vao);
-
-	glGenBuffers(1, &batch.vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
-	glBufferData(GL_ARRAY_BUFFER, BATCH_BUFFER_SIZE, NULL, GL_DYNAMIC_DRAW);
-
-	//the last argument to glVertexAttribPointer is the offset from the start of the vertex to the
-	//data you want to look at - so each new attrib adds up all the ones before it.
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)0);                     //vertices
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)(2 * sizeof(GLfloat))); //color
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)(6 * sizeof(GLfloat))); //tex coords
-	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)(8 * sizeof(GLfloat))); //texture id
+	glGenVertexArrays(BATCH_BUFFERS, batch.vao);
+	glGenBuffers(BATCH_BUFFERS, batch.vbo);
+	for (u32 i = 0; i < BATCH_BUFFERS; ++i) {
+		glBindVertexArray(batch.vao[i]);
 
-	GLushort indices[BATCH_INDICE_SIZE];
+		glBindBuffer(GL_ARRAY_BUFFER, batch.vbo[i]);
+		glBufferData(GL_ARRAY_BUFFER, BATCH_BUFFER_SIZE, NULL, GL_STREAM_DRAW);
 
-	int offset = 0;
-	for (u32 i = 0; i < BATCH_INDICE_SIZE; i += 6) {
-		indices[i] = offset + 0;
-		indices[i + 1] = offset + 1;
-		indices[i + 2] = offset + 2;
-		indices[i + 3] = offset + 2;
-		indices[i + 4] = offset + 3;
-		indices[i + 5] = offset + 0;
+		//the last argument to glVertexAttribPointer is the offset from the start of the vertex to the
+		//data you want to look at - so each new attrib adds up all the ones before it.
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)0);                     //vertices
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)(2 * sizeof(GLfloat))); //color
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)(6 * sizeof(GLfloat))); //tex coords
+		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, BATCH_VERTEX_SIZE, (const GLvoid*)(8 * sizeof(GLfloat))); //texture id
 
-		offset += 4;
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.ebo);
 	}
 
-	glGenBuffers(1, &batch.ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, BATCH_INDICE_SIZE * sizeof(GLushort), indices, GL_STATIC_DRAW);
-
 	//the vao must be unbound before the buffers
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -110,6 +148,8 @@ QuadBatch create_quad_batch() {
 INTERNAL inline
 void bind_quad_batch(QuadBatch* batch, bool blending = true, bool depthTest = false) {
 	start_shader(batch->shader);
+	batch->blending = blending;
+	batch->depthTest = depthTest;
 
 	if (blending)
 		glEnable(GL_BLEND);
@@ -120,10 +160,29 @@ void bind_quad_batch(QuadBatch* batch, bool blending = true, bool depthTest = fa
 	else
 		glDisable(GL_DEPTH_TEST);
 
-	glBindBuffer(GL_ARRAY_BUFFER, batch->vbo);
+	//only waits when the GPU is still drawing the batch from BATCH_BUFFERS flushes ago
+	u32 current = batch->current;
+	if (batch->fences[current]) {
+		glClientWaitSync(batch->fences[current], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(batch->fences[current]);
+		batch->fences[current] = 0;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, batch->vbo[current]);
 	batch->buffer = (VertexData*)glMapBufferRange(GL_ARRAY_BUFFER, 0, BATCH_BUFFER_SIZE,
-		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT
 	);
+	if (batch->buffer == NULL)
+		BMT_LOG(MINOR_ERROR, "Could not map quad batch buffer #%d, nothing is drawn until it maps", batch->vbo[current]);
+}
+
+//draws the batch first when it has no room left for another quad, false when the
+//vertex buffer could not be mapped and the quad has to be skipped
+INTERNAL inline
+bool reserve_quad(QuadBatch* batch) {
+	if (batch->indexcount >= BATCH_INDICE_SIZE)
+		flush_quad_batch(batch);
+	return batch->buffer != NULL;
 }
 
 INTERNAL inline
@@ -138,21 +197,30 @@ i32 submit_tex(QuadBatch* batch, Texture tex) {
 		}
 	}
 	if (!found) {
-		if (batch->texcount >= BATCH_MAX_TEXTURES) {
-			unbind_quad_batch(batch);
-			bind_quad_batch(batch);
-		}
+		if (batch->texcount >= batch->maxtextures)
+			flush_quad_batch(batch);
 		batch->textures[batch->texcount++] = tex.ID;
 		texSlot = batch->texcount;
 	}
 	return texSlot;
 }
 
+//room for one quad drawn with tex, returns its texture id or -1 when the quad has to be skipped
+INTERNAL inline
+i32 reserve_textured_quad(QuadBatch* batch, Texture tex) {
+	if (!reserve_quad(batch))
+		return -1;
+	i32 texSlot = submit_tex(batch, tex);
+	return batch->buffer != NULL ? texSlot : -1;
+}
+
 INTERNAL inline
 void draw_texture(QuadBatch* batch, Texture tex, i32 xPos, i32 yPos, f32 r, f32 g, f32 b, f32 a) {
 	if (tex.ID == 0)
 		return;
-	i32 texSlot = submit_tex(batch, tex);
+	i32 texSlot = reserve_textured_quad(batch, tex);
+	if (texSlot < 0)
+		return;
 
 	f32 x = (f32)xPos;
 	f32 y = (f32)yPos;
@@ -212,7 +280,9 @@ INTERNAL inline
 void draw_texture_rotated(QuadBatch* batch, Texture tex, i32 x, i32 y, vec2 origin, f32 rotation, f32 r, f32 g, f32 b, f32 a) {
 	if (tex.ID == 0)
 		return;
-	i32 texSlot = submit_tex(batch, tex);
+	i32 texSlot = reserve_textured_quad(batch, tex);
+	if (texSlot < 0)
+		return;
 
 	LOCAL f32 FLIP_VER_UVS[8] = { 0, 1, 0, 0, 1, 0, 1, 1 };
 	LOCAL f32 FLIP_HOR_UVS[8] = { 1, 1, 1, 0, 0, 0, 0, 1 };
@@ -337,7 +407,9 @@ void draw_texture_EX(QuadBatch* batch, Texture tex, Rect source, Rect dest, f32
 		uvs[7] = (source.y + source.height) / tex.height;
 	}
 
-	i32 texSlot = submit_tex(batch, tex);
+	i32 texSlot = reserve_textured_quad(batch, tex);
+	if (texSlot < 0)
+		return;
 
 	batch->buffer->pos = {dest.x, dest.y};
 	batch->buffer->color = { r, g, b, a };
@@ -383,6 +455,8 @@ void draw_framebuffer(QuadBatch* batch, Framebuffer buffer, i32 x, i32 y) {
 
 INTERNAL inline
 void draw_rectangle(QuadBatch* batch, i32 xPos, i32 yPos, i32 width, i32 height, f32 r, f32 g, f32 b, f32 a) {
+	if (!reserve_quad(batch))
+		return;
 	f32 x = (f32)xPos;
 	f32 y = (f32)yPos;
 
@@ -431,19 +505,29 @@ INTERNAL inline
 void unbind_quad_batch(QuadBatch* batch) {
 	glUnmapBuffer(GL_ARRAY_BUFFER);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (batch->indexcount == 0) {
+		batch->texcount = 0;
+		stop_shader();
+		return;
+	}
+	BMT_STAT_ADD(STAT_BUFFER_BYTES, batch->indexcount / 6 * 4 * sizeof(VertexData));
 
-	for (u16 i = 0; i < batch->texcount; ++i) {
+	for (u32 i = 0; i < batch->texcount; ++i) {
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, batch->textures[i]);
 	}
+	BMT_STAT_ADD(STAT_TEXTURE_BINDS, batch->texcount);
 
-	glBindVertexArray(batch->vao);
+	u32 current = batch->current;
+	glBindVertexArray(batch->vao[current]);
 	glEnableVertexAttribArray(0); //position
 	glEnableVertexAttribArray(1); //color
 	glEnableVertexAttribArray(2); //texture coordinates
 	glEnableVertexAttribArray(3); //texture ID
 
-	glDrawElements(GL_TRIANGLES, batch->indexcount, GL_UNSIGNED_SHORT, 0);
+	glDrawElements(GL_TRIANGLES, batch->indexcount, GL_UNSIGNED_INT, 0);
+	BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+	BMT_STAT_DRAW(GL_TRIANGLES, batch->indexcount, 1);
 
 	glDisableVertexAttribArray(0); //position
 	glDisableVertexAttribArray(1); //color
@@ -451,15 +535,34 @@ void unbind_quad_batch(QuadBatch* batch) {
 	glDisableVertexAttribArray(3); //textureID
 	glBindVertexArray(0);
 
-	for (u16 i = 0; i < batch->texcount; ++i)
-		unbind_texture(batch->textures[i]);
+	for (u32 i = 0; i < batch->texcount; ++i)
+		unbind_texture(i);
 
+	batch->fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	batch->current = (current + 1) % BATCH_BUFFERS;
 	batch->indexcount = 0;
 	batch->texcount = 0;
 
 	stop_shader();
 }
 
+//==========================================================================================
+//Description: Draws what is in the batch so far and starts it again
+//
+//Comments: The draw functions call this themselves when the batch is full, the next
+//          vertex buffer is mapped so it doesn't wait on the draw just issued.
+//==========================================================================================
+INTERNAL inline
+void flush_quad_batch(QuadBatch* batch) {
+	unbind_quad_batch(batch);
+	bind_quad_batch(batch, batch->blending, batch->depthTest);
+}
+
+INTERNAL inline
+u32 quad_batch_room(QuadBatch* batch) {
+	return BATCH_MAX_SPRITES - batch->indexcount / 6;
+}
+
 #include <string>
 INTERNAL inline
 Shader load_quad_shader() {
@@ -538,11 +641,13 @@ void main() {
 )FOO";
     Shader shader = load_shader_2D_from_strings(ORTHO_SHADER_VERT_SHADER, ORTHO_SHADER_FRAG_SHADER);
     start_shader(shader);
-    for(int i = 0; i < 32; ++i) {
-        std::string str = "textures[";
+    //submit_tex hands out ids from 1, the texture with id n is bound to unit n - 1
+    u32 units = quad_batch_texture_units();
+    for(u32 i = 1; i <= units; ++i) {
+        std::string str = "sampler[";
         str.append(std::to_string(i));
         str.append("]");
-        upload_int(shader, str.c_str(), i);
+        upload_int(shader, str.c_str(), i - 1);
     }
     stop_shader();
     return shader;
@@ -550,9 +655,15 @@ void main() {
 
 INTERNAL inline
 void dispose_quad_batch(QuadBatch* batch) {
-	glDeleteVertexArrays(1, &batch->vao);
-	glDeleteBuffers(1, &batch->vbo);
-	glDeleteBuffers(1, &batch->ebo);
+	for (u32 i = 0; i < BATCH_BUFFERS; ++i)
+		if (batch->fences[i])
+			glDeleteSync(batch->fences[i]);
+	glDeleteVertexArrays(BATCH_BUFFERS, batch->vao);
+	glDeleteBuffers(BATCH_BUFFERS, batch->vbo);
+	if (--quadBatchUsers == 0) {
+		glDeleteBuffers(1, &quadBatchIndices);
+		quadBatchIndices = 0;
+	}
 	dispose_shader(batch->shader);
 }
 
@@ -0,0 +1,229 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        render_stats.h                           //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include "defines.h"
+
+//Render statistics. Compile with BMT_RENDER_STATS defined to enable them,
+//otherwise every macro below expands to nothing and the draw paths carry no
+//extra work at all.
+//
+//		BMT_STAT_DRAW(mode, count, instances);  one draw call of count vertices or indices
+//		BMT_STAT_ADD(stat, n);                  adds n to one of the RenderStat counters
+//		BMT_STAT_PASS_BEGIN(name);              counts what follows into a pass (execute_frame_graph does this)
+//		BMT_STAT_PASS_END();
+//		BMT_STAT_FRAME();                       ends the frame, its totals are what get_render_stats returns
+//
+//A bump is a single add into the running frame totals. A pass remembers the
+//totals it began with and keeps the difference when it ends, so nested passes
+//are also counted in their parents. Like the rest of the header-only engine
+//state the counters belong to the translation unit that draws, and only the
+//GL thread may touch them.
+
+#ifndef RENDER_STATS_MAX_PASSES
+#define RENDER_STATS_MAX_PASSES    32
+#endif
+#define RENDER_STATS_MAX_DEPTH     8
+#define RENDER_STATS_NAME_LENGTH   32
+
+enum RenderStat {
+	STAT_DRAWS,
+	STAT_TRIANGLES,
+	STAT_VERTEX_ARRAY_BINDS,
+	STAT_PROGRAM_BINDS,
+	STAT_UNIFORM_UPLOADS,
+	STAT_TEXTURE_BINDS,
+	STAT_FRAMEBUFFER_BINDS,
+	STAT_BUFFER_BYTES,
+	STAT_COUNT
+};
+
+struct RenderPassStats {
+	char name[RENDER_STATS_NAME_LENGTH];
+	u64 counters[STAT_COUNT];
+};
+
+struct RenderFrameStats {
+	u64 counters[STAT_COUNT];
+	RenderPassStats passes[RENDER_STATS_MAX_PASSES];
+	u32 passCount;
+	u64 frame;
+};
+
+struct RenderStats {
+	RenderFrameStats current;
+	RenderFrameStats last;
+	u64 start[RENDER_STATS_MAX_DEPTH][STAT_COUNT];
+	u32 open[RENDER_STATS_MAX_DEPTH];
+	u32 depth;
+};
+
+GLOBAL RenderStats renderStats;
+
+//==========================================================================================
+//Description: Returns the totals of the last completed frame, per frame and per pass
+//
+//Comments: All zero unless the engine was compiled with BMT_RENDER_STATS
+//==========================================================================================
+INTERNAL inline
+const RenderFrameStats* get_render_stats() {
+	return &renderStats.last;
+}
+
+INTERNAL inline
+u64 get_render_stat(RenderStat stat) {
+	return renderStats.last.counters[stat];
+}
+
+//==========================================================================================
+//Description: Returns the triangles a draw of count vertices or indices produces
+//==========================================================================================
+INTERNAL inline
+u64 count_triangles(GLenum mode, u64 count) {
+	switch (mode) {
+	case GL_TRIANGLES:
+		return count / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:
+		return count > 2 ? count - 2 : 0;
+	default:
+		return 0;
+	}
+}
+
+INTERNAL inline
+void render_stats_draw(GLenum mode, u64 count, u64 instances) {
+	renderStats.current.counters[STAT_DRAWS]++;
+	renderStats.current.counters[STAT_TRIANGLES] += count_triangles(mode, count) * instances;
+}
+
+//==========================================================================================
+//Description: Starts counting into the named pass
+//
+//Comments: A pass that runs more than once a frame is added up under the one name
+//==========================================================================================
+INTERNAL inline
+void begin_render_stats_pass(const char* name) {
+	RenderFrameStats* frame = &renderStats.current;
+	if (renderStats.depth >= RENDER_STATS_MAX_DEPTH) {
+		renderStats.depth++;
+		return;
+	}
+
+	u32 index = 0;
+	while (index < frame->passCount && strncmp(frame->passes[index].name, name, RENDER_STATS_NAME_LENGTH - 1) != 0)
+		index++;
+	if (index == frame->passCount) {
+		if (frame->passCount == RENDER_STATS_MAX_PASSES) {
+			index = 0xFFFFFFFF;
+		}
+		else {
+			RenderPassStats* pass = &frame->passes[frame->passCount++];
+			strncpy(pass->name, name, RENDER_STATS_NAME_LENGTH - 1);
+			pass->name[RENDER_STATS_NAME_LENGTH - 1] = '\0';
+			memset(pass->counters, 0, sizeof(pass->counters));
+		}
+	}
+
+	renderStats.open[renderStats.depth] = index;
+	memcpy(renderStats.start[renderStats.depth], frame->counters, sizeof(frame->counters));
+	renderStats.depth++;
+}
+
+INTERNAL inline
+void end_render_stats_pass() {
+	if (renderStats.depth == 0)
+		return;
+	renderStats.depth--;
+	if (renderStats.depth >= RENDER_STATS_MAX_DEPTH || renderStats.open[renderStats.depth] == 0xFFFFFFFF)
+		return;
+
+	RenderFrameStats* frame = &renderStats.current;
+	RenderPassStats* pass = &frame->passes[renderStats.open[renderStats.depth]];
+	for (u32 i = 0; i < STAT_COUNT; ++i)
+		pass->counters[i] += frame->counters[i] - renderStats.start[renderStats.depth][i];
+}
+
+//==========================================================================================
+//Description: Publishes the frame's totals and starts counting the next frame from zero
+//
+//Comments: Passes still open are closed first
+//==========================================================================================
+INTERNAL inline
+void end_render_stats_frame() {
+	while (renderStats.depth > 0)
+		end_render_stats_pass();
+	u64 frame = renderStats.current.frame;
+	renderStats.last = renderStats.current;
+	memset(&renderStats.current, 0, sizeof(renderStats.current));
+	renderStats.current.frame = frame + 1;
+}
+
+INTERNAL inline
+void dump_render_stats() {
+	const RenderFrameStats* stats = get_render_stats();
+	BMT_LOG(INFO, "Render stats (frame %llu)", (unsigned long long)stats->frame);
+	BMT_LOG(INFO, "%-20s %8s %10s %8s %8s %8s %8s %8s %12s", "pass",
+		"draws", "triangles", "vaos", "programs", "uniforms", "textures", "fbos", "bytes");
+	for (u32 p = 0; p <= stats->passCount; ++p) {
+		const u64* c = p < stats->passCount ? stats->passes[p].counters : stats->counters;
+		BMT_LOG(INFO, "%-20s %8llu %10llu %8llu %8llu %8llu %8llu %8llu %12llu",
+			p < stats->passCount ? stats->passes[p].name : "frame",
+			(unsigned long long)c[STAT_DRAWS], (unsigned long long)c[STAT_TRIANGLES],
+			(unsigned long long)c[STAT_VERTEX_ARRAY_BINDS], (unsigned long long)c[STAT_PROGRAM_BINDS],
+			(unsigned long long)c[STAT_UNIFORM_UPLOADS], (unsigned long long)c[STAT_TEXTURE_BINDS],
+			(unsigned long long)c[STAT_FRAMEBUFFER_BINDS], (unsigned long long)c[STAT_BUFFER_BYTES]);
+	}
+}
+
+#ifdef BMT_RENDER_STATS
+
+//column headers of the stats overlay
+GLOBAL const char* RENDER_STAT_NAMES[STAT_COUNT] = {
+	"draws", "tris", "vaos", "progs", "unifs", "texs", "fbos", "bytes"
+};
+
+#define BMT_STAT_DRAW(mode, count, instances) render_stats_draw(mode, (u64)(count), (u64)(instances))
+#define BMT_STAT_ADD(stat, n) (renderStats.current.counters[stat] += (u64)(n))
+#define BMT_STAT_PASS_BEGIN(name) begin_render_stats_pass(name)
+#define BMT_STAT_PASS_END() end_render_stats_pass()
+#define BMT_STAT_FRAME() end_render_stats_frame()
+
+#else
+
+#define BMT_STAT_DRAW(mode, count, instances)
+#define BMT_STAT_ADD(stat, n)
+#define BMT_STAT_PASS_BEGIN(name)
+#define BMT_STAT_PASS_END()
+#define BMT_STAT_FRAME()
+
+#endif
+
+#endif
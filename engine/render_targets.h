@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        render_targets.h                         //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef RENDER_TARGETS_H
+#define RENDER_TARGETS_H
+
+#include "defines.h"
+#include "maths.h"
+#include "texture.h"
+#include <vector>
+
+//Pool of transient render targets.
+//
+//A pass asks for a target by size, format and sample count. It gets a free
+//pooled one with the same key, or a new one if there isn't any. It hands the
+//target back as soon as no later pass reads it. A target handed back is free
+//for the next pass in the same frame, so passes whose lifetimes don't overlap
+//alias the same memory. Targets nobody asked for in maxIdleFrames frames are
+//freed. Resizing the window or adding passes therefore settles into a fixed
+//set of targets instead of a create/dispose every time.
+//
+//		begin_render_target_frame(&pool);
+//		Framebuffer scene = acquire_render_target(&pool, width, height, RENDER_TARGET_SCENE);
+//		...
+//		release_render_target(&pool, scene);
+
+enum RenderTargetFormat {
+	//RGBA8 color texture with a depth renderbuffer, see create_color_buffer()
+	RENDER_TARGET_COLOR,
+	//RGBA8 color texture with a depth texture, see create_scene_buffer()
+	RENDER_TARGET_SCENE,
+	//depth texture only, see create_depth_buffer()
+	RENDER_TARGET_DEPTH
+};
+
+struct PooledRenderTarget {
+	Framebuffer buffer;
+	u32 width;
+	u32 height;
+	RenderTargetFormat format;
+	u32 samples;
+	u16 filter;
+	bool inUse;
+	u64 lastUsedFrame;
+	u64 bytes;
+};
+
+struct RenderTargetPool {
+	std::vector<PooledRenderTarget> targets;
+	u64 frame;
+	u32 maxIdleFrames;
+	u64 bytes;
+
+	//what happened last frame
+	u32 created;
+	u32 reused;
+	u32 freed;
+};
+
+INTERNAL inline
+RenderTargetPool create_render_target_pool(u32 maxIdleFrames = 8) {
+	RenderTargetPool pool;
+	pool.frame = 0;
+	pool.maxIdleFrames = maxIdleFrames;
+	pool.bytes = 0;
+	pool.created = pool.reused = pool.freed = 0;
+	return pool;
+}
+
+INTERNAL inline
+void dispose_render_target_pool(RenderTargetPool* pool) {
+	for (u32 i = 0; i < pool->targets.size(); ++i)
+		dispose_framebuffer(pool->targets[i].buffer);
+	pool->targets.clear();
+	pool->bytes = 0;
+}
+
+//an estimate, drivers pad 24 bit depth to 32 bits and may add more of their own
+INTERNAL inline
+u64 render_target_bytes(u32 width, u32 height, RenderTargetFormat format, u32 samples) {
+	u64 pixels = (u64)width * height * (samples > 1 ? samples : 1);
+	switch (format) {
+		case RENDER_TARGET_DEPTH: return pixels * 4;
+		default:                  return pixels * 8;
+	}
+}
+
+//==========================================================================================
+//Description: Starts a frame, frees the targets that have sat unused for too long
+//
+//Comments: Every target should have been released by now. One that wasn't is
+//          released here with a warning, so a missing release can't hold a target forever
+//==========================================================================================
+INTERNAL inline
+void begin_render_target_frame(RenderTargetPool* pool) {
+	pool->frame++;
+	pool->created = pool->reused = pool->freed = 0;
+	for (u32 i = 0; i < pool->targets.size();) {
+		PooledRenderTarget* target = &pool->targets[i];
+		if (target->inUse) {
+			BMT_LOG(WARNING, "Render target #%d was never released", target->buffer.ID);
+			target->inUse = false;
+		}
+		if (target->lastUsedFrame + pool->maxIdleFrames < pool->frame) {
+			dispose_framebuffer(target->buffer);
+			pool->bytes -= target->bytes;
+			pool->freed++;
+			pool->targets[i] = pool->targets.back();
+			pool->targets.pop_back();
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+//==========================================================================================
+//Description: Hands out a target for this frame, reusing a free one with the same key
+//
+//Parameters:
+//		-The pool
+//		-Size, format and sample count of the target
+//		-Filter of the color texture, ignored for multisampled targets
+//
+//Comments: Multisampled targets always have color and depth renderbuffers, whatever the
+//          format. The contents of a reused target are whatever the last user left, so
+//          clear it before drawing.
+//==========================================================================================
+INTERNAL inline
+Framebuffer acquire_render_target(RenderTargetPool* pool, u32 width, u32 height, RenderTargetFormat format, u32 samples = 1, u16 filter = GL_LINEAR) {
+	for (u32 i = 0; i < pool->targets.size(); ++i) {
+		PooledRenderTarget* target = &pool->targets[i];
+		if (!target->inUse && target->width == width && target->height == height && target->format == format && target->samples == samples && target->filter == filter) {
+			target->inUse = true;
+			target->lastUsedFrame = pool->frame;
+			pool->reused++;
+			return target->buffer;
+		}
+	}
+
+	PooledRenderTarget target;
+	target.width = width;
+	target.height = height;
+	target.format = format;
+	target.samples = samples;
+	target.filter = filter;
+	target.inUse = true;
+	target.lastUsedFrame = pool->frame;
+	target.bytes = render_target_bytes(width, height, format, samples);
+	if (samples > 1)
+		target.buffer = create_multisample_buffer(width, height, samples);
+	else if (format == RENDER_TARGET_SCENE)
+		target.buffer = create_scene_buffer(width, height, filter);
+	else if (format == RENDER_TARGET_DEPTH)
+		target.buffer = create_depth_buffer(width, height, filter);
+	else
+		target.buffer = create_color_buffer(width, height, filter);
+	pool->targets.push_back(target);
+	pool->bytes += target.bytes;
+	pool->created++;
+	return target.buffer;
+}
+
+//==========================================================================================
+//Description: Returns a target to the pool, later passes of this frame may get it again
+//==========================================================================================
+INTERNAL inline
+void release_render_target(RenderTargetPool* pool, Framebuffer buffer) {
+	for (u32 i = 0; i < pool->targets.size(); ++i) {
+		if (pool->targets[i].buffer.ID == buffer.ID) {
+			pool->targets[i].inUse = false;
+			return;
+		}
+	}
+	BMT_LOG(WARNING, "Framebuffer #%d is not from this pool", buffer.ID);
+}
+
+INTERNAL inline
+u64 get_render_target_memory(RenderTargetPool* pool) {
+	return pool->bytes;
+}
+
+//==========================================================================================
+//Description: Logs every pooled target and the GPU memory they take
+//==========================================================================================
+INTERNAL inline
+void dump_render_target_pool(RenderTargetPool* pool) {
+	const char* formats[] = { "color", "scene", "depth" };
+	BMT_LOG(INFO, "Render target pool, %d targets, %.2f MB (last frame %d created, %d reused, %d freed)",
+		(i32)pool->targets.size(), pool->bytes / (1024.0 * 1024.0), pool->created, pool->reused, pool->freed);
+	for (u32 i = 0; i < pool->targets.size(); ++i) {
+		PooledRenderTarget* target = &pool->targets[i];
+		BMT_LOG(INFO, "    #%-4d %5dx%-5d %s x%d  %8.2f MB  idle %d frames", target->buffer.ID, target->width, target->height,
+			formats[target->format], target->samples, target->bytes / (1024.0 * 1024.0), (i32)(pool->frame - target->lastUsedFrame));
+	}
+}
+
+#endif
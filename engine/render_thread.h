@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        render_thread.h                          //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include "defines.h"
+#include "window.h"
+#include "profiler.h"
+#include <atomic>
+#include <thread>
+
+//A thread that owns the GL context, fed by a lock-free triple buffer.
+//
+//The simulation fills the back slot of the triple buffer and publishes it; the
+//render thread picks up whatever was published last. Neither side ever waits on
+//the other: publishing swaps the back slot with the middle one, acquiring swaps
+//the front slot with the middle one, and both are a single atomic exchange. If
+//the simulation publishes twice before the render thread comes back, the older
+//snapshot is simply dropped, so anything that must not be lost (a key press
+//asking for a dump) should travel as a counter rather than a flag.
+//
+//The slots are owned by the caller so a snapshot can hold vectors. Once a slot is
+//published it must not be written until it comes back from publish as the new
+//back slot.
+//
+//		init_triple_buffer(&snapshots, &slots[0], &slots[1], &slots[2]);
+//		start_render_thread(&renderer, render_frame, &state);
+//		while(window_open()) {
+//			Snapshot* next = (Snapshot*)triple_buffer_back(&snapshots);
+//			...
+//			publish_triple_buffer(&snapshots);
+//			poll_window_events();
+//		}
+//		stop_render_thread(&renderer);
+
+//set in the middle slot index when it holds a snapshot the reader hasn't taken
+#define TRIPLE_BUFFER_FRESH 4
+#define TRIPLE_BUFFER_INDEX 3
+
+struct TripleBuffer {
+	void* slots[3];
+	std::atomic<u32> middle;
+	//only touched by the writer
+	u32 back;
+	//only touched by the reader
+	u32 front;
+};
+
+INTERNAL inline
+void init_triple_buffer(TripleBuffer* buffer, void* first, void* second, void* third) {
+	buffer->slots[0] = first;
+	buffer->slots[1] = second;
+	buffer->slots[2] = third;
+	buffer->back = 0;
+	buffer->middle.store(1);
+	buffer->front = 2;
+}
+
+//the slot the writer fills next
+INTERNAL inline
+void* triple_buffer_back(TripleBuffer* buffer) {
+	return buffer->slots[buffer->back];
+}
+
+INTERNAL inline
+void publish_triple_buffer(TripleBuffer* buffer) {
+	buffer->back = buffer->middle.exchange(buffer->back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX;
+}
+
+//==========================================================================================
+//Description: Takes the most recently published slot
+//
+//Comments: Returns NULL if nothing was published since the last call. The slot stays
+//          the reader's, untouched by the writer, until the next successful acquire
+//==========================================================================================
+INTERNAL inline
+void* acquire_triple_buffer(TripleBuffer* buffer) {
+	if ((buffer->middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH) == 0)
+		return NULL;
+	buffer->front = buffer->middle.exchange(buffer->front, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX;
+	return buffer->slots[buffer->front];
+}
+
+typedef void(*RenderFunc)(void* data);
+
+struct RenderThread {
+	std::thread thread;
+	std::atomic<bool> running;
+	RenderFunc func;
+	void* data;
+};
+
+INTERNAL inline
+void render_thread_main(RenderThread* renderer) {
+	BMT_PROFILE_THREAD("render");
+	make_gl_context_current();
+	while (renderer->running.load(std::memory_order_acquire))
+		renderer->func(renderer->data);
+	release_gl_context();
+}
+
+//==========================================================================================
+//Description: Hands the GL context to a new thread that calls func until stopped
+//
+//Parameters:
+//		-The render thread
+//		-Called over and over on the render thread, one frame per call at most. It should
+//		 wait a little when acquire_triple_buffer has nothing new instead of spinning
+//		-Passed to func
+//
+//Comments: Must be called from the thread the context is current on, which can't make
+//          GL calls again until stop_render_thread
+//==========================================================================================
+INTERNAL inline
+void start_render_thread(RenderThread* renderer, RenderFunc func, void* data) {
+	renderer->func = func;
+	renderer->data = data;
+	renderer->running.store(true);
+	release_gl_context();
+	renderer->thread = std::thread(render_thread_main, renderer);
+}
+
+//lets the frame in flight finish, then takes the context back to the calling thread
+INTERNAL inline
+void stop_render_thread(RenderThread* renderer) {
+	if (!renderer->thread.joinable())
+		return;
+	renderer->running.store(false, std::memory_order_release);
+	renderer->thread.join();
+	make_gl_context_current();
+}
+
+#endif
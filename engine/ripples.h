@@ -0,0 +1,376 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        ripples.h                                //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef RIPPLES_H
+#define RIPPLES_H
+
+#include "defines.h"
+#include "maths.h"
+#include "texture.h"
+#include "jobs.h"
+#include "profiler.h"
+#include <chrono>
+
+//Local wave equation heightfield that follows the camera and lets ships
+//push the water around their hulls.
+//
+//The two height buffers ping-pong. Each step writes the next state over the
+//oldest one, so a step costs one read pass and one write pass. Rows are
+//spread across the job system and every row is stepped four cells at a time
+//with SSE.
+//
+//The timestep is fixed. update_ripples() never runs more than maxSteps
+//steps or spends more than budgetMs in a frame, and any time it could not
+//catch up on is dropped. A slow frame slows the water down instead of
+//spiralling.
+//
+//		RippleField ripples = create_ripple_field(256, 0.5f);
+//		init_ripple_texture(&ripples);
+//		recenter_ripples(&ripples, focus);
+//		add_ripple_source(&ripples, shipPosition, 1.5f, 0.02f);
+//		update_ripples(&ripples, dt);
+//		upload_ripples(&ripples);
+
+#define RIPPLE_MAX_SOURCES 256
+
+struct RippleSource {
+	i32 x;
+	i32 z;
+	i32 radius;
+	f32 strength;
+};
+
+struct RippleField {
+	u32 size;
+	f32 cellSize;
+	//world space position of cell 0, 0, always a whole number of cells
+	i32 originX;
+	i32 originZ;
+
+	f32 timestep;
+	f32 courant;
+	f32 damping;
+	u32 maxSteps;
+	f64 budgetMs;
+	f32 accumulator;
+
+	//current and previous heights, the next step overwrites previous
+	f32* current;
+	f32* previous;
+	f32* scratch;
+	//normal.xyz and height of every cell, what upload_ripples() sends to the GPU
+	vec4* output;
+
+	RippleSource sources[RIPPLE_MAX_SOURCES];
+	u32 sourceCount;
+
+	//stats of the last update
+	u32 steps;
+	f64 ms;
+	f32 droppedTime;
+
+	Texture map;
+};
+
+//==========================================================================================
+//Description: Creates a square ripple field
+//
+//Parameters:
+//		-Cells per side, rounded up to a multiple of 4
+//		-World space size of one cell
+//		-Speed of the waves in world units per second
+//		-Fixed timestep of the solver
+//
+//Comments: The timestep is shortened if the speed would make it unstable. Creates no GL
+//          objects, see init_ripple_texture()
+//==========================================================================================
+INTERNAL inline
+RippleField create_ripple_field(u32 size, f32 cellSize, f32 waveSpeed = 6.0f, f32 timestep = 1.0f / 60.0f) {
+	RippleField field = { 0 };
+	size = (size + 3) & ~3u;
+	if (size < 8)
+		size = 8;
+	field.size = size;
+	field.cellSize = cellSize;
+
+	//the explicit scheme is stable while (speed * dt / dx)^2 stays at or below 0.5
+	f32 courant = waveSpeed * timestep / cellSize;
+	if (courant * courant > 0.5f) {
+		timestep = 0.70710678f * cellSize / waveSpeed;
+		courant = 0.70710678f;
+		BMT_LOG(WARNING, "Ripple timestep too large for the wave speed, using %f", timestep);
+	}
+	field.timestep = timestep;
+	field.courant = courant * courant;
+	field.damping = 0.985f;
+	field.maxSteps = 2;
+	field.budgetMs = 1.0;
+
+	u32 count = size * size;
+	field.current = (f32*)calloc(count, sizeof(f32));
+	field.previous = (f32*)calloc(count, sizeof(f32));
+	field.scratch = (f32*)calloc(count, sizeof(f32));
+	field.output = (vec4*)calloc(count, sizeof(vec4));
+	for (u32 i = 0; i < count; ++i)
+		field.output[i] = V4(0, 1, 0, 0);
+	return field;
+}
+
+INTERNAL inline
+void init_ripple_texture(RippleField* field) {
+	Texture* texture = &field->map;
+	texture->width = texture->height = field->size;
+	texture->flip_flag = 0;
+	glGenTextures(1, &texture->ID);
+	glBindTexture(GL_TEXTURE_2D, texture->ID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, field->size, field->size, 0, GL_RGBA, GL_FLOAT, field->output);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+INTERNAL inline
+void dispose_ripple_field(RippleField* field) {
+	free(field->current);
+	free(field->previous);
+	free(field->scratch);
+	free(field->output);
+	if (field->map.ID)
+		dispose_texture(field->map);
+	field->size = 0;
+}
+
+//world space position of the centre of the field
+INTERNAL inline
+vec2 get_ripple_center(const RippleField* field) {
+	f32 half = field->size * 0.5f;
+	return V2((field->originX + half) * field->cellSize, (field->originZ + half) * field->cellSize);
+}
+
+//world space width of the field
+INTERNAL inline
+f32 get_ripple_extent(const RippleField* field) {
+	return field->size * field->cellSize;
+}
+
+INTERNAL
+void shift_ripple_buffer(RippleField* field, f32** buffer, i32 dx, i32 dz) {
+	const i32 size = field->size;
+	memset(field->scratch, 0, size * size * sizeof(f32));
+	for (i32 z = 0; z < size; ++z) {
+		i32 srcZ = z + dz;
+		if (srcZ < 0 || srcZ >= size)
+			continue;
+		i32 begin = dx < 0 ? -dx : 0;
+		i32 end = dx > 0 ? size - dx : size;
+		if (begin < end)
+			memcpy(field->scratch + z * size + begin, *buffer + srcZ * size + begin + dx, (end - begin) * sizeof(f32));
+	}
+	f32* swap = *buffer;
+	*buffer = field->scratch;
+	field->scratch = swap;
+}
+
+//==========================================================================================
+//Description: Moves the field so that it stays centred on focus
+//
+//Comments: The field only moves by whole cells and only once focus is more than an eighth
+//          of the field away, so waves already in flight keep their world position.
+//==========================================================================================
+INTERNAL inline
+void recenter_ripples(RippleField* field, vec3 focus) {
+	i32 half = field->size / 2;
+	i32 targetX = (i32)floorf(focus.x / field->cellSize) - half;
+	i32 targetZ = (i32)floorf(focus.z / field->cellSize) - half;
+	i32 dx = targetX - field->originX;
+	i32 dz = targetZ - field->originZ;
+	i32 threshold = field->size / 8;
+	if (abs(dx) <= threshold && abs(dz) <= threshold)
+		return;
+
+	BMT_PROFILE_FUNCTION();
+	shift_ripple_buffer(field, &field->current, dx, dz);
+	shift_ripple_buffer(field, &field->previous, dx, dz);
+	field->originX = targetX;
+	field->originZ = targetZ;
+}
+
+//==========================================================================================
+//Description: Pushes the water down around a world space point during the next update
+//
+//Parameters:
+//		-World space position, usually the hull of a ship
+//		-Radius of the disturbance in world units
+//		-Depth added per step at the centre, falling off towards the radius
+//
+//Comments: Sources outside the field are ignored and the rest are dropped once
+//          RIPPLE_MAX_SOURCES is reached, so the cost per step stays bounded no matter
+//          how many ships are sailing. Sources are cleared by update_ripples().
+//==========================================================================================
+INTERNAL inline
+void add_ripple_source(RippleField* field, vec3 position, f32 radius, f32 strength) {
+	if (field->sourceCount >= RIPPLE_MAX_SOURCES)
+		return;
+	i32 x = (i32)floorf(position.x / field->cellSize) - field->originX;
+	i32 z = (i32)floorf(position.z / field->cellSize) - field->originZ;
+	i32 r = (i32)ceilf(radius / field->cellSize);
+	if (r < 1)
+		r = 1;
+	if (x + r < 1 || z + r < 1 || x - r >= (i32)field->size - 1 || z - r >= (i32)field->size - 1)
+		return;
+	field->sources[field->sourceCount++] = { x, z, r, strength };
+}
+
+INTERNAL
+void apply_ripple_sources(RippleField* field) {
+	const i32 size = field->size;
+	for (u32 s = 0; s < field->sourceCount; ++s) {
+		RippleSource source = field->sources[s];
+		f32 inverseRadius = 1.0f / (source.radius * source.radius);
+		for (i32 dz = -source.radius; dz <= source.radius; ++dz) {
+			i32 z = source.z + dz;
+			if (z < 1 || z >= size - 1)
+				continue;
+			for (i32 dx = -source.radius; dx <= source.radius; ++dx) {
+				i32 x = source.x + dx;
+				if (x < 1 || x >= size - 1)
+					continue;
+				f32 falloff = 1.0f - (dx * dx + dz * dz) * inverseRadius;
+				if (falloff > 0.0f)
+					field->current[z * size + x] -= source.strength * falloff * falloff;
+			}
+		}
+	}
+}
+
+//next = (2 - 4c) * h + c * (left + right + up + down) - previous, written over previous.
+//The border cells stay at zero.
+INTERNAL
+void ripple_step_rows(void* data, u32 begin, u32 end) {
+	RippleField* field = (RippleField*)data;
+	const u32 size = field->size;
+	const f32 c = field->courant;
+	const f32 centre = 2.0f - 4.0f * c;
+	const f32 damping = field->damping;
+	for (u32 z = begin; z < end; ++z) {
+		if (z == 0 || z == size - 1)
+			continue;
+		const f32* h = field->current + z * size;
+		const f32* up = h - size;
+		const f32* down = h + size;
+		f32* out = field->previous + z * size;
+		u32 x = 1;
+#ifdef BMT_SSE
+		__m128 vc = _mm_set1_ps(c);
+		__m128 vcentre = _mm_set1_ps(centre);
+		__m128 vdamping = _mm_set1_ps(damping);
+		for (; x + 4 <= size - 1; x += 4) {
+			__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(h + x - 1), _mm_loadu_ps(h + x + 1)),
+				_mm_add_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x)));
+			__m128 next = _mm_add_ps(_mm_mul_ps(vcentre, _mm_loadu_ps(h + x)), _mm_mul_ps(vc, sum));
+			next = _mm_sub_ps(next, _mm_loadu_ps(out + x));
+			_mm_storeu_ps(out + x, _mm_mul_ps(next, vdamping));
+		}
+#endif
+		for (; x < size - 1; ++x) {
+			f32 sum = h[x - 1] + h[x + 1] + up[x] + down[x];
+			out[x] = (centre * h[x] + c * sum - out[x]) * damping;
+		}
+	}
+}
+
+INTERNAL
+void ripple_output_rows(void* data, u32 begin, u32 end) {
+	RippleField* field = (RippleField*)data;
+	const i32 size = field->size;
+	const f32 scale = 1.0f / (2.0f * field->cellSize);
+	for (i32 z = begin; z < (i32)end; ++z) {
+		const f32* h = field->current + z * size;
+		const f32* up = z > 0 ? h - size : h;
+		const f32* down = z < size - 1 ? h + size : h;
+		for (i32 x = 0; x < size; ++x) {
+			f32 left = h[x > 0 ? x - 1 : x];
+			f32 right = h[x < size - 1 ? x + 1 : x];
+			vec3 normal = normalize(V3((left - right) * scale, 1.0f, (up[x] - down[x]) * scale));
+			field->output[z * size + x] = V4(normal.x, normal.y, normal.z, h[x]);
+		}
+	}
+}
+
+//==========================================================================================
+//Description: Advances the field by as many fixed steps as fit in dt and the budget
+//
+//Comments: Touches no GL state, call upload_ripples() afterwards to update the texture
+//==========================================================================================
+INTERNAL inline
+void update_ripples(RippleField* field, f32 dt) {
+	BMT_PROFILE_FUNCTION();
+	auto start = std::chrono::steady_clock::now();
+	const u32 grain = field->size / 16;
+
+	field->accumulator += dt;
+	field->steps = 0;
+	field->droppedTime = 0;
+	while (field->accumulator >= field->timestep && field->steps < field->maxSteps) {
+		apply_ripple_sources(field);
+		parallel_for(field->size, grain, ripple_step_rows, field);
+		f32* swap = field->current;
+		field->current = field->previous;
+		field->previous = swap;
+
+		field->accumulator -= field->timestep;
+		field->steps++;
+		if (std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count() > field->budgetMs)
+			break;
+	}
+	//whatever could not be simulated this frame is dropped rather than carried over
+	if (field->accumulator >= field->timestep) {
+		field->droppedTime = field->accumulator;
+		field->accumulator = fmodf(field->accumulator, field->timestep);
+		field->droppedTime -= field->accumulator;
+	}
+	//sources stay queued until a step has actually disturbed the field with them
+	if (field->steps > 0)
+		field->sourceCount = 0;
+
+	if (field->steps > 0)
+		parallel_for(field->size, grain, ripple_output_rows, field);
+	field->ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+INTERNAL inline
+void upload_ripples(RippleField* field) {
+	BMT_PROFILE_FUNCTION();
+	glBindTexture(GL_TEXTURE_2D, field->map.ID);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, field->size, field->size, GL_RGBA, GL_FLOAT, field->output);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+#endif
@@ -31,6 +31,8 @@
 
 #include "defines.h"
 #include "maths.h"
+#include "profiler.h"
+#include "render_stats.h"
 #include <vector>
 
 struct Shader {
@@ -46,6 +48,7 @@ GLint get_uniform_location(Shader shader, const GLchar* name) {
 
 INTERNAL inline
 GLuint load_shader_file(const GLchar* path, GLuint type) {
+	BMT_PROFILE_FUNCTION();
 	i32 shaderID = glCreateShader(type);
 
 	const GLchar* shaderSource = read_file(path);
@@ -89,7 +92,7 @@ GLuint load_shader_string(const GLchar* string, GLuint type) {
 		std::vector<char> error(len);
 		glGetShaderInfoLog(shaderID, len, &len, &error[0]);
 		glDeleteShader(shaderID);
-		BMT_LOG(ERROR, "\nCOULD NOT COMPILE %s SHADER! (ID: %d)\n", (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT"), shaderID);
+		BMT_LOG(MINOR_ERROR, "\nCOULD NOT COMPILE %s SHADER! (ID: %d)\n", (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT"), shaderID);
 		BMT_LOG(FATAL_ERROR, "%s\n", &error[0]);
 		return 0;
 	}
@@ -192,59 +195,69 @@ INTERNAL inline
 void upload_float(Shader shader, const GLchar* name, f32 value) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform1f(location, value);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_float_array(Shader shader, const GLchar* name, f32 arr[], i32 count) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform1fv(location, count, arr);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_int(Shader shader, const GLchar* name, i32 value) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform1i(location, value);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_int_array(Shader shader, const GLchar* name, i32 arr[], i32 count) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform1iv(location, count, arr);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_vec2(Shader shader, const GLchar* name, vec2 vec) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform2f(location, vec.x, vec.y);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_vec3(Shader shader, const GLchar* name, vec3 vec) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform3f(location, vec.x, vec.y, vec.z);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_vec4(Shader shader, const GLchar* name, vec4 vec) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform4f(location, vec.x, vec.y, vec.z, vec.w);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_bool(Shader shader, const GLchar* name, bool value) {
 	i32 location = get_uniform_location(shader, name);
 	glUniform1f(location, value ? 1 : 0);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void upload_mat4(Shader shader, const GLchar* name, mat4 mat) {
 	i32 location = get_uniform_location(shader, name);
 	glUniformMatrix4fv(location, 1, GL_FALSE, mat.elements);
+	BMT_STAT_ADD(STAT_UNIFORM_UPLOADS, 1);
 }
 
 INTERNAL inline
 void start_shader(Shader shader) {
 	glUseProgram(shader.ID);
+	BMT_STAT_ADD(STAT_PROGRAM_BINDS, 1);
 }
 
 INTERNAL inline
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        stats_hud.h                              //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef STATS_HUD_H
+#define STATS_HUD_H
+
+#include "defines.h"
+#include "render2D.h"
+#include "render_stats.h"
+#include "text.h"
+
+//shortens a counter to at most 6 characters, 1234567 becomes 1234.6K
+INTERNAL inline
+void format_stat(char* out, u32 size, u64 value) {
+	if (value < 100000)
+		snprintf(out, size, "%llu", (unsigned long long)value);
+	else if (value < 100000000)
+		snprintf(out, size, "%.1fK", value / 1000.0);
+	else
+		snprintf(out, size, "%.1fM", value / 1000000.0);
+}
+
+//==========================================================================================
+//Description: Draws the counters of the last frame as a table, one row per pass and
+//             the frame total last
+//
+//Parameters:
+//		-A bound quad batch
+//		-The font to write with
+//		-Top left corner of the table
+//
+//Comments: Shows a note instead when the engine was built without BMT_RENDER_STATS.
+//          The overlay is drawn into the frame it measures, so its own quads are only
+//          in the next frame's numbers.
+//==========================================================================================
+INTERNAL inline
+void draw_render_stats(QuadBatch* batch, Font* font, i32 x, i32 y) {
+	const i32 line = (i32)font->lineHeight;
+	const i32 margin = line / 4;
+
+#ifndef BMT_RENDER_STATS
+	const char* note = "render stats off, build with BMT_RENDER_STATS";
+	vec2 size = measure_text(font, note);
+	draw_rectangle(batch, x - margin, y - margin, (i32)size.x + 2 * margin, line + 2 * margin, 0, 0, 0, 160);
+	draw_text(batch, font, note, x, y, V4(255, 255, 255, 255));
+#else
+	const i32 nameColumn = (i32)measure_text(font, "0000000000000000").x;
+	const i32 column = (i32)measure_text(font, "000000000").x;
+	const RenderFrameStats* stats = get_render_stats();
+
+	draw_rectangle(batch, x - margin, y - margin, nameColumn + column * STAT_COUNT + 2 * margin,
+		line * (stats->passCount + 2) + 2 * margin, 0, 0, 0, 160);
+
+	vec4 header = V4(253, 249, 0, 255);
+	draw_text(batch, font, "pass", x, y, header);
+	for (u32 s = 0; s < STAT_COUNT; ++s)
+		draw_text(batch, font, RENDER_STAT_NAMES[s], x + nameColumn + column * s, y, header);
+
+	char text[16];
+	for (u32 p = 0; p <= stats->passCount; ++p) {
+		bool total = p == stats->passCount;
+		const u64* counters = total ? stats->counters : stats->passes[p].counters;
+		vec4 color = total ? V4(0, 228, 48, 255) : V4(255, 255, 255, 255);
+		i32 rowY = y + line * (p + 1);
+
+		snprintf(text, sizeof(text), "%.15s", total ? "frame" : stats->passes[p].name);
+		draw_text(batch, font, text, x, rowY, color);
+		for (u32 s = 0; s < STAT_COUNT; ++s) {
+			format_stat(text, sizeof(text), counters[s]);
+			draw_text(batch, font, text, x + nameColumn + column * s, rowY, color);
+		}
+	}
+#endif
+}
+
+#endif
@@ -0,0 +1,651 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        text.h                                   //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "defines.h"
+#include "render2D.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <chrono>
+
+#ifdef BMT_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+//Text drawn through a QuadBatch.
+//
+//Glyphs are rasterised on first use into one shared single channel atlas. A texture
+//swizzle reads its red channel as white with coverage in alpha, so the quad shader draws
+//glyphs like any other texture, and since every font packs into the same atlas a run of
+//text never switches textures. Glyphs are packed into shelves; a full atlas is cleared
+//and glyphs are rasterised again as they are drawn.
+//
+//The layout of a string (glyph lookups, kerning, line breaks) is cached per font as a
+//list of finished quads relative to the pen, so drawing a string that was drawn before
+//is a hash and four vertices per glyph. The cache keeps two generations: when the newer
+//one fills up the older one is dropped, so numbers that change every frame can't push
+//out the labels drawn next to them.
+//
+//FreeType is only used when the engine is compiled with BMT_FREETYPE and linked against
+//freetype.lib. Without it, or when a font file can't be opened, a font falls back to the
+//built-in 3x5 pixel font scaled up, which goes through the same atlas and cache.
+
+#ifndef GLYPH_ATLAS_SIZE
+#define GLYPH_ATLAS_SIZE          1024
+#endif
+#ifndef TEXT_LAYOUT_CACHE_SIZE
+#define TEXT_LAYOUT_CACHE_SIZE    512
+#endif
+#define GLYPH_PADDING             1
+
+#define BUILTIN_FONT_FIRST        32
+#define BUILTIN_FONT_LAST         95
+
+//five rows of three bits, one octal digit per row with the top row first, so 075557 is a 0
+GLOBAL const u16 BUILTIN_FONT[BUILTIN_FONT_LAST - BUILTIN_FONT_FIRST + 1] = {
+	0,      002220, 055000, 057575, 036736, 051245, 025257, 022000, //  ! " # $ % & '
+	012221, 042224, 005250, 002720, 000024, 000700, 000002, 011244, //( ) * + , - . /
+	075557, 026227, 071747, 071317, 055711, 074717, 074757, 071111, //0 1 2 3 4 5 6 7
+	075757, 075717, 002020, 002024, 012421, 007070, 042124, 071202, //8 9 : ; < = > ?
+	075547, 025755, 065656, 034443, 065556, 074647, 074644, 034553, //@ A B C D E F G
+	055755, 072227, 011152, 055655, 044447, 057755, 065555, 025552, //H I J K L M N O
+	065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, //P Q R S T U V W
+	055255, 055222, 071247, 064446, 044211, 031113, 025000, 000007  //X Y Z [ \ ] ^ _
+};
+
+struct GlyphAtlas {
+	Texture texture;
+	u32 shelfX;
+	u32 shelfY;
+	u32 shelfHeight;
+	//bumped every time the atlas is cleared, fonts drop their caches when it changes
+	u32 generation;
+};
+
+struct Glyph {
+	u16 x;
+	u16 y;
+	u16 width;
+	u16 height;
+	//offset of the bitmap from the pen, top is measured up from the baseline
+	i16 left;
+	i16 top;
+	f32 advance;
+	u32 index;
+	bool loaded;
+};
+
+struct TextQuad {
+	f32 x0, y0, x1, y1;
+	f32 u0, v0, u1, v1;
+};
+
+struct TextLayout {
+	std::string text;
+	std::vector<TextQuad> quads;
+	vec2 size;
+};
+
+struct Font {
+	GlyphAtlas* atlas;
+	//size of one pixel of the built-in font, 0 for FreeType fonts
+	u32 scale;
+#ifdef BMT_FREETYPE
+	FT_Face face;
+#endif
+	f32 ascent;
+	f32 lineHeight;
+	bool kerning;
+	u32 generation;
+	Glyph ascii[128];
+	std::unordered_map<u32, Glyph> glyphs;
+	std::unordered_map<u64, f32> kerningPairs;
+	//[0] is the newer generation
+	std::unordered_map<u64, TextLayout> layouts[2];
+};
+
+#ifdef BMT_FREETYPE
+GLOBAL FT_Library freetype = NULL;
+#endif
+
+INTERNAL inline
+GlyphAtlas create_glyph_atlas(u32 size = GLYPH_ATLAS_SIZE) {
+	GlyphAtlas atlas = { 0 };
+	atlas.texture.width = size;
+	atlas.texture.height = size;
+	atlas.shelfX = GLYPH_PADDING;
+	atlas.shelfY = GLYPH_PADDING;
+	atlas.generation = 1;
+
+	std::vector<u8> clear(size * size, 0);
+	glGenTextures(1, &atlas.texture.ID);
+	glBindTexture(GL_TEXTURE_2D, atlas.texture.ID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, &clear[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLint swizzle[4] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return atlas;
+}
+
+INTERNAL inline
+void dispose_glyph_atlas(GlyphAtlas* atlas) {
+	dispose_texture(atlas->texture);
+}
+
+//==========================================================================================
+//Description: Forgets every glyph in the atlas, they are rasterised again when next drawn
+//
+//Comments: Quads already in a batch still point at the old glyphs, flush it first
+//==========================================================================================
+INTERNAL inline
+void reset_glyph_atlas(GlyphAtlas* atlas) {
+	atlas->shelfX = GLYPH_PADDING;
+	atlas->shelfY = GLYPH_PADDING;
+	atlas->shelfHeight = 0;
+	atlas->generation++;
+}
+
+INTERNAL inline
+bool pack_glyph(GlyphAtlas* atlas, u32 width, u32 height, u16* x, u16* y) {
+	u32 size = atlas->texture.width;
+	if (width + 2 * GLYPH_PADDING > size || height + 2 * GLYPH_PADDING > size)
+		return false;
+	if (atlas->shelfX + width + GLYPH_PADDING > size) {
+		atlas->shelfY += atlas->shelfHeight + GLYPH_PADDING;
+		atlas->shelfX = GLYPH_PADDING;
+		atlas->shelfHeight = 0;
+	}
+	if (atlas->shelfY + height + GLYPH_PADDING > (u32)atlas->texture.height)
+		return false;
+
+	*x = (u16)atlas->shelfX;
+	*y = (u16)atlas->shelfY;
+	atlas->shelfX += width + GLYPH_PADDING;
+	if (height > atlas->shelfHeight)
+		atlas->shelfHeight = height;
+	return true;
+}
+
+INTERNAL inline
+void upload_glyph(GlyphAtlas* atlas, const Glyph* glyph, const u8* pixels) {
+	glBindTexture(GL_TEXTURE_2D, atlas->texture.ID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, glyph->x, glyph->y, glyph->width, glyph->height, GL_RED, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+//==========================================================================================
+//Description: Creates a font out of the built-in 3x5 pixel font
+//
+//Parameters:
+//		-The atlas the glyphs are rasterised into
+//		-Screen pixels per font pixel
+//
+//Comments: Covers ASCII 32 to 95, lower case letters are drawn upper case
+//==========================================================================================
+INTERNAL inline
+Font create_builtin_font(GlyphAtlas* atlas, u32 scale = 2) {
+	Font font;
+	font.atlas = atlas;
+	font.scale = scale ? scale : 1;
+#ifdef BMT_FREETYPE
+	font.face = NULL;
+#endif
+	font.ascent = 5.0f * font.scale;
+	font.lineHeight = 7.0f * font.scale;
+	font.kerning = false;
+	font.generation = atlas->generation;
+	memset(font.ascii, 0, sizeof(font.ascii));
+	return font;
+}
+
+//==========================================================================================
+//Description: Loads a TrueType or OpenType font with FreeType
+//
+//Parameters:
+//		-The atlas the glyphs are rasterised into
+//		-Path of the font file
+//		-Height of a line in pixels
+//
+//Comments: Falls back to the built-in font if FreeType is compiled out or the file
+//          can't be loaded, so the result can always be drawn with.
+//==========================================================================================
+INTERNAL inline
+Font load_font(GlyphAtlas* atlas, const char* path, u32 pixelSize) {
+	Font font = create_builtin_font(atlas, pixelSize / 7 > 0 ? pixelSize / 7 : 1);
+#ifdef BMT_FREETYPE
+	if (freetype == NULL && FT_Init_FreeType(&freetype) != 0) {
+		BMT_LOG(WARNING, "Could not initialize FreeType, using the built-in font");
+		freetype = NULL;
+		return font;
+	}
+	FT_Face face;
+	if (FT_New_Face(freetype, path, 0, &face) != 0) {
+		BMT_LOG(WARNING, "Could not load font %s, using the built-in font", path);
+		return font;
+	}
+	FT_Set_Pixel_Sizes(face, 0, pixelSize);
+	font.scale = 0;
+	font.face = face;
+	font.ascent = face->size->metrics.ascender / 64.0f;
+	font.lineHeight = face->size->metrics.height / 64.0f;
+	font.kerning = FT_HAS_KERNING(face) != 0;
+#else
+	BMT_LOG(WARNING, "Could not load font %s, the engine was built without BMT_FREETYPE", path);
+#endif
+	return font;
+}
+
+INTERNAL inline
+void dispose_font(Font* font) {
+#ifdef BMT_FREETYPE
+	if (font->face)
+		FT_Done_Face(font->face);
+	font->face = NULL;
+#endif
+	font->glyphs.clear();
+	font->kerningPairs.clear();
+	font->layouts[0].clear();
+	font->layouts[1].clear();
+}
+
+INTERNAL inline
+void rasterize_builtin_glyph(Font* font, u32 codepoint, Glyph* glyph, std::vector<u8>* pixels) {
+	if (codepoint >= 'a' && codepoint <= 'z')
+		codepoint += 'A' - 'a';
+	u16 bits = codepoint >= BUILTIN_FONT_FIRST && codepoint <= BUILTIN_FONT_LAST ? BUILTIN_FONT[codepoint - BUILTIN_FONT_FIRST] : 0;
+	u32 scale = font->scale;
+	glyph->width = bits ? 3 * scale : 0;
+	glyph->height = bits ? 5 * scale : 0;
+	glyph->left = 0;
+	glyph->top = (i16)(5 * scale);
+	glyph->advance = 4.0f * scale;
+	glyph->index = codepoint;
+
+	pixels->assign(glyph->width * glyph->height, 0);
+	for (u32 y = 0; y < glyph->height; ++y)
+		for (u32 x = 0; x < glyph->width; ++x)
+			if (bits & (1 << ((4 - y / scale) * 3 + 2 - x / scale)))
+				(*pixels)[y * glyph->width + x] = 255;
+}
+
+#ifdef BMT_FREETYPE
+INTERNAL inline
+void rasterize_freetype_glyph(Font* font, u32 codepoint, Glyph* glyph, std::vector<u8>* pixels) {
+	glyph->index = FT_Get_Char_Index(font->face, codepoint);
+	if (FT_Load_Glyph(font->face, glyph->index, FT_LOAD_RENDER) != 0) {
+		glyph->width = glyph->height = 0;
+		glyph->advance = 0;
+		return;
+	}
+	FT_GlyphSlot slot = font->face->glyph;
+	glyph->width = (u16)slot->bitmap.width;
+	glyph->height = (u16)slot->bitmap.rows;
+	glyph->left = (i16)slot->bitmap_left;
+	glyph->top = (i16)slot->bitmap_top;
+	glyph->advance = slot->advance.x / 64.0f;
+
+	//the pitch can be padded or negative, copy the rows out tightly packed
+	pixels->resize(glyph->width * glyph->height);
+	for (u32 y = 0; y < glyph->height; ++y) {
+		const u8* row = slot->bitmap.buffer + (slot->bitmap.pitch >= 0 ? y : glyph->height - 1 - y) * abs(slot->bitmap.pitch);
+		memcpy(&(*pixels)[y * glyph->width], row, glyph->width);
+	}
+}
+#endif
+
+//Cached glyphs are only valid while the atlas is on the generation they were packed in
+INTERNAL inline
+void sync_font_atlas(Font* font) {
+	if (font->generation == font->atlas->generation)
+		return;
+	memset(font->ascii, 0, sizeof(font->ascii));
+	font->glyphs.clear();
+	font->layouts[0].clear();
+	font->layouts[1].clear();
+	font->generation = font->atlas->generation;
+}
+
+//==========================================================================================
+//Description: Returns a glyph, rasterising it into the atlas the first time it's asked for
+//
+//Parameters:
+//		-The font
+//		-A unicode codepoint
+//		-The batch being drawn into, flushed before the atlas is cleared so the quads
+//		 already in it draw the glyphs they were made for. May be NULL.
+//
+//Comments: A full atlas is cleared, after which every glyph the font had is gone and
+//          sync_font_atlas has to be called before any other glyph is used.
+//==========================================================================================
+INTERNAL inline
+const Glyph* get_glyph(Font* font, u32 codepoint, QuadBatch* batch) {
+	Glyph* glyph;
+	if (codepoint < 128)
+		glyph = &font->ascii[codepoint];
+	else
+		glyph = &font->glyphs[codepoint];
+	if (glyph->loaded)
+		return glyph;
+
+	LOCAL std::vector<u8> pixels;
+#ifdef BMT_FREETYPE
+	if (font->face)
+		rasterize_freetype_glyph(font, codepoint, glyph, &pixels);
+	else
+#endif
+		rasterize_builtin_glyph(font, codepoint, glyph, &pixels);
+
+	if (glyph->width > 0 && glyph->height > 0) {
+		if (!pack_glyph(font->atlas, glyph->width, glyph->height, &glyph->x, &glyph->y)) {
+			if (batch && batch->indexcount > 0)
+				flush_quad_batch(batch);
+			reset_glyph_atlas(font->atlas);
+			if (!pack_glyph(font->atlas, glyph->width, glyph->height, &glyph->x, &glyph->y)) {
+				BMT_LOG(WARNING, "Glyph %d does not fit in the glyph atlas", codepoint);
+				glyph->width = glyph->height = 0;
+			}
+			//the reset invalidated the caches this glyph lives in, put it back afterwards
+			Glyph packed = *glyph;
+			sync_font_atlas(font);
+			glyph = codepoint < 128 ? &font->ascii[codepoint] : &font->glyphs[codepoint];
+			*glyph = packed;
+		}
+		if (glyph->width > 0)
+			upload_glyph(font->atlas, glyph, &pixels[0]);
+	}
+	glyph->loaded = true;
+	return glyph;
+}
+
+INTERNAL inline
+f32 get_kerning(Font* font, u32 left, u32 right) {
+#ifdef BMT_FREETYPE
+	if (!font->kerning)
+		return 0;
+	u64 key = (u64)left << 32 | right;
+	std::unordered_map<u64, f32>::iterator found = font->kerningPairs.find(key);
+	if (found != font->kerningPairs.end())
+		return found->second;
+	FT_Vector delta;
+	FT_Get_Kerning(font->face, left, right, FT_KERNING_DEFAULT, &delta);
+	font->kerningPairs[key] = delta.x / 64.0f;
+	return delta.x / 64.0f;
+#else
+	return 0;
+#endif
+}
+
+INTERNAL inline
+u32 decode_utf8(const char** text) {
+	const u8* c = (const u8*)*text;
+	u32 codepoint = c[0];
+	u32 length = 1;
+	if (c[0] >= 0xF0 && c[1] && c[2] && c[3]) {
+		codepoint = (c[0] & 0x07) << 18 | (c[1] & 0x3F) << 12 | (c[2] & 0x3F) << 6 | (c[3] & 0x3F);
+		length = 4;
+	}
+	else if (c[0] >= 0xE0 && c[1] && c[2]) {
+		codepoint = (c[0] & 0x0F) << 12 | (c[1] & 0x3F) << 6 | (c[2] & 0x3F);
+		length = 3;
+	}
+	else if (c[0] >= 0xC0 && c[1]) {
+		codepoint = (c[0] & 0x1F) << 6 | (c[1] & 0x3F);
+		length = 2;
+	}
+	*text += length;
+	return codepoint;
+}
+
+INTERNAL inline
+void build_text_layout(Font* font, const char* text, QuadBatch* batch, TextLayout* layout, bool retry = true) {
+	u32 generation = font->atlas->generation;
+	layout->quads.clear();
+	f32 invWidth = 1.0f / font->atlas->texture.width;
+	f32 invHeight = 1.0f / font->atlas->texture.height;
+	f32 x = 0;
+	f32 baseline = font->ascent;
+	f32 width = 0;
+	u32 previous = 0;
+
+	for (const char* c = text; *c; ) {
+		u32 codepoint = decode_utf8(&c);
+		if (codepoint == '\n') {
+			x = 0;
+			baseline += font->lineHeight;
+			previous = 0;
+			continue;
+		}
+		const Glyph* glyph = get_glyph(font, codepoint, batch);
+		if (font->atlas->generation != generation) {
+			//the atlas was cleared halfway, the quads so far point at glyphs that are gone
+			if (retry) {
+				build_text_layout(font, text, batch, layout, false);
+			}
+			else {
+				BMT_LOG(WARNING, "Text does not fit in the glyph atlas");
+				layout->quads.clear();
+			}
+			return;
+		}
+		if (previous)
+			x += get_kerning(font, previous, glyph->index);
+		previous = glyph->index;
+
+		if (glyph->width > 0) {
+			TextQuad quad;
+			quad.x0 = x + glyph->left;
+			quad.y0 = baseline - glyph->top;
+			quad.x1 = quad.x0 + glyph->width;
+			quad.y1 = quad.y0 + glyph->height;
+			quad.u0 = glyph->x * invWidth;
+			quad.v0 = glyph->y * invHeight;
+			quad.u1 = (glyph->x + glyph->width) * invWidth;
+			quad.v1 = (glyph->y + glyph->height) * invHeight;
+			layout->quads.push_back(quad);
+		}
+		x += glyph->advance;
+		if (x > width)
+			width = x;
+	}
+	layout->size = V2(width, baseline - font->ascent + font->lineHeight);
+}
+
+//==========================================================================================
+//Description: Returns the layout of a string, from the cache if it was drawn recently
+//
+//Comments: The pointer is only good until the next call for the same font
+//==========================================================================================
+INTERNAL inline
+const TextLayout* get_text_layout(Font* font, const char* text, QuadBatch* batch = NULL) {
+	sync_font_atlas(font);
+
+	//FNV-1a
+	u64 hash = 14695981039346656037ULL;
+	for (const char* c = text; *c; ++c)
+		hash = (hash ^ (u8)*c) * 1099511628211ULL;
+
+	std::unordered_map<u64, TextLayout>::iterator found = font->layouts[0].find(hash);
+	if (found != font->layouts[0].end() && found->second.text == text)
+		return &found->second;
+
+	TextLayout built;
+	found = font->layouts[1].find(hash);
+	if (found != font->layouts[1].end() && found->second.text == text) {
+		built = std::move(found->second);
+		font->layouts[1].erase(found);
+	}
+	else {
+		//built outside the cache, rasterising a glyph can clear the atlas and the cache with it
+		built.text = text;
+		build_text_layout(font, text, batch, &built);
+	}
+
+	if (font->layouts[0].size() >= TEXT_LAYOUT_CACHE_SIZE / 2) {
+		font->layouts[1] = std::move(font->layouts[0]);
+		font->layouts[0].clear();
+	}
+	TextLayout* layout = &font->layouts[0][hash];
+	*layout = std::move(built);
+	return layout;
+}
+
+INTERNAL inline
+vec2 measure_text(Font* font, const char* text) {
+	return get_text_layout(font, text)->size;
+}
+
+//==========================================================================================
+//Description: Draws a string into a bound quad batch
+//
+//Parameters:
+//		-A bound quad batch
+//		-The font
+//		-The text, UTF-8, '\n' starts a new line
+//		-Top left corner of the text, rounded to whole pixels
+//		-Color (0-255)
+//
+//Comments: The batch is drawn and restarted whenever it fills up, so a string may be any
+//          length.
+//==========================================================================================
+INTERNAL inline
+void draw_text(QuadBatch* batch, Font* font, const char* text, f32 x, f32 y, vec4 color) {
+	const TextLayout* layout = get_text_layout(font, text, batch);
+	x = floorf(x + 0.5f);
+	y = floorf(y + 0.5f);
+	vec4 rgba = V4(color.x / 255.0f, color.y / 255.0f, color.z / 255.0f, color.w / 255.0f);
+
+	u32 count = layout->quads.size();
+	u32 i = 0;
+	while (i < count) {
+		i32 texSlot = reserve_textured_quad(batch, font->atlas->texture);
+		if (texSlot < 0)
+			return;
+		u32 end = i + (count - i < quad_batch_room(batch) ? count - i : quad_batch_room(batch));
+
+		VertexData* vertex = batch->buffer;
+		for (; i < end; ++i) {
+			const TextQuad* quad = &layout->quads[i];
+			vertex[0].pos = V2(x + quad->x0, y + quad->y0);
+			vertex[0].color = rgba;
+			vertex[0].uv = V2(quad->u0, quad->v0);
+			vertex[0].texid = texSlot;
+			vertex[1].pos = V2(x + quad->x0, y + quad->y1);
+			vertex[1].color = rgba;
+			vertex[1].uv = V2(quad->u0, quad->v1);
+			vertex[1].texid = texSlot;
+			vertex[2].pos = V2(x + quad->x1, y + quad->y1);
+			vertex[2].color = rgba;
+			vertex[2].uv = V2(quad->u1, quad->v1);
+			vertex[2].texid = texSlot;
+			vertex[3].pos = V2(x + quad->x1, y + quad->y0);
+			vertex[3].color = rgba;
+			vertex[3].uv = V2(quad->u1, quad->v0);
+			vertex[3].texid = texSlot;
+			vertex += 4;
+			batch->indexcount += 6;
+		}
+		batch->buffer = vertex;
+	}
+}
+
+//==========================================================================================
+//Description: Logs how many glyphs per millisecond the text path lays out and emits
+//
+//Comments: Must be called on the GL thread, glyphs are uploaded to the atlas. The quads
+//          go into a scratch array that is never drawn, so only the CPU side is timed:
+//              -cached    the same labels every draw, the layout comes from the cache
+//              -uncached  a different string every draw, laid out from cached glyphs
+//              -raster    the atlas cleared before every round, every glyph rasterised
+//==========================================================================================
+INTERNAL inline
+void benchmark_text(Font* font, u32 draws = 20000) {
+	BMT_LOG(INFO, "Text benchmark, %s font", font->scale ? "built-in" : "FreeType");
+	std::vector<VertexData> vertices(BATCH_MAX_SPRITES * 4);
+	QuadBatch scratch = { 0 };
+	scratch.maxtextures = BATCH_MAX_TEXTURES - 1;
+
+	std::vector<std::string> labels;
+	char text[64];
+	for (u32 i = 0; i < 64; ++i) {
+		snprintf(text, sizeof(text), "pass %-12d draws %6d tris %8d", i, i * 37, i * 4099);
+		labels.push_back(text);
+	}
+	std::vector<std::string> unique;
+	for (u32 i = 0; i < draws; ++i) {
+		snprintf(text, sizeof(text), "frame %8d cpu %6.3f ms gpu %6.3f ms", i, i * 0.001f, i * 0.0007f);
+		unique.push_back(text);
+	}
+
+	//warm the glyph cache so the first two runs don't include rasterisation
+	for (u32 i = 0; i < labels.size(); ++i)
+		get_text_layout(font, labels[i].c_str());
+	get_text_layout(font, unique[0].c_str());
+
+	for (u32 run = 0; run < 2; ++run) {
+		u64 glyphs = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < draws; ++i) {
+			const std::string& line = run == 0 ? labels[i % labels.size()] : unique[i];
+			if (quad_batch_room(&scratch) < line.size()) {
+				scratch.indexcount = 0;
+				scratch.texcount = 0;
+			}
+			if (scratch.indexcount == 0)
+				scratch.buffer = &vertices[0];
+			draw_text(&scratch, font, line.c_str(), 10, 10, V4(255, 255, 255, 255));
+			glyphs += line.size();
+		}
+		f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+		BMT_LOG(INFO, "    %-9s %8.3f ms %10.0f glyphs/ms", run == 0 ? "cached" : "uncached", ms, glyphs / ms);
+	}
+
+	std::string ascii;
+	for (char c = 33; c < 127; ++c)
+		ascii += c;
+	u32 rounds = 64;
+	auto start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < rounds; ++i) {
+		reset_glyph_atlas(font->atlas);
+		get_text_layout(font, ascii.c_str());
+	}
+	f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+	BMT_LOG(INFO, "    %-9s %8.3f ms %10.0f glyphs/ms", "raster", ms, rounds * ascii.size() / ms);
+	reset_glyph_atlas(font->atlas);
+}
+
+#endif
@@ -30,6 +30,9 @@
 #define TEXTURE_H
 
 #include "defines.h"
+#include "profiler.h"
+#include "render_stats.h"
+#include "window.h"
 #include <vector>
 #include <SOIL.h>
 
@@ -88,6 +91,7 @@ void dispose_texture(Texture& texture) {
 
 INTERNAL inline
 Texture load_texture(const char* filepath, u16 param) {
+    BMT_PROFILE_FUNCTION();
     Texture texture;
     glGenTextures(1, &texture.ID);
     glBindTexture(GL_TEXTURE_2D, texture.ID);
@@ -130,6 +134,7 @@ INTERNAL inline
 void bind_texture(Texture texture, u32 slot) {
     glActiveTexture(GL_TEXTURE0 + slot);
     glBindTexture(GL_TEXTURE_2D, texture.ID);
+    BMT_STAT_ADD(STAT_TEXTURE_BINDS, 1);
 }
 
 INTERNAL inline
@@ -173,6 +178,12 @@ void set_texture_wrap_y(Texture texture, u32 type) {
 struct Framebuffer {
     GLuint ID;
     Texture texture;
+    //only set by create_scene_buffer(), the other buffers keep their depth in a renderbuffer
+    Texture depth;
+    GLuint renderbuffer;
+    //multisampled buffers render into renderbuffers and only keep the size in texture
+    GLuint colorbuffer;
+    u32 samples;
 };
 
 #define DEPTHBUFFER 0
@@ -182,7 +193,7 @@ INTERNAL inline
 Framebuffer create_framebuffer(u32 width, u32 height, u16 param, u8 buffertype) {
     assert(buffertype < 2);
 
-    Framebuffer buffer;
+    Framebuffer buffer = { 0 };
     buffer.texture.width = width;
     buffer.texture.height = height;
     buffer.texture.flip_flag = 0;
@@ -214,11 +225,14 @@ Framebuffer create_framebuffer(u32 width, u32 height, u16 param, u8 buffertype)
         glReadBuffer(GL_NONE);
     }
 
-    GLuint depthBuffer;
-    glGenRenderbuffers(1, &depthBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    //a depth buffer already has its depth texture, attaching a renderbuffer would replace it
+    if (buffertype == COLORBUFFER) {
+        glGenRenderbuffers(1, &buffer.renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, buffer.renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, buffer.renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
         BMT_LOG(INFO, "Framebuffer #%d successfully created", buffer.ID);
@@ -226,7 +240,7 @@ Framebuffer create_framebuffer(u32 width, u32 height, u16 param, u8 buffertype)
     else {
         BMT_LOG(WARNING, "Framebuffer #%d not complete!", buffer.ID);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, get_default_framebuffer());
     return buffer;
 }
 
@@ -240,20 +254,121 @@ Framebuffer create_depth_buffer(u32 width, u32 height, u16 param) {
     return create_framebuffer(width, height, param, DEPTHBUFFER);
 }
 
+//==========================================================================================
+//Description: Creates a framebuffer with a color texture and a depth texture
+//
+//Comments: Both attachments can be sampled after rendering, e.g. to read the scene's
+//          depth in a later pass. The depth texture uses nearest filtering.
+//==========================================================================================
+INTERNAL inline
+Framebuffer create_scene_buffer(u32 width, u32 height, u16 param) {
+    Framebuffer buffer = { 0 };
+    Texture* textures[] = { &buffer.texture, &buffer.depth };
+    for (u32 i = 0; i < 2; ++i) {
+        Texture* texture = textures[i];
+        texture->width = width;
+        texture->height = height;
+        texture->flip_flag = 0;
+        glGenTextures(1, &texture->ID);
+        glBindTexture(GL_TEXTURE_2D, texture->ID);
+        if (i == 0)
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, i == 0 ? param : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, i == 0 ? param : GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &buffer.ID);
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer.ID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.texture.ID, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, buffer.depth.ID, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+        BMT_LOG(INFO, "Framebuffer #%d successfully created", buffer.ID);
+    }
+    else {
+        BMT_LOG(WARNING, "Framebuffer #%d not complete!", buffer.ID);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, get_default_framebuffer());
+    return buffer;
+}
+
+//==========================================================================================
+//Description: Creates a multisampled framebuffer with color and depth renderbuffers
+//
+//Comments: Renderbuffers can't be sampled, blit_framebuffer() resolves the buffer into a
+//          single sampled one of the same size first
+//==========================================================================================
+INTERNAL inline
+Framebuffer create_multisample_buffer(u32 width, u32 height, u32 samples) {
+    Framebuffer buffer = { 0 };
+    buffer.texture.width = width;
+    buffer.texture.height = height;
+    buffer.samples = samples;
+
+    glGenFramebuffers(1, &buffer.ID);
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer.ID);
+    glGenRenderbuffers(1, &buffer.colorbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, buffer.colorbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffer.colorbuffer);
+    glGenRenderbuffers(1, &buffer.renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, buffer.renderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, buffer.renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+        BMT_LOG(INFO, "Framebuffer #%d successfully created", buffer.ID);
+    }
+    else {
+        BMT_LOG(WARNING, "Framebuffer #%d not complete!", buffer.ID);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, get_default_framebuffer());
+    return buffer;
+}
+
 INTERNAL inline
 void dispose_framebuffer(Framebuffer buffer) {
-    dispose_texture(buffer.texture);
+    if (buffer.texture.ID)
+        dispose_texture(buffer.texture);
+    if (buffer.depth.ID)
+        dispose_texture(buffer.depth);
+    if (buffer.renderbuffer)
+        glDeleteRenderbuffers(1, &buffer.renderbuffer);
+    if (buffer.colorbuffer)
+        glDeleteRenderbuffers(1, &buffer.colorbuffer);
     glDeleteFramebuffers(1, &buffer.ID);
 }
 
+//==========================================================================================
+//Description: Copies the attachments selected by mask from one framebuffer to another
+//
+//Comments: Both framebuffers must be the same size. Leaves the window framebuffer bound
+//==========================================================================================
+INTERNAL inline
+void blit_framebuffer(Framebuffer source, Framebuffer dest, GLbitfield mask) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source.ID ? source.ID : get_default_framebuffer());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dest.ID ? dest.ID : get_default_framebuffer());
+    glBlitFramebuffer(0, 0, source.texture.width, source.texture.height, 0, 0, dest.texture.width, dest.texture.height, mask, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, get_default_framebuffer());
+}
+
 INTERNAL inline
 void bind_framebuffer(Framebuffer buffer) {
-    glBindFramebuffer(GL_FRAMEBUFFER, buffer.ID);
+    //an empty Framebuffer is the window
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer.ID ? buffer.ID : get_default_framebuffer());
+    BMT_STAT_ADD(STAT_FRAMEBUFFER_BINDS, 1);
 }
 
 INTERNAL inline
 void unbind_framebuffer() {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, get_default_framebuffer());
+    BMT_STAT_ADD(STAT_FRAMEBUFFER_BINDS, 1);
 }
 
 //==========================================================================================
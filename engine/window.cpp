@@ -27,9 +27,30 @@
 ///////////////////////////////////////////////////////////////////////////
 
 #include <thread>
+#include <chrono>
 #include "window.h"
+#include "profiler.h"
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
 
 GLOBAL GLFWwindow* glfw_window;
+
+//headless backend, the window is an offscreen framebuffer standing in for framebuffer 0
+GLOBAL bool headless;
+GLOBAL bool headlessShouldClose;
+GLOBAL GLuint headlessFramebuffer;
+GLOBAL GLuint headlessColor;
+GLOBAL GLuint headlessDepth;
+GLOBAL std::chrono::steady_clock::time_point headlessStart;
+#if defined(__linux__)
+GLOBAL EGLDisplay eglDisplay;
+GLOBAL EGLContext eglContext;
+#endif
 GLOBAL i32 winVirtualWidth;
 GLOBAL i32 winVirtualHeight;
 GLOBAL i32 winx;
@@ -63,6 +84,14 @@ GLOBAL f64 lastScrollX;
 GLOBAL f64 lastScrollY;
 
 //TODO: implement the GUI into this engine.
+//glfwGetTime() needs glfwInit(), which fails without a display
+INTERNAL
+f64 window_time() {
+	if (headless)
+		return std::chrono::duration<f64>(std::chrono::steady_clock::now() - headlessStart).count();
+	return glfwGetTime();
+}
+
 INTERNAL
 void keycallback(GLFWwindow* win, int key, int scancode, int action, int mods) {
 	keys[key] = action;
@@ -116,29 +145,20 @@ void scrollCallback(GLFWwindow* win, double xoffset, double yoffset) {
 	lastScrollY = yoffset;
 }
 
-void init_window(int window_width, int window_height, const char* title, bool fullscreen, bool resizable, bool primary_monitor) {
-	winwidth = window_width;
-	winheight = window_height;
-	winVirtualWidth = winwidth;
-	winVirtualHeight = winheight;
-
-	lastKeyPressed = lastButtonPressed = 0;
-	lastScrollX = 0;
-	lastScrollY = 0;
-
+INTERNAL
+bool init_glfw_window(const char* title, bool fullscreen, bool resizable, bool primary_monitor) {
 	//INIT GLFW
 	if (!glfwInit()) {
 		BMT_LOG(MINOR_ERROR, "GLFW could not initialize");
+		return false;
 	}
-	else {
-		BMT_LOG(INFO, "GLFW has initialized");
+	BMT_LOG(INFO, "GLFW has initialized");
+	if (glfwGetPrimaryMonitor() == NULL) {
+		BMT_LOG(MINOR_ERROR, "GLFW found no monitor");
+		glfwTerminate();
+		return false;
 	}
 
-	for (int i = 0; i < MAX_KEYS; ++i)
-		keys[i] = -1;
-	for (int i = 0; i < MAX_BUTTONS; ++i)
-		buttons[i] = -1;
-
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
     glfwWindowHint(GLFW_SAMPLES, 4);
@@ -156,6 +176,7 @@ void init_window(int window_width, int window_height, const char* title, bool fu
 		if (!glfw_window) {
 			BMT_LOG(MINOR_ERROR, "Windowed Window failed to be created");
 			glfwTerminate();
+			return false;
 		}
 		winx = winy = 0;
 
@@ -174,6 +195,7 @@ void init_window(int window_width, int window_height, const char* title, bool fu
 		if (!glfw_window) {
 			BMT_LOG(MINOR_ERROR, "Windowed Window failed to be created");
 			glfwTerminate();
+			return false;
 		}
 		winx = winy = 0;
 
@@ -195,6 +217,119 @@ void init_window(int window_width, int window_height, const char* title, bool fu
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
 		BMT_LOG(FATAL_ERROR, "Failed to initialize GLAD\n");
 	}
+
+	glfwSetKeyCallback(glfw_window, keycallback);
+	glfwSetWindowSizeCallback(glfw_window, resizeCallback);
+	glfwSetMouseButtonCallback(glfw_window, mouseButtonCallback);
+	glfwSetCursorPosCallback(glfw_window, cursorPosCallback);
+	glfwSetCharCallback(glfw_window, char_callback);
+	glfwSetScrollCallback(glfw_window, scrollCallback);
+	return true;
+}
+
+//(re)allocates the offscreen framebuffer that stands in for the window
+INTERNAL
+void resize_headless_framebuffer() {
+	glBindRenderbuffer(GL_RENDERBUFFER, headlessColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, winwidth, winheight);
+	glBindRenderbuffer(GL_RENDERBUFFER, headlessDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, winwidth, winheight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+//==========================================================================================
+//Description: Creates an offscreen GL 3.3 core context with no display, through EGL on
+//             Mesa's surfaceless platform (llvmpipe when there is no GPU either)
+//
+//Comments: There is no default framebuffer without a surface, so one is made up and
+//          get_default_framebuffer() hands it out wherever framebuffer 0 would be bound
+//==========================================================================================
+INTERNAL
+bool init_headless_context() {
+#if defined(__linux__)
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	eglDisplay = EGL_NO_DISPLAY;
+	if (getPlatformDisplay)
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+		BMT_LOG(MINOR_ERROR, "EGL could not initialize");
+		return false;
+	}
+	BMT_LOG(INFO, "EGL %d.%d has initialized", major, minor);
+
+	EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint configCount = 0;
+	eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount);
+	eglBindAPI(EGL_OPENGL_API);
+	EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	//surfaceless displays may have no configs at all, EGL_KHR_no_config_context covers that
+	eglContext = eglCreateContext(eglDisplay, configCount ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+		BMT_LOG(MINOR_ERROR, "EGL could not create a GL 3.3 context (0x%x)", eglGetError());
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+		BMT_LOG(FATAL_ERROR, "Failed to initialize GLAD\n");
+	}
+
+	glGenRenderbuffers(1, &headlessColor);
+	glGenRenderbuffers(1, &headlessDepth);
+	resize_headless_framebuffer();
+	glGenFramebuffers(1, &headlessFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, headlessFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headlessColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headlessDepth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		BMT_LOG(WARNING, "Headless framebuffer #%d not complete!", headlessFramebuffer);
+	glViewport(0, 0, winwidth, winheight);
+
+	headless = true;
+	headlessShouldClose = false;
+	headlessStart = std::chrono::steady_clock::now();
+	return true;
+#else
+	BMT_LOG(MINOR_ERROR, "The headless backend needs EGL, which is only used on Linux");
+	return false;
+#endif
+}
+
+void init_window(int window_width, int window_height, const char* title, bool fullscreen, bool resizable, bool primary_monitor, WindowBackend backend) {
+	winwidth = window_width;
+	winheight = window_height;
+	winVirtualWidth = winwidth;
+	winVirtualHeight = winheight;
+
+	lastKeyPressed = lastButtonPressed = 0;
+	lastScrollX = 0;
+	lastScrollY = 0;
+
+	for (int i = 0; i < MAX_KEYS; ++i)
+		keys[i] = -1;
+	for (int i = 0; i < MAX_BUTTONS; ++i)
+		buttons[i] = -1;
+
+	headless = false;
+	if (backend == WINDOW_BACKEND_GLFW && !init_glfw_window(title, fullscreen, resizable, primary_monitor)) {
+		BMT_LOG(WARNING, "No window could be opened, falling back to the headless backend");
+		backend = WINDOW_BACKEND_HEADLESS;
+	}
+	if (backend == WINDOW_BACKEND_HEADLESS && !init_headless_context()) {
+		BMT_LOG(FATAL_ERROR, "No OpenGL context could be created");
+		return;
+	}
+
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
@@ -202,19 +337,26 @@ void init_window(int window_width, int window_height, const char* title, bool fu
 	BMT_LOG(INFO, "GLSL Version: %s", glGetString(GL_SHADING_LANGUAGE_VERSION));
 	BMT_LOG(INFO, "OpenGL Vendor: %s", glGetString(GL_VENDOR));
 	BMT_LOG(INFO, "Graphics Card: %s", glGetString(GL_RENDERER));
+}
 
-	glfwSetKeyCallback(glfw_window, keycallback);
-	glfwSetWindowSizeCallback(glfw_window, resizeCallback);
-	glfwSetMouseButtonCallback(glfw_window, mouseButtonCallback);
-	glfwSetCursorPosCallback(glfw_window, cursorPosCallback);
-	glfwSetCharCallback(glfw_window, char_callback);
-	glfwSetScrollCallback(glfw_window, scrollCallback);
+bool is_headless() {
+	return headless;
+}
+
+GLuint get_default_framebuffer() {
+	return headlessFramebuffer;
+}
+
+void read_window_pixels(u8* pixels) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, get_default_framebuffer());
+	glReadPixels(0, 0, winwidth, winheight, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 }
 
 void set_window_pos(int window_x, int window_y) {
 	winx = window_x;
 	winy = window_y;
-	glfwSetWindowPos(glfw_window, winx, winy);
+	if (!headless)
+		glfwSetWindowPos(glfw_window, winx, winy);
 }
 
 void set_window_size(int window_width, int window_height) {
@@ -222,7 +364,10 @@ void set_window_size(int window_width, int window_height) {
 	if (window_height < 1) window_height = 1;
 	winwidth = window_width;
 	winheight = window_height;
-	glfwSetWindowSize(glfw_window, winwidth, winheight);
+	if (headless)
+		resize_headless_framebuffer();
+	else
+		glfwSetWindowSize(glfw_window, winwidth, winheight);
 }
 
 void set_clear_color(float r, float g, float b, float a) {
@@ -234,14 +379,22 @@ void set_clear_color(vec4 color) {
 }
 
 void begin_drawing() {
-	currentTime = glfwGetTime();
+	currentTime = window_time();
 	updateTime = currentTime - previousTime;
 	previousTime = currentTime;
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void end_drawing() {
+void swap_window_buffers() {
+	//nothing is presented headless, the frame stays in the framebuffer for read_window_pixels()
+	if (headless)
+		return;
+	BMT_PROFILE_ZONE("glfwSwapBuffers");
+	glfwSwapBuffers(glfw_window);
+}
+
+void poll_window_events() {
 	for (int i = 0; i < MAX_KEYS; ++i) {
 		keys[i] = -1;
 	}
@@ -255,31 +408,59 @@ void end_drawing() {
 	lastScrollX = 0;
 	lastScrollY = 0;
 
-	glfwSwapBuffers(glfw_window);
+	if (headless)
+		return;
+	BMT_PROFILE_ZONE("glfwPollEvents");
 	glfwPollEvents();
+}
+
+void make_gl_context_current() {
+#if defined(__linux__)
+	if (headless) {
+		eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext);
+		return;
+	}
+#endif
+	glfwMakeContextCurrent(glfw_window);
+}
 
-	currentTime = glfwGetTime();
+void release_gl_context() {
+#if defined(__linux__)
+	if (headless) {
+		eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		return;
+	}
+#endif
+	glfwMakeContextCurrent(NULL);
+}
+
+void end_drawing() {
+	swap_window_buffers();
+	poll_window_events();
+
+	currentTime = window_time();
 	drawTime = currentTime - previousTime;
 	previousTime = currentTime;
 
 	frameTime = updateTime + drawTime;
 	if (frameTime < targetTime)
 	{
-		double prevTime = glfwGetTime();
+		BMT_PROFILE_ZONE("fps cap wait");
+		double prevTime = window_time();
 		double nextTime = 0.0;
 
 #if defined(_BUSY_WAIT)
 		// Busy wait loop
-		while ((nextTime - prevTime) < ((targetTime - frameTime)*1000.0f) / 1000.0f) nextTime = glfwGetTime();
+		while ((nextTime - prevTime) < ((targetTime - frameTime)*1000.0f) / 1000.0f) nextTime = window_time();
 #elif defined(_WIN32) || defined(_WIN64)
 		Sleep((DWORD)((targetTime - frameTime)*1000.0f));
-#elif defined(__LINUX__)
+#elif defined(__linux__)
 		usleep((targetTime - frameTime)*1000.0f);
 #elif defined(__APPLE__)
 		usleep((targetTime - frameTime)*1000.0f);
 #endif
 
-		currentTime = glfwGetTime();
+		currentTime = window_time();
 		double extraTime = currentTime - previousTime;
 		previousTime = currentTime;
 
@@ -293,11 +474,12 @@ void end_drawing() {
 		framecount = 0;
 	}
 #endif
+	BMT_PROFILE_FRAME();
 
 }
 
 double get_elapsed_time() {
-	return glfwGetTime();
+	return window_time();
 }
 
 void set_fps_cap(double FPS) {
@@ -306,10 +488,14 @@ void set_fps_cap(double FPS) {
 }
 
 bool window_closed() {
+	if (headless)
+		return headlessShouldClose;
 	return glfwWindowShouldClose(glfw_window) == 1;
 }
 
 bool window_open() {
+	if (headless)
+		return !headlessShouldClose;
 	return glfwWindowShouldClose(glfw_window) == 0;
 }
 
@@ -381,6 +567,8 @@ bool is_button_released(unsigned int button) {
 }
 
 bool is_key_down(unsigned int keycode) {
+	if (headless)
+		return false;
 	if (glfwGetKey(glfw_window, keycode) == 1) {
 		return true;
 	}
@@ -388,6 +576,8 @@ bool is_key_down(unsigned int keycode) {
 }
 
 bool is_button_down(unsigned int button) {
+	if (headless)
+		return false;
 	if (glfwGetMouseButton(glfw_window, button) == 1) {
 		return true;
 	}
@@ -395,6 +585,8 @@ bool is_button_down(unsigned int button) {
 }
 
 bool is_key_up(unsigned int keycode) {
+	if (headless)
+		return true;
 	if (glfwGetKey(glfw_window, keycode) == 0) {
 		return true;
 	}
@@ -402,6 +594,8 @@ bool is_key_up(unsigned int keycode) {
 }
 
 bool is_button_up(unsigned int button) {
+	if (headless)
+		return true;
 	if (glfwGetMouseButton(glfw_window, button) == 0) {
 		return true;
 	}
@@ -409,6 +603,8 @@ bool is_button_up(unsigned int button) {
 }
 
 void set_vsync(bool vsync) {
+	if (headless)
+		return;
 	if (vsync)
 		glfwSwapInterval(1);
 	else
@@ -452,10 +648,27 @@ vec2 get_mouse_pos(Rect viewport) {
 }
 
 void set_window_should_close(bool shouldClose) {
+	if (headless) {
+		headlessShouldClose = shouldClose;
+		return;
+	}
 	glfwSetWindowShouldClose(glfw_window, shouldClose);
 }
 
 void dispose_window() {
+#if defined(__linux__)
+	if (headless) {
+		glDeleteFramebuffers(1, &headlessFramebuffer);
+		glDeleteRenderbuffers(1, &headlessColor);
+		glDeleteRenderbuffers(1, &headlessDepth);
+		headlessFramebuffer = 0;
+		eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(eglDisplay, eglContext);
+		eglTerminate(eglDisplay);
+		headlessShouldClose = true;
+		return;
+	}
+#endif
 	glfwSetWindowShouldClose(glfw_window, true);
 	glfwDestroyWindow(glfw_window);
 	glfwDefaultWindowHints();
@@ -464,6 +677,8 @@ void dispose_window() {
 
 void set_mouse_state(MouseState state) {
 	mouseState = state;
+	if (headless)
+		return;
 	if (state == MOUSE_LOCKED)
 		glfwSetInputMode(glfw_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	else if (state == MOUSE_HIDDEN)
@@ -473,12 +688,16 @@ void set_mouse_state(MouseState state) {
 }
 
 int get_window_width() {
+	if (headless)
+		return winwidth;
 	int win_width;
 	glfwGetWindowSize(glfw_window, &win_width, 0);
 	return win_width;
 }
 
 int get_window_height() {
+	if (headless)
+		return winheight;
 	int win_height;
 	glfwGetWindowSize(glfw_window, 0, &win_height);
 	return win_height;
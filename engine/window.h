@@ -34,7 +34,7 @@
 #if defined(_WIN32)
 #include <windows.h>
 #endif
-#if defined(__LINUX__)
+#if defined(__linux__)
 #include <unistd.h>
 #endif
 #if defined(__APPLE__)
@@ -47,12 +47,31 @@
 #define MAX_KEYS	1024
 #define MAX_BUTTONS	32
 
-void init_window(int width, int height, const char* title, bool fullscreen, bool resizable, bool primary_monitor);
+enum WindowBackend {
+	//a visible GLFW window, falls back to WINDOW_BACKEND_HEADLESS if there is no display
+	WINDOW_BACKEND_GLFW,
+	//an offscreen GL 3.3 context, for benchmarks on build machines and server side rendering
+	WINDOW_BACKEND_HEADLESS
+};
+
+void init_window(int width, int height, const char* title, bool fullscreen, bool resizable, bool primary_monitor, WindowBackend backend = WINDOW_BACKEND_GLFW);
+bool is_headless();
+//what to bind instead of framebuffer 0 to draw to the window, the offscreen framebuffer when headless
+GLuint get_default_framebuffer();
+//reads back the whole window as RGBA, bottom row first
+void read_window_pixels(u8* pixels);
 
 void set_window_pos(int x, int y);
 void set_window_size(int width, int height);
 void begin_drawing();
 void end_drawing();
+//the two halves of end_drawing(), for when presenting and input live on different threads.
+//Events have to be polled on the thread that created the window
+void swap_window_buffers();
+void poll_window_events();
+//the context is current on one thread at a time, release it before another thread takes it
+void make_gl_context_current();
+void release_gl_context();
 bool window_closed();
 bool window_open();
 
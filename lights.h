@@ -0,0 +1,293 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include "render.h"
+#include "ENGINE/jobs.h"
+
+//Clustered forward lighting for point lights.
+//
+//The view frustum is cut into CLUSTER_X * CLUSTER_Y screen tiles and CLUSTER_Z
+//exponentially spaced depth slices. Every frame the lights are binned into the
+//clusters they touch on the CPU. The depth slices are spread across the job
+//system, and the clusters of a slice are tested against a light sphere four at
+//a time. static.frag then finds its cluster from gl_FragCoord and its view
+//depth, and shades only the lights listed for that cluster.
+//
+//Everything reaches the shader through three buffer textures:
+//		clusterGrid    (RG32UI)  first index and light count of every cluster
+//		clusterIndices (R16UI)   the light lists of all clusters back to back
+//		lightData      (RGBA32F) position + radius, color + intensity per light
+
+#define CLUSTER_X              16
+#define CLUSTER_Y              9
+#define CLUSTER_Z              24
+#define CLUSTER_COUNT          (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define CLUSTER_MAX_LIGHTS     128
+#define MAX_POINT_LIGHTS       4096
+
+struct PointLight {
+    vec3 position;
+    f32 radius;
+    vec3 color;
+    f32 intensity;
+};
+
+struct LightClusters {
+    //the projection the cluster bounds were built for
+    f32 near;
+    f32 far;
+    f32 projX;
+    f32 projY;
+
+    //view space bounds of every cluster, split by component so four can be tested at once
+    std::vector<f32> minX, minY, minZ;
+    std::vector<f32> maxX, maxY, maxZ;
+
+    //view space position and radius of every light this frame
+    std::vector<vec4> viewLights;
+    std::vector<u16> lists;
+    //every light touching the cluster, only the first CLUSTER_MAX_LIGHTS make it into its list
+    std::vector<u32> counts;
+    std::vector<u32> grid;
+    std::vector<u16> indices;
+    std::vector<vec4> lightData;
+
+    GLuint gridBuffer, gridTexture;
+    GLuint indexBuffer, indexTexture;
+    GLuint lightBuffer, lightTexture;
+
+    u32 lightcount;
+    //light indices the last update dropped because their cluster already held CLUSTER_MAX_LIGHTS
+    u32 dropped;
+    u32 fullClusters;
+};
+
+static inline
+void create_light_buffer_texture(GLuint* buffer, GLuint* texture, GLenum format) {
+    glGenBuffers(1, buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+    glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_BUFFER, *texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+static inline
+LightClusters create_light_clusters() {
+    LightClusters clusters;
+    clusters.near = clusters.far = clusters.projX = clusters.projY = 0;
+    clusters.minX.resize(CLUSTER_COUNT); clusters.minY.resize(CLUSTER_COUNT); clusters.minZ.resize(CLUSTER_COUNT);
+    clusters.maxX.resize(CLUSTER_COUNT); clusters.maxY.resize(CLUSTER_COUNT); clusters.maxZ.resize(CLUSTER_COUNT);
+    clusters.lists.resize(CLUSTER_COUNT * CLUSTER_MAX_LIGHTS);
+    clusters.counts.resize(CLUSTER_COUNT);
+    clusters.grid.resize(CLUSTER_COUNT * 2);
+    clusters.lightcount = 0;
+    clusters.dropped = 0;
+    clusters.fullClusters = 0;
+
+    create_light_buffer_texture(&clusters.gridBuffer, &clusters.gridTexture, GL_RG32UI);
+    create_light_buffer_texture(&clusters.indexBuffer, &clusters.indexTexture, GL_R16UI);
+    create_light_buffer_texture(&clusters.lightBuffer, &clusters.lightTexture, GL_RGBA32F);
+    return clusters;
+}
+
+static inline
+void dispose_light_clusters(LightClusters* clusters) {
+    GLuint buffers[] = {clusters->gridBuffer, clusters->indexBuffer, clusters->lightBuffer};
+    GLuint textures[] = {clusters->gridTexture, clusters->indexTexture, clusters->lightTexture};
+    glDeleteBuffers(3, buffers);
+    glDeleteTextures(3, textures);
+}
+
+static inline
+f32 cluster_slice_depth(const LightClusters* clusters, u32 slice) {
+    return clusters->near * powf(clusters->far / clusters->near, (f32)slice / CLUSTER_Z);
+}
+
+//Works out the view space box around every cluster. Only needs to run when the projection changes.
+static inline
+void build_cluster_bounds(LightClusters* clusters, mat4 projection, f32 nearPlane, f32 farPlane) {
+    clusters->near = nearPlane;
+    clusters->far = farPlane;
+    clusters->projX = projection.elements[0];
+    clusters->projY = projection.elements[5];
+
+    for(u32 z = 0; z < CLUSTER_Z; ++z) {
+        f32 d0 = cluster_slice_depth(clusters, z);
+        f32 d1 = cluster_slice_depth(clusters, z + 1);
+        for(u32 y = 0; y < CLUSTER_Y; ++y) {
+            f32 ny0 = -1.0f + 2.0f * y / CLUSTER_Y;
+            f32 ny1 = -1.0f + 2.0f * (y + 1) / CLUSTER_Y;
+            for(u32 x = 0; x < CLUSTER_X; ++x) {
+                f32 nx0 = -1.0f + 2.0f * x / CLUSTER_X;
+                f32 nx1 = -1.0f + 2.0f * (x + 1) / CLUSTER_X;
+                u32 i = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+
+                //the tile widens with depth, so the extremes are on either the near or the far face
+                clusters->minX[i] = fminf(nx0 * d0, nx0 * d1) / clusters->projX;
+                clusters->maxX[i] = fmaxf(nx1 * d0, nx1 * d1) / clusters->projX;
+                clusters->minY[i] = fminf(ny0 * d0, ny0 * d1) / clusters->projY;
+                clusters->maxY[i] = fmaxf(ny1 * d0, ny1 * d1) / clusters->projY;
+                clusters->minZ[i] = -d1;
+                clusters->maxZ[i] = -d0;
+            }
+        }
+    }
+}
+
+static inline
+void bin_lights_into_slices(void* data, u32 begin, u32 end) {
+    BMT_PROFILE_ZONE("bin lights");
+    LightClusters* clusters = (LightClusters*)data;
+
+    for(u32 z = begin; z < end; ++z) {
+        f32 sliceNear = cluster_slice_depth(clusters, z);
+        f32 sliceFar = cluster_slice_depth(clusters, z + 1);
+        u32 first = z * CLUSTER_X * CLUSTER_Y;
+        for(u32 i = first; i < first + CLUSTER_X * CLUSTER_Y; ++i)
+            clusters->counts[i] = 0;
+
+        for(u32 l = 0; l < clusters->lightcount; ++l) {
+            vec4 light = clusters->viewLights[l];
+            f32 depth = -light.z;
+            if(depth + light.w < sliceNear || depth - light.w > sliceFar)
+                continue;
+            f32 radiusSq = light.w * light.w;
+
+#ifdef BMT_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 cx = _mm_set1_ps(light.x);
+            const __m128 cy = _mm_set1_ps(light.y);
+            const __m128 cz = _mm_set1_ps(light.z);
+            const __m128 r2 = _mm_set1_ps(radiusSq);
+            for(u32 i = first; i < first + CLUSTER_X * CLUSTER_Y; i += 4) {
+                //distance from the sphere centre to the nearest point of each box
+                __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusters->minX[i]), cx), zero), _mm_max_ps(_mm_sub_ps(cx, _mm_loadu_ps(&clusters->maxX[i])), zero));
+                __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusters->minY[i]), cy), zero), _mm_max_ps(_mm_sub_ps(cy, _mm_loadu_ps(&clusters->maxY[i])), zero));
+                __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusters->minZ[i]), cz), zero), _mm_max_ps(_mm_sub_ps(cz, _mm_loadu_ps(&clusters->maxZ[i])), zero));
+                __m128 distSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_add_ps(_mm_mul_ps(dy, dy), _mm_mul_ps(dz, dz)));
+                i32 hits = _mm_movemask_ps(_mm_cmple_ps(distSq, r2));
+                if(hits == 0)
+                    continue;
+                for(u32 j = 0; j < 4; ++j) {
+                    u32 c = i + j;
+                    if(!(hits & (1 << j)))
+                        continue;
+                    if(clusters->counts[c] < CLUSTER_MAX_LIGHTS)
+                        clusters->lists[c * CLUSTER_MAX_LIGHTS + clusters->counts[c]] = (u16)l;
+                    clusters->counts[c]++;
+                }
+            }
+#else
+            for(u32 i = first; i < first + CLUSTER_X * CLUSTER_Y; ++i) {
+                f32 dx = fmaxf(clusters->minX[i] - light.x, 0.0f) + fmaxf(light.x - clusters->maxX[i], 0.0f);
+                f32 dy = fmaxf(clusters->minY[i] - light.y, 0.0f) + fmaxf(light.y - clusters->maxY[i], 0.0f);
+                f32 dz = fmaxf(clusters->minZ[i] - light.z, 0.0f) + fmaxf(light.z - clusters->maxZ[i], 0.0f);
+                if(dx * dx + dy * dy + dz * dz > radiusSq)
+                    continue;
+                if(clusters->counts[i] < CLUSTER_MAX_LIGHTS)
+                    clusters->lists[i * CLUSTER_MAX_LIGHTS + clusters->counts[i]] = (u16)l;
+                clusters->counts[i]++;
+            }
+#endif
+        }
+    }
+}
+
+//==========================================================================================
+//Description: Bins the lights into the clusters of one camera and uploads the result
+//
+//Parameters:
+//		-The clusters of this camera
+//		-View and projection matrix of the camera
+//		-Near plane, and the distance past which point lights are ignored
+//		-The lights, in world space
+//==========================================================================================
+static inline
+void update_light_clusters(LightClusters* clusters, mat4 view, mat4 projection, f32 nearPlane, f32 farPlane, const PointLight* lights, u32 count) {
+    BMT_PROFILE_FUNCTION();
+    if(clusters->near != nearPlane || clusters->far != farPlane || clusters->projX != projection.elements[0] || clusters->projY != projection.elements[5])
+        build_cluster_bounds(clusters, projection, nearPlane, farPlane);
+
+    if(count > MAX_POINT_LIGHTS) {
+        BMT_LOG(WARNING, "%d point lights given, only the first %d are used", count, MAX_POINT_LIGHTS);
+        count = MAX_POINT_LIGHTS;
+    }
+    clusters->lightcount = count;
+    clusters->viewLights.resize(count);
+    clusters->lightData.resize(count * 2);
+    const f32* e = view.elements;
+    for(u32 i = 0; i < count; ++i) {
+        vec3 p = lights[i].position;
+        clusters->viewLights[i] = {
+            e[0] * p.x + e[4] * p.y + e[8] * p.z + e[12],
+            e[1] * p.x + e[5] * p.y + e[9] * p.z + e[13],
+            e[2] * p.x + e[6] * p.y + e[10] * p.z + e[14],
+            lights[i].radius
+        };
+        clusters->lightData[i * 2 + 0] = V4(p, lights[i].radius);
+        clusters->lightData[i * 2 + 1] = V4(lights[i].color, lights[i].intensity);
+    }
+
+    parallel_for(CLUSTER_Z, 1, bin_lights_into_slices, clusters);
+
+    //pack every list back to back, every cluster belongs to one slice so the counts are only
+    //read once all the binning jobs are done
+    clusters->indices.clear();
+    clusters->dropped = 0;
+    clusters->fullClusters = 0;
+    for(u32 i = 0; i < CLUSTER_COUNT; ++i) {
+        u32 listed = clusters->counts[i];
+        if(listed > CLUSTER_MAX_LIGHTS) {
+            clusters->dropped += listed - CLUSTER_MAX_LIGHTS;
+            clusters->fullClusters++;
+            listed = CLUSTER_MAX_LIGHTS;
+        }
+        clusters->grid[i * 2 + 0] = clusters->indices.size();
+        clusters->grid[i * 2 + 1] = listed;
+        clusters->indices.insert(clusters->indices.end(), &clusters->lists[i * CLUSTER_MAX_LIGHTS], &clusters->lists[i * CLUSTER_MAX_LIGHTS] + listed);
+    }
+    //buffer textures can't be empty
+    if(clusters->indices.empty())
+        clusters->indices.push_back(0);
+    if(clusters->lightData.empty())
+        clusters->lightData.push_back(V4(0, 0, 0, 0));
+
+    glBindBuffer(GL_TEXTURE_BUFFER, clusters->gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, clusters->grid.size() * sizeof(u32), &clusters->grid[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, clusters->indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, clusters->indices.size() * sizeof(u16), &clusters->indices[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, clusters->lightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, clusters->lightData.size() * sizeof(vec4), &clusters->lightData[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    BMT_STAT_ADD(STAT_BUFFER_BYTES, clusters->grid.size() * sizeof(u32) + clusters->indices.size() * sizeof(u16) + clusters->lightData.size() * sizeof(vec4));
+}
+
+//Logs how many lights the last update binned and how many of them the full clusters dropped.
+static inline
+void dump_light_clusters(LightClusters* clusters, const char* name) {
+    BMT_LOG(INFO, "%s clusters: %d lights, %d light indices dropped from %d full clusters", name, clusters->lightcount, clusters->dropped, clusters->fullClusters);
+}
+
+//Binds the cluster data to three texture slots starting at firstSlot, for a render target of the given size.
+static inline
+void bind_light_clusters(LightClusters* clusters, Shader shader, u32 firstSlot, f32 width, f32 height) {
+    glActiveTexture(GL_TEXTURE0 + firstSlot);
+    glBindTexture(GL_TEXTURE_BUFFER, clusters->gridTexture);
+    glActiveTexture(GL_TEXTURE0 + firstSlot + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, clusters->indexTexture);
+    glActiveTexture(GL_TEXTURE0 + firstSlot + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, clusters->lightTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    upload_int(shader, "clusterGrid", firstSlot);
+    upload_int(shader, "clusterIndices", firstSlot + 1);
+    upload_int(shader, "lightData", firstSlot + 2);
+    upload_vec2(shader, "clusterScreenSize", V2(width, height));
+    upload_float(shader, "clusterNear", clusters->near);
+    upload_float(shader, "clusterFar", clusters->far);
+}
+
+#endif
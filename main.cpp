@@ -10,23 +10,202 @@
 #include "ENGINE/shader.h"
 #include "ENGINE/texture.h"
 #include "ENGINE/render2D.h"
+#include "ENGINE/gpu_profiler.h"
+#include "ENGINE/profiler.h"
+#include "ENGINE/jobs.h"
+#include "ENGINE/occlusion.h"
+#include "ENGINE/ocean.h"
+#include "ENGINE/ripples.h"
+#include "ENGINE/cdlod.h"
+#include "ENGINE/noise.h"
+#include "ENGINE/render_targets.h"
+#include "ENGINE/frame_graph.h"
+#include "ENGINE/particles.h"
 #include <stdlib.h>
 #include <time.h>
+#include <chrono>
 #include "render.h"
+#include "shadows.h"
+#include "lights.h"
+#include "terrain.h"
+#include "animation.h"
+#include "vertex_animation.h"
 #include "map_editor.h"
 
 #define RENDER_WIDTH 800.0f
 #define RENDER_HEIGHT 600.0f
 
+//THE FIRST FLEET_SIZE MODELS OF THE SCENE ARE SHIPS, THE REST FOLLOW AT FIXED INDICES
+#define FLEET_SIZE 120
+#define PALM_INDEX  (FLEET_SIZE + 0)
+#define ROCK_INDEX  (FLEET_SIZE + 1)
+#define TOWER_INDEX (FLEET_SIZE + 2)
+//MODELS PER COMMAND BUFFER WHEN THE SCENE IS RECORDED ACROSS THE JOB SYSTEM
+#define SCENE_CHUNK 16
+//SMALLEST OCCLUDER BOX WORTH RASTERIZING, IN MODEL UNITS (THE SCENE DRAWS MODELS AT A QUARTER SCALE)
+#define MIN_OCCLUDER_SIZE 8.0f
+
+//ONE ANIMATED PIRATE STANDING ON THE DECK OF A SHIP
+struct CrewMember {
+    u32 pirate;
+    u32 ship;
+    u32 animation;
+};
+
+//EVERYTHING THE PASSES OF ONE FRAME NEED, HANDED TO EACH OF THEM BY THE FRAME GRAPH
+struct FrameContext {
+    mat4 projection;
+    mat4 view;
+    mat4 reflectedView;
+    vec3 camera;
+    vec3 reflectedCamera;
+    vec3 sunDirection;
+    //WINDOW SIZE FROM THE SNAPSHOT, GLFW ONLY ANSWERS ON THE MAIN THREAD
+    i32 width;
+    i32 height;
+
+    Shader basic;
+    Shader prepass;
+    bool depthPrepass;
+    bool renderStats;
+    ModelUniforms basicUniforms;
+    ModelUniforms prepassUniforms;
+    //ONE COLOR AND ONE DEPTH BUFFER PER SCENE CHUNK
+    std::vector<CommandBuffer>* colorCommands;
+    std::vector<CommandBuffer>* depthCommands;
+    Shader water;
+    Shader present;
+    std::vector<Model>* scene;
+    bool* visible;
+    bool occlusionCulling;
+    OcclusionBuffer* reflectionOcclusion;
+    OcclusionBuffer* mainOcclusion;
+    std::vector<PointLight>* lights;
+    LightClusters* reflectionClusters;
+    LightClusters* mainClusters;
+    ShadowCascades* shadows;
+    Terrain* terrain;
+    CDLOD* waterLod;
+    Ocean* ocean;
+    RippleField* ripples;
+    Texture dudvMap;
+    f32 moveFactor;
+    QuadBatch* batch;
+    Font* font;
+    GPUProfiler* gpuProfiler;
+    ParticleSystem* particles;
+    Shader skinned;
+    SkinnedModel* pirates;
+    std::vector<CrewMember>* crew;
+    Animator* animator;
+    Shader vat;
+    VertexAnimation* crowd;
+    std::vector<VertexAnimationInstance>* crowdInstances;
+    f32 crowdTime;
+
+    //FRAME GRAPH RESOURCES
+    u32 reflection;
+    u32 sceneBuffer;
+    u32 refraction;
+};
+
+//ONE-SHOT REQUESTS FROM THE KEYBOARD THAT HAVE TO RUN ON THE RENDER THREAD
+enum RenderRequest {
+    REQUEST_GPU_DUMP,
+    REQUEST_TRACE_EXPORT,
+    REQUEST_GRAPH_DUMP,
+    REQUEST_OCEAN_BENCHMARK,
+    REQUEST_NOISE_BENCHMARK,
+    REQUEST_PARTICLE_BENCHMARK,
+    REQUEST_ANIMATION_BENCHMARK,
+    REQUEST_GL_CAPTURE,
+    REQUEST_TEXT_BENCHMARK,
+    REQUEST_COUNT
+};
+
+//WHAT THE SIMULATION HANDS THE RENDER THREAD EVERY TICK, NEVER WRITTEN AGAIN ONCE PUBLISHED
+struct SceneSnapshot {
+    u64 tick;
+    Camera camera;
+    f32 sunAngle;
+    bool occlusionCulling;
+    bool depthPrepass;
+    bool renderStats;
+    //THE RENDER THREAD CAN'T ASK GLFW FOR THE WINDOW SIZE ITSELF
+    i32 width;
+    i32 height;
+    //TRANSFORMS OF THE SAILING MODELS, THE SWELL IS ADDED ON THE RENDER THREAD WHERE THE OCEAN IS STEPPED
+    std::vector<vec3> positions;
+    std::vector<vec3> rotations;
+    //REQUESTS COUNT UP INSTEAD OF BEING FLAGS, SO A SNAPSHOT THE RENDER THREAD SKIPPED CAN'T SWALLOW ONE
+    u32 requests[REQUEST_COUNT];
+};
+
+//OWNED BY THE RENDER THREAD ONCE IT STARTS
+struct RenderState {
+    //EVERYTHING THAT LIVES AS LONG AS THE RENDERER, COPIED INTO EVERY FRAME'S CONTEXT
+    FrameContext resources;
+    TripleBuffer* snapshots;
+    RenderTargetPool* targets;
+    FrameGraph* graph;
+    ParticleDesc smoke;
+    ParticleDesc splash;
+    u32* wakes;
+    u64 tick;
+    u32 handled[REQUEST_COUNT];
+    //SET IN BENCHMARK MODE, THE SIMULATION THEN WAITS FOR EVERY TICK TO BE DRAWN BEFORE STEPPING AGAIN
+    Benchmark* benchmark;
+    const char* benchmarkJson;
+    std::atomic<u64> renderedTick;
+    const char* capturePath;
+    u32 captureFrames;
+};
+
+//COMMAND LINE
+//  --benchmark             FLY A CAMERA PATH WITH A FIXED SEED AND PRINT FRAME TIME STATISTICS, THEN QUIT
+//  --path FILE             CAMERA PATH TO FLY INSTEAD OF THE BUILT-IN ORBIT
+//  --seed N --warmup N --frames N --json FILE
+//  --record FILE           SAVE THE CAMERA OF AN INTERACTIVE SESSION AS A PATH, ONE KEY A SECOND
+//  --capture FILE          INSTALL THE GL CAPTURE LAYER, F12 (OR --capture-at TICK) RECORDS --capture-frames N FRAMES
+//                          INTO FILE FOR tools/gl_replay
+//  --font FILE             FONT OF THE OVERLAYS (NEEDS BMT_FREETYPE), THE BUILT-IN PIXEL FONT OTHERWISE
+struct Options {
+    bool benchmark;
+    const char* path;
+    u32 seed;
+    u32 warmup;
+    u32 frames;
+    const char* json;
+    const char* record;
+    const char* capture;
+    u32 captureFrames;
+    u64 captureAt;
+    const char* font;
+};
+
 //
 //  PROTOTYPES
 //
 
+Options parse_options(int argc, char** argv);
 void initialize();
 void setup_environment();
 void camera_controls(Camera* cam, vec2* lastPos);
-Model generate_terrain(f32 width, f32 height);
+void render_frame(void* data);
+void simulate_effects(RenderState* state, SceneSnapshot* snapshot, u32 steps);
+void cull_scene(OcclusionBuffer* buffer, mat4 viewProjection, std::vector<Model>& scene, bool enabled, bool* visible);
 Shader load_water_shader();
+void record_scene_chunk(void* data, u32 begin, u32 end);
+void draw_scene(FrameContext* frame, mat4 view);
+void draw_crew(FrameContext* frame, mat4 view, LightClusters* clusters, u32 width, u32 height);
+void shadow_pass(FrameGraph* graph, void* data);
+void reflection_pass(FrameGraph* graph, void* data);
+void main_pass(FrameGraph* graph, void* data);
+void refraction_copy_pass(FrameGraph* graph, void* data);
+void water_pass(FrameGraph* graph, void* data);
+void particle_pass(FrameGraph* graph, void* data);
+void present_pass(FrameGraph* graph, void* data);
+void gui_pass(FrameGraph* graph, void* data);
 
 //
 //  MAIN
@@ -35,28 +214,47 @@ Shader load_water_shader();
 const int WATER_WIDTH = 1600;
 const int WATER_HEIGHT = 1400;
 
-int main() {
-    srand(time(NULL));
+int main(int argc, char** argv) {
+    Options options = parse_options(argc, argv);
+    srand(options.benchmark ? options.seed : time(NULL));
     initialize();
+    if(options.capture)
+        install_gl_capture();
 
     //LOAD SHADERS
     Shader basic = load_shader_3D("data/shaders/static.vert", "data/shaders/static.frag");
+    Shader prepass = load_shader_3D("data/shaders/prepass.vert", "data/shaders/depth.frag");
     Shader water = load_water_shader();
+    Shader present = load_shader_2D("data/shaders/present.vert", "data/shaders/present.frag");
+    start_shader(present);
+    upload_int(present, "scene", 0);
+    stop_shader();
 
     //CREATE QUAD BATCH FOR EFFICIENT GUI RENDERING
-    QuadBatch* batch = &create_quad_batch();
+    QuadBatch quadBatch = create_quad_batch();
+    QuadBatch* batch = &quadBatch;
     batch->shader = load_quad_shader();
     start_shader(batch->shader);
     upload_mat4(batch->shader, "projection", orthographic_projection(0, 0, get_window_width(), get_window_height(), -1, 1));
     stop_shader();
+    //EVERY FONT SHARES ONE GLYPH ATLAS, TEXT NEVER SWITCHES TEXTURES IN THE BATCH
+    GlyphAtlas glyphAtlas = create_glyph_atlas();
+    Font font = options.font ? load_font(&glyphAtlas, options.font, 16) : create_builtin_font(&glyphAtlas, 2);
 
     //LOAD SCENE
-    Model groundModel = generate_terrain(350, 350);
+    //THE WATER IS DRAWN AS RINGS OF INSTANCED GRID TILES THAT GET COARSER AWAY FROM THE CAMERA
+    CDLOD waterLod = create_cdlod(5, 32, 16.0f);
+    waterLod.minHeight = -8.0f;
+    waterLod.maxHeight = 8.0f;
+    init_cdlod_meshes(&waterLod);
     std::vector<Model> scene;
-    scene.push_back(load_model("data/models/ship_light.obj"));
-    scene.push_back(load_model("data/models/ship_light.obj"));
-    scene.push_back(load_model("data/models/ship_light.obj"));
+    //THE SHIPS SHARE ONE LOADED MODEL, COPIES ONLY DUPLICATE THE MESH HANDLES
+    Model ship = load_model("data/models/ship_light.obj");
+    for(int i = 0; i < FLEET_SIZE; ++i)
+        scene.push_back(ship);
     scene.push_back(load_model("data/models/palm_long.obj"));
+    scene.push_back(load_model("data/models/formationLarge_rock.obj"));
+    scene.push_back(load_model("data/models/tower.obj"));
     for(int i = 0; i < scene.size(); ++i) {
         scene[i].scale.x /= 4;
         scene[i].scale.y /= 4;
@@ -65,85 +263,598 @@ int main() {
         scene[i].pos.z = (rand()%(100+100))-100;
         scene[i].rotate.y = (rand()%360);
     }
+    //THE WHOLE FLEET SPREADS FURTHER OUT THAN THE PALM, ROCK AND TOWER
+    for(int i = 0; i < FLEET_SIZE; ++i) {
+        scene[i].pos.x = (rand()%400)-200;
+        scene[i].pos.z = (rand()%400)-200;
+    }
+
+    //THE OCCLUDERS ARE BOXES INSIDE THE RENDER MESHES, ONLY THE ONES BIG ENOUGH TO HIDE SOMETHING ARE REGISTERED
+    Occluder shipOccluder = load_occluder("data/models/ship_light.obj");
+    Occluder rockOccluder = load_occluder("data/models/formationLarge_rock.obj");
+    Occluder towerOccluder = load_occluder("data/models/tower.obj");
+    if(simplify_occluder(&shipOccluder, MIN_OCCLUDER_SIZE))
+        for(int i = 0; i < FLEET_SIZE; ++i)
+            scene[i].occluder = &shipOccluder;
+    if(simplify_occluder(&rockOccluder, MIN_OCCLUDER_SIZE))
+        scene[ROCK_INDEX].occluder = &rockOccluder;
+    if(simplify_occluder(&towerOccluder, MIN_OCCLUDER_SIZE))
+        scene[TOWER_INDEX].occluder = &towerOccluder;
+    scene[ROCK_INDEX].isStatic = true;
+    scene[TOWER_INDEX].isStatic = true;
+
+    OcclusionBuffer reflectionOcclusion = create_occlusion_buffer();
+    OcclusionBuffer mainOcclusion = create_occlusion_buffer();
+    bool* visible = (bool*)malloc(scene.size() * sizeof(bool));
+    bool occlusionCulling = true;
+    bool depthPrepass = false;
+    bool renderStats = false;
+    ModelUniforms basicUniforms = get_model_uniforms(basic);
+    ModelUniforms prepassUniforms = get_model_uniforms(prepass);
+    std::vector<CommandBuffer> colorCommands((scene.size() + SCENE_CHUNK - 1) / SCENE_CHUNK);
+    std::vector<CommandBuffer> depthCommands(colorCommands.size());
 
     vec2 lastMousePos = {0};
     Camera cam = {0};
     cam.y = 5;
 
-    Framebuffer inverse = create_color_buffer(WATER_WIDTH, WATER_HEIGHT, GL_LINEAR);
+    //OFFSCREEN TARGETS ARE HANDED OUT PER FRAME, SO RESIZING REUSES OR RETIRES THEM INSTEAD OF REALLOCATING
+    RenderTargetPool targets = create_render_target_pool();
+    FrameGraph graph;
     Texture dudvMap = load_texture("data/textures/dudv.png", GL_LINEAR);
-    float moveFactor = 0;
 
+    //FFT OCEAN, ONE 100x100 PATCH TILED ACROSS THE WHOLE WATER PLANE
+    Ocean ocean = create_ocean(256, 100.0f, V2(12, 4));
+    init_ocean_textures(&ocean);
+
+    //SHALLOW WATER RIPPLES AROUND THE CAMERA, 128x128 WORLD UNITS
+    RippleField ripples = create_ripple_field(256, 0.5f);
+    init_ripple_texture(&ripples);
+
+    //LANTERNS SCATTERED AROUND THE HARBOUR, PLUS TORCHES RINGING THE TOWER
+    std::vector<PointLight> lights;
+    for(int i = 0; i < 240; ++i) {
+        PointLight lantern;
+        lantern.position = {(f32)(rand()%400) - 200, 1.0f + (rand()%40) / 10.0f, (f32)(rand()%400) - 200};
+        lantern.radius = 8.0f + (rand()%80) / 10.0f;
+        lantern.color = {1.0f, 0.55f + (rand()%30) / 100.0f, 0.2f};
+        lantern.intensity = 6.0f;
+        lights.push_back(lantern);
+    }
+    for(int i = 0; i < 16; ++i) {
+        f32 angle = deg_to_rad(i * 360.0f / 16);
+        PointLight torch;
+        torch.position = scene[TOWER_INDEX].pos + V3(cosf(angle) * 6.0f, 4.0f, sinf(angle) * 6.0f);
+        torch.radius = 10.0f;
+        torch.color = {1.0f, 0.4f, 0.1f};
+        torch.intensity = 10.0f;
+        lights.push_back(torch);
+    }
+    LightClusters reflectionClusters = create_light_clusters();
+    LightClusters mainClusters = create_light_clusters();
+
+    //ISLANDS AROUND THE HARBOUR, CHUNKS ARE GENERATED ON THE JOB SYSTEM AS THE CAMERA NEEDS THEM
+    Terrain terrain;
+    init_terrain(&terrain, "data/textures/heightmap.png", "data/textures/blendmap.png");
+
+    ShadowCascades shadows = create_shadow_cascades();
+    f32 sunAngle = 35;
+
+    //WAKE SPRAY BEHIND EVERY SHIP, PLUS MUZZLE SMOKE AND SPLASHES WHEN A CANNON FIRES
+    ParticleSystem particles = create_particle_system(131072);
+    init_particle_rendering(&particles);
+    particles.sort = true;
+    particles.wind = {1.5f, 0.0f, 0.5f};
+    ParticleDesc spray = {0};
+    spray.velocity = {0.0f, 1.5f, 0.0f};
+    spray.spread = {0.8f, 0.6f, 0.8f};
+    spray.radius = 0.4f;
+    spray.lifeMin = 0.6f;
+    spray.lifeMax = 1.2f;
+    spray.size = 0.08f;
+    spray.growth = 0.05f;
+    spray.gravity = -6.0f;
+    spray.drag = 0.3f;
+    spray.color = {230, 240, 255, 200};
+    ParticleDesc smoke = {0};
+    smoke.velocity = {0.0f, 0.8f, 0.0f};
+    smoke.spread = {1.5f, 0.4f, 1.5f};
+    smoke.radius = 0.3f;
+    smoke.lifeMin = 2.0f;
+    smoke.lifeMax = 4.0f;
+    smoke.size = 0.3f;
+    smoke.growth = 0.6f;
+    smoke.gravity = 0.4f;
+    smoke.drag = 1.2f;
+    smoke.color = {170, 165, 160, 150};
+    ParticleDesc splash = {0};
+    splash.velocity = {0.0f, 7.0f, 0.0f};
+    splash.spread = {1.5f, 2.5f, 1.5f};
+    splash.radius = 0.5f;
+    splash.lifeMin = 0.8f;
+    splash.lifeMax = 1.6f;
+    splash.size = 0.12f;
+    splash.growth = 0.1f;
+    splash.gravity = -9.81f;
+    splash.drag = 0.2f;
+    splash.color = {240, 245, 255, 220};
+    u32 wakes[FLEET_SIZE];
+    for(int i = 0; i < FLEET_SIZE; ++i)
+        wakes[i] = create_particle_emitter(&particles, spray, scene[i].pos, 60.0f);
+
+    //A PIRATE ON EVERY OTHER SHIP, SOME IDLE AND SOME HAULING ROPE, POSED ON THE JOB SYSTEM AND SKINNED ON THE GPU
+    Shader skinned = load_skinned_shader();
+    SkinnedModel pirates[3];
+    pirates[0] = load_skinned_model("data/models/pirate_captain.obj");
+    pirates[1] = load_skinned_model("data/models/pirate_crew.obj");
+    pirates[2] = load_skinned_model("data/models/pirate_officer.obj");
+    Animator animator = create_animator();
+    std::vector<CrewMember> crew;
+    for(int i = 0; i < FLEET_SIZE; i += 2) {
+        CrewMember member;
+        member.pirate = rand() % 3;
+        member.ship = i;
+        SkinnedModel* pirate = &pirates[member.pirate];
+        member.animation = add_animation_instance(&animator, pirate, find_animation_clip(pirate, "idle"), (rand() % 100) / 50.0f);
+        AnimationInstance* instance = &animator.instances[member.animation];
+        instance->blendClip = find_animation_clip(pirate, "haul");
+        instance->speed = 0.8f + (rand() % 40) / 100.0f;
+        crew.push_back(member);
+    }
+
+    //CROWDS ON THE BEACHES ARE TOO MANY TO SKIN, THEY PLAY BAKED VERTEX ANIMATION IN ONE INSTANCED DRAW
+    Shader vat = load_vertex_animation_shader();
+    VertexAnimation crowd = bake_vertex_animation(&pirates[1]);
+    init_vertex_animation(&crowd);
+    std::vector<VertexAnimationInstance> crowdInstances;
+    for(int i = 0; i < terrain.islandCount; ++i) {
+        Island* island = &terrain.islands[i];
+        for(int j = 0; j < 40 && crowdInstances.size() < 20 * (i + 1); ++j) {
+            f32 angle = (rand() % 360) * PI / 180.0f;
+            f32 distance = island->radius * (0.5f + (rand() % 30) / 100.0f);
+            f32 x = island->center.x + cosf(angle) * distance;
+            f32 z = island->center.y + sinf(angle) * distance;
+            f32 y = terrain_height(&terrain, x, z);
+            if(y < 0.3f)
+                continue;
+            VertexAnimationInstance instance;
+            instance.position = V3(x, y, z);
+            instance.heading = rand() % 360;
+            instance.scale = 0.9f + (rand() % 20) / 100.0f;
+            instance.clip = crowdInstances.size() % crowd.clips.size();
+            instance.timeOffset = (rand() % 100) / 25.0f;
+            instance.speed = 0.8f + (rand() % 40) / 100.0f;
+            crowdInstances.push_back(instance);
+        }
+    }
+
+    GPUProfiler gpuProfiler;
+    init_gpu_profiler(&gpuProfiler);
+
+    //FROM HERE ON THIS THREAD ONLY POLLS INPUT AND SAILS THE SHIPS, THE RENDER THREAD OWNS THE GL CONTEXT
+    //AND DRAWS WHATEVER SNAPSHOT WAS PUBLISHED LAST, SO SLOW DRIVER CALLS NO LONGER HOLD UP THE SIMULATION
+    RenderState state;
+    FrameContext* resources = &state.resources;
+    resources->basic = basic;
+    resources->prepass = prepass;
+    resources->basicUniforms = basicUniforms;
+    resources->prepassUniforms = prepassUniforms;
+    resources->colorCommands = &colorCommands;
+    resources->depthCommands = &depthCommands;
+    resources->water = water;
+    resources->present = present;
+    //THE RENDER THREAD DRAWS ITS OWN COPY OF THE SCENE, THE MESHES ARE SHARED HANDLES
+    std::vector<Model> renderScene = scene;
+    resources->scene = &renderScene;
+    resources->visible = visible;
+    resources->reflectionOcclusion = &reflectionOcclusion;
+    resources->mainOcclusion = &mainOcclusion;
+    resources->lights = &lights;
+    resources->reflectionClusters = &reflectionClusters;
+    resources->mainClusters = &mainClusters;
+    resources->shadows = &shadows;
+    resources->terrain = &terrain;
+    resources->waterLod = &waterLod;
+    resources->ocean = &ocean;
+    resources->ripples = &ripples;
+    resources->dudvMap = dudvMap;
+    resources->batch = batch;
+    resources->font = &font;
+    resources->gpuProfiler = &gpuProfiler;
+    resources->particles = &particles;
+    resources->skinned = skinned;
+    resources->pirates = pirates;
+    resources->crew = &crew;
+    resources->animator = &animator;
+    resources->vat = vat;
+    resources->crowd = &crowd;
+    resources->crowdInstances = &crowdInstances;
+    state.targets = &targets;
+    state.graph = &graph;
+    state.smoke = smoke;
+    state.splash = splash;
+    state.wakes = wakes;
+    state.tick = 0;
+    state.renderedTick.store(0);
+    state.benchmark = NULL;
+    state.benchmarkJson = options.json;
+    state.capturePath = options.capture;
+    state.captureFrames = options.captureFrames;
+    memset(state.handled, 0, sizeof(state.handled));
+
+    SceneSnapshot slots[3];
+    TripleBuffer snapshots;
+    init_triple_buffer(&snapshots, &slots[0], &slots[1], &slots[2]);
+    state.snapshots = &snapshots;
+    u32 requests[REQUEST_COUNT] = {0};
+    u64 tick = 0;
+
+    //A BENCHMARK FLIES A FIXED PATH WITH NO VSYNC, ONE SIMULATION TICK PER FRAME
+    Benchmark benchmark = create_benchmark(options.seed, options.warmup, options.frames);
+    CameraPath cameraPath = create_orbit_camera_path(V3(0, 0, 0), 80.0f, 25.0f, 13, 5.0f);
+    if(options.path && load_camera_path(&cameraPath, options.path))
+        benchmark.path = options.path;
+    if(options.benchmark) {
+        state.benchmark = &benchmark;
+        set_vsync(false);
+        BMT_LOG(INFO, "Benchmark mode, %d warm-up and %d measured frames", options.warmup, options.frames);
+    }
+    CameraPath recording;
+    recording.secondsPerKey = 1.0f;
+
+    RenderThread renderer;
+    start_render_thread(&renderer, render_frame, &state);
+
+    //THE SIMULATION STEPS AT A FIXED 60HZ WHATEVER THE RENDER THREAD MANAGES
+    std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now();
     while(window_open()) {
-        camera_controls(&cam, &lastMousePos);
+        {
+            BMT_PROFILE_ZONE("camera update");
+            if(options.benchmark) {
+                cam = sample_camera_path(&cameraPath, tick / 60.0f);
+            }
+            else {
+                camera_controls(&cam, &lastMousePos);
+                if(options.record) {
+                    u32 keys = recording.keys.size();
+                    record_camera_key(&recording, cam, tick / 60.0f);
+                    if(recording.keys.size() != keys)
+                        save_camera_path(&recording, options.record);
+                }
+            }
+        }
+        if(is_key_released(KEY_F2))
+            requests[REQUEST_GPU_DUMP]++;
+        if(is_key_released(KEY_F3))
+            requests[REQUEST_TRACE_EXPORT]++;
+        if(is_key_released(KEY_F4)) {
+            occlusionCulling = !occlusionCulling;
+            BMT_LOG(INFO, "Occlusion culling %s", occlusionCulling ? "on" : "off");
+        }
+        if(is_key_released(KEY_F5))
+            requests[REQUEST_OCEAN_BENCHMARK]++;
+        if(is_key_released(KEY_F6))
+            requests[REQUEST_NOISE_BENCHMARK]++;
+        //F7 DUMPS THE FRAME GRAPH AND THE RENDER TARGET POOL AFTER THE NEXT FRAME HAS RUN
+        if(is_key_released(KEY_F7))
+            requests[REQUEST_GRAPH_DUMP]++;
+        //F8 LAYS DOWN THE DEPTH OF THE MODELS FIRST SO static.frag ONLY RUNS ONCE PER PIXEL, COMPARE THE PASS TIMES WITH F2
+        if(is_key_released(KEY_F8)) {
+            depthPrepass = !depthPrepass;
+            BMT_LOG(INFO, "Depth pre-pass %s", depthPrepass ? "on" : "off");
+        }
+        if(is_key_released(KEY_F9))
+            requests[REQUEST_PARTICLE_BENCHMARK]++;
+        if(is_key_released(KEY_F10))
+            requests[REQUEST_ANIMATION_BENCHMARK]++;
+        //F11 SHOWS THE DRAW CALLS, BINDS, UPLOADS AND TRIANGLES OF EVERY PASS (BUILD WITH BMT_RENDER_STATS)
+        if(is_key_released(KEY_F11))
+            renderStats = !renderStats;
+        if(is_key_released(KEY_T))
+            requests[REQUEST_TEXT_BENCHMARK]++;
+        if(options.capture && (is_key_released(KEY_F12) || tick == options.captureAt))
+            requests[REQUEST_GL_CAPTURE]++;
+        //HOLD L TO MOVE THE SUN (THIS RE-RENDERS THE CACHED STATIC SHADOWS)
+        if(is_key_down(KEY_L))
+            sunAngle += 0.5f;
 
-        for(int i = 0; i < scene.size(); ++i) {
-            scene[i].rotate.y += 0.1;
-            f32 theta = deg_to_rad(scene[i].rotate.y);
-            scene[i].pos.z -= 0.05f * cos(theta);
-            scene[i].pos.x -= 0.05f * sin(theta);
+        {
+            BMT_PROFILE_ZONE("scene update");
+            //ONLY THE SHIPS AND THE PALM SAIL AROUND, THE ROCK AND TOWER STAY PUT
+            for(int i = 0; i <= PALM_INDEX; ++i) {
+                scene[i].rotate.y += 0.1;
+                f32 theta = deg_to_rad(scene[i].rotate.y);
+                scene[i].pos.z -= 0.05f * cos(theta);
+                scene[i].pos.x -= 0.05f * sin(theta);
+            }
+        }
+        {
+            BMT_PROFILE_ZONE("publish snapshot");
+            SceneSnapshot* snapshot = (SceneSnapshot*)triple_buffer_back(&snapshots);
+            snapshot->tick = ++tick;
+            snapshot->camera = cam;
+            snapshot->sunAngle = sunAngle;
+            snapshot->occlusionCulling = occlusionCulling;
+            snapshot->depthPrepass = depthPrepass;
+            snapshot->renderStats = renderStats;
+            snapshot->width = get_window_width();
+            snapshot->height = get_window_height();
+            snapshot->positions.resize(PALM_INDEX + 1);
+            snapshot->rotations.resize(PALM_INDEX + 1);
+            for(int i = 0; i <= PALM_INDEX; ++i) {
+                snapshot->positions[i] = scene[i].pos;
+                snapshot->rotations[i] = scene[i].rotate;
+            }
+            memcpy(snapshot->requests, requests, sizeof(requests));
+            publish_triple_buffer(&snapshots);
+        }
+
+        if(options.benchmark) {
+            //LOCKSTEP, NO SNAPSHOT MAY BE DROPPED OR EVERY RUN WOULD DRAW DIFFERENT FRAMES
+            while(state.renderedTick.load() < tick && window_open())
+                std::this_thread::yield();
         }
+        else {
+            nextTick += std::chrono::microseconds(16667);
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if(nextTick < now)
+                nextTick = now;
+            std::this_thread::sleep_until(nextTick);
+        }
+        poll_window_events();
+    }
+    stop_render_thread(&renderer);
+}
+
+//RUNS OVER AND OVER ON THE RENDER THREAD, DRAWS ONE FRAME FOR EVERY NEW SNAPSHOT
+void render_frame(void* data) {
+    RenderState* state = (RenderState*)data;
+    SceneSnapshot* snapshot = (SceneSnapshot*)acquire_triple_buffer(state->snapshots);
+    if(snapshot == NULL) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        return;
+    }
+    //TICKS THE RENDER THREAD FELL BEHIND ON ARE CAUGHT UP, UP TO A POINT
+    u32 steps = (u32)(snapshot->tick - state->tick);
+    if(steps > 4)
+        steps = 4;
+    state->tick = snapshot->tick;
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+    FrameContext* resources = &state->resources;
+
+    bool dumpGraph = false;
+    for(int i = 0; i < REQUEST_COUNT; ++i) {
+        if(snapshot->requests[i] == state->handled[i])
+            continue;
+        state->handled[i] = snapshot->requests[i];
+        switch(i) {
+            case REQUEST_GPU_DUMP:
+                dump_gpu_profiler(resources->gpuProfiler);
+                dump_render_stats();
+                dump_light_clusters(resources->mainClusters, "main");
+                dump_light_clusters(resources->reflectionClusters, "reflection");
+                break;
+            case REQUEST_TRACE_EXPORT:        profiler_export_chrome_trace("profile.json"); break;
+            case REQUEST_GRAPH_DUMP:          dumpGraph = true; break;
+            case REQUEST_OCEAN_BENCHMARK:     benchmark_ocean(); break;
+            case REQUEST_NOISE_BENCHMARK:     benchmark_noise(); break;
+            case REQUEST_PARTICLE_BENCHMARK:  benchmark_particles(); break;
+            case REQUEST_ANIMATION_BENCHMARK: benchmark_animation(&resources->pirates[0]); break;
+            case REQUEST_GL_CAPTURE:          begin_gl_capture(state->capturePath, snapshot->width, snapshot->height, state->captureFrames); break;
+            case REQUEST_TEXT_BENCHMARK:      benchmark_text(resources->font); break;
+        }
+    }
+
+    std::vector<Model>& scene = *resources->scene;
+    for(int i = 0; i < snapshot->positions.size(); ++i) {
+        scene[i].pos = snapshot->positions[i];
+        scene[i].rotate = snapshot->rotations[i];
+    }
+    simulate_effects(state, snapshot, steps);
+
+    begin_drawing();
+    begin_gpu_frame(resources->gpuProfiler);
+    setup_environment();
+
+    begin_render_target_frame(state->targets);
+    f32 time = snapshot->tick / 60.0f;
+    Camera cam = snapshot->camera;
 
-        begin_drawing();
-        setup_environment();
-
-        mat4 projection = perspective_projection(90, get_window_width() / get_window_height(), 0.1f, 999.9f);
-
-        //PREPARE BASIC SHADER
-        start_shader(basic);
-        upload_mat4(basic, "projection", projection);
-        moveFactor += 0.0005f;
-
-        //REFLECT CAMERA ACROSS WATER (Y-AXIS)
-        float distance = 2 * cam.y;
-        cam.y -= distance;
-        cam.pitch = -cam.pitch;
-        upload_mat4(basic, "view", create_view_matrix(cam));
-
-        //RENDER INVERTED SCENE ONTO FRAMEBUFFER
-        set_viewport(0, 0, WATER_WIDTH, WATER_HEIGHT);
-        bind_framebuffer(inverse);
-        clear_bound_framebuffer();
-        for(Model m : scene)
-            draw_model(basic, &m);
-        unbind_framebuffer();
-
-        //UN-REFLECT CAMERA
-        cam.y += distance;
-        cam.pitch = -cam.pitch;
-        mat4 view = create_view_matrix(cam);
-        upload_mat4(basic, "view", view);
-
-        //DRAW SCENE TO SCREEN
-        set_viewport(0, 0, get_window_width(), get_window_height());
-        for(Model m : scene)
-            draw_model(basic, &m);
-
-        //DRAW WATER
-        start_shader(water);
-        bind_texture(inverse.texture, 0); //bind inverse framebuffer texture to texture slot 0
-        bind_texture(dudvMap, 1); //bind dudv texture to texture slot 1
-        upload_float(water, "moveFactor", sin(moveFactor));
-        upload_mat4(water, "view", view);
-        draw_mesh(water, groundModel.meshes[0]);
-
-        //DRAW GUI
-        bind_quad_batch(batch);
-            //draw_texture(batch, dudvMap, 0, 0);
-        unbind_quad_batch(batch);
-
-        end_drawing();
+    FrameContext frame = *resources;
+    frame.width = snapshot->width;
+    frame.height = snapshot->height;
+    frame.projection = perspective_projection(90, frame.width / frame.height, 0.1f, 999.9f);
+    frame.view = create_view_matrix(cam);
+    frame.sunDirection = {cosf(deg_to_rad(snapshot->sunAngle)) * 0.6f, 1.0f, sinf(deg_to_rad(snapshot->sunAngle)) * 0.6f};
+    frame.camera = V3(cam.x, cam.y, cam.z);
+
+    //REFLECT CAMERA ACROSS WATER (Y-AXIS)
+    Camera reflected = cam;
+    reflected.y = -cam.y;
+    reflected.pitch = -cam.pitch;
+    frame.reflectedView = create_view_matrix(reflected);
+    frame.reflectedCamera = V3(reflected.x, reflected.y, reflected.z);
+
+    frame.depthPrepass = snapshot->depthPrepass;
+    frame.occlusionCulling = snapshot->occlusionCulling;
+    frame.renderStats = snapshot->renderStats;
+    frame.moveFactor = time * 0.03f;
+    frame.crowdTime = time;
+
+    //DECLARE THE FRAME, THE REFLECTION AND REFRACTION PASSES ARE CULLED WHEN NO WATER IS IN VIEW
+    FrameGraph* graph = state->graph;
+    select_cdlod(frame.waterLod, frame.camera, frame.projection * frame.view);
+    bool waterVisible = !frame.waterLod->nodes.empty() || !frame.waterLod->quarters.empty();
+
+    Framebuffer window = { 0 };
+    window.texture.width = frame.width;
+    window.texture.height = frame.height;
+    begin_frame_graph(graph, state->targets, frame.gpuProfiler);
+    u32 windowTarget = import_frame_target(graph, "window", window, true);
+    u32 shadowMaps = import_frame_resource(graph, "shadow cascades");
+    frame.reflection = create_frame_target(graph, "reflection", WATER_WIDTH, WATER_HEIGHT, RENDER_TARGET_COLOR);
+    frame.sceneBuffer = create_frame_target(graph, "scene", frame.width, frame.height, RENDER_TARGET_SCENE);
+    frame.refraction = create_frame_target(graph, "refraction", frame.width, frame.height, RENDER_TARGET_SCENE);
+
+    u32 pass = add_frame_pass(graph, "shadows", shadow_pass, &frame);
+    write_frame_target(graph, pass, shadowMaps);
+    pass = add_frame_pass(graph, "reflection", reflection_pass, &frame);
+    read_frame_target(graph, pass, shadowMaps);
+    write_frame_target(graph, pass, frame.reflection);
+    pass = add_frame_pass(graph, "main", main_pass, &frame);
+    read_frame_target(graph, pass, shadowMaps);
+    write_frame_target(graph, pass, frame.sceneBuffer);
+    pass = add_frame_pass(graph, "refraction copy", refraction_copy_pass, &frame);
+    read_frame_target(graph, pass, frame.sceneBuffer);
+    write_frame_target(graph, pass, frame.refraction, false);
+    if(waterVisible) {
+        pass = add_frame_pass(graph, "water", water_pass, &frame);
+        read_frame_target(graph, pass, frame.reflection);
+        read_frame_target(graph, pass, frame.refraction);
+        write_frame_target(graph, pass, frame.sceneBuffer);
+    }
+    pass = add_frame_pass(graph, "particles", particle_pass, &frame);
+    read_frame_target(graph, pass, frame.sceneBuffer);
+    write_frame_target(graph, pass, frame.sceneBuffer);
+    pass = add_frame_pass(graph, "present", present_pass, &frame);
+    read_frame_target(graph, pass, frame.sceneBuffer);
+    write_frame_target(graph, pass, windowTarget);
+    pass = add_frame_pass(graph, "gui", gui_pass, &frame);
+    write_frame_target(graph, pass, windowTarget);
+
+    compile_frame_graph(graph);
+    execute_frame_graph(graph);
+    if(dumpGraph)
+        dump_frame_graph(graph);
+
+    end_gpu_frame(frame.gpuProfiler);
+    swap_window_buffers();
+    end_gl_capture_frame();
+    BMT_PROFILE_FRAME();
+    BMT_STAT_FRAME();
+
+    //THE GPU TIME IS A FEW FRAMES OLD, THE PROFILER READS ITS QUERIES BACK LATE SO IT NEVER STALLS
+    f64 cpuMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    if(state->benchmark && benchmark_frame(state->benchmark, cpuMs, frame.gpuProfiler->frameTime)) {
+        report_benchmark(state->benchmark, frame.gpuProfiler, state->benchmarkJson);
+        state->benchmark = NULL;
+        set_window_should_close(true);
+    }
+    state->renderedTick.store(snapshot->tick);
+}
+
+//THE SYSTEMS THAT UPLOAD TO THE GPU EVERY STEP LIVE ON THE RENDER THREAD, DRIVEN BY THE SNAPSHOT
+void simulate_effects(RenderState* state, SceneSnapshot* snapshot, u32 steps) {
+    FrameContext* resources = &state->resources;
+    std::vector<Model>& scene = *resources->scene;
+    Ocean* ocean = resources->ocean;
+    RippleField* ripples = resources->ripples;
+    ParticleSystem* particles = resources->particles;
+    Animator* animator = resources->animator;
+    std::vector<CrewMember>& crew = *resources->crew;
+    f32 time = snapshot->tick / 60.0f;
+    f32 dt = steps / 60.0f;
+    {
+        BMT_PROFILE_ZONE("ocean update");
+        update_ocean(ocean, time);
+        upload_ocean(ocean);
+        //SHIPS RIDE THE SWELL
+        for(int i = 0; i < FLEET_SIZE; ++i)
+            scene[i].pos.y = ocean_height_at(ocean, scene[i].pos.x, scene[i].pos.z);
+    }
+    {
+        BMT_PROFILE_ZONE("ripple update");
+        //EVERY HULL PUSHES THE WATER DOWN AS IT SAILS THROUGH
+        recenter_ripples(ripples, V3(snapshot->camera.x, snapshot->camera.y, snapshot->camera.z));
+        for(u32 step = 0; step < steps; ++step) {
+            for(int i = 0; i < FLEET_SIZE; ++i)
+                add_ripple_source(ripples, scene[i].pos, 1.5f, 0.01f);
+            update_ripples(ripples, 1.0f / 60.0f);
+        }
+        upload_ripples(ripples);
     }
+    {
+        BMT_PROFILE_ZONE("particle update");
+        //THE WAKES FOLLOW THE STERNS, NOW AND THEN A SHIP FIRES A BROADSIDE AND THE BALL LANDS IN THE WATER
+        for(int i = 0; i < FLEET_SIZE; ++i) {
+            f32 theta = deg_to_rad(scene[i].rotate.y);
+            particles->emitters[state->wakes[i]].position = scene[i].pos + V3(sinf(theta) * 2.0f, 0.0f, cosf(theta) * 2.0f);
+        }
+        if(rand() % 20 < steps) {
+            Model* ship = &scene[rand() % FLEET_SIZE];
+            f32 theta = deg_to_rad(ship->rotate.y);
+            vec3 side = V3(cosf(theta), 0.0f, -sinf(theta));
+            emit_particles(particles, &state->smoke, ship->pos + 1.2f * side + V3(0, 1.0f, 0), 80);
+            vec3 impact = ship->pos + (20.0f + rand() % 30) * side;
+            impact.y = ocean_height_at(ocean, impact.x, impact.z);
+            emit_particles(particles, &state->splash, impact, 150);
+        }
+        update_particles(particles, dt);
+    }
+    {
+        BMT_PROFILE_ZONE("animation update");
+        //EVERY PIRATE DRIFTS BETWEEN IDLING AND HAULING AT ITS OWN PACE
+        for(int i = 0; i < crew.size(); ++i)
+            animator->instances[crew[i].animation].blendWeight = 0.5f + 0.5f * sinf(time * 0.3f + i);
+        update_animations(animator, dt);
+        upload_animations(animator);
+    }
+    update_terrain(resources->terrain);
+    //CHUNKS THAT STREAMED IN OR OUT CHANGE THE CACHED TERRAIN SHADOWS UNDER THEM
+    mark_shadow_cascades_dirty(resources->shadows, resources->terrain->changedMin, resources->terrain->changedMax);
 }
 
 //
 //  FUNCTIONS
 //
 
+Options parse_options(int argc, char** argv) {
+    Options options = {0};
+    options.seed = 1337;
+    options.warmup = 120;
+    options.frames = 1200;
+    options.json = "benchmark.json";
+    options.captureFrames = 1;
+    options.captureAt = (u64)-1;
+    for(int i = 1; i < argc; ++i) {
+        bool value = i + 1 < argc;
+        if(strcmp(argv[i], "--benchmark") == 0)
+            options.benchmark = true;
+        else if(strcmp(argv[i], "--path") == 0 && value)
+            options.path = argv[++i];
+        else if(strcmp(argv[i], "--seed") == 0 && value)
+            options.seed = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--warmup") == 0 && value)
+            options.warmup = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--frames") == 0 && value)
+            options.frames = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--json") == 0 && value)
+            options.json = argv[++i];
+        else if(strcmp(argv[i], "--record") == 0 && value)
+            options.record = argv[++i];
+        else if(strcmp(argv[i], "--capture") == 0 && value)
+            options.capture = argv[++i];
+        else if(strcmp(argv[i], "--capture-frames") == 0 && value)
+            options.captureFrames = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--capture-at") == 0 && value)
+            options.captureAt = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--font") == 0 && value)
+            options.font = argv[++i];
+        else
+            BMT_LOG(WARNING, "Unknown option %s", argv[i]);
+    }
+    return options;
+}
+
 void initialize() {
     //INITIALIZE WINDOW
     printf("\n/////////////////////////////////\n       BAHAMUT ENGINE\n/////////////////////////////////\n\n");
-    init_window(RENDER_WIDTH, RENDER_HEIGHT, "OpenGL - Bahamut Engine", false, true, true);
+    BMT_PROFILE_THREAD("main");
+    profiler_set_spike_threshold(50.0);
+    init_job_system();
+    //BMT_HEADLESS=1 RENDERS OFFSCREEN WITHOUT A DISPLAY, FOR PERFORMANCE RUNS ON BUILD MACHINES
+    WindowBackend backend = getenv("BMT_HEADLESS") ? WINDOW_BACKEND_HEADLESS : WINDOW_BACKEND_GLFW;
+    init_window(RENDER_WIDTH, RENDER_HEIGHT, "OpenGL - Bahamut Engine", false, true, true, backend);
     set_fps_cap(60);
     set_vsync(true);
     set_clear_color(SKYBLUE);
@@ -187,7 +898,7 @@ void camera_controls(Camera* cam, vec2* lastPos) {
     }
 
     if(is_key_released(KEY_ESCAPE))
-        exit(0);
+        set_window_should_close(true);
 
     if(is_key_released(KEY_F1)) {
         if(look)
@@ -199,51 +910,215 @@ void camera_controls(Camera* cam, vec2* lastPos) {
     }
 }
 
-Model generate_terrain(f32 width, f32 height) {
-    Model model;
-    model.pos = {0};
-    model.rotate = {180, 0, 0};
-    model.scale = {1, 1, 1};
+void cull_scene(OcclusionBuffer* buffer, mat4 viewProjection, std::vector<Model>& scene, bool enabled, bool* visible) {
+    BMT_PROFILE_FUNCTION();
+    if(!enabled) {
+        for(int i = 0; i < scene.size(); ++i)
+            visible[i] = true;
+        return;
+    }
+
+    std::vector<vec3> boundsMin(scene.size());
+    std::vector<vec3> boundsMax(scene.size());
+    std::vector<mat4> transforms(scene.size());
+
+    //RASTERIZE THE OCCLUDERS, THEN TEST EVERY MODEL'S BOUNDING BOX AGAINST THEM
+    begin_occlusion(buffer, viewProjection);
+    for(int i = 0; i < scene.size(); ++i) {
+        transforms[i] = create_transformation_matrix(scene[i].pos, scene[i].rotate, scene[i].scale);
+        boundsMin[i] = scene[i].boundsMin;
+        boundsMax[i] = scene[i].boundsMax;
+        if(scene[i].occluder)
+            add_occluder(buffer, scene[i].occluder, transforms[i]);
+    }
+    finish_occlusion(buffer);
+    test_occlusion_aabbs(buffer, &boundsMin[0], &boundsMax[0], &transforms[0], scene.size(), visible);
+}
+
+//
+//  PASSES
+//
+
+//RECORDS ONE CHUNK OF THE SCENE INTO ITS OWN BUFFERS, RUNS ON THE JOB SYSTEM SO NO GL CALLS
+void record_scene_chunk(void* data, u32 begin, u32 end) {
+    FrameContext* frame = (FrameContext*)data;
+    std::vector<Model>& scene = *frame->scene;
+    u32 chunk = begin / SCENE_CHUNK;
+    CommandBuffer* color = &(*frame->colorCommands)[chunk];
+    CommandBuffer* depth = &(*frame->depthCommands)[chunk];
+    reset_command_buffer(color);
+    reset_command_buffer(depth);
+    //OVER A PRE-PASS THE DEPTH IS ALREADY THERE, ONLY THE EXACT SAME SURFACE GETS SHADED
+    record_bind_pipeline(color, frame->basic.ID, frame->depthPrepass ? PIPELINE_DEPTH_EQUAL | PIPELINE_DEPTH_READ_ONLY : PIPELINE_DEFAULT);
+    if(frame->depthPrepass)
+        record_bind_pipeline(depth, frame->prepass.ID);
+    for(u32 i = begin; i < end; ++i) {
+        if(!frame->visible[i])
+            continue;
+        record_model(color, frame->basicUniforms, &scene[i]);
+        if(frame->depthPrepass)
+            record_model_depth(depth, frame->prepassUniforms, &scene[i]);
+    }
+}
+
+//DRAWS THE VISIBLE SCENE WITH THE BASIC SHADER, WHICH MUST ALREADY HAVE ITS PER-PASS UNIFORMS SET.
+//THE MATRICES AND MATERIALS ARE RECORDED ACROSS THE JOB SYSTEM, THEN REPLAYED HERE ON THE GL THREAD
+void draw_scene(FrameContext* frame, mat4 view) {
+    BMT_PROFILE_FUNCTION();
+    std::vector<CommandBuffer>& color = *frame->colorCommands;
+    std::vector<CommandBuffer>& depth = *frame->depthCommands;
+    {
+        BMT_PROFILE_ZONE("record scene");
+        parallel_for(frame->scene->size(), SCENE_CHUNK, record_scene_chunk, frame);
+    }
+    //THE PRE-PASS LAYS DOWN THE DEPTH OF THE VISIBLE MODELS FROM THEIR POSITION-ONLY STREAMS, THE COLOUR
+    //DRAWS THAT FOLLOW THEN TEST WITH GL_EQUAL AND ONLY SHADE THE NEAREST SURFACE
+    if(frame->depthPrepass) {
+        start_shader(frame->prepass);
+        upload_mat4(frame->prepass, "projection", frame->projection);
+        upload_mat4(frame->prepass, "view", view);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        replay_command_buffers(&depth[0], depth.size());
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+    replay_command_buffers(&color[0], color.size());
+}
+
+//DRAWS THE PIRATES ON THEIR SHIPS WITH THE SKINNING SHADER, LIT LIKE THE REST OF THE SCENE
+void draw_crew(FrameContext* frame, mat4 view, LightClusters* clusters, u32 width, u32 height) {
+    BMT_PROFILE_FUNCTION();
+    std::vector<Model>& scene = *frame->scene;
+    Shader skinned = frame->skinned;
+    start_shader(skinned);
+    upload_mat4(skinned, "projection", frame->projection);
+    upload_mat4(skinned, "view", view);
+    bind_shadow_cascades(frame->shadows, skinned, 2);
+    bind_light_clusters(clusters, skinned, 3, width, height);
+    bind_animations(frame->animator, skinned, 6);
+    for(int i = 0; i < frame->crew->size(); ++i) {
+        CrewMember member = (*frame->crew)[i];
+        Model* ship = &scene[member.ship];
+        if(!frame->visible[member.ship])
+            continue;
+        //STAND ON THE DECK, A THIRD OF THE WAY UP THE HULL
+        SkinnedModel* pirate = &frame->pirates[member.pirate];
+        pirate->model.pos = ship->pos + V3(0, (ship->boundsMax.y - ship->boundsMin.y) * ship->scale.y * 0.3f, 0);
+        pirate->model.rotate = ship->rotate;
+        pirate->model.scale = ship->scale;
+        draw_skinned_model(skinned, pirate, frame->animator, member.animation);
+    }
+    start_shader(frame->basic);
+}
 
-    std::vector<ColorVertex> vertices;
-    std::vector<GLushort>    indices;
+void shadow_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    //RENDER SHADOW CASCADES AROUND THE CAMERA
+    update_shadow_cascades(frame->shadows, frame->view, 90, frame->width / frame->height, 0.1f, frame->sunDirection);
+    render_shadow_cascades(frame->shadows, *frame->scene, frame->terrain);
+}
 
-    ColorVertex triOne[3];
-    ColorVertex triTwo[3];
+void reflection_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    Shader basic = frame->basic;
+    std::vector<Model>& scene = *frame->scene;
 
-    vec3 topLeft = {-width, 0, -height};
-    vec3 topRight = {width, 0, -height};
-    vec3 bottomLeft = {-width, 0, height};
-    vec3 bottomRight = {width, 0, height};
+    //RENDER INVERTED SCENE ONTO FRAMEBUFFER
+    cull_scene(frame->reflectionOcclusion, frame->projection * frame->reflectedView, scene, frame->occlusionCulling, frame->visible);
+    update_light_clusters(frame->reflectionClusters, frame->reflectedView, frame->projection, 0.1f, 300.0f, &(*frame->lights)[0], frame->lights->size());
+    start_shader(basic);
+    upload_mat4(basic, "projection", frame->projection);
+    upload_mat4(basic, "view", frame->reflectedView);
+    bind_shadow_cascades(frame->shadows, basic, 2);
+    bind_light_clusters(frame->reflectionClusters, basic, 3, WATER_WIDTH, WATER_HEIGHT);
+    draw_scene(frame, frame->reflectedView);
+    draw_crew(frame, frame->reflectedView, frame->reflectionClusters, WATER_WIDTH, WATER_HEIGHT);
+    //ONLY WHAT IS ABOVE THE WATER SHOWS UP IN THE REFLECTION
+    glEnable(GL_CLIP_DISTANCE0);
+    draw_terrain(frame->terrain, frame->reflectedCamera, frame->projection, frame->reflectedView, frame->sunDirection, V4(0, 1, 0, 0));
+    glDisable(GL_CLIP_DISTANCE0);
+}
 
-    vec3 normal = {0, 1, 0};
-    vec4 color = {88.0f/255.0f, 213.0f/255.0f, 211.0f/255.0f};
+void main_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    Shader basic = frame->basic;
+    std::vector<Model>& scene = *frame->scene;
 
-    triOne[0] = { topLeft, normal, color };
-    triOne[1] = { topRight, normal, color };
-    triOne[2] = { bottomLeft, normal, color };
+    //DRAW OPAQUE SCENE OFFSCREEN
+    cull_scene(frame->mainOcclusion, frame->projection * frame->view, scene, frame->occlusionCulling, frame->visible);
+    update_light_clusters(frame->mainClusters, frame->view, frame->projection, 0.1f, 300.0f, &(*frame->lights)[0], frame->lights->size());
+    start_shader(basic);
+    upload_mat4(basic, "projection", frame->projection);
+    upload_mat4(basic, "view", frame->view);
+    bind_shadow_cascades(frame->shadows, basic, 2);
+    bind_light_clusters(frame->mainClusters, basic, 3, frame->width, frame->height);
+    draw_scene(frame, frame->view);
+    draw_crew(frame, frame->view, frame->mainClusters, frame->width, frame->height);
+    start_shader(frame->vat);
+    upload_mat4(frame->vat, "projection", frame->projection);
+    upload_mat4(frame->vat, "view", frame->view);
+    upload_vec3(frame->vat, "lightDirection", frame->sunDirection);
+    draw_vertex_animation(frame->vat, frame->crowd, frame->crowdInstances->data(), frame->crowdInstances->size(), frame->crowdTime);
+    draw_terrain(frame->terrain, frame->camera, frame->projection, frame->view, frame->sunDirection);
+}
 
-    triTwo[0] = { bottomLeft, normal, color };
-    triTwo[1] = { topRight, normal, color };
-    triTwo[2] = { bottomRight, normal, color };
+void refraction_copy_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    //COPY COLOR AND DEPTH FOR THE WATER TO REFRACT, THE WATER ITSELF IS DRAWN ON TOP OF THE ORIGINAL
+    blit_framebuffer(get_frame_target(graph, frame->sceneBuffer), get_frame_target(graph, frame->refraction), GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
 
-    vertices.push_back(triOne[0]);
-    vertices.push_back(triOne[1]);
-    vertices.push_back(triOne[2]);
-    vertices.push_back(triTwo[0]);
-    vertices.push_back(triTwo[1]);
-    vertices.push_back(triTwo[2]);
+void water_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    Shader water = frame->water;
+    Framebuffer refraction = get_frame_target(graph, frame->refraction);
 
-    indices.push_back(0);
-    indices.push_back(0);
-    indices.push_back(0);
-    indices.push_back(0);
-    indices.push_back(0);
-    indices.push_back(0);
+    //DRAW WATER, THE RINGS WERE ALREADY SELECTED WHEN THE FRAME WAS DECLARED
+    start_shader(water);
+    bind_texture(get_frame_target(graph, frame->reflection).texture, 0); //bind inverse framebuffer texture to texture slot 0
+    bind_texture(frame->dudvMap, 1); //bind dudv texture to texture slot 1
+    bind_texture(frame->ocean->displacementMap, 2);
+    bind_texture(frame->ocean->normalMap, 3);
+    bind_texture(frame->ripples->map, 4);
+    bind_texture(refraction.texture, 5);
+    bind_texture(refraction.depth, 6);
+    upload_float(water, "oceanPatchSize", frame->ocean->patchSize);
+    upload_vec2(water, "rippleCenter", get_ripple_center(frame->ripples));
+    upload_float(water, "rippleExtent", get_ripple_extent(frame->ripples));
+    upload_vec3(water, "cameraPos", frame->camera);
+    upload_float(water, "moveFactor", sin(frame->moveFactor));
+    upload_mat4(water, "projection", frame->projection);
+    upload_mat4(water, "view", frame->view);
+    upload_float(water, "oceanSize", frame->ocean->size);
+    bind_cdlod(frame->waterLod, water);
+    draw_cdlod(frame->waterLod);
+}
+
+void particle_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    //BLEND THE PARTICLES OVER THE FINISHED SCENE, TESTED AGAINST ITS DEPTH
+    draw_particles(frame->particles, frame->projection, frame->view);
+}
 
-    model.meshes.push_back(create_color_mesh(vertices, indices));
+void present_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    //PRESENT THE FINISHED SCENE TO THE WINDOW
+    glDisable(GL_DEPTH_TEST);
+    start_shader(frame->present);
+    bind_texture(get_frame_target(graph, frame->sceneBuffer).texture, 0);
+    draw_fullscreen_triangle();
+    stop_shader();
+    glEnable(GL_DEPTH_TEST);
+}
 
-    return model;
+void gui_pass(FrameGraph* graph, void* data) {
+    FrameContext* frame = (FrameContext*)data;
+    //DRAW GUI
+    bind_quad_batch(frame->batch);
+        //draw_texture(batch, dudvMap, 0, 0);
+        draw_gpu_profiler(frame->batch, frame->gpuProfiler, 10, 10);
+        if(frame->renderStats)
+            draw_render_stats(frame->batch, frame->font, 10, 50);
+    unbind_quad_batch(frame->batch);
 }
 
 Shader load_water_shader() {
@@ -256,15 +1131,18 @@ Shader load_water_shader() {
     glAttachShader(shader.ID, shader.fragshaderID);
     glBindFragDataLocation(shader.ID, 0, "out_color");
     glBindAttribLocation(shader.ID, 0, "position");
-    glBindAttribLocation(shader.ID, 1, "normal");
-    glBindAttribLocation(shader.ID, 2, "color");
+    glBindAttribLocation(shader.ID, 1, "node");
     glLinkProgram(shader.ID);
     glValidateProgram(shader.ID);
 
     start_shader(shader);
     upload_int(shader, "reflection", 0);
     upload_int(shader, "dudv", 1);
-    upload_mat4(shader, "transform", create_transformation_matrix({0, 0, 0}, {180, 0, 0}, {1, 1, 1}));
+    upload_int(shader, "displacementMap", 2);
+    upload_int(shader, "normalMap", 3);
+    upload_int(shader, "rippleMap", 4);
+    upload_int(shader, "refractionColor", 5);
+    upload_int(shader, "refractionDepth", 6);
     upload_mat4(shader, "projection", perspective_projection(90, WATER_WIDTH / WATER_HEIGHT, 0.1f, 999.9f));
 
     glUseProgram(0);
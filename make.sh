@@ -0,0 +1,10 @@
+#!/bin/sh
+#Linux build. Needs GLFW, SOIL, assimp and EGL, the headless backend (BMT_HEADLESS=1) runs on EGL without a display
+
+mkdir -p build
+cd build
+#the sources include ENGINE/..., which only finds the engine folder on a case-insensitive file system
+ln -sfn ../engine ENGINE
+gcc -c -I../include ../engine/glad.c -o glad.o
+g++ -std=c++17 -O2 -I../include -I. ../main.cpp ../engine/*.cpp glad.o -lglfw -lSOIL -lassimp -lEGL -lGL -ldl -lpthread -o bahamut
+cd ..
@@ -9,6 +9,9 @@
 #include "ENGINE/maths.h"
 #include "ENGINE/texture.h"
 #include "ENGINE/shader.h"
+#include "ENGINE/profiler.h"
+#include "ENGINE/occlusion.h"
+#include "ENGINE/command_buffer.h"
 
 #define INVALID_MATERIAL 0xFFFFFFFF
 
@@ -38,6 +41,9 @@ struct Mesh {
     GLuint vao;
     GLuint vbo;
     GLuint ebo;
+    //tightly packed positions sharing the same ebo, for depth-only passes
+    GLuint positionVao;
+    GLuint positionVbo;
     u32 indexcount;
     u32 material;
 };
@@ -49,8 +55,22 @@ struct Model {
     vec3 pos;
     vec3 rotate;
     vec3 scale;
+
+    //model space bounding box of every mesh, used for occlusion tests
+    vec3 boundsMin;
+    vec3 boundsMax;
+    //optional low-poly stand-in rasterized into the occlusion buffer, NULL if the model hides nothing
+    Occluder* occluder;
+    //never moves, so its shadow can be cached
+    bool isStatic;
 };  
 
+//uniform locations the recording jobs need, looked up once on the GL thread
+struct ModelUniforms {
+    i32 transform;
+    i32 diffuseColor;
+};
+
 struct ModelBatch {
     std::unordered_map<GLuint, std::vector<Model>> drawpool;
     Shader shader;
@@ -60,7 +80,9 @@ static inline
 void dispose_mesh(Mesh* mesh) {
     glDeleteBuffers(1, &mesh->vbo);
     glDeleteBuffers(1, &mesh->ebo);
+    glDeleteBuffers(1, &mesh->positionVbo);
     glDeleteVertexArrays(1, &mesh->vao);
+    glDeleteVertexArrays(1, &mesh->positionVao);
     mesh->indexcount = mesh->material = 0;
 }
 
@@ -72,6 +94,25 @@ void dispose_model(Model* model) {
     model->materials.clear();
 }
 
+//BUILDS THE POSITION-ONLY STREAM OF A MESH, THE DEPTH PASSES ONLY FETCH 12 BYTES PER VERTEX INSTEAD OF THE WHOLE VERTEX
+static inline
+void create_position_stream(Mesh* mesh, const std::vector<vec3>& positions) {
+    glGenVertexArrays(1, &mesh->positionVao);
+    glBindVertexArray(mesh->positionVao);
+
+    glGenBuffers(1, &mesh->positionVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->positionVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * positions.size(), &positions[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (const GLvoid*)0);                       //position
+
+    //the element buffer binding is part of the vao, so both streams share the same indices
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
 static inline
 Mesh create_mesh(std::vector<Vertex> vertices, std::vector<GLushort> indices) {
     Mesh mesh = {0};
@@ -97,6 +138,11 @@ Mesh create_mesh(std::vector<Vertex> vertices, std::vector<GLushort> indices) {
 
     mesh.indexcount = indices.size();
 
+    std::vector<vec3> positions(vertices.size());
+    for(u32 i = 0; i < vertices.size(); ++i)
+        positions[i] = vertices[i].position;
+    create_position_stream(&mesh, positions);
+
     return mesh;
 }
 
@@ -125,14 +171,21 @@ Mesh create_color_mesh(std::vector<ColorVertex> vertices, std::vector<GLushort>
 
     mesh.indexcount = indices.size();
 
+    std::vector<vec3> positions(vertices.size());
+    for(u32 i = 0; i < vertices.size(); ++i)
+        positions[i] = vertices[i].position;
+    create_position_stream(&mesh, positions);
+
     return mesh;
 }
 
 static inline
 void load_mesh(Model* model, u32 i, const aiMesh* paiMesh) {
+    BMT_PROFILE_FUNCTION();
     model->meshes[i].material = paiMesh->mMaterialIndex;
 
     std::vector<Vertex> vertices;
+    std::vector<vec3> positions;
     std::vector<GLushort> indices;
 
     const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
@@ -142,6 +195,9 @@ void load_mesh(Model* model, u32 i, const aiMesh* paiMesh) {
         const aiVector3D* normal = &(paiMesh->mNormals[i]);
         const aiVector3D* uv = paiMesh->HasTextureCoords(0) ? &(paiMesh->mTextureCoords[0][i]) : &Zero3D;
 
+        model->boundsMin = {fminf(model->boundsMin.x, pos->x), fminf(model->boundsMin.y, pos->y), fminf(model->boundsMin.z, pos->z)};
+        model->boundsMax = {fmaxf(model->boundsMax.x, pos->x), fmaxf(model->boundsMax.y, pos->y), fmaxf(model->boundsMax.z, pos->z)};
+
         Vertex v = {
             {pos->x, pos->y, pos->z},
             {normal->x, normal->y, normal->z},
@@ -149,6 +205,7 @@ void load_mesh(Model* model, u32 i, const aiMesh* paiMesh) {
         };
 
         vertices.push_back(v);
+        positions.push_back(v.position);
     }
 
     for(u32 i = 0; i < paiMesh->mNumFaces; ++i) {
@@ -179,10 +236,12 @@ void load_mesh(Model* model, u32 i, const aiMesh* paiMesh) {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     model->meshes[i].indexcount = indices.size();
+    create_position_stream(&model->meshes[i], positions);
 }
 
 static inline
 void load_materials(Model* model, const aiScene* pScene, const char* filename) {
+    BMT_PROFILE_FUNCTION();
     for(u32 i = 0; i < pScene->mNumMaterials; ++i) {
         const aiMaterial* mat = pScene->mMaterials[i];
         model->materials[i] = {0};
@@ -222,15 +281,17 @@ void load_materials(Model* model, const aiScene* pScene, const char* filename) {
     }
 }
 
+//BUILDS A MODEL FROM AN ALREADY IMPORTED SCENE, SO LOADERS THAT ALSO NEED THE BONES CAN SHARE ONE IMPORT
 static inline
-Model load_model(const char* filename) {
+Model load_model_from_scene(const aiScene* pScene, const char* filename) {
     Model model;
     model.pos = {0};
     model.rotate = {0};
     model.scale = {1, 1, 1};
-
-    Assimp::Importer importer;
-    const aiScene* pScene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_GenNormals);
+    model.boundsMin = {FLT_MAX, FLT_MAX, FLT_MAX};
+    model.boundsMax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    model.occluder = NULL;
+    model.isStatic = false;
 
     if(pScene) {
         model.meshes.resize(pScene->mNumMeshes);
@@ -249,6 +310,45 @@ Model load_model(const char* filename) {
     return model;
 }
 
+static inline
+Model load_model(const char* filename) {
+    BMT_PROFILE_FUNCTION();
+    Assimp::Importer importer;
+    const aiScene* pScene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_GenNormals);
+    return load_model_from_scene(pScene, filename);
+}
+
+//Loads every mesh of a file as one position-only triangle soup for the occlusion buffer.
+//Occluders should be cheap, so point this at a low-poly version of the model when there is one.
+static inline
+Occluder load_occluder(const char* filename) {
+    BMT_PROFILE_FUNCTION();
+    Occluder occluder;
+
+    Assimp::Importer importer;
+    const aiScene* pScene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+    if(pScene == NULL) {
+        BMT_LOG(MINOR_ERROR, "[%s] Could not load occluder", filename);
+        return occluder;
+    }
+
+    for(u32 m = 0; m < pScene->mNumMeshes; ++m) {
+        const aiMesh* paiMesh = pScene->mMeshes[m];
+        u32 base = occluder.vertices.size();
+        for(u32 i = 0; i < paiMesh->mNumVertices; ++i)
+            occluder.vertices.push_back({paiMesh->mVertices[i].x, paiMesh->mVertices[i].y, paiMesh->mVertices[i].z});
+        for(u32 i = 0; i < paiMesh->mNumFaces; ++i) {
+            const aiFace& face = paiMesh->mFaces[i];
+            if(face.mNumIndices != 3)
+                continue;
+            occluder.indices.push_back(base + face.mIndices[0]);
+            occluder.indices.push_back(base + face.mIndices[1]);
+            occluder.indices.push_back(base + face.mIndices[2]);
+        }
+    }
+    return occluder;
+}
+
 static inline
 void draw_mesh(Shader shader, Mesh mesh) {
     //bind VERTEX ARRAY OBJECT
@@ -259,8 +359,9 @@ void draw_mesh(Shader shader, Mesh mesh) {
     glEnableVertexAttribArray(2); //2 = Color
 
     //draw bound VAO using triangles, up to mesh.indexcount indices
-    //glDrawElements(GL_TRIANGLES, mesh.indexcount, GL_UNSIGNED_SHORT, 0);
-    glDrawArrays(GL_TRIANGLES, 0, mesh.indexcount);
+    glDrawElements(GL_TRIANGLES, mesh.indexcount, GL_UNSIGNED_SHORT, 0);
+    BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+    BMT_STAT_DRAW(GL_TRIANGLES, mesh.indexcount, 1);
 
     //unbind attributes and VAO
     glDisableVertexAttribArray(2);
@@ -283,6 +384,8 @@ void draw_mesh(Shader basic, Mesh mesh, Material material) {
     upload_vec4(basic, "diffuseColor", material.diffuseColor);
     //draw bound VAO using triangles, up to mesh.indexcount indices
     glDrawElements(GL_TRIANGLES, mesh.indexcount, GL_UNSIGNED_SHORT, 0);
+    BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+    BMT_STAT_DRAW(GL_TRIANGLES, mesh.indexcount, 1);
 
     //unbind attributes and VAO
     glDisableVertexAttribArray(2);
@@ -291,6 +394,19 @@ void draw_mesh(Shader basic, Mesh mesh, Material material) {
     glBindVertexArray(0);
 }
 
+//DRAWS ONE TRIANGLE COVERING THE WHOLE VIEWPORT, THE VERTEX SHADER BUILDS IT FROM gl_VertexID
+static inline
+void draw_fullscreen_triangle() {
+    static GLuint vao = 0;
+    if(vao == 0)
+        glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+    BMT_STAT_DRAW(GL_TRIANGLES, 3, 1);
+}
+
 static inline
 void draw_model(Shader shader, Model* model) {
         //UPLOAD MODEL MATRIX
@@ -302,6 +418,51 @@ void draw_model(Shader shader, Model* model) {
         }
 }
 
+//DRAWS ONLY THE POSITIONS OF A MODEL, FOR DEPTH PRE-PASSES AND SHADOW MAPS. THE SHADER ONLY NEEDS A "position" INPUT
+static inline
+void draw_model_depth(Shader shader, Model* model) {
+    upload_mat4(shader, "transform", create_transformation_matrix(model->pos, model->rotate, model->scale));
+
+    for(Mesh mesh : model->meshes) {
+        glBindVertexArray(mesh.positionVao);
+        glEnableVertexAttribArray(0);
+        glDrawElements(GL_TRIANGLES, mesh.indexcount, GL_UNSIGNED_SHORT, 0);
+        glDisableVertexAttribArray(0);
+        BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+        BMT_STAT_DRAW(GL_TRIANGLES, mesh.indexcount, 1);
+    }
+    glBindVertexArray(0);
+}
+
+static inline
+ModelUniforms get_model_uniforms(Shader shader) {
+    ModelUniforms uniforms;
+    uniforms.transform = get_uniform_location(shader, "transform");
+    uniforms.diffuseColor = get_uniform_location(shader, "diffuseColor");
+    return uniforms;
+}
+
+//SAME AS draw_model BUT ONLY WRITES COMMANDS, SO IT CAN RUN ON ANY THREAD. THE PIPELINE HAS TO BE RECORDED BEFORE IT
+static inline
+void record_model(CommandBuffer* buffer, ModelUniforms uniforms, const Model* model) {
+    record_uniform_mat4(buffer, uniforms.transform, create_transformation_matrix(model->pos, model->rotate, model->scale));
+    for(const Mesh& mesh : model->meshes) {
+        //0 = Position, 1 = Normals, 2 = Texture Coordinates
+        record_bind_vertex_array(buffer, mesh.vao, 0x7);
+        record_uniform_vec4(buffer, uniforms.diffuseColor, model->materials[mesh.material].diffuseColor);
+        record_draw_indexed(buffer, PRIMITIVE_TRIANGLES, mesh.indexcount, INDEX_U16);
+    }
+}
+
+static inline
+void record_model_depth(CommandBuffer* buffer, ModelUniforms uniforms, const Model* model) {
+    record_uniform_mat4(buffer, uniforms.transform, create_transformation_matrix(model->pos, model->rotate, model->scale));
+    for(const Mesh& mesh : model->meshes) {
+        record_bind_vertex_array(buffer, mesh.positionVao, 0x1);
+        record_draw_indexed(buffer, PRIMITIVE_TRIANGLES, mesh.indexcount, INDEX_U16);
+    }
+}
+
 /*
 static inline
 void begin3D(ModelBatch* batch) {
@@ -0,0 +1,317 @@
+#ifndef SHADOWS_H
+#define SHADOWS_H
+
+#include "render.h"
+#include "terrain.h"
+
+//Cascaded shadow maps for one directional light.
+//
+//Every cascade covers the bounding sphere of one slice of the view frustum.
+//A sphere doesn't change size when the camera turns, so the cascade only has
+//to follow the camera's position. Its centre is snapped to a coarse grid in
+//light space, which stops the shadow edges from shimmering and keeps the
+//cascade matrix unchanged for many frames in a row.
+//
+//Models marked isStatic and the terrain are rendered into a separate cached
+//map. That map is only redrawn when the light turns, a cascade moves to a new
+//grid cell or terrain chunks stream in under it. Each frame the cached depth
+//is blitted into the sampled map and only the moving models are drawn over it.
+
+#define SHADOW_MAX_CASCADES     4
+//how far behind a cascade (towards the light) casters are still picked up
+#define SHADOW_CASTER_DISTANCE  100.0f
+
+struct ShadowCascades {
+    u32 count;
+    u32 size;
+    f32 distance;
+
+    //sampled by static.frag as a sampler2DArray, one layer per cascade
+    GLuint depthArray;
+    GLuint staticArray;
+    GLuint fbo;
+    GLuint staticFbo;
+    Shader shader;
+
+    vec3 lightDirection;
+    mat4 lightSpace[SHADOW_MAX_CASCADES];
+    //snapped centre of every cascade, the terrain picks its detail around it
+    vec3 centers[SHADOW_MAX_CASCADES];
+    f32 bias[SHADOW_MAX_CASCADES];
+    f32 splits[SHADOW_MAX_CASCADES + 1];
+
+    //light space grid cell each cached static layer was rendered for
+    i32 cachedCell[SHADOW_MAX_CASCADES][3];
+    vec3 cachedLightDirection;
+    bool staticDirty[SHADOW_MAX_CASCADES];
+
+    //number of static layers redrawn since creation, for checking that the cache works
+    u32 staticRenders;
+};
+
+static inline
+GLuint create_shadow_array(u32 size, u32 count) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, count, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    //anything outside of the map is lit
+    f32 border[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+static inline
+GLuint create_shadow_framebuffer(GLuint texture) {
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        BMT_LOG(WARNING, "Shadow framebuffer #%d not complete!", fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, get_default_framebuffer());
+    return fbo;
+}
+
+//==========================================================================================
+//Description: Creates the shadow maps and the depth-only shader used to fill them
+//
+//Parameters:
+//		-Number of cascades (1 to SHADOW_MAX_CASCADES)
+//		-Width and height of each cascade in texels
+//		-Distance from the camera that the last cascade ends at
+//==========================================================================================
+static inline
+ShadowCascades create_shadow_cascades(u32 count = 3, u32 size = 1024, f32 distance = 150.0f) {
+    ShadowCascades shadows = {0};
+    shadows.count = count < SHADOW_MAX_CASCADES ? count : SHADOW_MAX_CASCADES;
+    shadows.size = size;
+    shadows.distance = distance;
+    shadows.depthArray = create_shadow_array(size, shadows.count);
+    shadows.staticArray = create_shadow_array(size, shadows.count);
+    shadows.fbo = create_shadow_framebuffer(shadows.depthArray);
+    shadows.staticFbo = create_shadow_framebuffer(shadows.staticArray);
+    shadows.shader = load_shader_3D("data/shaders/depth.vert", "data/shaders/depth.frag");
+    for(u32 i = 0; i < shadows.count; ++i) {
+        shadows.lightSpace[i] = identity();
+        shadows.staticDirty[i] = true;
+    }
+    return shadows;
+}
+
+static inline
+void dispose_shadow_cascades(ShadowCascades* shadows) {
+    glDeleteFramebuffers(1, &shadows->fbo);
+    glDeleteFramebuffers(1, &shadows->staticFbo);
+    glDeleteTextures(1, &shadows->depthArray);
+    glDeleteTextures(1, &shadows->staticArray);
+    dispose_shader(shadows->shader);
+    shadows->count = 0;
+}
+
+//==========================================================================================
+//Description: Fits every cascade to the camera and works out which cached layers are stale
+//
+//Parameters:
+//		-The shadow cascades
+//		-The camera's view matrix
+//		-The camera's vertical field of view in degrees, aspect ratio and near plane
+//		-Direction pointing towards the light
+//==========================================================================================
+static inline
+void update_shadow_cascades(ShadowCascades* shadows, mat4 view, f32 fov, f32 aspect, f32 nearPlane, vec3 lightDirection) {
+    lightDirection = normalize(lightDirection);
+    bool lightMoved = !(lightDirection == shadows->cachedLightDirection);
+    shadows->lightDirection = lightDirection;
+    shadows->cachedLightDirection = lightDirection;
+
+    //camera basis and position straight out of the view matrix
+    const f32* e = view.elements;
+    vec3 right = {e[0], e[4], e[8]};
+    vec3 up = {e[1], e[5], e[9]};
+    vec3 forward = {-e[2], -e[6], -e[10]};
+    vec3 eye = {
+        -(e[0] * e[12] + e[1] * e[13] + e[2] * e[14]),
+        -(e[4] * e[12] + e[5] * e[13] + e[6] * e[14]),
+        -(e[8] * e[12] + e[9] * e[13] + e[10] * e[14])
+    };
+
+    //light basis, kept away from a degenerate up vector when the sun is straight overhead
+    vec3 lightForward = -1.0f * lightDirection;
+    vec3 worldUp = fabsf(lightForward.y) > 0.99f ? V3(0, 0, 1) : V3(0, 1, 0);
+    vec3 lightRight = normalize(cross(lightForward, worldUp));
+    vec3 lightUp = cross(lightRight, lightForward);
+
+    //split the frustum between logarithmic and uniform distribution
+    const f32 lambda = 0.75f;
+    f32 farPlane = shadows->distance;
+    for(u32 i = 0; i <= shadows->count; ++i) {
+        f32 t = (f32)i / shadows->count;
+        f32 logarithmic = nearPlane * powf(farPlane / nearPlane, t);
+        f32 uniform = nearPlane + (farPlane - nearPlane) * t;
+        shadows->splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+
+    f32 tanY = tanf(deg_to_rad(fov) * 0.5f);
+    f32 tanX = tanY * aspect;
+    for(u32 i = 0; i < shadows->count; ++i) {
+        f32 sliceNear = shadows->splits[i];
+        f32 sliceFar = shadows->splits[i + 1];
+
+        //bounding sphere of the slice
+        vec3 corners[8];
+        vec3 center = {0, 0, 0};
+        for(u32 c = 0; c < 8; ++c) {
+            f32 d = (c & 4) ? sliceFar : sliceNear;
+            f32 sx = (c & 1) ? 1.0f : -1.0f;
+            f32 sy = (c & 2) ? 1.0f : -1.0f;
+            corners[c] = eye + (d * forward) + ((sx * d * tanX) * right) + ((sy * d * tanY) * up);
+            center = center + corners[c];
+        }
+        center = (1.0f / 8.0f) * center;
+        f32 radius = 0;
+        for(u32 c = 0; c < 8; ++c)
+            radius = fmaxf(radius, length(corners[c] - center));
+        radius = ceilf(radius * 16.0f) / 16.0f;
+
+        //the cascade is a third bigger than the sphere so that its centre can snap to a grid
+        //a quarter of the cascade wide (a whole number of texels) and still contain the sphere
+        f32 halfSize = radius * 4.0f / 3.0f;
+        f32 step = halfSize * 0.5f;
+        i32 cell[3] = {
+            (i32)floorf(dot(center, lightRight) / step + 0.5f),
+            (i32)floorf(dot(center, lightUp) / step + 0.5f),
+            (i32)floorf(dot(center, lightForward) / step + 0.5f)
+        };
+        vec3 snapped = ((cell[0] * step) * lightRight) + ((cell[1] * step) * lightUp) + ((cell[2] * step) * lightForward);
+
+        vec3 lightEye = snapped - ((halfSize + SHADOW_CASTER_DISTANCE) * lightForward);
+        mat4 lightView = look_at(lightEye, lightEye + lightForward, lightUp);
+        f32 depthRange = 2.0f * halfSize + SHADOW_CASTER_DISTANCE;
+        mat4 lightProjection = orthographic_projection(-halfSize, halfSize, halfSize, -halfSize, 0.0f, depthRange);
+        shadows->lightSpace[i] = lightProjection * lightView;
+        shadows->centers[i] = snapped;
+
+        //about two texels of depth, in [0, 1] depth units
+        shadows->bias[i] = 2.0f * (2.0f * halfSize / shadows->size) / depthRange;
+
+        if(lightMoved || cell[0] != shadows->cachedCell[i][0] || cell[1] != shadows->cachedCell[i][1] || cell[2] != shadows->cachedCell[i][2]) {
+            shadows->staticDirty[i] = true;
+            shadows->cachedCell[i][0] = cell[0];
+            shadows->cachedCell[i][1] = cell[1];
+            shadows->cachedCell[i][2] = cell[2];
+        }
+    }
+}
+
+//==========================================================================================
+//Description: Marks the cached layers that a change to static geometry shows up in as stale
+//
+//Parameters:
+//		-The shadow cascades
+//		-World space bounds of the geometry that changed, nothing is marked when min > max
+//==========================================================================================
+static inline
+void mark_shadow_cascades_dirty(ShadowCascades* shadows, vec3 min, vec3 max) {
+    if(min.x > max.x || min.y > max.y || min.z > max.z)
+        return;
+    for(u32 i = 0; i < shadows->count; ++i) {
+        //the cascades are orthographic, so w stays 1 and the corners only need their x, y and z
+        vec3 lo = V3(FLT_MAX, FLT_MAX, FLT_MAX);
+        vec3 hi = V3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        const f32* e = shadows->lightSpace[i].elements;
+        for(u32 c = 0; c < 8; ++c) {
+            vec3 p = V3((c & 1) ? max.x : min.x, (c & 2) ? max.y : min.y, (c & 4) ? max.z : min.z);
+            vec3 q = V3(e[0] * p.x + e[4] * p.y + e[8] * p.z + e[12],
+                        e[1] * p.x + e[5] * p.y + e[9] * p.z + e[13],
+                        e[2] * p.x + e[6] * p.y + e[10] * p.z + e[14]);
+            lo = V3(fminf(lo.x, q.x), fminf(lo.y, q.y), fminf(lo.z, q.z));
+            hi = V3(fmaxf(hi.x, q.x), fmaxf(hi.y, q.y), fmaxf(hi.z, q.z));
+        }
+        if(hi.x >= -1.0f && lo.x <= 1.0f && hi.y >= -1.0f && lo.y <= 1.0f && hi.z >= -1.0f && lo.z <= 1.0f)
+            shadows->staticDirty[i] = true;
+    }
+}
+
+//==========================================================================================
+//Description: Renders the shadow casters of the scene into every cascade
+//
+//Parameters:
+//		-The shadow cascades
+//		-The scene models
+//		-The terrain, or NULL when there is none
+//
+//Comments: Static models and the terrain are only drawn into layers whose cache went stale,
+//          everything else is drawn every frame. Only the position-only vertex streams are
+//          read. Leaves the window framebuffer bound and no shader active, the caller has
+//          to reset the viewport.
+//==========================================================================================
+static inline
+void render_shadow_cascades(ShadowCascades* shadows, std::vector<Model>& scene, Terrain* terrain = NULL) {
+    BMT_PROFILE_FUNCTION();
+    set_viewport(0, 0, shadows->size, shadows->size);
+    //single sided geometry like sails still has to cast a shadow from behind
+    glDisable(GL_CULL_FACE);
+    start_shader(shadows->shader);
+
+    for(u32 i = 0; i < shadows->count; ++i) {
+        upload_mat4(shadows->shader, "lightSpaceMatrix", shadows->lightSpace[i]);
+
+        if(shadows->staticDirty[i]) {
+            glBindFramebuffer(GL_FRAMEBUFFER, shadows->staticFbo);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->staticArray, 0, i);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            for(u32 m = 0; m < scene.size(); ++m)
+                if(scene[m].isStatic)
+                    draw_model_depth(shadows->shader, &scene[m]);
+            //the terrain has its own depth shader, the moving models go back to the cascade's
+            if(terrain) {
+                draw_terrain_depth(terrain, shadows->centers[i], shadows->lightSpace[i]);
+                start_shader(shadows->shader);
+            }
+            shadows->staticDirty[i] = false;
+            shadows->staticRenders++;
+        }
+
+        //start from the cached static depth and add the moving models on top
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, shadows->staticFbo);
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->staticArray, 0, i);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadows->fbo);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->depthArray, 0, i);
+        glBlitFramebuffer(0, 0, shadows->size, shadows->size, 0, 0, shadows->size, shadows->size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, shadows->fbo);
+        for(u32 m = 0; m < scene.size(); ++m)
+            if(!scene[m].isStatic)
+                draw_model_depth(shadows->shader, &scene[m]);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, get_default_framebuffer());
+    stop_shader();
+    glEnable(GL_CULL_FACE);
+}
+
+//Uploads the cascades to a shader using static.frag and binds the maps to the given texture slot.
+static inline
+void bind_shadow_cascades(ShadowCascades* shadows, Shader shader, u32 slot) {
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadows->depthArray);
+    upload_int(shader, "shadowMap", slot);
+    upload_int(shader, "cascadeCount", shadows->count);
+    upload_vec3(shader, "lightDirection", shadows->lightDirection);
+    upload_float_array(shader, "cascadeBias", shadows->bias, shadows->count);
+    for(u32 i = 0; i < shadows->count; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "lightSpaceMatrices[%u]", i);
+        upload_mat4(shader, name, shadows->lightSpace[i]);
+    }
+}
+
+#endif
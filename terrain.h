@@ -0,0 +1,769 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include "render.h"
+#include "ENGINE/cdlod.h"
+#include "ENGINE/jobs.h"
+#include "ENGINE/noise.h"
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+
+//Chunked island terrain drawn with CDLOD.
+//
+//Every quadtree node is a chunk with its own vertex buffer of heights and
+//normals. Chunks are made on request: when selection reaches a chunk that
+//isn't loaded, the chunk is queued. A handful of chunks are then generated
+//on the job system each frame, and the finished ones are uploaded a few per
+//frame. Until a node's children are loaded the node stays whole, so there
+//is always something to draw. Chunks that haven't been drawn for a while
+//are evicted once more than maxResident are loaded. Together with the CDLOD
+//ranges this bounds both the memory use and the vertices drawn.
+//
+//The islands are copies of the heightmap, each with a round falloff,
+//scattered around the harbour. Texturing picks between the layers of a
+//texture array. Grass, mud, flowers and path come from the blend map, and
+//sand and rock are chosen by height and slope.
+
+#define TERRAIN_MAX_ISLANDS     32
+
+#define TERRAIN_CHUNK_QUEUED    0
+#define TERRAIN_CHUNK_WORKING   1
+#define TERRAIN_CHUNK_GENERATED 2
+#define TERRAIN_CHUNK_RESIDENT  3
+
+enum TerrainLayer {
+    TERRAIN_GRASS,
+    TERRAIN_MUD,
+    TERRAIN_FLOWERS,
+    TERRAIN_PATH,
+    TERRAIN_SAND,
+    TERRAIN_ROCK,
+    TERRAIN_LAYER_COUNT
+};
+
+struct Island {
+    vec2 center;
+    f32 radius;
+    f32 height;
+    //where the island starts reading the tiling heightmap and blend map, so no two look alike
+    vec2 mapOffset;
+};
+
+struct Terrain;
+
+struct TerrainChunk {
+    Terrain* terrain;
+    u32 level;
+    i32 x;
+    i32 z;
+    std::atomic<u32> state;
+    f32 minHeight;
+    f32 maxHeight;
+    //height, morph target height, normal x and normal z of every vertex, freed after the upload
+    vec4* vertices;
+    GLuint vao;
+    GLuint vbo;
+    u64 lastUsed;
+};
+
+struct Terrain {
+    CDLOD lod;
+    f32 worldSize;
+    f32 seaFloor;
+
+    //the heightmap and blend map images, sampled on the CPU by the chunk jobs
+    f32* heightmap;
+    u32* blendmap;
+    i32 mapWidth;
+    i32 mapHeight;
+    Island islands[TERRAIN_MAX_ISLANDS];
+    u32 islandCount;
+    //ridged noise roughening the islands above the sea floor
+    Noise detail;
+    f32 detailHeight;
+
+    std::unordered_map<u64, TerrainChunk*> chunks;
+    std::vector<TerrainChunk*> queue;
+    std::vector<TerrainChunk*> working;
+    JobCounter jobs;
+    u32 maxJobsPerFrame;
+    u32 maxUploadsPerFrame;
+    u32 maxResident;
+    u32 resident;
+    u64 frame;
+
+    //grid positions shared by every chunk, and one index buffer holding the full grid
+    //followed by its four quarters
+    GLuint gridVbo;
+    GLuint ebo;
+    u32 indexOffset[5];
+    u32 indexCount[5];
+
+    Shader shader;
+    //position only, for the shadow maps
+    Shader depthShader;
+    GLuint layers;
+    Texture blendTexture;
+
+    //bounds of the chunks the last update uploaded or evicted, min above max when none did
+    vec3 changedMin;
+    vec3 changedMax;
+
+    //stats of the last draw
+    u32 drawnChunks;
+    u32 drawnVertices;
+};
+
+static inline
+u64 terrain_chunk_key(u32 level, i32 x, i32 z) {
+    return ((u64)level << 32) | ((u64)(u16)x << 16) | (u64)(u16)z;
+}
+
+//bilinear, wrapping sample of an image stored as floats
+static inline
+f32 sample_terrain_map(const f32* map, i32 width, i32 height, f32 u, f32 v) {
+    f32 x = u * width - 0.5f;
+    f32 y = v * height - 0.5f;
+    f32 fx = floorf(x);
+    f32 fy = floorf(y);
+    f32 tx = x - fx;
+    f32 ty = y - fy;
+    i32 x0 = (((i32)fx % width) + width) % width;
+    i32 y0 = (((i32)fy % height) + height) % height;
+    i32 x1 = (x0 + 1) % width;
+    i32 y1 = (y0 + 1) % height;
+    f32 top = map[y0 * width + x0] * (1 - tx) + map[y0 * width + x1] * tx;
+    f32 bottom = map[y1 * width + x0] * (1 - tx) + map[y1 * width + x1] * tx;
+    return top * (1 - ty) + bottom * ty;
+}
+
+//how far inside an island a point is, 1 in the middle fading to 0 at its radius
+static inline
+f32 island_falloff(const Island* island, f32 x, f32 z) {
+    f32 dx = x - island->center.x;
+    f32 dz = z - island->center.y;
+    f32 distance = sqrtf(dx * dx + dz * dz) / island->radius;
+    if(distance >= 1.0f)
+        return 0.0f;
+    f32 t = distance < 0.35f ? 0.0f : (distance - 0.35f) / 0.65f;
+    return 1.0f - t * t * (3.0f - 2.0f * t);
+}
+
+//height of the islands without the detail noise, and how far inland the point is
+static inline
+f32 island_height(const Terrain* terrain, f32 x, f32 z, f32* inland) {
+    f32 height = terrain->seaFloor;
+    *inland = 0.0f;
+    for(u32 i = 0; i < terrain->islandCount; ++i) {
+        const Island* island = &terrain->islands[i];
+        f32 falloff = island_falloff(island, x, z);
+        if(falloff <= 0.0f)
+            continue;
+        f32 u = (x - island->center.x) / (island->radius * 2.0f) + island->mapOffset.x;
+        f32 v = (z - island->center.y) / (island->radius * 2.0f) + island->mapOffset.y;
+        f32 shape = sample_terrain_map(terrain->heightmap, terrain->mapWidth, terrain->mapHeight, u, v);
+        f32 islandHeight = terrain->seaFloor + falloff * (island->height * (0.4f + shape) - terrain->seaFloor);
+        if(islandHeight > height)
+            height = islandHeight;
+        if(falloff > *inland)
+            *inland = falloff;
+    }
+    return height;
+}
+
+//==========================================================================================
+//Description: Returns the height of the terrain at a world space position
+//
+//Comments: Safe to call from any thread. The chunk jobs compute the same height a grid at
+//          a time, with the detail noise generated four samples at once
+//==========================================================================================
+static inline
+f32 terrain_height(const Terrain* terrain, f32 x, f32 z) {
+    f32 inland;
+    f32 height = island_height(terrain, x, z, &inland);
+    return height + inland * terrain->detailHeight * noise_2D(&terrain->detail, x, z);
+}
+
+static inline
+void generate_terrain_chunk(void* data) {
+    BMT_PROFILE_FUNCTION();
+    TerrainChunk* chunk = (TerrainChunk*)data;
+    const Terrain* terrain = chunk->terrain;
+    const i32 cells = terrain->lod.resolution;
+    const i32 stride = cells + 3;
+    f32 size = terrain->lod.leafSize * (f32)(1 << chunk->level);
+    f32 spacing = size / cells;
+    f32 originX = chunk->x * size;
+    f32 originZ = chunk->z * size;
+
+    //heights with a one cell border so every vertex has neighbours for its normal
+    std::vector<f32> heights(stride * stride);
+    NoiseRows rows = { &terrain->detail, &heights[0], (u32)stride, originX - spacing, originZ - spacing, spacing };
+    generate_noise_rows(&rows, 0, stride);
+    for(i32 z = 0; z < stride; ++z) {
+        for(i32 x = 0; x < stride; ++x) {
+            f32 inland;
+            f32 height = island_height(terrain, originX + (x - 1) * spacing, originZ + (z - 1) * spacing, &inland);
+            heights[z * stride + x] = height + inland * terrain->detailHeight * heights[z * stride + x];
+        }
+    }
+
+    chunk->vertices = (vec4*)malloc((cells + 1) * (cells + 1) * sizeof(vec4));
+    f32 minHeight = heights[stride + 1];
+    f32 maxHeight = minHeight;
+    for(i32 z = 0; z <= cells; ++z) {
+        for(i32 x = 0; x <= cells; ++x) {
+            const f32* h = &heights[(z + 1) * stride + (x + 1)];
+            //odd vertices morph onto their even neighbour, so they morph to its height too
+            f32 morph = heights[((z & ~1) + 1) * stride + (x & ~1) + 1];
+            vec3 normal = normalize(V3(h[-1] - h[1], 2.0f * spacing, h[-stride] - h[stride]));
+            chunk->vertices[z * (cells + 1) + x] = V4(h[0], morph, normal.x, normal.z);
+            minHeight = h[0] < minHeight ? h[0] : minHeight;
+            maxHeight = h[0] > maxHeight ? h[0] : maxHeight;
+        }
+    }
+    chunk->minHeight = minHeight;
+    chunk->maxHeight = maxHeight;
+    chunk->state.store(TERRAIN_CHUNK_GENERATED, std::memory_order_release);
+}
+
+//grows the changed bounds by a chunk that was just uploaded or evicted
+static inline
+void mark_terrain_chunk_changed(Terrain* terrain, TerrainChunk* chunk) {
+    f32 size = terrain->lod.leafSize * (f32)(1 << chunk->level);
+    vec3 min = V3(chunk->x * size, chunk->minHeight, chunk->z * size);
+    vec3 max = V3(min.x + size, chunk->maxHeight, min.z + size);
+    terrain->changedMin = V3(fminf(terrain->changedMin.x, min.x), fminf(terrain->changedMin.y, min.y), fminf(terrain->changedMin.z, min.z));
+    terrain->changedMax = V3(fmaxf(terrain->changedMax.x, max.x), fmaxf(terrain->changedMax.y, max.y), fmaxf(terrain->changedMax.z, max.z));
+}
+
+static inline
+void upload_terrain_chunk(Terrain* terrain, TerrainChunk* chunk) {
+    u32 vertexCount = (terrain->lod.resolution + 1) * (terrain->lod.resolution + 1);
+    glGenVertexArrays(1, &chunk->vao);
+    glBindVertexArray(chunk->vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, terrain->gridVbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), (const GLvoid*)0);
+
+    glGenBuffers(1, &chunk->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk->vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(vec4), chunk->vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(vec4), (const GLvoid*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain->ebo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    free(chunk->vertices);
+    chunk->vertices = NULL;
+    chunk->state.store(TERRAIN_CHUNK_RESIDENT, std::memory_order_relaxed);
+    terrain->resident++;
+    mark_terrain_chunk_changed(terrain, chunk);
+}
+
+static inline
+void evict_terrain_chunk(Terrain* terrain, TerrainChunk* chunk) {
+    terrain->chunks.erase(terrain_chunk_key(chunk->level, chunk->x, chunk->z));
+    if(chunk->vao) {
+        glDeleteVertexArrays(1, &chunk->vao);
+        glDeleteBuffers(1, &chunk->vbo);
+        terrain->resident--;
+        mark_terrain_chunk_changed(terrain, chunk);
+    }
+    free(chunk->vertices);
+    delete chunk;
+}
+
+//CDLODNodeFunc of the terrain, queues every chunk that selection asks for but isn't loaded
+static inline
+bool terrain_node_ready(void* data, u32 level, i32 x, i32 z, f32* minHeight, f32* maxHeight) {
+    Terrain* terrain = (Terrain*)data;
+    u64 key = terrain_chunk_key(level, x, z);
+    auto found = terrain->chunks.find(key);
+    TerrainChunk* chunk;
+    if(found == terrain->chunks.end()) {
+        chunk = new TerrainChunk();
+        chunk->terrain = terrain;
+        chunk->level = level;
+        chunk->x = x;
+        chunk->z = z;
+        chunk->state.store(TERRAIN_CHUNK_QUEUED);
+        chunk->vertices = NULL;
+        chunk->vao = 0;
+        chunk->vbo = 0;
+        terrain->chunks[key] = chunk;
+        terrain->queue.push_back(chunk);
+    }
+    else {
+        chunk = found->second;
+    }
+    chunk->lastUsed = terrain->frame;
+    if(chunk->state.load(std::memory_order_relaxed) != TERRAIN_CHUNK_RESIDENT)
+        return false;
+    *minHeight = chunk->minHeight;
+    *maxHeight = chunk->maxHeight;
+    return true;
+}
+
+static inline
+void create_terrain_meshes(Terrain* terrain) {
+    const u32 cells = terrain->lod.resolution;
+    std::vector<vec2> grid;
+    for(u32 z = 0; z <= cells; ++z)
+        for(u32 x = 0; x <= cells; ++x)
+            grid.push_back(V2((f32)x, (f32)z));
+
+    //the full grid, then each quarter of it in the order the CDLOD children are numbered
+    std::vector<GLushort> indices;
+    for(u32 part = 0; part < 5; ++part) {
+        u32 count = part == 0 ? cells : cells / 2;
+        u32 startX = part == 0 ? 0 : ((part - 1) & 1) * count;
+        u32 startZ = part == 0 ? 0 : ((part - 1) >> 1) * count;
+        terrain->indexOffset[part] = indices.size();
+        for(u32 z = startZ; z < startZ + count; ++z) {
+            for(u32 x = startX; x < startX + count; ++x) {
+                GLushort topLeft = z * (cells + 1) + x;
+                GLushort bottomLeft = topLeft + cells + 1;
+                indices.push_back(topLeft);
+                indices.push_back(bottomLeft);
+                indices.push_back(topLeft + 1);
+                indices.push_back(topLeft + 1);
+                indices.push_back(bottomLeft);
+                indices.push_back(bottomLeft + 1);
+            }
+        }
+        terrain->indexCount[part] = indices.size() - terrain->indexOffset[part];
+    }
+
+    glGenBuffers(1, &terrain->gridVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, terrain->gridVbo);
+    glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(vec2), &grid[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &terrain->ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+//small hash for the procedural layer textures
+static inline
+f32 terrain_hash(u32 x, u32 y, u32 seed) {
+    u32 h = x * 374761393u + y * 668265263u + seed * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return ((h ^ (h >> 16)) & 0xFFFF) / 65535.0f;
+}
+
+//==========================================================================================
+//Description: Fills a texture array with one tiling texture per terrain layer
+//
+//Comments: The repo has no terrain textures, so the layers are generated: a base colour
+//          with a few octaves of tiling value noise on top.
+//==========================================================================================
+static inline
+GLuint create_terrain_layers(u32 size) {
+    const vec3 colors[TERRAIN_LAYER_COUNT] = {
+        {0.30f, 0.52f, 0.20f},  //grass
+        {0.38f, 0.28f, 0.18f},  //mud
+        {0.52f, 0.50f, 0.30f},  //flowers
+        {0.62f, 0.55f, 0.42f},  //path
+        {0.86f, 0.78f, 0.56f},  //sand
+        {0.46f, 0.45f, 0.44f},  //rock
+    };
+    std::vector<u32> pixels(size * size * TERRAIN_LAYER_COUNT);
+    for(u32 layer = 0; layer < TERRAIN_LAYER_COUNT; ++layer) {
+        for(u32 y = 0; y < size; ++y) {
+            for(u32 x = 0; x < size; ++x) {
+                f32 noise = 0.0f;
+                f32 weight = 0.5f;
+                for(u32 cell = 8; cell <= size; cell *= 2, weight *= 0.5f) {
+                    u32 period = size / cell;
+                    f32 fx = (f32)x / period;
+                    f32 fy = (f32)y / period;
+                    u32 x0 = (u32)fx, y0 = (u32)fy;
+                    f32 tx = fx - x0, ty = fy - y0;
+                    f32 top = terrain_hash(x0 % cell, y0 % cell, layer) * (1 - tx) + terrain_hash((x0 + 1) % cell, y0 % cell, layer) * tx;
+                    f32 bottom = terrain_hash(x0 % cell, (y0 + 1) % cell, layer) * (1 - tx) + terrain_hash((x0 + 1) % cell, (y0 + 1) % cell, layer) * tx;
+                    noise += (top * (1 - ty) + bottom * ty) * weight;
+                }
+                f32 shade = 0.75f + 0.5f * noise;
+                u32 r = (u32)fminf(colors[layer].x * shade * 255.0f, 255.0f);
+                u32 g = (u32)fminf(colors[layer].y * shade * 255.0f, 255.0f);
+                u32 b = (u32)fminf(colors[layer].z * shade * 255.0f, 255.0f);
+                pixels[(layer * size + y) * size + x] = r | (g << 8) | (b << 16) | (255u << 24);
+            }
+        }
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, TERRAIN_LAYER_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+struct TerrainBlendRows {
+    Terrain* terrain;
+    u32* pixels;
+    u32 size;
+};
+
+//the blend map of the whole world, every island stamps its own part of blendmap.png
+static inline
+void build_terrain_blend_rows(void* data, u32 begin, u32 end) {
+    TerrainBlendRows* rows = (TerrainBlendRows*)data;
+    const Terrain* terrain = rows->terrain;
+    for(u32 y = begin; y < end; ++y) {
+        for(u32 x = 0; x < rows->size; ++x) {
+            f32 worldX = ((x + 0.5f) / rows->size - 0.5f) * terrain->worldSize;
+            f32 worldZ = ((y + 0.5f) / rows->size - 0.5f) * terrain->worldSize;
+            u32 pixel = 0;
+            f32 strongest = 0.0f;
+            for(u32 i = 0; i < terrain->islandCount; ++i) {
+                const Island* island = &terrain->islands[i];
+                f32 falloff = island_falloff(island, worldX, worldZ);
+                if(falloff <= strongest)
+                    continue;
+                strongest = falloff;
+                f32 u = (worldX - island->center.x) / (island->radius * 2.0f) + island->mapOffset.x;
+                f32 v = (worldZ - island->center.y) / (island->radius * 2.0f) + island->mapOffset.y;
+                i32 px = ((i32)floorf(u * terrain->mapWidth) % terrain->mapWidth + terrain->mapWidth) % terrain->mapWidth;
+                i32 py = ((i32)floorf(v * terrain->mapHeight) % terrain->mapHeight + terrain->mapHeight) % terrain->mapHeight;
+                pixel = terrain->blendmap[py * terrain->mapWidth + px];
+            }
+            rows->pixels[y * rows->size + x] = pixel;
+        }
+    }
+}
+
+static inline
+bool load_terrain_maps(Terrain* terrain, const char* heightmapFile, const char* blendmapFile) {
+    i32 width, height, blendWidth, blendHeight;
+    unsigned char* heightPixels = SOIL_load_image(heightmapFile, &width, &height, 0, SOIL_LOAD_L);
+    unsigned char* blendPixels = SOIL_load_image(blendmapFile, &blendWidth, &blendHeight, 0, SOIL_LOAD_RGBA);
+    if(heightPixels == NULL || blendPixels == NULL || width != blendWidth || height != blendHeight) {
+        BMT_LOG(WARNING, "Could not load terrain maps %s and %s", heightmapFile, blendmapFile);
+        if(heightPixels)
+            SOIL_free_image_data(heightPixels);
+        if(blendPixels)
+            SOIL_free_image_data(blendPixels);
+        return false;
+    }
+
+    terrain->mapWidth = width;
+    terrain->mapHeight = height;
+    terrain->heightmap = (f32*)malloc(width * height * sizeof(f32));
+    terrain->blendmap = (u32*)malloc(width * height * sizeof(u32));
+    for(i32 i = 0; i < width * height; ++i)
+        terrain->heightmap[i] = heightPixels[i] / 255.0f;
+    memcpy(terrain->blendmap, blendPixels, width * height * sizeof(u32));
+    SOIL_free_image_data(heightPixels);
+    SOIL_free_image_data(blendPixels);
+    return true;
+}
+
+static inline
+Shader load_terrain_shader() {
+    Shader shader = { 0 };
+    shader.vertexshaderID = load_shader_file("data/shaders/terrain.vert", GL_VERTEX_SHADER);
+    shader.fragshaderID = load_shader_file("data/shaders/terrain.frag", GL_FRAGMENT_SHADER);
+    shader.ID = glCreateProgram();
+
+    glAttachShader(shader.ID, shader.vertexshaderID);
+    glAttachShader(shader.ID, shader.fragshaderID);
+    glBindFragDataLocation(shader.ID, 0, "outColor");
+    glBindAttribLocation(shader.ID, 0, "position");
+    glBindAttribLocation(shader.ID, 1, "heights");
+    glLinkProgram(shader.ID);
+    glValidateProgram(shader.ID);
+
+    start_shader(shader);
+    upload_int(shader, "layers", 0);
+    upload_int(shader, "blendMap", 1);
+    stop_shader();
+    return shader;
+}
+
+static inline
+Shader load_terrain_depth_shader() {
+    Shader shader = { 0 };
+    shader.vertexshaderID = load_shader_file("data/shaders/terrain_depth.vert", GL_VERTEX_SHADER);
+    shader.fragshaderID = load_shader_file("data/shaders/depth.frag", GL_FRAGMENT_SHADER);
+    shader.ID = glCreateProgram();
+
+    glAttachShader(shader.ID, shader.vertexshaderID);
+    glAttachShader(shader.ID, shader.fragshaderID);
+    glBindAttribLocation(shader.ID, 0, "position");
+    glBindAttribLocation(shader.ID, 1, "heights");
+    glLinkProgram(shader.ID);
+    glValidateProgram(shader.ID);
+    return shader;
+}
+
+//==========================================================================================
+//Description: Creates an archipelago around the origin and loads its coarsest chunks
+//
+//Parameters:
+//		-The terrain to initialize
+//		-Heightmap and blend map images, both the same size
+//		-Number of islands, and the seed that places them
+//
+//Comments: The islands stay out of the harbour within harbourRadius of the origin
+//==========================================================================================
+static inline
+void init_terrain(Terrain* terrain, const char* heightmapFile, const char* blendmapFile, u32 islands = 24, u32 seed = 7, f32 harbourRadius = 320.0f) {
+    BMT_PROFILE_FUNCTION();
+    terrain->worldSize = 4096.0f;
+    terrain->seaFloor = -15.0f;
+    terrain->maxJobsPerFrame = 8;
+    terrain->maxUploadsPerFrame = 8;
+    terrain->maxResident = 512;
+    terrain->resident = 0;
+    terrain->frame = 0;
+    terrain->changedMin = V3(FLT_MAX, FLT_MAX, FLT_MAX);
+    terrain->changedMax = V3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    terrain->heightmap = NULL;
+    terrain->blendmap = NULL;
+    terrain->detail = create_noise(seed, NOISE_PERLIN, NOISE_RIDGED, 5, 1.0f / 48.0f);
+    terrain->detailHeight = 6.0f;
+
+    //32 cells per chunk, 1 unit apart at the finest level, and two 2048 unit roots per side
+    terrain->lod = create_cdlod(7, 32, 32.0f);
+    terrain->lod.nodeFunc = terrain_node_ready;
+    terrain->lod.nodeData = terrain;
+    terrain->lod.bounded = true;
+    terrain->lod.rootBegin[0] = terrain->lod.rootBegin[1] = -1;
+    terrain->lod.rootEnd[0] = terrain->lod.rootEnd[1] = 1;
+
+    if(!load_terrain_maps(terrain, heightmapFile, blendmapFile)) {
+        terrain->mapWidth = terrain->mapHeight = 1;
+        terrain->heightmap = (f32*)calloc(1, sizeof(f32));
+        terrain->blendmap = (u32*)calloc(1, sizeof(u32));
+    }
+
+    u32 state = seed;
+    terrain->islandCount = islands < TERRAIN_MAX_ISLANDS ? islands : TERRAIN_MAX_ISLANDS;
+    for(u32 i = 0; i < terrain->islandCount; ++i) {
+        Island* island = &terrain->islands[i];
+        state = state * 1664525u + 1013904223u;
+        f32 angle = (state >> 8) / 16777216.0f * 2.0f * PI;
+        state = state * 1664525u + 1013904223u;
+        island->radius = 80.0f + (state >> 8) / 16777216.0f * 180.0f;
+        state = state * 1664525u + 1013904223u;
+        f32 distance = harbourRadius + island->radius + (state >> 8) / 16777216.0f * (terrain->worldSize * 0.5f - harbourRadius - island->radius * 2.0f);
+        island->center = V2(cosf(angle) * distance, sinf(angle) * distance);
+        state = state * 1664525u + 1013904223u;
+        island->height = 20.0f + (state >> 8) / 16777216.0f * 40.0f;
+        state = state * 1664525u + 1013904223u;
+        island->mapOffset = V2((state & 0xFFFF) / 65536.0f, (state >> 16) / 65536.0f);
+    }
+
+    create_terrain_meshes(terrain);
+    terrain->shader = load_terrain_shader();
+    terrain->depthShader = load_terrain_depth_shader();
+    terrain->layers = create_terrain_layers(128);
+
+    const u32 blendSize = 1024;
+    std::vector<u32> pixels(blendSize * blendSize);
+    TerrainBlendRows rows = { terrain, &pixels[0], blendSize };
+    parallel_for(blendSize, 32, build_terrain_blend_rows, &rows);
+    terrain->blendTexture = load_texture((unsigned char*)&pixels[0], blendSize, blendSize, GL_LINEAR);
+
+    //the roots are loaded right away so there is always something to draw
+    std::vector<TerrainChunk*> roots;
+    u32 top = terrain->lod.levels - 1;
+    for(i32 z = terrain->lod.rootBegin[1]; z < terrain->lod.rootEnd[1]; ++z) {
+        for(i32 x = terrain->lod.rootBegin[0]; x < terrain->lod.rootEnd[0]; ++x) {
+            f32 minHeight, maxHeight;
+            terrain_node_ready(terrain, top, x, z, &minHeight, &maxHeight);
+            roots.push_back(terrain->chunks[terrain_chunk_key(top, x, z)]);
+        }
+    }
+    terrain->queue.clear();
+    for(u32 i = 0; i < roots.size(); ++i)
+        run_job(generate_terrain_chunk, roots[i], &terrain->jobs);
+    wait_for_jobs(&terrain->jobs);
+    for(u32 i = 0; i < roots.size(); ++i)
+        upload_terrain_chunk(terrain, roots[i]);
+}
+
+static inline
+void dispose_terrain(Terrain* terrain) {
+    wait_for_jobs(&terrain->jobs);
+    std::vector<TerrainChunk*> chunks;
+    for(auto& pair : terrain->chunks)
+        chunks.push_back(pair.second);
+    for(u32 i = 0; i < chunks.size(); ++i)
+        evict_terrain_chunk(terrain, chunks[i]);
+    terrain->queue.clear();
+    terrain->working.clear();
+    glDeleteBuffers(1, &terrain->gridVbo);
+    glDeleteBuffers(1, &terrain->ebo);
+    glDeleteTextures(1, &terrain->layers);
+    dispose_texture(terrain->blendTexture);
+    dispose_shader(terrain->shader);
+    dispose_shader(terrain->depthShader);
+    free(terrain->heightmap);
+    free(terrain->blendmap);
+}
+
+//==========================================================================================
+//Description: Uploads finished chunks, starts generating queued ones and evicts old ones
+//
+//Comments: Call once per frame before drawing. Never waits on the job system
+//==========================================================================================
+static inline
+void update_terrain(Terrain* terrain) {
+    BMT_PROFILE_FUNCTION();
+    terrain->frame++;
+    terrain->changedMin = V3(FLT_MAX, FLT_MAX, FLT_MAX);
+    terrain->changedMax = V3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    u32 uploads = 0;
+    for(u32 i = 0; i < terrain->working.size() && uploads < terrain->maxUploadsPerFrame;) {
+        TerrainChunk* chunk = terrain->working[i];
+        if(chunk->state.load(std::memory_order_acquire) == TERRAIN_CHUNK_GENERATED) {
+            upload_terrain_chunk(terrain, chunk);
+            terrain->working[i] = terrain->working.back();
+            terrain->working.pop_back();
+            uploads++;
+        }
+        else {
+            ++i;
+        }
+    }
+
+    //requests nobody asked for again since the last frame are dropped, the rest start
+    //coarsest first because those fill the biggest holes
+    u32 kept = 0;
+    for(u32 i = 0; i < terrain->queue.size(); ++i) {
+        TerrainChunk* chunk = terrain->queue[i];
+        if(chunk->lastUsed + 1 < terrain->frame)
+            evict_terrain_chunk(terrain, chunk);
+        else
+            terrain->queue[kept++] = chunk;
+    }
+    terrain->queue.resize(kept);
+    std::sort(terrain->queue.begin(), terrain->queue.end(), [](TerrainChunk* a, TerrainChunk* b) { return a->level < b->level; });
+    for(u32 started = 0; started < terrain->maxJobsPerFrame && !terrain->queue.empty(); ++started) {
+        TerrainChunk* chunk = terrain->queue.back();
+        terrain->queue.pop_back();
+        chunk->state.store(TERRAIN_CHUNK_WORKING, std::memory_order_relaxed);
+        terrain->working.push_back(chunk);
+        run_job(generate_terrain_chunk, chunk, &terrain->jobs);
+    }
+
+    if(terrain->resident > terrain->maxResident) {
+        std::vector<TerrainChunk*> candidates;
+        u32 top = terrain->lod.levels - 1;
+        for(auto& pair : terrain->chunks) {
+            TerrainChunk* chunk = pair.second;
+            if(chunk->level != top && chunk->lastUsed + 1 < terrain->frame && chunk->state.load(std::memory_order_relaxed) == TERRAIN_CHUNK_RESIDENT)
+                candidates.push_back(chunk);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](TerrainChunk* a, TerrainChunk* b) { return a->lastUsed < b->lastUsed; });
+        for(u32 i = 0; i < candidates.size() && terrain->resident > terrain->maxResident; ++i)
+            evict_terrain_chunk(terrain, candidates[i]);
+    }
+}
+
+//draws the selected nodes whose chunks are loaded, the shader must be started and bound to the cdlod
+static inline
+void draw_terrain_nodes(Terrain* terrain, Shader shader) {
+    u32 cells = terrain->lod.resolution;
+    std::vector<CDLODNode>* lists[] = { &terrain->lod.nodes, &terrain->lod.quarters };
+    for(u32 list = 0; list < 2; ++list) {
+        for(u32 i = 0; i < lists[list]->size(); ++i) {
+            CDLODNode node = (*lists[list])[i];
+            u32 level = (u32)node.level;
+            f32 size = node.spacing * cells;
+            i32 x = (i32)floorf(node.x / size);
+            i32 z = (i32)floorf(node.z / size);
+            auto found = terrain->chunks.find(terrain_chunk_key(level, x, z));
+            if(found == terrain->chunks.end() || found->second->vao == 0)
+                continue;
+            //quarters draw the part of their parent's grid that lies under them
+            u32 part = 0;
+            if(list == 1)
+                part = 1 + (node.x > x * size ? 1 : 0) + (node.z > z * size ? 2 : 0);
+
+            upload_vec4(shader, "node", V4(x * size, z * size, node.spacing, node.level));
+            glBindVertexArray(found->second->vao);
+            glDrawElements(GL_TRIANGLES, terrain->indexCount[part], GL_UNSIGNED_SHORT, (const GLvoid*)(terrain->indexOffset[part] * sizeof(GLushort)));
+            BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+            BMT_STAT_DRAW(GL_TRIANGLES, terrain->indexCount[part], 1);
+            terrain->drawnChunks++;
+            terrain->drawnVertices += part == 0 ? (cells + 1) * (cells + 1) : (cells / 2 + 1) * (cells / 2 + 1);
+        }
+    }
+    glBindVertexArray(0);
+}
+
+//==========================================================================================
+//Description: Selects, culls and draws the terrain from the given camera
+//
+//Parameters:
+//		-Camera position and matrices
+//		-Light direction and a world space clip plane, (0, 1, 0, 0) keeps what is above the water
+//==========================================================================================
+static inline
+void draw_terrain(Terrain* terrain, vec3 camera, mat4 projection, mat4 view, vec3 lightDirection, vec4 clipPlane = V4(0, 0, 0, 1)) {
+    BMT_PROFILE_FUNCTION();
+    select_cdlod(&terrain->lod, camera, projection * view);
+
+    Shader shader = terrain->shader;
+    start_shader(shader);
+    upload_mat4(shader, "projection", projection);
+    upload_mat4(shader, "view", view);
+    upload_vec3(shader, "cameraPos", camera);
+    upload_vec3(shader, "lightDirection", lightDirection);
+    upload_vec4(shader, "clipPlane", clipPlane);
+    upload_float(shader, "worldSize", terrain->worldSize);
+    bind_cdlod(&terrain->lod, shader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, terrain->layers);
+    bind_texture(terrain->blendTexture, 1);
+
+    terrain->drawnChunks = 0;
+    terrain->drawnVertices = 0;
+    draw_terrain_nodes(terrain, shader);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    stop_shader();
+}
+
+//==========================================================================================
+//Description: Draws the depth of the terrain into the bound framebuffer, for shadow maps
+//
+//Parameters:
+//		-The point the level of detail is picked around
+//		-Light space matrix of the map, whose frustum culls the terrain
+//
+//Comments: Leaves no shader active. The chunks counted in the draw stats are reset by the
+//          next draw_terrain()
+//==========================================================================================
+static inline
+void draw_terrain_depth(Terrain* terrain, vec3 center, mat4 lightSpace) {
+    BMT_PROFILE_FUNCTION();
+    select_cdlod(&terrain->lod, center, lightSpace);
+
+    Shader shader = terrain->depthShader;
+    start_shader(shader);
+    upload_mat4(shader, "lightSpaceMatrix", lightSpace);
+    upload_vec3(shader, "cameraPos", center);
+    bind_cdlod(&terrain->lod, shader);
+    draw_terrain_nodes(terrain, shader);
+    stop_shader();
+}
+
+#endif
@@ -0,0 +1,689 @@
+///////////////////////////////////////////////////////////////////////////
+// FILE:                        gl_replay.cpp                            //
+///////////////////////////////////////////////////////////////////////////
+//                      BAHAMUT GRAPHICS LIBRARY                         //
+//                        Author: Corbin Stark                           //
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019 Corbin Stark                                       //
+//                                                                       //
+// Permission is hereby granted, free of charge, to any person obtaining //
+// a copy of this software and associated documentation files (the       //
+// "Software"), to deal in the Software without restriction, including   //
+// without limitation the rights to use, copy, modify, merge, publish,   //
+// distribute, sublicense, and/or sell copies of the Software, and to    //
+// permit persons to whom the Software is furnished to do so, subject to //
+// the following conditions:                                             //
+//                                                                       //
+// The above copyright notice and this permission notice shall be        //
+// included in all copies or substantial portions of the Software.       //
+//                                                                       //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.//
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  //
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  //
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     //
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                //
+///////////////////////////////////////////////////////////////////////////
+
+
+//Replays a capture written by engine/gl_capture.cpp and times every call.
+//
+//		gl_replay capture.bin [--loops N] [--sync] [--csv calls.csv] [--top N]
+//
+//The setup stream runs once, untimed. The frames then run --loops times, each call
+//timed on the CPU and each frame timed on the GPU with a pair of timestamp queries.
+//--sync puts a glFinish after every call so the per-call times include the GPU's
+//share of the work. That is slow, but it shows which draw a hitch came from.
+//Object state carries over from one loop to the next, the frames are not reset.
+
+#include "../engine/defines.h"
+#include "../engine/window.h"
+#include "../engine/gl_capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+struct ReplayReader {
+	const u8* at;
+	const u8* end;
+};
+
+INTERNAL inline
+void read_bytes(ReplayReader* reader, void* out, u64 size) {
+	if (reader->at + size > reader->end) {
+		memset(out, 0, size);
+		reader->at = reader->end;
+		return;
+	}
+	memcpy(out, reader->at, size);
+	reader->at += size;
+}
+
+INTERNAL inline u32 read_u32(ReplayReader* reader) { u32 value; read_bytes(reader, &value, sizeof(value)); return value; }
+INTERNAL inline i32 read_i32(ReplayReader* reader) { i32 value; read_bytes(reader, &value, sizeof(value)); return value; }
+INTERNAL inline f32 read_f32(ReplayReader* reader) { f32 value; read_bytes(reader, &value, sizeof(value)); return value; }
+INTERNAL inline u64 read_u64(ReplayReader* reader) { u64 value; read_bytes(reader, &value, sizeof(value)); return value; }
+
+//memory is not copied out, the pointer is into the loaded file
+INTERNAL inline
+const void* read_memory(ReplayReader* reader, u64* size = NULL) {
+	u64 length = read_u64(reader);
+	if (reader->at + length > reader->end)
+		length = reader->end - reader->at;
+	const void* data = reader->at;
+	reader->at += length;
+	if (size)
+		*size = length;
+	return data;
+}
+
+INTERNAL inline
+std::string read_string(ReplayReader* reader) {
+	u64 length;
+	const char* data = (const char*)read_memory(reader, &length);
+	return std::string(data, length);
+}
+
+//captured names to the names this context handed out
+typedef std::unordered_map<u32, GLuint> NameMap;
+
+struct Replay {
+	NameMap buffers;
+	NameMap textures;
+	NameMap framebuffers;
+	NameMap renderbuffers;
+	NameMap vertexArrays;
+	NameMap shaders;
+	NameMap programs;
+	NameMap queries;
+	std::unordered_map<u64, GLsync> syncs;
+	std::unordered_map<u64, GLint> locations;
+	std::unordered_map<u32, u8*> mapped;
+	u32 defaultFramebuffer;
+	u32 program;
+	std::vector<u8> scratch;
+	u32 unknownNames;
+};
+
+struct CallStats {
+	u64 count;
+	f64 totalMs;
+	f64 maxMs;
+};
+
+INTERNAL inline
+GLuint lookup(Replay* replay, NameMap& names, u32 name) {
+	if (name == 0)
+		return 0;
+	NameMap::iterator it = names.find(name);
+	if (it != names.end())
+		return it->second;
+	replay->unknownNames++;
+	return 0;
+}
+
+INTERNAL inline
+GLuint lookup_framebuffer(Replay* replay, u32 name) {
+	if (name == 0 || name == replay->defaultFramebuffer)
+		return get_default_framebuffer();
+	return lookup(replay, replay->framebuffers, name);
+}
+
+INTERNAL inline
+GLint lookup_location(Replay* replay, i32 location) {
+	if (location < 0)
+		return -1;
+	std::unordered_map<u64, GLint>::iterator it = replay->locations.find(((u64)replay->program << 32) | (u32)location);
+	return it == replay->locations.end() ? location : it->second;
+}
+
+INTERNAL inline
+void generate(ReplayReader* reader, NameMap& names, void (APIENTRYP gen)(GLsizei, GLuint*)) {
+	i32 n = read_i32(reader);
+	for (i32 i = 0; i < n; ++i) {
+		GLuint name;
+		gen(1, &name);
+		names[read_u32(reader)] = name;
+	}
+}
+
+INTERNAL inline
+void destroy(Replay* replay, ReplayReader* reader, NameMap& names, void (APIENTRYP del)(GLsizei, const GLuint*)) {
+	i32 n = read_i32(reader);
+	for (i32 i = 0; i < n; ++i) {
+		u32 captured = read_u32(reader);
+		GLuint name = lookup(replay, names, captured);
+		del(1, &name);
+		names.erase(captured);
+	}
+}
+
+//image data is in the capture, or an offset into the bound pixel unpack buffer
+INTERNAL inline
+const void* read_pixels(ReplayReader* reader) {
+	u32 source = read_u32(reader);
+	if (source == 1)
+		return read_memory(reader);
+	if (source == 2)
+		return (const void*)(uintptr_t)read_u64(reader);
+	return NULL;
+}
+
+//==========================================================================================
+//Description: Executes one record. Arguments are read in the order gl_capture.cpp wrote them
+//==========================================================================================
+INTERNAL
+void execute(Replay* replay, u16 call, ReplayReader* reader) {
+	switch (call) {
+	case CAPTURE_ACTIVE_TEXTURE: glActiveTexture(read_u32(reader)); break;
+	case CAPTURE_ATTACH_SHADER: {
+		GLuint program = lookup(replay, replay->programs, read_u32(reader));
+		glAttachShader(program, lookup(replay, replay->shaders, read_u32(reader)));
+	} break;
+	case CAPTURE_BIND_ATTRIB_LOCATION: {
+		GLuint program = lookup(replay, replay->programs, read_u32(reader));
+		u32 index = read_u32(reader);
+		glBindAttribLocation(program, index, read_string(reader).c_str());
+	} break;
+	case CAPTURE_BIND_BUFFER: {
+		GLenum target = read_u32(reader);
+		glBindBuffer(target, lookup(replay, replay->buffers, read_u32(reader)));
+	} break;
+	case CAPTURE_BIND_FRAG_DATA_LOCATION: {
+		GLuint program = lookup(replay, replay->programs, read_u32(reader));
+		u32 color = read_u32(reader);
+		glBindFragDataLocation(program, color, read_string(reader).c_str());
+	} break;
+	case CAPTURE_BIND_FRAMEBUFFER: {
+		GLenum target = read_u32(reader);
+		glBindFramebuffer(target, lookup_framebuffer(replay, read_u32(reader)));
+	} break;
+	case CAPTURE_BIND_RENDERBUFFER: {
+		GLenum target = read_u32(reader);
+		glBindRenderbuffer(target, lookup(replay, replay->renderbuffers, read_u32(reader)));
+	} break;
+	case CAPTURE_BIND_TEXTURE: {
+		GLenum target = read_u32(reader);
+		glBindTexture(target, lookup(replay, replay->textures, read_u32(reader)));
+	} break;
+	case CAPTURE_BIND_VERTEX_ARRAY: glBindVertexArray(lookup(replay, replay->vertexArrays, read_u32(reader))); break;
+	case CAPTURE_BLEND_FUNC: {
+		GLenum source = read_u32(reader);
+		glBlendFunc(source, read_u32(reader));
+	} break;
+	case CAPTURE_BLIT_FRAMEBUFFER: {
+		i32 v[8];
+		for (u32 i = 0; i < 8; ++i)
+			v[i] = read_i32(reader);
+		GLbitfield mask = read_u32(reader);
+		glBlitFramebuffer(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], mask, read_u32(reader));
+	} break;
+	case CAPTURE_BUFFER_DATA: {
+		GLenum target = read_u32(reader);
+		u64 size = read_u64(reader);
+		GLenum usage = read_u32(reader);
+		const void* data = read_u32(reader) ? read_memory(reader) : NULL;
+		glBufferData(target, size, data, usage);
+	} break;
+	case CAPTURE_CHECK_FRAMEBUFFER_STATUS: glCheckFramebufferStatus(read_u32(reader)); break;
+	case CAPTURE_CLEAR: glClear(read_u32(reader)); break;
+	case CAPTURE_CLEAR_COLOR: {
+		f32 c[4];
+		for (u32 i = 0; i < 4; ++i)
+			c[i] = read_f32(reader);
+		glClearColor(c[0], c[1], c[2], c[3]);
+	} break;
+	case CAPTURE_CLIENT_WAIT_SYNC: {
+		u64 sync = read_u64(reader);
+		GLbitfield flags = read_u32(reader);
+		u64 timeout = read_u64(reader);
+		if (replay->syncs.count(sync))
+			glClientWaitSync(replay->syncs[sync], flags, timeout);
+	} break;
+	case CAPTURE_COLOR_MASK: {
+		u32 c[4];
+		for (u32 i = 0; i < 4; ++i)
+			c[i] = read_u32(reader);
+		glColorMask(c[0], c[1], c[2], c[3]);
+	} break;
+	case CAPTURE_COMPILE_SHADER: glCompileShader(lookup(replay, replay->shaders, read_u32(reader))); break;
+	case CAPTURE_CREATE_PROGRAM: replay->programs[read_u32(reader)] = glCreateProgram(); break;
+	case CAPTURE_CREATE_SHADER: {
+		GLenum type = read_u32(reader);
+		replay->shaders[read_u32(reader)] = glCreateShader(type);
+	} break;
+	case CAPTURE_CULL_FACE: glCullFace(read_u32(reader)); break;
+	case CAPTURE_DELETE_BUFFERS: destroy(replay, reader, replay->buffers, glDeleteBuffers); break;
+	case CAPTURE_DELETE_FRAMEBUFFERS: destroy(replay, reader, replay->framebuffers, glDeleteFramebuffers); break;
+	case CAPTURE_DELETE_PROGRAM: {
+		u32 program = read_u32(reader);
+		glDeleteProgram(lookup(replay, replay->programs, program));
+		replay->programs.erase(program);
+	} break;
+	case CAPTURE_DELETE_QUERIES: destroy(replay, reader, replay->queries, glDeleteQueries); break;
+	case CAPTURE_DELETE_RENDERBUFFERS: destroy(replay, reader, replay->renderbuffers, glDeleteRenderbuffers); break;
+	case CAPTURE_DELETE_SHADER: {
+		u32 shader = read_u32(reader);
+		glDeleteShader(lookup(replay, replay->shaders, shader));
+		replay->shaders.erase(shader);
+	} break;
+	case CAPTURE_DELETE_SYNC: {
+		u64 sync = read_u64(reader);
+		if (replay->syncs.count(sync)) {
+			glDeleteSync(replay->syncs[sync]);
+			replay->syncs.erase(sync);
+		}
+	} break;
+	case CAPTURE_DELETE_TEXTURES: destroy(replay, reader, replay->textures, glDeleteTextures); break;
+	case CAPTURE_DELETE_VERTEX_ARRAYS: destroy(replay, reader, replay->vertexArrays, glDeleteVertexArrays); break;
+	case CAPTURE_DEPTH_FUNC: glDepthFunc(read_u32(reader)); break;
+	case CAPTURE_DEPTH_MASK: glDepthMask(read_u32(reader)); break;
+	case CAPTURE_DISABLE: glDisable(read_u32(reader)); break;
+	case CAPTURE_DISABLE_VERTEX_ATTRIB_ARRAY: glDisableVertexAttribArray(read_u32(reader)); break;
+	case CAPTURE_DRAW_ARRAYS: {
+		GLenum mode = read_u32(reader);
+		i32 first = read_i32(reader);
+		glDrawArrays(mode, first, read_i32(reader));
+	} break;
+	case CAPTURE_DRAW_ARRAYS_INSTANCED: {
+		GLenum mode = read_u32(reader);
+		i32 first = read_i32(reader);
+		i32 count = read_i32(reader);
+		glDrawArraysInstanced(mode, first, count, read_i32(reader));
+	} break;
+	case CAPTURE_DRAW_BUFFER: glDrawBuffer(read_u32(reader)); break;
+	case CAPTURE_DRAW_ELEMENTS: {
+		GLenum mode = read_u32(reader);
+		i32 count = read_i32(reader);
+		GLenum type = read_u32(reader);
+		glDrawElements(mode, count, type, (const void*)(uintptr_t)read_u64(reader));
+	} break;
+	case CAPTURE_DRAW_ELEMENTS_INSTANCED: {
+		GLenum mode = read_u32(reader);
+		i32 count = read_i32(reader);
+		GLenum type = read_u32(reader);
+		const void* indices = (const void*)(uintptr_t)read_u64(reader);
+		glDrawElementsInstanced(mode, count, type, indices, read_i32(reader));
+	} break;
+	case CAPTURE_ENABLE: glEnable(read_u32(reader)); break;
+	case CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY: glEnableVertexAttribArray(read_u32(reader)); break;
+	case CAPTURE_FENCE_SYNC: {
+		GLenum condition = read_u32(reader);
+		GLbitfield flags = read_u32(reader);
+		replay->syncs[read_u64(reader)] = glFenceSync(condition, flags);
+	} break;
+	case CAPTURE_FRAMEBUFFER_RENDERBUFFER: {
+		GLenum target = read_u32(reader);
+		GLenum attachment = read_u32(reader);
+		GLenum renderbufferTarget = read_u32(reader);
+		glFramebufferRenderbuffer(target, attachment, renderbufferTarget, lookup(replay, replay->renderbuffers, read_u32(reader)));
+	} break;
+	case CAPTURE_FRAMEBUFFER_TEXTURE_2D: {
+		GLenum target = read_u32(reader);
+		GLenum attachment = read_u32(reader);
+		GLenum textureTarget = read_u32(reader);
+		GLuint texture = lookup(replay, replay->textures, read_u32(reader));
+		glFramebufferTexture2D(target, attachment, textureTarget, texture, read_i32(reader));
+	} break;
+	case CAPTURE_FRAMEBUFFER_TEXTURE_LAYER: {
+		GLenum target = read_u32(reader);
+		GLenum attachment = read_u32(reader);
+		GLuint texture = lookup(replay, replay->textures, read_u32(reader));
+		i32 level = read_i32(reader);
+		glFramebufferTextureLayer(target, attachment, texture, level, read_i32(reader));
+	} break;
+	case CAPTURE_GEN_BUFFERS: generate(reader, replay->buffers, glGenBuffers); break;
+	case CAPTURE_GEN_FRAMEBUFFERS: generate(reader, replay->framebuffers, glGenFramebuffers); break;
+	case CAPTURE_GEN_QUERIES: generate(reader, replay->queries, glGenQueries); break;
+	case CAPTURE_GEN_RENDERBUFFERS: generate(reader, replay->renderbuffers, glGenRenderbuffers); break;
+	case CAPTURE_GEN_TEXTURES: generate(reader, replay->textures, glGenTextures); break;
+	case CAPTURE_GEN_VERTEX_ARRAYS: generate(reader, replay->vertexArrays, glGenVertexArrays); break;
+	case CAPTURE_GENERATE_MIPMAP: glGenerateMipmap(read_u32(reader)); break;
+	case CAPTURE_GET_QUERY_OBJECT_IV: {
+		GLuint query = lookup(replay, replay->queries, read_u32(reader));
+		GLint result;
+		glGetQueryObjectiv(query, read_u32(reader), &result);
+	} break;
+	case CAPTURE_GET_QUERY_OBJECT_UI64V: {
+		GLuint query = lookup(replay, replay->queries, read_u32(reader));
+		GLuint64 result;
+		glGetQueryObjectui64v(query, read_u32(reader), &result);
+	} break;
+	case CAPTURE_GET_UNIFORM_LOCATION: {
+		u32 program = read_u32(reader);
+		std::string name = read_string(reader);
+		i32 location = read_i32(reader);
+		GLint replayed = glGetUniformLocation(lookup(replay, replay->programs, program), name.c_str());
+		if (location >= 0)
+			replay->locations[((u64)program << 32) | (u32)location] = replayed;
+	} break;
+	case CAPTURE_LINK_PROGRAM: glLinkProgram(lookup(replay, replay->programs, read_u32(reader))); break;
+	case CAPTURE_MAP_BUFFER_RANGE: {
+		GLenum target = read_u32(reader);
+		u64 offset = read_u64(reader);
+		u64 length = read_u64(reader);
+		replay->mapped[target] = (u8*)glMapBufferRange(target, offset, length, read_u32(reader));
+	} break;
+	case CAPTURE_QUERY_COUNTER: {
+		GLuint query = lookup(replay, replay->queries, read_u32(reader));
+		glQueryCounter(query, read_u32(reader));
+	} break;
+	case CAPTURE_READ_BUFFER: glReadBuffer(read_u32(reader)); break;
+	case CAPTURE_READ_PIXELS: {
+		i32 x = read_i32(reader), y = read_i32(reader), width = read_i32(reader), height = read_i32(reader);
+		GLenum format = read_u32(reader);
+		GLenum type = read_u32(reader);
+		u32 packBuffer = read_u32(reader);
+		u64 pointer = read_u64(reader);
+		if (packBuffer) {
+			glReadPixels(x, y, width, height, format, type, (void*)(uintptr_t)pointer);
+		}
+		else {
+			replay->scratch.resize(gl_capture_pixel_bytes(format, type, width, height, 1));
+			glReadPixels(x, y, width, height, format, type, &replay->scratch[0]);
+		}
+	} break;
+	case CAPTURE_RENDERBUFFER_STORAGE: {
+		GLenum target = read_u32(reader);
+		GLenum format = read_u32(reader);
+		i32 width = read_i32(reader);
+		glRenderbufferStorage(target, format, width, read_i32(reader));
+	} break;
+	case CAPTURE_RENDERBUFFER_STORAGE_MULTISAMPLE: {
+		GLenum target = read_u32(reader);
+		i32 samples = read_i32(reader);
+		GLenum format = read_u32(reader);
+		i32 width = read_i32(reader);
+		glRenderbufferStorageMultisample(target, samples, format, width, read_i32(reader));
+	} break;
+	case CAPTURE_SHADER_SOURCE: {
+		GLuint shader = lookup(replay, replay->shaders, read_u32(reader));
+		u64 length;
+		const GLchar* source = (const GLchar*)read_memory(reader, &length);
+		GLint sourceLength = (GLint)length;
+		glShaderSource(shader, 1, &source, &sourceLength);
+	} break;
+	case CAPTURE_TEX_BUFFER: {
+		GLenum target = read_u32(reader);
+		GLenum format = read_u32(reader);
+		glTexBuffer(target, format, lookup(replay, replay->buffers, read_u32(reader)));
+	} break;
+	case CAPTURE_TEX_IMAGE_2D: {
+		GLenum target = read_u32(reader);
+		i32 level = read_i32(reader), internalFormat = read_i32(reader);
+		i32 width = read_i32(reader), height = read_i32(reader), border = read_i32(reader);
+		GLenum format = read_u32(reader);
+		GLenum type = read_u32(reader);
+		glTexImage2D(target, level, internalFormat, width, height, border, format, type, read_pixels(reader));
+	} break;
+	case CAPTURE_TEX_IMAGE_3D: {
+		GLenum target = read_u32(reader);
+		i32 level = read_i32(reader), internalFormat = read_i32(reader);
+		i32 width = read_i32(reader), height = read_i32(reader), depth = read_i32(reader), border = read_i32(reader);
+		GLenum format = read_u32(reader);
+		GLenum type = read_u32(reader);
+		glTexImage3D(target, level, internalFormat, width, height, depth, border, format, type, read_pixels(reader));
+	} break;
+	case CAPTURE_TEX_PARAMETER_I: {
+		GLenum target = read_u32(reader);
+		GLenum name = read_u32(reader);
+		glTexParameteri(target, name, read_i32(reader));
+	} break;
+	case CAPTURE_TEX_PARAMETER_FV: {
+		GLenum target = read_u32(reader);
+		GLenum name = read_u32(reader);
+		GLfloat values[4] = { 0, 0, 0, 0 };
+		u64 size;
+		const void* data = read_memory(reader, &size);
+		memcpy(values, data, size < sizeof(values) ? size : sizeof(values));
+		glTexParameterfv(target, name, values);
+	} break;
+	case CAPTURE_TEX_SUB_IMAGE_2D: {
+		GLenum target = read_u32(reader);
+		i32 level = read_i32(reader);
+		i32 x = read_i32(reader), y = read_i32(reader), width = read_i32(reader), height = read_i32(reader);
+		GLenum format = read_u32(reader);
+		GLenum type = read_u32(reader);
+		glTexSubImage2D(target, level, x, y, width, height, format, type, read_pixels(reader));
+	} break;
+	case CAPTURE_UNIFORM_1F: case CAPTURE_UNIFORM_2F: case CAPTURE_UNIFORM_3F: case CAPTURE_UNIFORM_4F:
+	case CAPTURE_UNIFORM_1I: case CAPTURE_UNIFORM_1IV: case CAPTURE_UNIFORM_1FV: case CAPTURE_UNIFORM_MATRIX_4FV: {
+		GLint location = lookup_location(replay, read_i32(reader));
+		i32 count = read_i32(reader);
+		u32 transpose = read_u32(reader);
+		const void* data = read_memory(reader);
+		const GLfloat* f = (const GLfloat*)data;
+		const GLint* i = (const GLint*)data;
+		switch (call) {
+		case CAPTURE_UNIFORM_1F: glUniform1f(location, f[0]); break;
+		case CAPTURE_UNIFORM_2F: glUniform2f(location, f[0], f[1]); break;
+		case CAPTURE_UNIFORM_3F: glUniform3f(location, f[0], f[1], f[2]); break;
+		case CAPTURE_UNIFORM_4F: glUniform4f(location, f[0], f[1], f[2], f[3]); break;
+		case CAPTURE_UNIFORM_1I: glUniform1i(location, i[0]); break;
+		case CAPTURE_UNIFORM_1IV: glUniform1iv(location, count, i); break;
+		case CAPTURE_UNIFORM_1FV: glUniform1fv(location, count, f); break;
+		case CAPTURE_UNIFORM_MATRIX_4FV: glUniformMatrix4fv(location, count, transpose, f); break;
+		}
+	} break;
+	case CAPTURE_UNMAP_BUFFER: {
+		GLenum target = read_u32(reader);
+		u64 size;
+		const void* data = read_memory(reader, &size);
+		if (replay->mapped[target])
+			memcpy(replay->mapped[target], data, size);
+		replay->mapped[target] = NULL;
+		glUnmapBuffer(target);
+	} break;
+	case CAPTURE_USE_PROGRAM: {
+		replay->program = read_u32(reader);
+		glUseProgram(lookup(replay, replay->programs, replay->program));
+	} break;
+	case CAPTURE_VALIDATE_PROGRAM: glValidateProgram(lookup(replay, replay->programs, read_u32(reader))); break;
+	case CAPTURE_VERTEX_ATTRIB_DIVISOR: {
+		u32 index = read_u32(reader);
+		glVertexAttribDivisor(index, read_u32(reader));
+	} break;
+	case CAPTURE_VERTEX_ATTRIB_I_POINTER: {
+		u32 index = read_u32(reader);
+		i32 size = read_i32(reader);
+		GLenum type = read_u32(reader);
+		i32 stride = read_i32(reader);
+		glVertexAttribIPointer(index, size, type, stride, (const void*)(uintptr_t)read_u64(reader));
+	} break;
+	case CAPTURE_VERTEX_ATTRIB_POINTER: {
+		u32 index = read_u32(reader);
+		i32 size = read_i32(reader);
+		GLenum type = read_u32(reader);
+		u32 normalized = read_u32(reader);
+		i32 stride = read_i32(reader);
+		glVertexAttribPointer(index, size, type, normalized, stride, (const void*)(uintptr_t)read_u64(reader));
+	} break;
+	case CAPTURE_VIEWPORT: {
+		i32 x = read_i32(reader), y = read_i32(reader), width = read_i32(reader);
+		glViewport(x, y, width, read_i32(reader));
+	} break;
+	case CAPTURE_BUFFER_SUB_DATA: {
+		GLenum target = read_u32(reader);
+		u64 offset = read_u64(reader);
+		u64 size;
+		const void* data = read_memory(reader, &size);
+		glBufferSubData(target, offset, size, data);
+	} break;
+	}
+}
+
+INTERNAL
+bool load_capture(const char* path, std::vector<u8>* file) {
+	FILE* input = fopen(path, "rb");
+	if (input == NULL)
+		return false;
+	fseek(input, 0, SEEK_END);
+	long size = ftell(input);
+	fseek(input, 0, SEEK_SET);
+	file->resize(size > 0 ? size : 0);
+	bool read = size > 0 && fread(&(*file)[0], 1, size, input) == (size_t)size;
+	fclose(input);
+	return read;
+}
+
+INTERNAL
+bool compare_calls(const std::pair<u32, CallStats>& a, const std::pair<u32, CallStats>& b) {
+	return a.second.totalMs > b.second.totalMs;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		printf("usage: gl_replay capture.bin [--loops N] [--sync] [--csv calls.csv] [--top N]\n");
+		return 1;
+	}
+	const char* path = argv[1];
+	u32 loops = 1;
+	u32 top = 20;
+	bool sync = false;
+	const char* csvPath = NULL;
+	for (int i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc)
+			loops = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+			top = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			csvPath = argv[++i];
+		else if (strcmp(argv[i], "--sync") == 0)
+			sync = true;
+	}
+
+	std::vector<u8> file;
+	if (!load_capture(path, &file) || file.size() < sizeof(GLCaptureHeader)) {
+		BMT_LOG(FATAL_ERROR, "Could not read the capture %s", path);
+		return 1;
+	}
+	GLCaptureHeader header;
+	memcpy(&header, &file[0], sizeof(header));
+	if (header.magic != GL_CAPTURE_MAGIC || header.version != GL_CAPTURE_VERSION ||
+		sizeof(header) + header.setupBytes + header.frameBytes > file.size()) {
+		BMT_LOG(FATAL_ERROR, "%s is not a version %d GL capture", path, GL_CAPTURE_VERSION);
+		return 1;
+	}
+
+	//the replay wants no display, EGL is only there on Linux so elsewhere it gets a window
+#if defined(__linux__)
+	init_window(header.width, header.height, "gl_replay", false, false, false, WINDOW_BACKEND_HEADLESS);
+#else
+	init_window(header.width, header.height, "gl_replay", false, false, false, WINDOW_BACKEND_GLFW);
+#endif
+	set_vsync(false);
+	BMT_LOG(INFO, "Replaying %s: %d frame(s), %.1f MB setup, %.1f MB of frames", path, header.frames,
+		header.setupBytes / (1024.0 * 1024.0), header.frameBytes / (1024.0 * 1024.0));
+
+	Replay replay;
+	replay.defaultFramebuffer = header.defaultFramebuffer;
+	replay.program = 0;
+	replay.unknownNames = 0;
+
+	const u8* setup = &file[sizeof(header)];
+	ReplayReader reader = { setup, setup + header.setupBytes };
+	std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now();
+	while (reader.at + sizeof(GLCaptureRecord) <= reader.end) {
+		GLCaptureRecord record;
+		read_bytes(&reader, &record, sizeof(record));
+		ReplayReader arguments = { reader.at, reader.at + record.size };
+		execute(&replay, record.call, &arguments);
+		reader.at += record.size;
+	}
+	glFinish();
+	BMT_LOG(INFO, "Setup took %.1f ms", std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - setupStart).count());
+
+	std::vector<CallStats> calls(CAPTURE_CALL_COUNT);
+	memset(&calls[0], 0, sizeof(CallStats) * CAPTURE_CALL_COUNT);
+	FILE* csv = csvPath ? fopen(csvPath, "w") : NULL;
+	if (csv)
+		fprintf(csv, "loop,frame,index,call,ms\n");
+
+	GLuint timestamps[2];
+	glGenQueries(2, timestamps);
+	std::vector<f64> cpuFrames, gpuFrames;
+	const u8* frames = setup + header.setupBytes;
+	for (u32 loop = 0; loop < loops; ++loop) {
+		reader.at = frames;
+		reader.end = frames + header.frameBytes;
+		u32 frame = 0, index = 0;
+		f64 frameMs = 0.0;
+		glQueryCounter(timestamps[0], GL_TIMESTAMP);
+		while (reader.at + sizeof(GLCaptureRecord) <= reader.end) {
+			GLCaptureRecord record;
+			read_bytes(&reader, &record, sizeof(record));
+			ReplayReader arguments = { reader.at, reader.at + record.size };
+			reader.at += record.size;
+
+			if (record.call == CAPTURE_FRAME_END) {
+				glQueryCounter(timestamps[1], GL_TIMESTAMP);
+				GLuint64 begin = 0, end = 0;
+				glGetQueryObjectui64v(timestamps[0], GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(timestamps[1], GL_QUERY_RESULT, &end);
+				GLuint64 gpuTime = end > begin ? end - begin : 0;
+				cpuFrames.push_back(frameMs);
+				gpuFrames.push_back(gpuTime / 1000000.0);
+				BMT_LOG(INFO, "loop %d frame %d: %d calls, CPU %.3f ms, GPU %.3f ms", loop, frame, index, frameMs, gpuTime / 1000000.0);
+				frame++;
+				index = 0;
+				frameMs = 0.0;
+				glQueryCounter(timestamps[0], GL_TIMESTAMP);
+				continue;
+			}
+			if (record.call >= CAPTURE_CALL_COUNT)
+				continue;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			execute(&replay, record.call, &arguments);
+			if (sync)
+				glFinish();
+			f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			CallStats* stats = &calls[record.call];
+			stats->count++;
+			stats->totalMs += ms;
+			stats->maxMs = ms > stats->maxMs ? ms : stats->maxMs;
+			frameMs += ms;
+			if (csv)
+				fprintf(csv, "%d,%d,%d,%s,%.6f\n", loop, frame, index, GL_CAPTURE_CALL_NAMES[record.call], ms);
+			index++;
+		}
+	}
+	if (csv)
+		fclose(csv);
+
+	std::vector<std::pair<u32, CallStats> > sorted;
+	for (u32 i = 0; i < CAPTURE_CALL_COUNT; ++i)
+		if (calls[i].count)
+			sorted.push_back(std::make_pair(i, calls[i]));
+	std::sort(sorted.begin(), sorted.end(), compare_calls);
+
+	BMT_LOG(INFO, "%s on %s, %s", glGetString(GL_VERSION), glGetString(GL_RENDERER), sync ? "synchronous" : "pipelined");
+	BMT_LOG(INFO, "%-34s %8s %10s %10s %10s", "call", "count", "total ms", "mean us", "max us");
+	for (u32 i = 0; i < sorted.size() && i < top; ++i) {
+		CallStats* stats = &sorted[i].second;
+		BMT_LOG(INFO, "%-34s %8llu %10.3f %10.2f %10.2f", GL_CAPTURE_CALL_NAMES[sorted[i].first], (unsigned long long)stats->count,
+			stats->totalMs, stats->totalMs * 1000.0 / stats->count, stats->maxMs * 1000.0);
+	}
+	if (!cpuFrames.empty()) {
+		f64 cpu = 0.0, gpu = 0.0;
+		for (u32 i = 0; i < cpuFrames.size(); ++i) {
+			cpu += cpuFrames[i];
+			gpu += gpuFrames[i];
+		}
+		BMT_LOG(INFO, "%d frame(s), mean CPU %.3f ms, mean GPU %.3f ms", (int)cpuFrames.size(), cpu / cpuFrames.size(), gpu / gpuFrames.size());
+	}
+	if (replay.unknownNames)
+		BMT_LOG(WARNING, "%d references to objects the capture never created, made before the layer was installed", replay.unknownNames);
+
+	glDeleteQueries(2, timestamps);
+	dispose_window();
+	return 0;
+}
@@ -0,0 +1,7 @@
+@echo off
+
+mkdir ..\build
+pushd ..\build
+cls
+cl /EHsc -I..\include ..\tools\gl_replay.cpp ..\ENGINE\window.cpp ..\ENGINE\gl_capture.cpp ..\ENGINE\glad.c ..\libs\*.lib msvcrt.lib shell32.lib user32.lib gdi32.lib opengl32.lib
+popd
@@ -0,0 +1,8 @@
+#!/bin/sh
+#Linux build of the replay tool, it replays on EGL without a display
+
+mkdir -p ../build
+cd ../build
+gcc -c -I../include ../engine/glad.c -o glad.o
+g++ -std=c++17 -O2 -I../include ../tools/gl_replay.cpp ../engine/window.cpp ../engine/gl_capture.cpp glad.o -lglfw -lEGL -lGL -ldl -lpthread -o gl_replay
+cd ../tools
@@ -0,0 +1,350 @@
+#ifndef VERTEX_ANIMATION_H
+#define VERTEX_ANIMATION_H
+
+#include "animation.h"
+#include <stdio.h>
+
+//Vertex animation textures for crowds too big to skin.
+//
+//Every clip of a skinned model is played through once, the mesh is skinned on the
+//CPU at every frame and the deformed positions and normals are written into two
+//texture arrays, one layer per clip:
+//		x = vertex % width,  y = frame * rows + vertex / width
+//vat.vert finds its texels from gl_VertexID and blends the two frames around its
+//time, so an instance is nothing but a position, heading, scale, clip and time
+//offset. All meshes are merged with their material colour per vertex, which lets
+//a whole crowd, every clip mixed, go out in one instanced draw.
+//
+//Baking can happen at load time, or once offline with save_vertex_animation, after
+//which load_vertex_animation only has to read the file.
+//
+//		VertexAnimation crowd = bake_vertex_animation(&pirate);
+//		init_vertex_animation(&crowd);
+//		draw_vertex_animation(vat, &crowd, &instances[0], instances.size(), time);
+
+#define VAT_MAX_WIDTH      1024
+#define VAT_MAX_CLIPS      8
+#define VAT_FILE_VERSION   1
+
+struct VertexAnimationClip {
+    char name[32];
+    u32 frameCount;
+    f32 duration;
+};
+
+struct VertexAnimationInstance {
+    vec3 position;
+    f32 heading;
+    f32 scale;
+    f32 clip;
+    f32 timeOffset;
+    f32 speed;
+};
+
+struct VertexAnimation {
+    u32 vertexCount;
+    u32 width;
+    u32 rows;
+    u32 maxFrames;
+    std::vector<VertexAnimationClip> clips;
+    std::vector<vec4> colors;
+    std::vector<u32> indices;
+    //[clip][frame * rows + row][column], every layer padded to maxFrames
+    std::vector<vec4> positions;
+    std::vector<vec4> normals;
+
+    GLuint vao;
+    GLuint colorBuffer;
+    GLuint ebo;
+    GLuint instanceBuffer;
+    GLuint positionTexture;
+    GLuint normalTexture;
+};
+
+struct VertexAnimationBake {
+    const SkinnedModel* skinned;
+    VertexAnimation* animation;
+    u32 clip;
+};
+
+//skins the whole mesh for a range of frames of one clip
+static inline
+void bake_vertex_animation_frames(void* data, u32 begin, u32 end) {
+    VertexAnimationBake* bake = (VertexAnimationBake*)data;
+    const SkinnedModel* skinned = bake->skinned;
+    VertexAnimation* animation = bake->animation;
+
+    AnimationInstance instance;
+    instance.skinned = skinned;
+    instance.clip = instance.blendClip = bake->clip;
+    instance.blendTime = instance.blendWeight = 0.0f;
+    instance.speed = 1.0f;
+    instance.boneOffset = 0;
+    mat4 palette[MAX_BONES];
+
+    for(u32 f = begin; f < end; ++f) {
+        instance.time = f / ANIMATION_SAMPLE_RATE;
+        pose_animation_instance(&instance, palette);
+        u32 layer = (bake->clip * animation->maxFrames + f) * animation->rows * animation->width;
+        for(u32 v = 0; v < animation->vertexCount; ++v) {
+            const u8* bones = &skinned->bindBones[v * 8];
+            mat4 skin = {0};
+            for(u32 i = 0; i < 4; ++i) {
+                f32 weight = bones[4 + i] / 255.0f;
+                for(u32 e = 0; e < 16; ++e)
+                    skin.elements[e] += palette[bones[i]].elements[e] * weight;
+            }
+            vec3 p = skinned->bindVertices[v].position;
+            vec3 n = skinned->bindVertices[v].normal;
+            const f32* m = skin.elements;
+            vec3 position = V3(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+                               m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                               m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+            vec3 normal = normalize(V3(m[0] * n.x + m[4] * n.y + m[8] * n.z,
+                                       m[1] * n.x + m[5] * n.y + m[9] * n.z,
+                                       m[2] * n.x + m[6] * n.y + m[10] * n.z));
+            animation->positions[layer + v] = V4(position.x, position.y, position.z, 1.0f);
+            animation->normals[layer + v] = V4(normal.x, normal.y, normal.z, 0.0f);
+        }
+    }
+}
+
+//==========================================================================================
+//Description: Plays every clip of a skinned model and records the deformed mesh
+//
+//Comments: CPU only, the frames of each clip are baked across the job system. The model
+//          has to come from load_skinned_model, which keeps the bind pose around.
+//==========================================================================================
+static inline
+VertexAnimation bake_vertex_animation(const SkinnedModel* skinned) {
+    BMT_PROFILE_FUNCTION();
+    VertexAnimation animation;
+    animation.vao = animation.colorBuffer = animation.ebo = animation.instanceBuffer = 0;
+    animation.positionTexture = animation.normalTexture = 0;
+    animation.vertexCount = skinned->bindVertices.size();
+    animation.width = animation.vertexCount < VAT_MAX_WIDTH ? animation.vertexCount : VAT_MAX_WIDTH;
+    animation.rows = animation.width ? (animation.vertexCount + animation.width - 1) / animation.width : 0;
+    animation.colors = skinned->bindColors;
+    animation.indices = skinned->bindIndices;
+    animation.maxFrames = 0;
+
+    u32 clipCount = skinned->clips.size() < VAT_MAX_CLIPS ? skinned->clips.size() : VAT_MAX_CLIPS;
+    if(animation.vertexCount == 0 || clipCount == 0 || skinned->skeleton.boneCount == 0) {
+        BMT_LOG(WARNING, "Nothing to bake, the model has no vertices, clips or bones");
+        return animation;
+    }
+    for(u32 c = 0; c < clipCount; ++c) {
+        VertexAnimationClip clip = {0};
+        snprintf(clip.name, sizeof(clip.name), "%s", skinned->clips[c].name.c_str());
+        clip.frameCount = skinned->clips[c].frameCount;
+        clip.duration = skinned->clips[c].duration;
+        animation.clips.push_back(clip);
+        animation.maxFrames = clip.frameCount > animation.maxFrames ? clip.frameCount : animation.maxFrames;
+    }
+
+    u32 texels = clipCount * animation.maxFrames * animation.rows * animation.width;
+    animation.positions.resize(texels, V4(0, 0, 0, 1));
+    animation.normals.resize(texels, V4(0, 1, 0, 0));
+    for(u32 c = 0; c < clipCount; ++c) {
+        VertexAnimationBake bake = { skinned, &animation, c };
+        parallel_for(animation.clips[c].frameCount, 4, bake_vertex_animation_frames, &bake);
+    }
+    BMT_LOG(INFO, "Baked %d clips of %d vertices, %d KB of textures", clipCount, animation.vertexCount, (u32)(texels * 2 * sizeof(vec4) / 1024));
+    return animation;
+}
+
+//Writes the baked data so it can be loaded without the skinned model
+static inline
+bool save_vertex_animation(const VertexAnimation* animation, const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if(file == NULL) {
+        BMT_LOG(MINOR_ERROR, "[%s] Could not write vertex animation", filename);
+        return false;
+    }
+    u32 header[] = { 0x54415642, VAT_FILE_VERSION, animation->vertexCount, animation->width, animation->rows,
+        animation->maxFrames, (u32)animation->clips.size(), (u32)animation->indices.size() };
+    fwrite(header, sizeof(header), 1, file);
+    fwrite(&animation->clips[0], sizeof(VertexAnimationClip), animation->clips.size(), file);
+    fwrite(&animation->colors[0], sizeof(vec4), animation->colors.size(), file);
+    fwrite(&animation->indices[0], sizeof(u32), animation->indices.size(), file);
+    fwrite(&animation->positions[0], sizeof(vec4), animation->positions.size(), file);
+    fwrite(&animation->normals[0], sizeof(vec4), animation->normals.size(), file);
+    fclose(file);
+    return true;
+}
+
+static inline
+VertexAnimation load_vertex_animation(const char* filename) {
+    BMT_PROFILE_FUNCTION();
+    VertexAnimation animation;
+    animation.vertexCount = animation.width = animation.rows = animation.maxFrames = 0;
+    animation.vao = animation.colorBuffer = animation.ebo = animation.instanceBuffer = 0;
+    animation.positionTexture = animation.normalTexture = 0;
+
+    FILE* file = fopen(filename, "rb");
+    if(file == NULL) {
+        BMT_LOG(MINOR_ERROR, "[%s] Could not open vertex animation", filename);
+        return animation;
+    }
+    u32 header[8];
+    if(fread(header, sizeof(header), 1, file) != 1 || header[0] != 0x54415642 || header[1] != VAT_FILE_VERSION) {
+        BMT_LOG(MINOR_ERROR, "[%s] Not a vertex animation file of version %d", filename, VAT_FILE_VERSION);
+        fclose(file);
+        return animation;
+    }
+    animation.vertexCount = header[2];
+    animation.width = header[3];
+    animation.rows = header[4];
+    animation.maxFrames = header[5];
+    animation.clips.resize(header[6]);
+    animation.indices.resize(header[7]);
+    animation.colors.resize(animation.vertexCount);
+    u32 texels = header[6] * animation.maxFrames * animation.rows * animation.width;
+    animation.positions.resize(texels);
+    animation.normals.resize(texels);
+
+    bool complete = fread(&animation.clips[0], sizeof(VertexAnimationClip), animation.clips.size(), file) == animation.clips.size()
+        && fread(&animation.colors[0], sizeof(vec4), animation.colors.size(), file) == animation.colors.size()
+        && fread(&animation.indices[0], sizeof(u32), animation.indices.size(), file) == animation.indices.size()
+        && fread(&animation.positions[0], sizeof(vec4), texels, file) == texels
+        && fread(&animation.normals[0], sizeof(vec4), texels, file) == texels;
+    fclose(file);
+    if(!complete) {
+        BMT_LOG(MINOR_ERROR, "[%s] Vertex animation file is truncated", filename);
+        animation.vertexCount = 0;
+    }
+    return animation;
+}
+
+static inline
+GLuint create_vertex_animation_texture(const VertexAnimation* animation, const std::vector<vec4>& texels) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    //half floats are plenty for a mesh a couple of units tall, and halve the bandwidth
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA16F, animation->width, animation->maxFrames * animation->rows, animation->clips.size(), 0, GL_RGBA, GL_FLOAT, &texels[0]);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+//==========================================================================================
+//Description: Uploads the baked textures and the merged mesh, and sets up instancing
+//
+//Comments: The CPU copies stay around so the animation can still be saved.
+//==========================================================================================
+static inline
+void init_vertex_animation(VertexAnimation* animation) {
+    if(animation->vertexCount == 0 || animation->clips.empty())
+        return;
+    animation->positionTexture = create_vertex_animation_texture(animation, animation->positions);
+    animation->normalTexture = create_vertex_animation_texture(animation, animation->normals);
+
+    glGenVertexArrays(1, &animation->vao);
+    glBindVertexArray(animation->vao);
+
+    //the positions come from the texture, so the only vertex attribute is the colour
+    glGenBuffers(1, &animation->colorBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, animation->colorBuffer);
+    glBufferData(GL_ARRAY_BUFFER, animation->colors.size() * sizeof(vec4), &animation->colors[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(vec4), (const GLvoid*)0);
+
+    glGenBuffers(1, &animation->instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, animation->instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(VertexAnimationInstance), NULL, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(3);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(VertexAnimationInstance), (const GLvoid*)0);                   //position, heading
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexAnimationInstance), (const GLvoid*)(4 * sizeof(GLfloat))); //scale, clip, time offset, speed
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribDivisor(4, 1);
+
+    glGenBuffers(1, &animation->ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, animation->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, animation->indices.size() * sizeof(u32), &animation->indices[0], GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+static inline
+void dispose_vertex_animation(VertexAnimation* animation) {
+    GLuint buffers[] = {animation->colorBuffer, animation->ebo, animation->instanceBuffer};
+    glDeleteBuffers(3, buffers);
+    GLuint textures[] = {animation->positionTexture, animation->normalTexture};
+    glDeleteTextures(2, textures);
+    glDeleteVertexArrays(1, &animation->vao);
+    animation->positions.clear();
+    animation->normals.clear();
+    animation->vertexCount = 0;
+}
+
+static inline
+Shader load_vertex_animation_shader() {
+    Shader shader = { 0 };
+    shader.vertexshaderID = load_shader_file("data/shaders/vat.vert", GL_VERTEX_SHADER);
+    shader.fragshaderID = load_shader_file("data/shaders/vat.frag", GL_FRAGMENT_SHADER);
+    shader.ID = glCreateProgram();
+
+    glAttachShader(shader.ID, shader.vertexshaderID);
+    glAttachShader(shader.ID, shader.fragshaderID);
+    glBindFragDataLocation(shader.ID, 0, "outColor");
+    glBindAttribLocation(shader.ID, 1, "color");
+    glBindAttribLocation(shader.ID, 3, "placement");
+    glBindAttribLocation(shader.ID, 4, "playback");
+    glLinkProgram(shader.ID);
+    glValidateProgram(shader.ID);
+
+    start_shader(shader);
+    upload_int(shader, "vatPositions", 0);
+    upload_int(shader, "vatNormals", 1);
+    glUseProgram(0);
+    return shader;
+}
+
+//==========================================================================================
+//Description: Draws every instance in one call
+//
+//Parameters:
+//		-Shader from load_vertex_animation_shader, with projection, view and lightDirection set
+//		-The baked animation
+//		-The instances, their clip has to be below the number of baked clips
+//		-Time in seconds that every instance's own offset is added to
+//==========================================================================================
+static inline
+void draw_vertex_animation(Shader shader, VertexAnimation* animation, const VertexAnimationInstance* instances, u32 count, f32 time) {
+    BMT_PROFILE_FUNCTION();
+    if(count == 0 || animation->vao == 0)
+        return;
+    glBindBuffer(GL_ARRAY_BUFFER, animation->instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(VertexAnimationInstance), instances, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    BMT_STAT_ADD(STAT_BUFFER_BYTES, count * sizeof(VertexAnimationInstance));
+
+    start_shader(shader);
+    for(u32 c = 0; c < animation->clips.size(); ++c) {
+        char name[32];
+        snprintf(name, sizeof(name), "clipFrames[%d]", c);
+        upload_float(shader, name, animation->clips[c].frameCount);
+    }
+    upload_int(shader, "vatWidth", animation->width);
+    upload_int(shader, "vatRows", animation->rows);
+    upload_float(shader, "time", time);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, animation->positionTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, animation->normalTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(animation->vao);
+    glDrawElementsInstanced(GL_TRIANGLES, animation->indices.size(), GL_UNSIGNED_INT, 0, count);
+    glBindVertexArray(0);
+    BMT_STAT_ADD(STAT_TEXTURE_BINDS, 2);
+    BMT_STAT_ADD(STAT_VERTEX_ARRAY_BINDS, 1);
+    BMT_STAT_DRAW(GL_TRIANGLES, animation->indices.size(), count);
+}
+
+#endif